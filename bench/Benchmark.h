@@ -0,0 +1,339 @@
+//
+// File: Benchmark.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <Bpp/Seq/Alphabet/Alphabet.h>
+#include <Bpp/Seq/Sequence.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+
+//From the STL:
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <ctime>
+
+#ifndef WIN32
+#include <sys/time.h>
+#endif
+
+/**
+ * @brief Wall-clock timer used by the benchmark programs.
+ */
+class BenchmarkTimer
+{
+  private:
+    double start_;
+
+  public:
+    BenchmarkTimer() : start_(now()) {}
+
+  public:
+    void reset() { start_ = now(); }
+
+    /**
+     * @return The number of seconds elapsed since creation or last reset.
+     */
+    double elapsed() const { return now() - start_; }
+
+    static double now()
+    {
+#ifdef WIN32
+      return static_cast<double>(std::clock()) / static_cast<double>(CLOCKS_PER_SEC);
+#else
+      struct timeval tv;
+      gettimeofday(&tv, 0);
+      return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) * 1e-6;
+#endif
+    }
+};
+
+/**
+ * @brief A piece of code to be timed.
+ *
+ * The setup() method is called once before the timed runs and is not
+ * accounted for in the measures.
+ */
+class BenchmarkTask
+{
+  public:
+    BenchmarkTask() {}
+    virtual ~BenchmarkTask() {}
+
+  public:
+    virtual void setup() {}
+    virtual void run() = 0;
+};
+
+/**
+ * @brief Linear congruential generator with a fixed seed.
+ *
+ * The benchmark data sets are generated with this generator rather than
+ * with RandomTools, so that they are identical from one run, platform or
+ * library version to the other.
+ */
+class BenchmarkRandom
+{
+  private:
+    unsigned long state_;
+
+  public:
+    BenchmarkRandom(unsigned long seed = 20091120) : state_(seed) {}
+
+  public:
+    unsigned long next()
+    {
+      state_ = (state_ * 1103515245UL + 12345UL) & 0x7fffffffUL;
+      return state_ >> 8;
+    }
+
+    /**
+     * @return An integer in [0, n[.
+     */
+    size_t giveIntNumber(size_t n) { return static_cast<size_t>(next() % n); }
+
+    /**
+     * @return A real number in ]0, 1[.
+     */
+    double giveRealNumber() { return (static_cast<double>(next() % 8388607UL) + 1.) / 8388608.; }
+};
+
+/**
+ * @brief Collect benchmark results and write them as JSON.
+ *
+ * The output has the form
+ * @code
+ * {
+ *   "library": "bpp-phyl",
+ *   "program": "bench_models",
+ *   "benchmarks": [
+ *     { "name": "getPij_t/GTR", "parameters": { "states": 4 },
+ *       "repetitions": 1000, "mean_seconds": 1.2e-06, "min_seconds": 1.1e-06, "max_seconds": 3.1e-06 },
+ *     ...
+ *   ]
+ * }
+ * @endcode
+ */
+class BenchmarkReport
+{
+  public:
+    typedef std::map<std::string, double> Parameters;
+
+  private:
+    struct Result
+    {
+      std::string name;
+      Parameters parameters;
+      size_t repetitions;
+      double mean;
+      double min;
+      double max;
+
+      Result(const std::string& n, const Parameters& p, size_t r) :
+        name(n), parameters(p), repetitions(r), mean(0), min(-1.), max(0) {}
+    };
+
+    std::string program_;
+    std::vector<Result> results_;
+
+  public:
+    BenchmarkReport(const std::string& program) : program_(program), results_() {}
+
+  public:
+    /**
+     * @brief Time a task.
+     *
+     * The task is run once as a warm-up, then the given number of times.
+     *
+     * @param name        The name of the benchmark.
+     * @param parameters  The size parameters of the benchmark.
+     * @param task        The task to time.
+     * @param repetitions The number of timed runs.
+     */
+    void measure(const std::string& name, const Parameters& parameters, BenchmarkTask& task, size_t repetitions)
+    {
+      task.setup();
+      task.run();
+      Result res(name, parameters, repetitions);
+      for (size_t i = 0; i < repetitions; i++)
+      {
+        BenchmarkTimer timer;
+        task.run();
+        double t = timer.elapsed();
+        res.mean += t;
+        if (res.min < 0 || t < res.min) res.min = t;
+        if (t > res.max) res.max = t;
+      }
+      if (repetitions > 0) res.mean /= static_cast<double>(repetitions);
+      results_.push_back(res);
+      std::cerr << std::setw(40) << std::left << name << " " << std::scientific << res.mean << " s" << std::endl;
+    }
+
+    void write(std::ostream& out) const
+    {
+      out << "{" << std::endl;
+      out << "  \"library\": \"bpp-phyl\"," << std::endl;
+      out << "  \"program\": \"" << program_ << "\"," << std::endl;
+      out << "  \"benchmarks\": [";
+      for (size_t i = 0; i < results_.size(); i++)
+      {
+        const Result& res = results_[i];
+        out << (i > 0 ? "," : "") << std::endl;
+        out << "    { \"name\": \"" << res.name << "\", \"parameters\": {";
+        for (Parameters::const_iterator it = res.parameters.begin(); it != res.parameters.end(); ++it)
+        {
+          out << (it != res.parameters.begin() ? ", " : " ") << "\"" << it->first << "\": " << it->second;
+        }
+        out << " }," << std::endl;
+        out << std::scientific;
+        out << "      \"repetitions\": " << res.repetitions
+            << ", \"mean_seconds\": " << res.mean
+            << ", \"min_seconds\": " << res.min
+            << ", \"max_seconds\": " << res.max << " }";
+        out.unsetf(std::ios::floatfield);
+      }
+      out << std::endl << "  ]" << std::endl << "}" << std::endl;
+    }
+
+    /**
+     * @brief Write the report to the file given as first program argument, or to the standard output.
+     */
+    int write(int argc, char** argv) const
+    {
+      if (argc > 1)
+      {
+        std::ofstream out(argv[1], std::ios::out);
+        if (!out) {
+          std::cerr << "Could not open file " << argv[1] << std::endl;
+          return 1;
+        }
+        write(out);
+      }
+      else
+      {
+        write(std::cout);
+      }
+      return 0;
+    }
+};
+
+/**
+ * @brief Deterministic data sets for the benchmarks.
+ */
+class BenchmarkData
+{
+  public:
+    static std::string getTaxonName(size_t i)
+    {
+      std::ostringstream oss;
+      oss << "T" << i;
+      return oss.str();
+    }
+
+    /**
+     * @brief Build a random rooted binary tree by joining random pairs of subtrees.
+     *
+     * @param nbTaxa The number of leaves.
+     * @param rng    The random generator to use.
+     * @return The tree in Newick format.
+     */
+    static std::string getRandomNewick(size_t nbTaxa, BenchmarkRandom& rng)
+    {
+      std::vector<std::string> subtrees;
+      for (size_t i = 0; i < nbTaxa; i++)
+        subtrees.push_back(getTaxonName(i));
+      while (subtrees.size() > 1)
+      {
+        size_t i = rng.giveIntNumber(subtrees.size());
+        std::swap(subtrees[i], subtrees.back());
+        std::string s1 = subtrees.back();
+        subtrees.pop_back();
+        size_t j = rng.giveIntNumber(subtrees.size());
+        std::ostringstream oss;
+        oss << "(" << s1 << ":" << getBranchLength(rng) << "," << subtrees[j] << ":" << getBranchLength(rng) << ")";
+        subtrees[j] = oss.str();
+      }
+      return subtrees[0] + ";";
+    }
+
+    /**
+     * @brief Build an alignment by sampling columns from a pool of random site patterns.
+     *
+     * @param alphabet   The alphabet to use.
+     * @param nbTaxa     The number of sequences, named as in getRandomNewick.
+     * @param nbSites    The number of sites.
+     * @param nbPatterns The number of distinct site patterns to sample from.
+     * @param rng        The random generator to use.
+     * @return A new site container.
+     */
+    static bpp::VectorSiteContainer* getRandomSites(const bpp::Alphabet* alphabet, size_t nbTaxa, size_t nbSites, size_t nbPatterns, BenchmarkRandom& rng)
+    {
+      size_t nbStates = static_cast<size_t>(alphabet->getSize());
+      std::vector< std::vector<int> > patterns(nbPatterns, std::vector<int>(nbTaxa));
+      for (size_t i = 0; i < nbPatterns; i++)
+        for (size_t j = 0; j < nbTaxa; j++)
+          patterns[i][j] = static_cast<int>(rng.giveIntNumber(nbStates));
+      std::vector< std::vector<int> > content(nbTaxa, std::vector<int>(nbSites));
+      for (size_t i = 0; i < nbSites; i++)
+      {
+        const std::vector<int>& pattern = patterns[rng.giveIntNumber(nbPatterns)];
+        for (size_t j = 0; j < nbTaxa; j++)
+          content[j][i] = pattern[j];
+      }
+      bpp::VectorSiteContainer* sites = new bpp::VectorSiteContainer(alphabet);
+      for (size_t j = 0; j < nbTaxa; j++)
+        sites->addSequence(bpp::BasicSequence(getTaxonName(j), content[j], alphabet), false);
+      return sites;
+    }
+
+  private:
+    static double getBranchLength(BenchmarkRandom& rng)
+    {
+      return 0.01 + 0.1 * rng.giveRealNumber();
+    }
+};
+
+#endif //_BENCHMARK_H_
+
@@ -0,0 +1,346 @@
+//
+// File: bench_likelihood.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Benchmark.h"
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/SitePatterns.h>
+#include <Bpp/Phyl/NNITopologySearch.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/MixtureOfSubstitutionModels.h>
+#include <Bpp/Phyl/Model/FrequenciesSet/NucleotideFrequenciesSet.h>
+#include <Bpp/Phyl/Model/SubstitutionModelSetTools.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/RNonHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousMixedTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/NNIHomogeneousTreeLikelihood.h>
+
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+/**
+ * Recompute the likelihood after all parameters were set.
+ */
+class FullLikelihoodTask :
+  public BenchmarkTask
+{
+  private:
+    TreeLikelihood* tl_;
+
+  public:
+    FullLikelihoodTask(TreeLikelihood* tl) : tl_(tl) {}
+    FullLikelihoodTask(const FullLikelihoodTask& task) : BenchmarkTask(task), tl_(task.tl_) {}
+    FullLikelihoodTask& operator=(const FullLikelihoodTask& task)
+    {
+      tl_ = task.tl_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      tl_->setParameters(tl_->getParameters());
+      if (tl_->getValue() < 0) cerr << "Negative log-likelihood!" << endl;
+    }
+};
+
+/**
+ * Recompute the likelihood after a single branch length was changed.
+ */
+class BranchLikelihoodTask :
+  public BenchmarkTask
+{
+  private:
+    TreeLikelihood* tl_;
+    ParameterList brLen_;
+
+  public:
+    BranchLikelihoodTask(TreeLikelihood* tl) : tl_(tl), brLen_()
+    {
+      brLen_.addParameter(tl->getBranchLengthsParameters()[0]);
+    }
+
+    BranchLikelihoodTask(const BranchLikelihoodTask& task) : BenchmarkTask(task), tl_(task.tl_), brLen_(task.brLen_) {}
+    BranchLikelihoodTask& operator=(const BranchLikelihoodTask& task)
+    {
+      tl_ = task.tl_;
+      brLen_ = task.brLen_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      brLen_[0].setValue(brLen_[0].getValue() == 0.1 ? 0.2 : 0.1);
+      tl_->matchParametersValues(brLen_);
+      if (tl_->getValue() < 0) cerr << "Negative log-likelihood!" << endl;
+    }
+};
+
+/**
+ * Recompute the likelihood after a single substitution model parameter was changed.
+ */
+class ModelLikelihoodTask :
+  public BenchmarkTask
+{
+  private:
+    TreeLikelihood* tl_;
+    ParameterList param_;
+
+  public:
+    ModelLikelihoodTask(TreeLikelihood* tl, const std::string& name) : tl_(tl), param_()
+    {
+      param_.addParameter(tl->getParameter(name));
+    }
+
+    ModelLikelihoodTask(const ModelLikelihoodTask& task) : BenchmarkTask(task), tl_(task.tl_), param_(task.param_) {}
+    ModelLikelihoodTask& operator=(const ModelLikelihoodTask& task)
+    {
+      tl_ = task.tl_;
+      param_ = task.param_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      param_[0].setValue(param_[0].getValue() == 0.3 ? 0.4 : 0.3);
+      tl_->matchParametersValues(param_);
+      if (tl_->getValue() < 0) cerr << "Negative log-likelihood!" << endl;
+    }
+};
+
+/**
+ * Compress an alignment into site patterns.
+ */
+class SitePatternsTask :
+  public BenchmarkTask
+{
+  private:
+    const SiteContainer* sites_;
+    size_t nbThreads_;
+
+  public:
+    SitePatternsTask(const SiteContainer* sites, size_t nbThreads) : sites_(sites), nbThreads_(nbThreads) {}
+    SitePatternsTask(const SitePatternsTask& task) : BenchmarkTask(task), sites_(task.sites_), nbThreads_(task.nbThreads_) {}
+    SitePatternsTask& operator=(const SitePatternsTask& task)
+    {
+      sites_ = task.sites_;
+      nbThreads_ = task.nbThreads_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      SitePatterns patterns(sites_, false, nbThreads_);
+      if (patterns.getWeights().size() == 0) cerr << "No site pattern!" << endl;
+    }
+};
+
+/**
+ * Run a full NNI search from the starting tree.
+ */
+class NNISearchTask :
+  public BenchmarkTask
+{
+  private:
+    const Tree* tree_;
+    const SiteContainer* sites_;
+    const SubstitutionModel* model_;
+    const DiscreteDistribution* rDist_;
+    size_t nbThreads_;
+
+  public:
+    NNISearchTask(const Tree* tree, const SiteContainer* sites, const SubstitutionModel* model, const DiscreteDistribution* rDist, size_t nbThreads) :
+      tree_(tree), sites_(sites), model_(model), rDist_(rDist), nbThreads_(nbThreads) {}
+
+    NNISearchTask(const NNISearchTask& task) :
+      BenchmarkTask(task), tree_(task.tree_), sites_(task.sites_), model_(task.model_), rDist_(task.rDist_), nbThreads_(task.nbThreads_) {}
+
+    NNISearchTask& operator=(const NNISearchTask& task)
+    {
+      tree_      = task.tree_;
+      sites_     = task.sites_;
+      model_     = task.model_;
+      rDist_     = task.rDist_;
+      nbThreads_ = task.nbThreads_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      auto_ptr<SubstitutionModel> model(model_->clone());
+      auto_ptr<DiscreteDistribution> rDist(rDist_->clone());
+      NNIHomogeneousTreeLikelihood tl(*tree_, *sites_, model.get(), rDist.get(), true, false);
+      tl.setNumberOfThreads(nbThreads_);
+      tl.initialize();
+      NNITopologySearch search(tl, NNITopologySearch::PHYML, 0);
+      search.search();
+    }
+};
+
+BenchmarkReport::Parameters getParameters(size_t nbTaxa, size_t nbSites, size_t nbPatterns, size_t nbThreads)
+{
+  BenchmarkReport::Parameters params;
+  params["taxa"]     = static_cast<double>(nbTaxa);
+  params["sites"]    = static_cast<double>(nbSites);
+  params["patterns"] = static_cast<double>(nbPatterns);
+  params["threads"]  = static_cast<double>(nbThreads);
+  return params;
+}
+
+int main(int argc, char** argv)
+{
+  BenchmarkReport report("bench_likelihood");
+  try {
+    const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+    T92 model(alphabet, 3., 0.4);
+    GammaDiscreteRateDistribution rDist(4, 0.5);
+
+    size_t taxa[] = { 8, 32, 128 };
+    size_t sites[] = { 1000, 10000 };
+    for (size_t i = 0; i < 3; i++)
+    {
+      for (size_t j = 0; j < 2; j++)
+      {
+        BenchmarkRandom rng;
+        auto_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree(BenchmarkData::getRandomNewick(taxa[i], rng)));
+        size_t nbPatterns = sites[j] / 2;
+        auto_ptr<VectorSiteContainer> data(BenchmarkData::getRandomSites(alphabet, taxa[i], sites[j], nbPatterns, rng));
+        BenchmarkReport::Parameters params = getParameters(taxa[i], sites[j], nbPatterns, 1);
+        size_t repetitions = 5;
+
+        auto_ptr<SubstitutionModel> rModel(model.clone());
+        RHomogeneousTreeLikelihood rtl(*tree, *data, rModel.get(), &rDist, true, false);
+        rtl.initialize();
+        FullLikelihoodTask rFull(&rtl);
+        report.measure("likelihood/RHomogeneous/full", params, rFull, repetitions);
+        BranchLikelihoodTask rBranch(&rtl);
+        report.measure("likelihood/RHomogeneous/branch", params, rBranch, repetitions);
+
+        auto_ptr<SubstitutionModel> drModel(model.clone());
+        DRHomogeneousTreeLikelihood drtl(*tree, *data, drModel.get(), &rDist, true, false);
+        drtl.initialize();
+        FullLikelihoodTask drFull(&drtl);
+        report.measure("likelihood/DRHomogeneous/full", params, drFull, repetitions);
+        BranchLikelihoodTask drBranch(&drtl);
+        report.measure("likelihood/DRHomogeneous/branch", params, drBranch, repetitions);
+
+        auto_ptr<SubstitutionModelSet> modelSet(SubstitutionModelSetTools::createHomogeneousModelSet(model.clone(), new GCFrequenciesSet(alphabet), tree.get()));
+        RNonHomogeneousTreeLikelihood nhtl(*tree, *data, modelSet.get(), &rDist, false);
+        nhtl.initialize();
+        FullLikelihoodTask nhFull(&nhtl);
+        report.measure("likelihood/RNonHomogeneous/full", params, nhFull, repetitions);
+
+        //One model per branch, a single one of them being modified:
+        vector<string> globalParameterNames(1, "T92.kappa");
+        auto_ptr<SubstitutionModelSet> branchModelSet(SubstitutionModelSetTools::createNonHomogeneousModelSet(model.clone(), new GCFrequenciesSet(alphabet), tree.get(), map<string, string>(), globalParameterNames));
+        RNonHomogeneousTreeLikelihood bmtl(*tree, *data, branchModelSet.get(), &rDist, false);
+        bmtl.initialize();
+        ModelLikelihoodTask bmModel(&bmtl, "T92.theta_1");
+        report.measure("likelihood/RNonHomogeneous/model", params, bmModel, repetitions);
+      }
+    }
+
+    //Mixture models, all components evaluated in a single traversal:
+    {
+      BenchmarkRandom rng;
+      auto_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree(BenchmarkData::getRandomNewick(32, rng)));
+      auto_ptr<VectorSiteContainer> data(BenchmarkData::getRandomSites(alphabet, 32, 10000, 5000, rng));
+      size_t nbComponents[] = { 2, 8 };
+      for (size_t k = 0; k < 2; k++)
+      {
+        vector<SubstitutionModel*> components;
+        for (size_t m = 0; m < nbComponents[k]; m++)
+        {
+          components.push_back(new T92(alphabet, 1. + static_cast<double>(m), 0.4));
+        }
+        MixtureOfSubstitutionModels mixture(alphabet, components);
+        for (size_t nbThreads = 1; nbThreads <= 4; nbThreads *= 4)
+        {
+          BenchmarkReport::Parameters params = getParameters(32, 10000, 5000, nbThreads);
+          params["components"] = static_cast<double>(nbComponents[k]);
+          RHomogeneousMixedTreeLikelihood mtl(*tree, *data, &mixture, &rDist, true, false);
+          mtl.setNumberOfThreads(nbThreads);
+          mtl.initialize();
+          FullLikelihoodTask mFull(&mtl);
+          report.measure("likelihood/RHomogeneousMixed/full", params, mFull, 5);
+          BranchLikelihoodTask mBranch(&mtl);
+          report.measure("likelihood/RHomogeneousMixed/branch", params, mBranch, 5);
+        }
+      }
+    }
+
+    //Site patterns compression:
+    {
+      BenchmarkRandom rng;
+      auto_ptr<VectorSiteContainer> data(BenchmarkData::getRandomSites(alphabet, 16, 100000, 1000, rng));
+      for (size_t nbThreads = 1; nbThreads <= 4; nbThreads *= 4)
+      {
+        SitePatternsTask task(data.get(), nbThreads);
+        report.measure("SitePatterns", getParameters(16, 100000, 1000, nbThreads), task, 5);
+      }
+    }
+
+    //NNI search:
+    {
+      BenchmarkRandom rng;
+      auto_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree(BenchmarkData::getRandomNewick(32, rng)));
+      auto_ptr<VectorSiteContainer> data(BenchmarkData::getRandomSites(alphabet, 32, 1000, 500, rng));
+      for (size_t nbThreads = 1; nbThreads <= 4; nbThreads *= 4)
+      {
+        NNISearchTask task(tree.get(), data.get(), &model, &rDist, nbThreads);
+        report.measure("NNISearch/PhyML", getParameters(32, 1000, 500, nbThreads), task, 1);
+      }
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return report.write(argc, argv);
+}
+
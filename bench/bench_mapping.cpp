@@ -0,0 +1,172 @@
+//
+// File: bench_mapping.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Benchmark.h"
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Mapping/SubstitutionRegister.h>
+#include <Bpp/Phyl/Mapping/DecompositionSubstitutionCount.h>
+#include <Bpp/Phyl/Mapping/UniformizationSubstitutionCount.h>
+#include <Bpp/Phyl/Mapping/SubstitutionMappingTools.h>
+
+#include <memory>
+#include <algorithm>
+
+using namespace bpp;
+using namespace std;
+
+/**
+ * Compute the substitution vectors for all branches of a tree.
+ */
+class MappingTask :
+  public BenchmarkTask
+{
+  private:
+    const DRTreeLikelihood* drtl_;
+    SubstitutionCount* count_;
+    size_t nbThreads_;
+
+  public:
+    MappingTask(const DRTreeLikelihood* drtl, SubstitutionCount* count, size_t nbThreads = 1) :
+      drtl_(drtl), count_(count), nbThreads_(nbThreads) {}
+    MappingTask(const MappingTask& task) :
+      BenchmarkTask(task), drtl_(task.drtl_), count_(task.count_), nbThreads_(task.nbThreads_) {}
+    MappingTask& operator=(const MappingTask& task)
+    {
+      drtl_      = task.drtl_;
+      count_     = task.count_;
+      nbThreads_ = task.nbThreads_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      delete SubstitutionMappingTools::computeSubstitutionVectors(*drtl_, *count_, false, nbThreads_);
+    }
+};
+
+/**
+ * Compute the total substitution counts on each branch, without storing site vectors.
+ */
+class CountsPerBranchTask :
+  public BenchmarkTask
+{
+  private:
+    const DRTreeLikelihood* drtl_;
+    SubstitutionCount* count_;
+    std::vector<int> ids_;
+    size_t nbThreads_;
+
+  public:
+    CountsPerBranchTask(const DRTreeLikelihood* drtl, SubstitutionCount* count, const std::vector<int>& ids, size_t nbThreads) :
+      drtl_(drtl), count_(count), ids_(ids), nbThreads_(nbThreads) {}
+    CountsPerBranchTask(const CountsPerBranchTask& task) :
+      BenchmarkTask(task), drtl_(task.drtl_), count_(task.count_), ids_(task.ids_), nbThreads_(task.nbThreads_) {}
+    CountsPerBranchTask& operator=(const CountsPerBranchTask& task)
+    {
+      drtl_      = task.drtl_;
+      count_     = task.count_;
+      ids_       = task.ids_;
+      nbThreads_ = task.nbThreads_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      SubstitutionMappingTools::computeCountsPerBranch(*drtl_, ids_, *count_, -1, false, nbThreads_);
+    }
+};
+
+int main(int argc, char** argv)
+{
+  BenchmarkReport report("bench_mapping");
+  try {
+    const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+    GTR model(alphabet, 1., 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2);
+    GammaDiscreteRateDistribution rDist(4, 0.5);
+
+    size_t taxa[] = { 8, 32 };
+    size_t sites[] = { 1000, 10000 };
+    for (size_t i = 0; i < 2; i++)
+    {
+      for (size_t j = 0; j < 2; j++)
+      {
+        BenchmarkRandom rng;
+        auto_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree(BenchmarkData::getRandomNewick(taxa[i], rng)));
+        size_t nbPatterns = sites[j] / 2;
+        auto_ptr<VectorSiteContainer> data(BenchmarkData::getRandomSites(alphabet, taxa[i], sites[j], nbPatterns, rng));
+        DRHomogeneousTreeLikelihood drtl(*tree, *data, &model, &rDist, true, false);
+        drtl.initialize();
+
+        BenchmarkReport::Parameters params;
+        params["taxa"]     = static_cast<double>(taxa[i]);
+        params["sites"]    = static_cast<double>(sites[j]);
+        params["patterns"] = static_cast<double>(nbPatterns);
+
+        DecompositionSubstitutionCount decomposition(&model, new TotalSubstitutionRegister(&model));
+        MappingTask decTask(&drtl, &decomposition);
+        report.measure("mapping/Decomposition", params, decTask, 3);
+
+        UniformizationSubstitutionCount uniformization(&model, new TotalSubstitutionRegister(&model));
+        MappingTask uniTask(&drtl, &uniformization);
+        report.measure("mapping/Uniformization", params, uniTask, 3);
+
+        MappingTask decTaskMt(&drtl, &decomposition, 0);
+        report.measure("mapping/Decomposition/AllThreads", params, decTaskMt, 3);
+
+        vector<int> ids = tree->getNodesId();
+        ids.erase(std::find(ids.begin(), ids.end(), tree->getRootId()));
+        CountsPerBranchTask branchTask(&drtl, &decomposition, ids, 0);
+        report.measure("mapping/CountsPerBranch/AllThreads", params, branchTask, 3);
+      }
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return report.write(argc, argv);
+}
+
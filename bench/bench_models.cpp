@@ -0,0 +1,146 @@
+//
+// File: bench_models.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Benchmark.h"
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Phyl/Model/Nucleotide/JCnuc.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Model/Nucleotide/HKY85.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/Protein/JTT92.h>
+#include <Bpp/Phyl/Model/Protein/LG08.h>
+#include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/FrequenciesSet/CodonFrequenciesSet.h>
+
+using namespace bpp;
+using namespace std;
+
+/**
+ * Compute transition probabilities, and optionally their derivatives, for a
+ * series of branch lengths. The lengths are shifted at each run so that every
+ * call requires an actual computation and does not hit the model cache.
+ */
+class PijtTask :
+  public BenchmarkTask
+{
+  private:
+    SubstitutionModel* model_;
+    size_t nbTimes_;
+    bool derivatives_;
+    double offset_;
+
+  public:
+    PijtTask(SubstitutionModel* model, size_t nbTimes, bool derivatives) :
+      model_(model), nbTimes_(nbTimes), derivatives_(derivatives), offset_(0) {}
+
+    PijtTask(const PijtTask& task) :
+      BenchmarkTask(task), model_(task.model_), nbTimes_(task.nbTimes_),
+      derivatives_(task.derivatives_), offset_(task.offset_) {}
+
+    PijtTask& operator=(const PijtTask& task)
+    {
+      model_       = task.model_;
+      nbTimes_     = task.nbTimes_;
+      derivatives_ = task.derivatives_;
+      offset_      = task.offset_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      double sum = 0;
+      offset_ += 1e-7;
+      for (size_t i = 0; i < nbTimes_; i++)
+      {
+        double t = 0.01 + static_cast<double>(i) * 0.001 + offset_;
+        sum += model_->getPij_t(0, 0, t);
+        if (derivatives_)
+          sum += model_->getdPij_dt(0, 0, t) + model_->getd2Pij_dt2(0, 0, t);
+      }
+      if (sum < 0) cerr << sum << endl;
+    }
+};
+
+void benchModel(BenchmarkReport& report, SubstitutionModel* model, const string& family, size_t nbTimes, size_t repetitions)
+{
+  BenchmarkReport::Parameters params;
+  params["states"] = static_cast<double>(model->getNumberOfStates());
+  params["branch_lengths"] = static_cast<double>(nbTimes);
+  PijtTask pijt(model, nbTimes, false);
+  report.measure("getPij_t/" + family, params, pijt, repetitions);
+  PijtTask deriv(model, nbTimes, true);
+  report.measure("getPij_t+derivatives/" + family, params, deriv, repetitions);
+}
+
+int main(int argc, char** argv)
+{
+  BenchmarkReport report("bench_models");
+  try {
+    const NucleicAlphabet* dna = &AlphabetTools::DNA_ALPHABET;
+    const ProteicAlphabet* prot = &AlphabetTools::PROTEIN_ALPHABET;
+
+    JCnuc jc(dna);
+    benchModel(report, &jc, "JC69", 100, 100);
+    K80 k80(dna, 2.);
+    benchModel(report, &k80, "K80", 100, 100);
+    HKY85 hky(dna, 2., 0.3, 0.2, 0.2, 0.3);
+    benchModel(report, &hky, "HKY85", 100, 100);
+    GTR gtr(dna, 1., 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2);
+    benchModel(report, &gtr, "GTR", 100, 100);
+
+    JTT92 jtt(prot);
+    benchModel(report, &jtt, "JTT92", 100, 20);
+    LG08 lg(prot);
+    benchModel(report, &lg, "LG08", 100, 20);
+
+    StandardGeneticCode gc(dna);
+    FrequenciesSet* fset = CodonFrequenciesSet::getFrequenciesSetForCodons(CodonFrequenciesSet::F3X4, &gc);
+    YN98 yn98(&gc, fset);
+    benchModel(report, &yn98, "YN98", 10, 5);
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return report.write(argc, argv);
+}
+
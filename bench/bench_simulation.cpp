@@ -0,0 +1,158 @@
+//
+// File: bench_simulation.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Benchmark.h"
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Simulation/NonHomogeneousSequenceSimulator.h>
+#include <Bpp/Phyl/Simulation/SimulatedSiteChunks.h>
+
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+/**
+ * Simulate an alignment, with the global random generator or with a seed.
+ */
+class SimulationTask :
+  public BenchmarkTask
+{
+  private:
+    const NonHomogeneousSequenceSimulator* simulator_;
+    size_t nbSites_;
+    bool seeded_;
+
+  public:
+    SimulationTask(const NonHomogeneousSequenceSimulator* simulator, size_t nbSites, bool seeded) :
+      simulator_(simulator), nbSites_(nbSites), seeded_(seeded) {}
+    SimulationTask(const SimulationTask& task) :
+      BenchmarkTask(task), simulator_(task.simulator_), nbSites_(task.nbSites_), seeded_(task.seeded_) {}
+    SimulationTask& operator=(const SimulationTask& task)
+    {
+      simulator_ = task.simulator_;
+      nbSites_   = task.nbSites_;
+      seeded_    = task.seeded_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      if (seeded_)
+        delete simulator_->simulate(nbSites_, 1);
+      else
+        delete simulator_->simulate(nbSites_);
+    }
+};
+
+/**
+ * Simulate an alignment chunk by chunk into a matrix of states, without building sequences.
+ */
+class ChunksTask :
+  public BenchmarkTask
+{
+  private:
+    SimulatedSiteChunks chunks_;
+
+  public:
+    ChunksTask(const NonHomogeneousSequenceSimulator& simulator, size_t nbSites, size_t chunkSize) :
+      chunks_(simulator, nbSites, 1, chunkSize) {}
+    ChunksTask(const ChunksTask& task) :
+      BenchmarkTask(task), chunks_(task.chunks_) {}
+    ChunksTask& operator=(const ChunksTask& task)
+    {
+      chunks_ = task.chunks_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      chunks_.rewind();
+      while (chunks_.nextStates() != 0) {}
+    }
+};
+
+int main(int argc, char** argv)
+{
+  BenchmarkReport report("bench_simulation");
+  try {
+    const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+    GTR model(alphabet, 1., 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2);
+    GammaDiscreteRateDistribution rDist(4, 0.5);
+
+    size_t taxa[] = { 8, 64 };
+    size_t sites[] = { 10000, 100000, 1000000 };
+    for (size_t i = 0; i < 2; i++)
+    {
+      BenchmarkRandom rng;
+      auto_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree(BenchmarkData::getRandomNewick(taxa[i], rng)));
+      NonHomogeneousSequenceSimulator simulator(&model, &rDist, tree.get());
+      NonHomogeneousSequenceSimulator simulatorMt(&model, &rDist, tree.get());
+      simulatorMt.setNumberOfThreads(0);
+      for (size_t j = 0; j < 3; j++)
+      {
+        BenchmarkReport::Parameters params;
+        params["taxa"]  = static_cast<double>(taxa[i]);
+        params["sites"] = static_cast<double>(sites[j]);
+
+        SimulationTask task(&simulator, sites[j], false);
+        report.measure("simulation/Global", params, task, 3);
+
+        SimulationTask seededTask(&simulator, sites[j], true);
+        report.measure("simulation/Seeded", params, seededTask, 3);
+
+        SimulationTask seededTaskMt(&simulatorMt, sites[j], true);
+        report.measure("simulation/Seeded/AllThreads", params, seededTaskMt, 3);
+
+        ChunksTask chunksTaskMt(simulatorMt, sites[j], 65536);
+        report.measure("simulation/Seeded/Chunks/AllThreads", params, chunksTaskMt, 3);
+      }
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return report.write(argc, argv);
+}
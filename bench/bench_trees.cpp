@@ -0,0 +1,315 @@
+//
+// File: bench_trees.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Benchmark.h"
+
+#include <Bpp/Seq/DistanceMatrix.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Io/NewickBatchReader.h>
+#include <Bpp/Phyl/Distance/BioNJ.h>
+#include <Bpp/Phyl/Distance/FastNeighborJoining.h>
+
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+/**
+ * Parse a set of trees in Newick format.
+ */
+class NewickTask :
+  public BenchmarkTask
+{
+  private:
+    string trees_;
+
+  public:
+    NewickTask(const string& trees) : trees_(trees) {}
+
+  public:
+    void run()
+    {
+      Newick newick;
+      istringstream iss(trees_);
+      vector<Tree*> trees;
+      newick.read(iss, trees);
+      for (size_t i = 0; i < trees.size(); i++)
+        delete trees[i];
+    }
+};
+
+/**
+ * Parse a set of trees in Newick format by batches, possibly in compact form.
+ */
+class NewickBatchTask :
+  public BenchmarkTask
+{
+  private:
+    string trees_;
+    bool compact_;
+    size_t nbThreads_;
+
+  public:
+    NewickBatchTask(const string& trees, bool compact, size_t nbThreads) : trees_(trees), compact_(compact), nbThreads_(nbThreads) {}
+
+  public:
+    void run()
+    {
+      NewickBatchReader reader(100);
+      reader.setNumberOfThreads(nbThreads_);
+      istringstream iss(trees_);
+      if (compact_)
+      {
+        vector<CompactTree> trees;
+        while (reader.read(iss, trees) > 0) {}
+      }
+      else
+      {
+        vector<Tree*> trees;
+        while (reader.read(iss, trees) > 0)
+        {
+          for (size_t i = 0; i < trees.size(); i++)
+            delete trees[i];
+          trees.clear();
+        }
+      }
+    }
+};
+
+/**
+ * Build the majority-rule consensus of a set of trees.
+ */
+class ConsensusTask :
+  public BenchmarkTask
+{
+  private:
+    const vector<Tree*>* trees_;
+
+  public:
+    ConsensusTask(const vector<Tree*>* trees) : trees_(trees) {}
+    ConsensusTask(const ConsensusTask& task) : BenchmarkTask(task), trees_(task.trees_) {}
+    ConsensusTask& operator=(const ConsensusTask& task)
+    {
+      trees_ = task.trees_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      delete TreeTools::majorityConsensus(*trees_, false);
+    }
+};
+
+/**
+ * Compute the Robinson-Foulds distances between all pairs of trees of a set.
+ */
+class RobinsonFouldsTask :
+  public BenchmarkTask
+{
+  private:
+    const vector<Tree*>* trees_;
+    size_t nbThreads_;
+
+  public:
+    RobinsonFouldsTask(const vector<Tree*>* trees, size_t nbThreads) : trees_(trees), nbThreads_(nbThreads) {}
+    RobinsonFouldsTask(const RobinsonFouldsTask& task) : BenchmarkTask(task), trees_(task.trees_), nbThreads_(task.nbThreads_) {}
+    RobinsonFouldsTask& operator=(const RobinsonFouldsTask& task)
+    {
+      trees_ = task.trees_;
+      nbThreads_ = task.nbThreads_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      delete TreeTools::robinsonFouldsDistances(*trees_, nbThreads_);
+    }
+};
+
+/**
+ * Build a BioNJ tree from a distance matrix.
+ */
+class BioNJTask :
+  public BenchmarkTask
+{
+  private:
+    const DistanceMatrix* dist_;
+
+  public:
+    BioNJTask(const DistanceMatrix* dist) : dist_(dist) {}
+    BioNJTask(const BioNJTask& task) : BenchmarkTask(task), dist_(task.dist_) {}
+    BioNJTask& operator=(const BioNJTask& task)
+    {
+      dist_ = task.dist_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      BioNJ bionj(*dist_, false, true, false);
+      bionj.computeTree();
+      delete bionj.getTree();
+    }
+};
+
+/**
+ * Build a BioNJ tree from a distance matrix, using the packed storage and bounded pair search.
+ */
+class FastBioNJTask :
+  public BenchmarkTask
+{
+  private:
+    const DistanceMatrix* dist_;
+    size_t nbThreads_;
+
+  public:
+    FastBioNJTask(const DistanceMatrix* dist, size_t nbThreads) : dist_(dist), nbThreads_(nbThreads) {}
+    FastBioNJTask(const FastBioNJTask& task) : BenchmarkTask(task), dist_(task.dist_), nbThreads_(task.nbThreads_) {}
+    FastBioNJTask& operator=(const FastBioNJTask& task)
+    {
+      dist_ = task.dist_;
+      nbThreads_ = task.nbThreads_;
+      return *this;
+    }
+
+  public:
+    void run()
+    {
+      FastNeighborJoining bionj(true, false, true, false);
+      bionj.setNumberOfThreads(nbThreads_);
+      bionj.setDistanceMatrix(*dist_);
+      bionj.computeTree();
+      delete bionj.getTree();
+    }
+};
+
+int main(int argc, char** argv)
+{
+  BenchmarkReport report("bench_trees");
+  try {
+    //Newick parsing:
+    size_t taxa[] = { 100, 1000, 10000 };
+    size_t nbTrees[] = { 100, 10, 1 };
+    for (size_t i = 0; i < 3; i++)
+    {
+      BenchmarkRandom rng;
+      string trees;
+      for (size_t j = 0; j < nbTrees[i]; j++)
+        trees += BenchmarkData::getRandomNewick(taxa[i], rng) + "\n";
+      BenchmarkReport::Parameters params;
+      params["taxa"]  = static_cast<double>(taxa[i]);
+      params["trees"] = static_cast<double>(nbTrees[i]);
+      params["bytes"] = static_cast<double>(trees.size());
+      NewickTask task(trees);
+      report.measure("Newick/read", params, task, 5);
+      params["threads"] = 0;
+      params["compact"] = 0;
+      NewickBatchTask batchTask(trees, false, 0);
+      report.measure("NewickBatchReader/read", params, batchTask, 5);
+      params["compact"] = 1;
+      NewickBatchTask compactTask(trees, true, 0);
+      report.measure("NewickBatchReader/read", params, compactTask, 5);
+    }
+
+    //Majority-rule consensus and Robinson-Foulds distances:
+    size_t consensusTrees[] = { 100, 1000, 10000 };
+    for (size_t i = 0; i < 3; i++)
+    {
+      BenchmarkRandom rng;
+      vector<Tree*> trees(consensusTrees[i]);
+      for (size_t j = 0; j < trees.size(); j++)
+        trees[j] = TreeTemplateTools::parenthesisToTree(BenchmarkData::getRandomNewick(50, rng));
+      BenchmarkReport::Parameters params;
+      params["taxa"]  = 50;
+      params["trees"] = static_cast<double>(consensusTrees[i]);
+      ConsensusTask task(&trees);
+      report.measure("TreeTools/majorityConsensus", params, task, 3);
+      if (trees.size() <= 1000)
+      {
+        params["threads"] = 1;
+        RobinsonFouldsTask rfTask(&trees, 1);
+        report.measure("TreeTools/robinsonFouldsDistances", params, rfTask, 3);
+        params["threads"] = 0;
+        RobinsonFouldsTask rfTaskMt(&trees, 0);
+        report.measure("TreeTools/robinsonFouldsDistances", params, rfTaskMt, 3);
+      }
+      for (size_t j = 0; j < trees.size(); j++)
+        delete trees[j];
+    }
+
+    //BioNJ, on additive distances with some noise:
+    size_t njTaxa[] = { 50, 200, 500 };
+    for (size_t i = 0; i < 3; i++)
+    {
+      BenchmarkRandom rng;
+      auto_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree(BenchmarkData::getRandomNewick(njTaxa[i], rng)));
+      auto_ptr<DistanceMatrix> dist(TreeTemplateTools::getDistanceMatrix(*tree));
+      for (size_t j = 0; j < njTaxa[i]; j++)
+      {
+        for (size_t k = 0; k < j; k++)
+        {
+          double d = (*dist)(j, k) * (0.95 + 0.1 * rng.giveRealNumber());
+          (*dist)(j, k) = d;
+          (*dist)(k, j) = d;
+        }
+      }
+      BenchmarkReport::Parameters params;
+      params["taxa"] = static_cast<double>(njTaxa[i]);
+      BioNJTask task(dist.get());
+      report.measure("BioNJ", params, task, 3);
+      params["threads"] = 1;
+      FastBioNJTask fastTask(dist.get(), 1);
+      report.measure("FastBioNJ", params, fastTask, 3);
+      params["threads"] = 0;
+      FastBioNJTask fastTaskMt(dist.get(), 0);
+      report.measure("FastBioNJ", params, fastTaskMt, 3);
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return report.write(argc, argv);
+}
+
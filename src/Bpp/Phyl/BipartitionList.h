@@ -76,9 +76,13 @@ template<class N> class TreeTemplate;
  * arrays of bits (e.g. getBitBipartition), or as map<string, bool>, in which keys are leaf names and
  * true/false values define the two partitions (e.g. getBipartition, addBipartition).
  *
+ * To count the bipartitions of many trees, SplitCounter is much faster: bipartitions are
+ * hashed instead of being compared pairwise.
+ *
  * @see Tree
  * @see BipartitionTools
  * @see TreeTools
+ * @see SplitCounter
  */
 class BipartitionList:
   public virtual Clonable
@@ -0,0 +1,77 @@
+//
+// File: CompactTree.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "CompactTree.h"
+
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+TreeTemplate<Node>* CompactTree::toTree(const vector<string>& leavesNames) const throw (Exception)
+{
+  if (fathers_.empty())
+    throw Exception("CompactTree::toTree. Empty tree.");
+  for (size_t i = 0; i < fathers_.size(); ++i)
+  {
+    if (fathers_[i] < 0 && i + 1 < fathers_.size())
+      throw Exception("CompactTree::toTree. Node " + TextTools::toString(i) + " has no father.");
+    if (leaves_[i] >= static_cast<int>(leavesNames.size()))
+      throw IndexOutOfBoundsException("CompactTree::toTree. Bad leaf index.", static_cast<size_t>(leaves_[i]), 0, leavesNames.size());
+  }
+
+  vector<Node*> nodes(fathers_.size());
+  for (size_t i = 0; i < nodes.size(); ++i)
+  {
+    nodes[i] = new Node(static_cast<int>(i));
+    if (leaves_[i] >= 0)
+      nodes[i]->setName(leavesNames[static_cast<size_t>(leaves_[i])]);
+    if (hasDistanceToFather(i))
+      nodes[i]->setDistanceToFather(lengths_[i]);
+  }
+  // Sons are added in their order in the tree:
+  for (size_t i = 0; i + 1 < nodes.size(); ++i)
+    nodes[static_cast<size_t>(fathers_[i])]->addSon(nodes[i]);
+  return new TreeTemplate<Node>(nodes.back());
+}
+
+/******************************************************************************/
+
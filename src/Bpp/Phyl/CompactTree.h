@@ -0,0 +1,166 @@
+//
+// File: CompactTree.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _COMPACTTREE_H_
+#define _COMPACTTREE_H_
+
+#include "TreeTemplate.h"
+
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <string>
+#include <vector>
+#include <limits>
+
+namespace bpp
+{
+
+/**
+ * @brief A compact, array-based representation of a rooted tree.
+ *
+ * Only the topology and the branch lengths are stored, in three arrays indexed by node,
+ * with no per-node object. Nodes are numbered in post-order: sons come before their
+ * father, in the order they have in the tree, and the root is the last node.
+ * Bottom-up computations, such as the bipartitions of a tree, hence only require
+ * a single pass over the nodes.
+ *
+ * Leaves do not store their names, but the index of their name in a list shared by
+ * several trees (see for instance NewickBatchReader).
+ *
+ * This representation is intended for large sets of trees, for instance posterior
+ * or bootstrap samples. Use toTree() to get a TreeTemplate<Node> object.
+ */
+class CompactTree
+{
+  private:
+    std::vector<int> fathers_;
+    std::vector<int> leaves_;
+    std::vector<double> lengths_;
+    size_t nbLeaves_;
+
+  public:
+    CompactTree() : fathers_(), leaves_(), lengths_(), nbLeaves_(0) {}
+
+    virtual ~CompactTree() {}
+
+  public:
+    /**
+     * @name Construction.
+     *
+     * @{
+     */
+
+    /**
+     * @brief Add a new node, without father.
+     *
+     * @param leaf   The index of the leaf name, or -1 for an internal node.
+     * @param length The length of the branch leading to the node, or NaN if there is none.
+     * @return The index of the new node.
+     */
+    size_t addNode(int leaf, double length = std::numeric_limits<double>::quiet_NaN())
+    {
+      fathers_.push_back(-1);
+      leaves_.push_back(leaf);
+      lengths_.push_back(length);
+      if (leaf >= 0) nbLeaves_++;
+      return fathers_.size() - 1;
+    }
+
+    /**
+     * @param node   The index of the son.
+     * @param father The index of the father. It must be greater than the one of the son.
+     */
+    void setFather(size_t node, size_t father) throw (Exception)
+    {
+      if (father <= node || father >= fathers_.size())
+        throw Exception("CompactTree::setFather. Nodes must be in post-order.");
+      fathers_[node] = static_cast<int>(father);
+    }
+
+    void clear()
+    {
+      fathers_.clear();
+      leaves_.clear();
+      lengths_.clear();
+      nbLeaves_ = 0;
+    }
+    /** @} */
+
+    size_t getNumberOfNodes() const { return fathers_.size(); }
+
+    size_t getNumberOfLeaves() const { return nbLeaves_; }
+
+    size_t getRootIndex() const { return fathers_.size() - 1; }
+
+    /**
+     * @return The index of the father of a node, or -1 for the root.
+     */
+    int getFather(size_t node) const { return fathers_[node]; }
+
+    bool isLeaf(size_t node) const { return leaves_[node] >= 0; }
+
+    /**
+     * @return The index of the name of a leaf, or -1 for an internal node.
+     */
+    int getLeafIndex(size_t node) const { return leaves_[node]; }
+
+    bool hasDistanceToFather(size_t node) const { return lengths_[node] == lengths_[node]; }
+
+    /**
+     * @return The length of the branch leading to a node, or NaN if there is none.
+     */
+    double getDistanceToFather(size_t node) const { return lengths_[node]; }
+
+    /**
+     * @brief Build the corresponding tree.
+     *
+     * Node ids are the node indices.
+     *
+     * @param leavesNames The names of the leaves.
+     * @return A pointer toward a dynamically created tree.
+     * @throw IndexOutOfBoundsException If a leaf index is not valid.
+     */
+    TreeTemplate<Node>* toTree(const std::vector<std::string>& leavesNames) const throw (Exception);
+};
+
+} //end of namespace bpp.
+
+#endif //_COMPACTTREE_H_
+
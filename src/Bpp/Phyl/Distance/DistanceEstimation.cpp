@@ -60,6 +60,13 @@ using namespace bpp;
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <utility>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
 
 using namespace std;
 
@@ -117,9 +124,81 @@ TwoTreeLikelihood::TwoTreeLikelihood(
 
 /******************************************************************************/
 
+TwoTreeLikelihood::TwoTreeLikelihood(
+    const std::string& seq1, const std::string& seq2,
+    const SiteContainer& data,
+    const SiteContainer& patterns,
+    const std::vector<unsigned int>& weights,
+    const std::vector<size_t>& indices,
+    SubstitutionModel* model,
+    DiscreteDistribution* rDist,
+    bool verbose) throw (Exception) :
+  AbstractDiscreteRatesAcrossSitesTreeLikelihood(rDist, verbose),
+  shrunkData_(0), seqnames_(2), model_(model), brLenParameters_(), pxy_(), dpxy_(), d2pxy_(),
+  rootPatternLinks_(), rootWeights_(), nbSites_(0), nbClasses_(0), nbStates_(0), nbDistinctSites_(0),
+  rootLikelihoods_(), rootLikelihoodsS_(), rootLikelihoodsSR_(), dLikelihoods_(), d2Likelihoods_(),
+  leafLikelihoods1_(), leafLikelihoods2_(),
+  minimumBrLen_(0.000001), brLenConstraint_(0), brLen_(0)
+{
+  seqnames_[0] = seq1;
+  seqnames_[1] = seq2;
+  data_ = PatternTools::getSequenceSubset(data, seqnames_);
+  if (data_->getAlphabet()->getAlphabetType()
+      != model_->getAlphabet()->getAlphabetType())
+    throw AlphabetMismatchException("TwoTreeTreeLikelihood::TwoTreeTreeLikelihood. Data and model must have the same alphabet type.",
+                                    data_->getAlphabet(),
+                                    model_->getAlphabet());
+
+  nbSites_   = data_->getNumberOfSites();
+  nbClasses_ = rateDistribution_->getNumberOfCategories();
+  nbStates_  = model_->getNumberOfStates();
+  if (indices.size() != nbSites_ || weights.size() != patterns.getNumberOfSites())
+    throw Exception("TwoTreeLikelihood::TwoTreeLikelihood. Site patterns do not match the alignment.");
+  if (verbose)
+    ApplicationTools::displayMessage("Double-Recursive Homogeneous Tree Likelihood");
+
+  // Merge the patterns of the alignment which are identical for the two sequences:
+  const vector<int>& content1 = patterns.getSequence(seq1).getContent();
+  const vector<int>& content2 = patterns.getSequence(seq2).getContent();
+  map<pair<int, int>, size_t> pairPatterns;
+  vector<size_t> links(content1.size());
+  vector<int> states1, states2;
+  for (size_t i = 0; i < content1.size(); i++)
+  {
+    pair<int, int> states(content1[i], content2[i]);
+    map<pair<int, int>, size_t>::iterator it = pairPatterns.find(states);
+    if (it == pairPatterns.end())
+    {
+      it = pairPatterns.insert(make_pair(states, states1.size())).first;
+      states1.push_back(states.first);
+      states2.push_back(states.second);
+      rootWeights_.push_back(0);
+    }
+    links[i] = it->second;
+    rootWeights_[it->second] += weights[i];
+  }
+  rootPatternLinks_.resize(nbSites_);
+  for (size_t i = 0; i < nbSites_; i++)
+    rootPatternLinks_[i] = links[indices[i]];
+  nbDistinctSites_ = states1.size();
+  if (verbose)
+    ApplicationTools::displayResult("Number of distinct sites", TextTools::toString(nbDistinctSites_));
+
+  // Init _likelihoods:
+  if (verbose) ApplicationTools::displayTask("Init likelihoods arrays");
+  initTreeLikelihoods_(states1, states2);
+
+  brLen_ = minimumBrLen_;
+  brLenConstraint_ = new IntervalConstraint(1, minimumBrLen_, true);
+
+  if (verbose) ApplicationTools::displayTaskDone();
+}
+
+/******************************************************************************/
+
 TwoTreeLikelihood::TwoTreeLikelihood(const TwoTreeLikelihood& lik) :
   AbstractDiscreteRatesAcrossSitesTreeLikelihood(lik),
-  shrunkData_        (dynamic_cast<SiteContainer*>(lik.shrunkData_->clone())),
+  shrunkData_        (lik.shrunkData_ ? dynamic_cast<SiteContainer*>(lik.shrunkData_->clone()) : 0),
   seqnames_          (lik.seqnames_),
   model_             (lik.model_),
   brLenParameters_   (lik.brLenParameters_),
@@ -149,7 +228,8 @@ TwoTreeLikelihood::TwoTreeLikelihood(const TwoTreeLikelihood& lik) :
 TwoTreeLikelihood& TwoTreeLikelihood::operator=(const TwoTreeLikelihood& lik)
 {
   AbstractDiscreteRatesAcrossSitesTreeLikelihood::operator=(lik);
-  shrunkData_        = dynamic_cast<SiteContainer*>(lik.shrunkData_->clone());
+  if (shrunkData_) delete shrunkData_;
+  shrunkData_        = lik.shrunkData_ ? dynamic_cast<SiteContainer*>(lik.shrunkData_->clone()) : 0;
   seqnames_          = lik.seqnames_;
   model_             = lik.model_;
   brLenParameters_   = lik.brLenParameters_;
@@ -420,6 +500,13 @@ void TwoTreeLikelihood::initTreeLikelihoods(const SequenceContainer& sequences)
 {
   const Sequence* seq1 = &sequences.getSequence(seqnames_[0]);
   const Sequence* seq2 = &sequences.getSequence(seqnames_[1]);
+  initTreeLikelihoods_(seq1->getContent(), seq2->getContent());
+}
+
+/******************************************************************************/
+
+void TwoTreeLikelihood::initTreeLikelihoods_(const std::vector<int>& states1, const std::vector<int>& states2) throw (Exception)
+{
   leafLikelihoods1_.resize(nbDistinctSites_);
   leafLikelihoods2_.resize(nbDistinctSites_);
   for (size_t i = 0; i < nbDistinctSites_; i++)
@@ -428,8 +515,8 @@ void TwoTreeLikelihood::initTreeLikelihoods(const SequenceContainer& sequences)
    Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
    leafLikelihoods1_i->resize(nbStates_);
    leafLikelihoods2_i->resize(nbStates_);
-   int state1 = seq1->getValue(i);
-   int state2 = seq2->getValue(i);
+   int state1 = states1[i];
+   int state2 = states2[i];
     for (size_t s = 0; s < nbStates_; s++)
     {
       // Leaves likelihood are set to 1 if the char correspond to the site in the sequence,
@@ -649,46 +736,137 @@ throw (Exception)
 
 /******************************************************************************/
 
-void DistanceEstimation::computeMatrix() throw (NullPointerException)
+void DistanceEstimation::setNumberOfThreads(size_t nbThreads)
+{
+#ifdef _OPENMP
+  if (nbThreads == 0)
+    nbThreads = static_cast<size_t>(omp_get_num_procs());
+  nbThreads_ = nbThreads;
+#else
+  nbThreads_ = 1;
+#endif
+}
+
+/******************************************************************************/
+
+void DistanceEstimation::computeMatrix() throw (Exception)
 {
+  if (!sites_)
+    throw NullPointerException("DistanceEstimation::computeMatrix(). No data to compute distances from.");
+  if (!model_.get())
+    throw NullPointerException("DistanceEstimation::computeMatrix(). No substitution model.");
+  if (!rateDist_.get())
+    throw NullPointerException("DistanceEstimation::computeMatrix(). No rate distribution.");
   size_t n = sites_->getNumberOfSequences();
   vector<string> names = sites_->getSequencesNames();
   if (dist_ != 0) delete dist_;
   dist_ = new DistanceMatrix(names);
+  size_t nbThreads = nbThreads_;
   optimizer_->setVerbose(static_cast<unsigned int>(max(static_cast<int>(verbose_) - 2, 0)));
-  for (size_t i = 0; i < n; ++i)
+
+  // Sequences are copied to a sequence-oriented container,
+  // as a site container may rebuild a sequence each time it is accessed:
+  AlignedSequenceContainer sequences(*sites_);
+
+  // Patterns of the whole alignment, if they are shared by all pairs:
+  auto_ptr<SitePatterns> sitePatterns;
+  auto_ptr<SiteContainer> patterns;
+  if (shareSitePatterns_)
+  {
+    sitePatterns.reset(new SitePatterns(&sequences, false, nbThreads));
+    auto_ptr<SiteContainer> tmp(sitePatterns->getSites());
+    patterns.reset(new AlignedSequenceContainer(*tmp));
+  }
+
+  // Each thread gets its own copy of all objects which are modified during a fit.
+  // All pairs start from the same parameter values, so that results do not depend on the order of computations.
+  ParameterList modelParameters = model_->getParameters();
+  ParameterList rateParameters = rateDist_->getParameters();
+  vector<SubstitutionModel*> models(nbThreads);
+  vector<DiscreteDistribution*> rateDists(nbThreads);
+  vector<Optimizer*> optimizers(nbThreads);
+  for (size_t t = 0; t < nbThreads; t++)
+  {
+    models[t] = dynamic_cast<SubstitutionModel*>(model_->clone());
+    rateDists[t] = dynamic_cast<DiscreteDistribution*>(rateDist_->clone());
+    optimizers[t] = dynamic_cast<Optimizer*>(optimizer_->clone());
+    if (nbThreads > 1)
+    {
+      optimizers[t]->setVerbose(0);
+      optimizers[t]->setMessageHandler(0);
+      optimizers[t]->setProfiler(0);
+    }
+  }
+
+  string error;
+  size_t nbRows = 0;
+  long nL = static_cast<long>(n);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads))
+#endif
+  for (long li = 0; li < nL; ++li)
   {
+    size_t i = static_cast<size_t>(li);
+    size_t t = 0;
+#ifdef _OPENMP
+    t = static_cast<size_t>(omp_get_thread_num());
+#endif
     (*dist_)(i, i) = 0;
-    if (verbose_ == 1)
+    if (verbose_ == 1 || (verbose_ > 1 && nbThreads > 1))
     {
-      ApplicationTools::displayGauge(i, n - 1, '=');
+#ifdef _OPENMP
+#  pragma omp critical
+#endif
+      ApplicationTools::displayGauge(nbRows++, n - 1, '=');
     }
-    for (size_t j = i + 1; j < n; j++)
+    try
     {
-      if (verbose_ > 1)
+      for (size_t j = i + 1; j < n; j++)
       {
-        ApplicationTools::displayGauge(j - i - 1, n - i - 2, '=');
+        if (verbose_ > 1 && nbThreads == 1)
+        {
+          ApplicationTools::displayGauge(j - i - 1, n - i - 2, '=');
+        }
+        models[t]->matchParametersValues(modelParameters);
+        rateDists[t]->matchParametersValues(rateParameters);
+        auto_ptr<TwoTreeLikelihood> lik(shareSitePatterns_ ?
+          new TwoTreeLikelihood(names[i], names[j], sequences, *patterns, sitePatterns->getWeights(), sitePatterns->getIndices(), models[t], rateDists[t], verbose_ > 3) :
+          new TwoTreeLikelihood(names[i], names[j], sequences, models[t], rateDists[t], verbose_ > 3));
+        lik->initialize();
+        lik->enableDerivatives(true);
+        size_t d = SymbolListTools::getNumberOfDistinctPositions(sequences.getSequence(i), sequences.getSequence(j));
+        size_t g = SymbolListTools::getNumberOfPositionsWithoutGap(sequences.getSequence(i), sequences.getSequence(j));
+        lik->setParameterValue("BrLen", g == 0 ? lik->getMinimumBranchLength() : std::max(lik->getMinimumBranchLength(), static_cast<double>(d) / static_cast<double>(g)));
+        // Optimization:
+        Optimizer* optimizer = optimizers[t];
+        optimizer->setFunction(lik.get());
+        optimizer->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
+        ParameterList params = lik->getBranchLengthsParameters();
+        params.addParameters(parameters_);
+        optimizer->init(params);
+        optimizer->optimize();
+        // Store results:
+        (*dist_)(i, j) = (*dist_)(j, i) = lik->getParameterValue("BrLen");
       }
-      TwoTreeLikelihood* lik =
-        new TwoTreeLikelihood(names[i], names[j], *sites_, model_.get(), rateDist_.get(), verbose_ > 3);
-      lik->initialize();
-      lik->enableDerivatives(true);
-      size_t d = SymbolListTools::getNumberOfDistinctPositions(sites_->getSequence(i), sites_->getSequence(j));
-      size_t g = SymbolListTools::getNumberOfPositionsWithoutGap(sites_->getSequence(i), sites_->getSequence(j));
-      lik->setParameterValue("BrLen", g == 0 ? lik->getMinimumBranchLength() : std::max(lik->getMinimumBranchLength(), static_cast<double>(d) / static_cast<double>(g)));
-      // Optimization:
-      optimizer_->setFunction(lik);
-      optimizer_->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
-      ParameterList params = lik->getBranchLengthsParameters();
-      params.addParameters(parameters_);
-      optimizer_->init(params);
-      optimizer_->optimize();
-      // Store results:
-      (*dist_)(i, j) = (*dist_)(j, i) = lik->getParameterValue("BrLen");
-      delete lik;
     }
-    if (verbose_ > 1 && ApplicationTools::message) ApplicationTools::message->endLine();
+    catch (std::exception& ex)
+    {
+#ifdef _OPENMP
+#  pragma omp critical
+#endif
+      error = ex.what();
+    }
+    if (verbose_ > 1 && nbThreads == 1 && ApplicationTools::message) ApplicationTools::message->endLine();
+  }
+
+  for (size_t t = 0; t < nbThreads; t++)
+  {
+    delete models[t];
+    delete rateDists[t];
+    delete optimizers[t];
   }
+  if (error.size() > 0)
+    throw Exception("DistanceEstimation::computeMatrix(). " + error);
 }
 
 /******************************************************************************/
@@ -120,6 +120,33 @@ class TwoTreeLikelihood:
       DiscreteDistribution* rDist,
       bool verbose)  throw (Exception);
 
+    /**
+     * @brief Build a new object from an alignment already compressed into site patterns.
+     *
+     * Only the patterns of the alignment are scanned to find the distinct pairs of states of
+     * the two sequences, which is faster than compressing the two sequences again
+     * when many pairs are computed from the same alignment.
+     *
+     * @param seq1     The name of the first sequence.
+     * @param seq2     The name of the second sequence.
+     * @param data     The full alignment.
+     * @param patterns The unique sites of the alignment, as computed by SitePatterns.
+     * @param weights  The number of sites identical to each pattern.
+     * @param indices  The pattern corresponding to each site of the alignment.
+     * @param model    The substitution model to use.
+     * @param rDist    The rate across sites distribution to use.
+     * @param verbose  Should I display some info?
+     */
+    TwoTreeLikelihood(
+      const std::string& seq1, const std::string& seq2,
+      const SiteContainer& data,
+      const SiteContainer& patterns,
+      const std::vector<unsigned int>& weights,
+      const std::vector<size_t>& indices,
+      SubstitutionModel* model,
+      DiscreteDistribution* rDist,
+      bool verbose)  throw (Exception);
+
     TwoTreeLikelihood(const TwoTreeLikelihood& lik);
     
     TwoTreeLikelihood& operator=(const TwoTreeLikelihood& lik);
@@ -271,6 +298,13 @@ class TwoTreeLikelihood:
      */
     virtual void initTreeLikelihoods(const SequenceContainer & sequences) throw (Exception);
 
+  private:
+    /**
+     * @brief Initialize the likelihood arrays from the states of the two sequences at each distinct site.
+     */
+    void initTreeLikelihoods_(const std::vector<int>& states1, const std::vector<int>& states2) throw (Exception);
+
+  protected:
     void fireParameterChanged(const ParameterList & params);
     virtual void computeTreeLikelihood();
     virtual void computeTreeDLikelihood();
@@ -315,6 +349,8 @@ class DistanceEstimation:
     MetaOptimizer* defaultOptimizer_;
     size_t verbose_;
     ParameterList parameters_;
+    size_t nbThreads_;
+    bool shareSitePatterns_;
 
   public:
   
@@ -343,7 +379,9 @@ class DistanceEstimation:
       optimizer_(0),
       defaultOptimizer_(0),
       verbose_(verbose),
-      parameters_()
+      parameters_(),
+      nbThreads_(1),
+      shareSitePatterns_(false)
     {
       init_();
     }
@@ -378,7 +416,9 @@ class DistanceEstimation:
       optimizer_(0),
       defaultOptimizer_(0),
       verbose_(verbose),
-      parameters_()
+      parameters_(),
+      nbThreads_(1),
+      shareSitePatterns_(false)
     {
       init_();
       if(computeMat) computeMatrix();
@@ -399,7 +439,9 @@ class DistanceEstimation:
       optimizer_(dynamic_cast<Optimizer *>(distanceEstimation.optimizer_->clone())),
       defaultOptimizer_(dynamic_cast<MetaOptimizer *>(distanceEstimation.defaultOptimizer_->clone())),
       verbose_(distanceEstimation.verbose_),
-      parameters_(distanceEstimation.parameters_)
+      parameters_(distanceEstimation.parameters_),
+      nbThreads_(distanceEstimation.nbThreads_),
+      shareSitePatterns_(distanceEstimation.shareSitePatterns_)
     {
       if(distanceEstimation.dist_ != 0)
         dist_ = new DistanceMatrix(*distanceEstimation.dist_);
@@ -428,6 +470,8 @@ class DistanceEstimation:
       // _defaultOptimizer has already been initialized since the default constructor has been called.
       verbose_    = distanceEstimation.verbose_;
       parameters_ = distanceEstimation.parameters_;
+      nbThreads_  = distanceEstimation.nbThreads_;
+      shareSitePatterns_ = distanceEstimation.shareSitePatterns_;
       return *this;
     }
 
@@ -469,10 +513,15 @@ class DistanceEstimation:
      *
      * Result can be called by the getMatrix() method.
      *
+     * Each pair of sequences is fitted independently, starting from the current values of
+     * the model and rate distribution parameters. Pairs are distributed over several threads
+     * if requested (see setNumberOfThreads()), and results do not depend on the number of threads used.
+     *
      * @throw NullPointerException if at least one of the model,
      * rate distribution or data are not initialized.
+     * @throw Exception if the fit of one pair failed.
      */
-    void computeMatrix() throw (NullPointerException);
+    void computeMatrix() throw (Exception);
     
     /**
      * @brief Get the distance matrix.
@@ -536,6 +585,42 @@ class DistanceEstimation:
       parameters_.reset();
     }
 
+    /**
+     * @brief Set the number of threads used to compute distances.
+     *
+     * Each thread works with its own copy of the substitution model, rate distribution and optimizer.
+     * The copies are made once, so that the eigen decomposition of the model is not recomputed for each pair
+     * as long as no model parameter is estimated.
+     * When more than one thread is used, the optimizer does not output any message nor profile.
+     * If the library was built without OpenMP support, computations are always single-threaded.
+     *
+     * @param nbThreads The number of threads to use. 0 means one thread per available processor.
+     */
+    void setNumberOfThreads(size_t nbThreads);
+
+    /**
+     * @return The number of threads used to compute distances.
+     */
+    size_t getNumberOfThreads() const { return nbThreads_; }
+
+    /**
+     * @brief Compress the alignment into site patterns once for all pairs.
+     *
+     * By default, the two sequences of each pair are extracted and compressed again.
+     * When this option is enabled, the patterns of the whole alignment are computed once
+     * and each pair only scans these patterns, which is much faster for alignments with
+     * many sequences. Distances may differ in the last digits, as site likelihoods are
+     * then summed in a different order.
+     *
+     * @param yn Enable/Disable the sharing of site patterns.
+     */
+    void shareSitePatterns(bool yn) { shareSitePatterns_ = yn; }
+
+    /**
+     * @return True if site patterns are computed once for all pairs.
+     */
+    bool sharesSitePatterns() const { return shareSitePatterns_; }
+
     /**
      * @param verbose Verbose level.
      */
@@ -0,0 +1,406 @@
+//
+// File: FastNeighborJoining.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "FastNeighborJoining.h"
+#include "../Node.h"
+
+#include <Bpp/App/ApplicationTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+  /**
+   * @brief An entry in the sorted distances of a node.
+   *
+   * Distances are stored as single precision lower bounds to halve the memory used,
+   * exact values are read from the packed matrix when a pair is evaluated.
+   */
+  struct RowEntry_
+  {
+    float distance;
+    unsigned int node;
+  };
+
+  inline bool operator<(const RowEntry_& e1, const RowEntry_& e2)
+  {
+    return e1.distance < e2.distance || (e1.distance == e2.distance && e1.node < e2.node);
+  }
+
+  /**
+   * @return A single precision value which is never greater than d.
+   */
+  inline float getLowerBound(double d)
+  {
+    return static_cast<float>(d - std::abs(d) * 1e-6);
+  }
+
+  /**
+   * @brief A candidate pair, with slot1 < slot2 and its criterion q (to be minimized).
+   */
+  struct Candidate_
+  {
+    double q;
+    size_t slot1;
+    size_t slot2;
+  };
+
+  // Ties are resolved in favour of the first pair in slot order, as in NeighborJoining.
+  inline bool isBetter(const Candidate_& c1, const Candidate_& c2)
+  {
+    if (c1.q != c2.q) return c1.q < c2.q;
+    if (c1.slot1 != c2.slot1) return c1.slot1 < c2.slot1;
+    return c1.slot2 < c2.slot2;
+  }
+
+  struct IsDead_
+  {
+    const vector<size_t>* slots;
+    explicit IsDead_(const vector<size_t>& s) : slots(&s) {}
+    bool operator()(const RowEntry_& e) const { return (*slots)[e.node] == string::npos; }
+  };
+}
+
+/******************************************************************************/
+
+void FastNeighborJoining::setDistanceMatrix(const DistanceMatrix& matrix) throw (Exception)
+{
+  if (matrix.size() <= 3)
+    throw Exception("FastNeighborJoining::setDistanceMatrix(): matrix must be at least of dimension 3.");
+  size_t n = matrix.size();
+  names_.resize(n);
+  for (size_t i = 0; i < n; ++i)
+    names_[i] = matrix.getName(i);
+  distances_.resize(n * (n - 1) / 2);
+  for (size_t i = 1; i < n; ++i)
+    for (size_t j = 0; j < i; ++j)
+      distances_[getIndex_(i, j)] = matrix(i, j);
+  if (bioNJ_)
+    variances_ = distances_;
+  else
+    variances_.clear();
+  if (tree_)
+  {
+    delete tree_;
+    tree_ = 0;
+  }
+}
+
+/******************************************************************************/
+
+void FastNeighborJoining::setNumberOfThreads(size_t nbThreads)
+{
+#ifdef _OPENMP
+  if (nbThreads == 0)
+    nbThreads = static_cast<size_t>(omp_get_num_procs());
+  nbThreads_ = nbThreads;
+#else
+  nbThreads_ = 1;
+#endif
+}
+
+/******************************************************************************/
+
+void FastNeighborJoining::computeTree() throw (Exception)
+{
+  size_t n = names_.size();
+  if (n <= 3 || distances_.size() != n * (n - 1) / 2 || (bioNJ_ && variances_.size() != distances_.size()))
+    throw Exception("FastNeighborJoining::computeTree(). No distance matrix set, call setDistanceMatrix() first.");
+  if (tree_)
+  {
+    delete tree_;
+    tree_ = 0;
+  }
+  const size_t npos = string::npos;
+  size_t nbThreads = nbThreads_;
+
+  // Initialization:
+  // Nodes are indexed by slots, the node created by an agglomeration taking the slot of the first node of the pair.
+  // Each node also has a unique id, and the distance of a pair is stored in the sorted row of its most recent node.
+  vector<Node*> nodes(n);
+  vector<unsigned int> nodeIds(n);
+  vector<size_t> slots(2 * n, npos);
+  vector<size_t> active(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    nodes[i] = new Node(static_cast<int>(i), names_[i]);
+    nodeIds[i] = static_cast<unsigned int>(i);
+    slots[i] = i;
+    active[i] = i;
+  }
+  vector<double> sums(n, 0.);
+  vector< vector<RowEntry_> > rows(n);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic, 16) num_threads(static_cast<int>(nbThreads))
+#endif
+  for (long li = 0; li < static_cast<long>(n); ++li)
+  {
+    size_t i = static_cast<size_t>(li);
+    double s = 0.;
+    for (size_t j = 0; j < n; ++j)
+      if (j != i) s += distances_[getIndex_(i, j)];
+    sums[i] = s;
+    vector<RowEntry_>& row = rows[i];
+    row.resize(i);
+    for (size_t j = 0; j < i; ++j)
+    {
+      row[j].distance = getLowerBound(distances_[getIndex_(i, j)]);
+      row[j].node = static_cast<unsigned int>(j);
+    }
+    sort(row.begin(), row.end());
+  }
+  size_t lastPurge = n;
+  int idNextNode = static_cast<int>(n);
+  vector<Candidate_> threadBest(nbThreads);
+  vector<RowEntry_> newRow;
+
+  // Build tree:
+  while (active.size() > (rootTree_ ? 2 : 3))
+  {
+    if (verbose_)
+      ApplicationTools::displayGauge(n - active.size(), n - (rootTree_ ? 2 : 3) - 1);
+    size_t r = active.size();
+    double rm2 = static_cast<double>(r - 2);
+    double sMax = sums[active[0]];
+    for (size_t i = 1; i < r; ++i)
+      if (sums[active[i]] > sMax) sMax = sums[active[i]];
+
+    // Bounded search of the pair minimizing (r-2)d(i,j) - S(i) - S(j):
+    Candidate_ none = { numeric_limits<double>::infinity(), npos, npos };
+    fill(threadBest.begin(), threadBest.end(), none);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic, 16) num_threads(static_cast<int>(nbThreads))
+#endif
+    for (long li = 0; li < static_cast<long>(r); ++li)
+    {
+      size_t t = 0;
+#ifdef _OPENMP
+      t = static_cast<size_t>(omp_get_thread_num());
+#endif
+      Candidate_& best = threadBest[t];
+      size_t s = active[static_cast<size_t>(li)];
+      double su = sums[s];
+      const vector<RowEntry_>& row = rows[s];
+      for (size_t k = 0; k < row.size(); ++k)
+      {
+        // The tolerance guarantees that pairs tied with the current best one are not skipped because of rounding errors:
+        double bound = rm2 * row[k].distance - su - sMax;
+        if (bound - best.q > 1e-12 * (std::abs(su) + std::abs(sMax) + std::abs(best.q)))
+          break;
+        size_t sv = slots[row[k].node];
+        if (sv == npos)
+          continue;
+        Candidate_ c = { rm2 * distances_[getIndex_(s, sv)] - (su + sums[sv]), min(s, sv), max(s, sv) };
+        if (isBetter(c, best))
+          best = c;
+      }
+    }
+    Candidate_ best = threadBest[0];
+    for (size_t t = 1; t < nbThreads; ++t)
+      if (isBetter(threadBest[t], best))
+        best = threadBest[t];
+    if (best.slot1 == npos)
+      throw Exception("FastNeighborJoining::computeTree(). Unexpected error: no minimum criterion found.");
+    size_t a = best.slot1;
+    size_t b = best.slot2;
+
+    // Branch lengths:
+    double dab = distances_[getIndex_(a, b)];
+    double ratio = (sums[a] - sums[b]) / rm2;
+    double la = .5 * (dab + ratio);
+    double lb = .5 * (dab - ratio);
+    if (positiveLengths_)
+    {
+      la = std::max(la, 0.);
+      lb = std::max(lb, 0.);
+    }
+    nodes[a]->setDistanceToFather(la);
+    nodes[b]->setDistanceToFather(lb);
+    Node* parent = new Node(idNextNode);
+    parent->addSon(nodes[a]);
+    parent->addSon(nodes[b]);
+    double lambda = bioNJ_ ? computeLambda_(active, a, b) : .5;
+    double vab = bioNJ_ ? variances_[getIndex_(a, b)] : 0.;
+
+    // Actualize nodes:
+    active.erase(find(active.begin(), active.end(), b));
+    size_t posA = static_cast<size_t>(find(active.begin(), active.end(), a) - active.begin());
+    slots[nodeIds[a]] = npos;
+    slots[nodeIds[b]] = npos;
+    nodeIds[a] = static_cast<unsigned int>(idNextNode);
+    slots[static_cast<size_t>(idNextNode)] = a;
+    nodes[a] = parent;
+    nodes[b] = 0;
+    idNextNode++;
+
+    // Reduction:
+    r = active.size();
+    newRow.resize(r - 1);
+#ifdef _OPENMP
+#  pragma omp parallel for num_threads(static_cast<int>(nbThreads))
+#endif
+    for (long li = 0; li < static_cast<long>(r); ++li)
+    {
+      size_t i = static_cast<size_t>(li);
+      if (i == posA) continue;
+      size_t k = active[i];
+      size_t iak = getIndex_(a, k);
+      size_t ibk = getIndex_(b, k);
+      double dak = distances_[iak];
+      double dbk = distances_[ibk];
+      double d = bioNJ_ ? lambda * (dak - la) + (1. - lambda) * (dbk - lb) : .5 * (dak - la + dbk - lb);
+      if (positiveLengths_)
+        d = std::max(d, 0.);
+      if (bioNJ_)
+        variances_[iak] = lambda * variances_[iak] + (1. - lambda) * variances_[ibk] - lambda * (1. - lambda) * vab;
+      distances_[iak] = d;
+      sums[k] += d - dak - dbk;
+      RowEntry_& e = newRow[i < posA ? i : i - 1];
+      e.distance = getLowerBound(d);
+      e.node = nodeIds[k];
+    }
+    // Summed in a fixed order, so that results do not depend on the number of threads:
+    double sa = 0.;
+    for (size_t i = 0; i < r; ++i)
+      if (i != posA) sa += distances_[getIndex_(a, active[i])];
+    sums[a] = sa;
+    sort(newRow.begin(), newRow.end());
+    rows[a].swap(newRow);
+    vector<RowEntry_>().swap(rows[b]);
+
+    // Entries of agglomerated nodes are skipped during the search, and removed once half of the nodes are gone:
+    if (2 * r < lastPurge)
+    {
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic, 16) num_threads(static_cast<int>(nbThreads))
+#endif
+      for (long li = 0; li < static_cast<long>(r); ++li)
+      {
+        vector<RowEntry_>& row = rows[active[static_cast<size_t>(li)]];
+        row.erase(remove_if(row.begin(), row.end(), IsDead_(slots)), row.end());
+      }
+      lastPurge = r;
+    }
+  }
+  finalStep_(active, nodes, idNextNode);
+
+  // The matrix has been consumed:
+  vector<double>().swap(distances_);
+  vector<double>().swap(variances_);
+}
+
+/******************************************************************************/
+
+double FastNeighborJoining::computeLambda_(const vector<size_t>& active, size_t a, size_t b) const
+{
+  double vab = variances_[getIndex_(a, b)];
+  if (vab == 0)
+    return .5;
+  double lambda = 0;
+  for (size_t i = 0; i < active.size(); ++i)
+  {
+    size_t k = active[i];
+    if (k != a && k != b)
+      lambda += variances_[getIndex_(b, k)] - variances_[getIndex_(a, k)];
+  }
+  lambda /= 2 * static_cast<double>(active.size() - 2) * vab;
+  lambda += .5;
+  if (lambda < 0.)
+    lambda = 0.;
+  if (lambda > 1.)
+    lambda = 1.;
+  return lambda;
+}
+
+/******************************************************************************/
+
+void FastNeighborJoining::finalStep_(const vector<size_t>& active, const vector<Node*>& nodes, int idRoot)
+{
+  Node* root = new Node(idRoot);
+  size_t i1 = active[0];
+  size_t i2 = active[1];
+  Node* n1 = nodes[i1];
+  Node* n2 = nodes[i2];
+  if (active.size() == 2)
+  {
+    // Rooted
+    double d = distances_[getIndex_(i1, i2)] / 2;
+    root->addSon(n1);
+    root->addSon(n2);
+    n1->setDistanceToFather(d);
+    n2->setDistanceToFather(d);
+  }
+  else
+  {
+    // Unrooted
+    size_t i3 = active[2];
+    Node* n3 = nodes[i3];
+    double d12 = distances_[getIndex_(i1, i2)];
+    double d13 = distances_[getIndex_(i1, i3)];
+    double d23 = distances_[getIndex_(i2, i3)];
+    double d1 = d12 + d13 - d23;
+    double d2 = d12 + d23 - d13;
+    double d3 = d13 + d23 - d12;
+    if (positiveLengths_)
+    {
+      d1 = std::max(d1, 0.);
+      d2 = std::max(d2, 0.);
+      d3 = std::max(d3, 0.);
+    }
+    root->addSon(n1);
+    root->addSon(n2);
+    root->addSon(n3);
+    n1->setDistanceToFather(d1 / 2.);
+    n2->setDistanceToFather(d2 / 2.);
+    n3->setDistanceToFather(d3 / 2.);
+  }
+  tree_ = new TreeTemplate<Node>(root);
+}
+
@@ -0,0 +1,220 @@
+//
+// File: FastNeighborJoining.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _FASTNEIGHBORJOINING_H_
+#define _FASTNEIGHBORJOINING_H_
+
+#include "DistanceMethod.h"
+#include "../TreeTemplate.h"
+
+//From bpp-seq:
+#include <Bpp/Seq/DistanceMatrix.h>
+
+//From the STL:
+#include <vector>
+#include <string>
+
+namespace bpp
+{
+
+/**
+ * @brief Neighbor joining and BioNJ for large distance matrices.
+ *
+ * This class builds the same trees as NeighborJoining and BioNJ, but is designed
+ * for matrices with tens of thousands of taxa:
+ * - distances (and variances, for BioNJ) are stored in packed lower-triangular arrays,
+ *   without a copy of the full input matrix;
+ * - the sum of distances of each node is updated after each agglomeration
+ *   instead of being recomputed;
+ * - the pair to agglomerate is found with the bounded search of RapidNJ:
+ *   the distances of each node are sorted in increasing order, and the scan of a
+ *   node stops as soon as no remaining pair can improve the current criterion;
+ * - nodes are scanned, and distances updated, in parallel when OpenMP is available.
+ *
+ * The pair found at each step is always the exact optimum of the neighbor joining criterion,
+ * ties being resolved in favour of the first pair in input order, and results do not depend on
+ * the number of threads. Because sums are updated rather than recomputed, branch lengths may differ
+ * from the ones of NeighborJoining and BioNJ in the last digits, and pairs with equal criteria
+ * (for instance the two possible pairs when only four nodes remain) may be agglomerated in a different order.
+ *
+ * Computing a tree consumes the stored matrix: setDistanceMatrix() has to be called again
+ * before computing another tree.
+ *
+ * References:
+ * - N Saitou and M Nei (1987), _Molecular Biology and Evolution_ 4(4) 406-25.
+ * - O Gascuel (1997), _Molecular Biology and Evolution_ 14(7) 685-95.
+ * - M Simonsen, T Mailund and CNS Pedersen (2008), _Algorithms in Bioinformatics_, LNCS 5251 113-22.
+ */
+class FastNeighborJoining :
+  public virtual AgglomerativeDistanceMethod
+{
+  private:
+    std::vector<std::string> names_;
+    std::vector<double> distances_;
+    std::vector<double> variances_;
+    Tree* tree_;
+    bool bioNJ_;
+    bool rootTree_;
+    bool positiveLengths_;
+    bool verbose_;
+    size_t nbThreads_;
+
+  public:
+    /**
+     * @brief Create a new FastNeighborJoining object instance, without performing any computation.
+     *
+     * @param bioNJ Use the BioNJ reduction instead of the neighbor joining one.
+     * @param rooted Tell if the output tree should be rooted.
+     * @param positiveLengths Tell if negative lengths should be avoided.
+     * @param verbose Allow to display extra information, like progress bars.
+     */
+    FastNeighborJoining(bool bioNJ = false, bool rooted = false, bool positiveLengths = false, bool verbose = true) :
+      names_(), distances_(), variances_(), tree_(0),
+      bioNJ_(bioNJ), rootTree_(rooted), positiveLengths_(positiveLengths), verbose_(verbose), nbThreads_(1)
+    {}
+
+    /**
+     * @brief Create a new FastNeighborJoining object instance and compute a tree from a distance matrix.
+     *
+     * @param matrix Input distance matrix.
+     * @param bioNJ Use the BioNJ reduction instead of the neighbor joining one.
+     * @param rooted Tell if the output tree should be rooted.
+     * @param positiveLengths Tell if negative lengths should be avoided.
+     * @param verbose Allow to display extra information, like progress bars.
+     */
+    FastNeighborJoining(const DistanceMatrix& matrix, bool bioNJ = false, bool rooted = false, bool positiveLengths = false, bool verbose = true) throw (Exception) :
+      names_(), distances_(), variances_(), tree_(0),
+      bioNJ_(bioNJ), rootTree_(rooted), positiveLengths_(positiveLengths), verbose_(verbose), nbThreads_(1)
+    {
+      setDistanceMatrix(matrix);
+      computeTree();
+    }
+
+    FastNeighborJoining(const FastNeighborJoining& fnj) :
+      names_(fnj.names_), distances_(fnj.distances_), variances_(fnj.variances_), tree_(0),
+      bioNJ_(fnj.bioNJ_), rootTree_(fnj.rootTree_), positiveLengths_(fnj.positiveLengths_),
+      verbose_(fnj.verbose_), nbThreads_(fnj.nbThreads_)
+    {
+      if (fnj.tree_)
+        tree_ = new TreeTemplate<Node>(*fnj.tree_);
+    }
+
+    FastNeighborJoining& operator=(const FastNeighborJoining& fnj)
+    {
+      names_           = fnj.names_;
+      distances_       = fnj.distances_;
+      variances_       = fnj.variances_;
+      if (tree_)
+        delete tree_;
+      tree_            = fnj.tree_ ? new TreeTemplate<Node>(*fnj.tree_) : 0;
+      bioNJ_           = fnj.bioNJ_;
+      rootTree_        = fnj.rootTree_;
+      positiveLengths_ = fnj.positiveLengths_;
+      verbose_         = fnj.verbose_;
+      nbThreads_       = fnj.nbThreads_;
+      return *this;
+    }
+
+    virtual ~FastNeighborJoining()
+    {
+      if (tree_)
+        delete tree_;
+    }
+
+    FastNeighborJoining* clone() const { return new FastNeighborJoining(*this); }
+
+  public:
+    std::string getName() const { return bioNJ_ ? "BioNJ" : "NJ"; }
+
+    void setDistanceMatrix(const DistanceMatrix& matrix) throw (Exception);
+
+    void computeTree() throw (Exception);
+
+    /**
+     * @brief Get the computed tree, if there is one.
+     *
+     * @return A copy of the computed tree if there is one, 0 otherwise.
+     */
+#if defined(NO_VIRTUAL_COV)
+    Tree*
+#else
+    TreeTemplate<Node>*
+#endif
+    getTree() const
+    {
+      return tree_ == 0 ? 0 : new TreeTemplate<Node>(*tree_);
+    }
+
+    void setVerbose(bool yn) { verbose_ = yn; }
+    bool isVerbose() const { return verbose_; }
+
+    void outputPositiveLengths(bool yn) { positiveLengths_ = yn; }
+
+    /**
+     * @brief Set the number of threads used for the pair search and the distance updates.
+     *
+     * If the library was built without OpenMP support, computations are always single-threaded.
+     *
+     * @param nbThreads The number of threads to use. 0 means one thread per available processor.
+     */
+    void setNumberOfThreads(size_t nbThreads);
+
+    /**
+     * @return The number of threads used for computations.
+     */
+    size_t getNumberOfThreads() const { return nbThreads_; }
+
+  private:
+    /**
+     * @return The position of the distance between slots i and j in the packed arrays.
+     */
+    static size_t getIndex_(size_t i, size_t j)
+    {
+      return i > j ? i * (i - 1) / 2 + j : j * (j - 1) / 2 + i;
+    }
+
+    double computeLambda_(const std::vector<size_t>& active, size_t a, size_t b) const;
+
+    void finalStep_(const std::vector<size_t>& active, const std::vector<Node*>& nodes, int idRoot);
+};
+
+} //end of namespace bpp.
+
+#endif //_FASTNEIGHBORJOINING_H_
+
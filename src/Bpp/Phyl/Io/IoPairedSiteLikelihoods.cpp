@@ -224,6 +224,70 @@ void IOTreepuzzlePairedSiteLikelihoods::write(const bpp::PairedSiteLikelihoods&
 }
 
 
+/*
+ * Incremental writing in Tree-puzzle, phylip-like format
+ */
+TreepuzzlePairedSiteLikelihoodsWriter::TreepuzzlePairedSiteLikelihoodsWriter(ostream& os, size_t nbModels, size_t nbSites, const string& delim) throw (Exception) :
+  os_(&os),
+  nbModels_(nbModels),
+  nbSites_(nbSites),
+  delim_(delim),
+  nbModelsWritten_(0),
+  nbSitesWritten_(0),
+  inModel_(false)
+{
+  if (delim != "\t" && delim != "  ")
+    throw Exception("TreepuzzlePairedSiteLikelihoodsWriter: Unknown field delimiter \"" + delim + "\".");
+  // Header line
+  *os_ << nbModels_ << " " << nbSites_ << endl;
+}
+
+void TreepuzzlePairedSiteLikelihoodsWriter::beginModel(const string& name) throw (Exception)
+{
+  if (inModel_)
+    throw Exception("TreepuzzlePairedSiteLikelihoodsWriter::beginModel: The previous model was not ended.");
+  if (nbModelsWritten_ == nbModels_)
+    throw Exception("TreepuzzlePairedSiteLikelihoodsWriter::beginModel: All models were already written.");
+  // Names are not aligned, as their lengths are not known in advance:
+  *os_ << name << delim_;
+  nbSitesWritten_ = 0;
+  inModel_ = true;
+}
+
+void TreepuzzlePairedSiteLikelihoodsWriter::writeSites(const vector<double>& siteLogLikelihoods) throw (Exception)
+{
+  if (!inModel_)
+    throw Exception("TreepuzzlePairedSiteLikelihoodsWriter::writeSites: No model was begun.");
+  if (nbSitesWritten_ + siteLogLikelihoods.size() > nbSites_)
+    throw Exception("TreepuzzlePairedSiteLikelihoodsWriter::writeSites: Too many sites for this model.");
+  for (vector<double>::const_iterator sitelik = siteLogLikelihoods.begin();
+       sitelik != siteLogLikelihoods.end();
+       ++sitelik)
+  {
+    if (nbSitesWritten_ > 0)
+      *os_ << " ";
+    *os_ << *sitelik;
+    nbSitesWritten_++;
+  }
+}
+
+void TreepuzzlePairedSiteLikelihoodsWriter::endModel() throw (Exception)
+{
+  if (!inModel_)
+    throw Exception("TreepuzzlePairedSiteLikelihoodsWriter::endModel: No model was begun.");
+  if (nbSitesWritten_ != nbSites_)
+  {
+    ostringstream oss;
+    oss << "TreepuzzlePairedSiteLikelihoodsWriter::endModel: Wrong number of sites ("
+        << nbSitesWritten_ << ", expected: " << nbSites_ << ")";
+    throw Exception(oss.str());
+  }
+  *os_ << endl;
+  nbModelsWritten_++;
+  inModel_ = false;
+}
+
+
 /*
  * Read from a stream in Phyml format
  */
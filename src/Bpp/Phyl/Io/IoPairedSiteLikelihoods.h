@@ -102,6 +102,100 @@ public:
 };
 
 
+/**
+ * @brief Incremental writer for the Tree-Puzzle/RAxML (phylip-like) paired-site likelihoods format.
+ *
+ * Contrary to IOTreepuzzlePairedSiteLikelihoods::write, site log-likelihoods do not need to be stored in a PairedSiteLikelihoods object:
+ * they are written as they are computed, one model after the other.
+ * As the header is written first, the number of models and sites must be known in advance.
+ *
+ * @code
+ * TreepuzzlePairedSiteLikelihoodsWriter writer(os, nbModels, nbSites);
+ * for each model:
+ *   writer.beginModel(name);
+ *   for each chunk of sites:
+ *     writer.writeSites(siteLogLikelihoods);
+ *   writer.endModel();
+ * @endcode
+ */
+class TreepuzzlePairedSiteLikelihoodsWriter
+{
+private:
+  std::ostream* os_;
+  size_t nbModels_;
+  size_t nbSites_;
+  std::string delim_;
+  size_t nbModelsWritten_;
+  size_t nbSitesWritten_;
+  bool inModel_;
+
+public:
+  /**
+   * @brief Build a new writer and write the header line.
+   *
+   * @param os The output stream.
+   * @param nbModels The number of models that will be written.
+   * @param nbSites The number of sites for each model.
+   * @param delim The delimiter between model names and likelihoods. The defaut is a tab but two spaces might be used.
+   * @throw Exception If the delimiter is not supported.
+   */
+  TreepuzzlePairedSiteLikelihoodsWriter(std::ostream& os, size_t nbModels, size_t nbSites, const std::string& delim = "\t") throw (Exception);
+
+  TreepuzzlePairedSiteLikelihoodsWriter(const TreepuzzlePairedSiteLikelihoodsWriter& writer) :
+    os_(writer.os_),
+    nbModels_(writer.nbModels_),
+    nbSites_(writer.nbSites_),
+    delim_(writer.delim_),
+    nbModelsWritten_(writer.nbModelsWritten_),
+    nbSitesWritten_(writer.nbSitesWritten_),
+    inModel_(writer.inModel_)
+  {}
+
+  TreepuzzlePairedSiteLikelihoodsWriter& operator=(const TreepuzzlePairedSiteLikelihoodsWriter& writer)
+  {
+    os_              = writer.os_;
+    nbModels_        = writer.nbModels_;
+    nbSites_         = writer.nbSites_;
+    delim_           = writer.delim_;
+    nbModelsWritten_ = writer.nbModelsWritten_;
+    nbSitesWritten_  = writer.nbSitesWritten_;
+    inModel_         = writer.inModel_;
+    return *this;
+  }
+
+  virtual ~TreepuzzlePairedSiteLikelihoodsWriter() {}
+
+public:
+  /**
+   * @brief Start the line of a new model.
+   *
+   * @param name The name of the model.
+   * @throw Exception If the previous model was not ended, or if all models were already written.
+   */
+  void beginModel(const std::string& name) throw (Exception);
+
+  /**
+   * @brief Append site log-likelihoods to the current model.
+   *
+   * @param siteLogLikelihoods The log-likelihoods of the next sites.
+   * @throw Exception If no model was begun, or if there are more sites than announced.
+   */
+  void writeSites(const std::vector<double>& siteLogLikelihoods) throw (Exception);
+
+  /**
+   * @brief End the line of the current model.
+   *
+   * @throw Exception If the number of sites written for this model is not the one announced.
+   */
+  void endModel() throw (Exception);
+
+  /**
+   * @return The number of models written so far.
+   */
+  size_t getNumberOfModelsWritten() const { return nbModelsWritten_; }
+};
+
+
 /**
  * @brief This class provides input for the Phyml paired-site likelihoods format.
  *
@@ -38,6 +38,7 @@ knowledge of the CeCILL license and that you accept its terms.
 */
 
 #include "Newick.h"
+#include "NewickParser.h"
 #include "../Tree.h"
 #include "../TreeTemplate.h"
 #include "../TreeTemplateTools.h"
@@ -76,24 +77,11 @@ Newick::read(istream& in) const throw (Exception)
   // Checking the existence of specified file
   if (! in) { throw IOException ("Newick::read: failed to read from stream"); }
   
-  //We concatenate all line in file till we reach the ending semi colon:
-  string temp, description;// Initialization
-  // Main loop : for all file lines
-  while (getline(in, temp, '\n'))
-  {
-    string::size_type index = temp.find(";");
-    if(index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      break;
-    }
-    else description += temp;
-  }
-
-  if (allowComments_) description = TextTools::removeSubstrings(description, '[', ']');
-  if (TextTools::isEmpty(description))
+  NewickParser parser(allowComments_, useBootstrap_, bootstrapPropertyName_, false, verbose_);
+  TreeTemplate<Node>* tree = parser.parse(in);
+  if (!tree)
     throw IOException("Newick::read: no tree was found!");
-  return TreeTemplateTools::parenthesisToTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_);
+  return tree;
 }
 
 /******************************************************************************/
@@ -136,23 +124,15 @@ void Newick::read(istream& in, vector<Tree*>& trees) const throw (Exception)
   // Checking the existence of specified file
   if (! in) { throw IOException ("Newick::read: failed to read from stream"); }
   
-  // Main loop : for all file lines
-  string temp, description;// Initialization
-  string::size_type index;
-  //We concatenate all line in file till we reach the ending semi colon:
-  while (getline(in, temp, '\n'))
+  // Trees are parsed one after the other, directly from the stream:
+  NewickParser parser(allowComments_, useBootstrap_, bootstrapPropertyName_, false, verbose_);
+  TreeTemplate<Node>* tree = parser.parse(in);
+  while (tree)
   {
-    index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      if (allowComments_) description = TextTools::removeSubstrings(description, '[', ']');
-      trees.push_back(TreeTemplateTools::parenthesisToTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_));
-      description = temp.substr(index + 1);
-    }
-    else description += temp;
+    trees.push_back(tree);
+    tree = parser.parse(in);
   }
-  //In case the file is empty, the method will not add any neww tree to the vector.
+  //In case the file is empty, the method will not add any new tree to the vector.
 }
 
 /******************************************************************************/
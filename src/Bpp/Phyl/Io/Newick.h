@@ -79,6 +79,9 @@ namespace bpp
  * This is achieved by calling the enableExtendedBootstrapProperty method, and providing a property name to use.
  * The additional information will be stored at each node as a property, in a String object.
  * The disableExtendedBootstrapProperty method restores the default behavior.
+ *
+ * Trees are parsed with a NewickParser. To read large multi-tree files in parallel,
+ * or in compact form, see NewickBatchReader.
  */
 class Newick:
   public AbstractITree,
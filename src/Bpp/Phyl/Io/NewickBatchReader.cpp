@@ -0,0 +1,244 @@
+//
+// File: NewickBatchReader.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "NewickBatchReader.h"
+
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+using namespace std;
+
+/******************************************************************************/
+
+void NewickBatchReader::setNumberOfThreads(size_t nbThreads)
+{
+#ifdef _OPENMP
+  if (nbThreads == 0)
+    nbThreads = static_cast<size_t>(omp_get_num_procs());
+  nbThreads_ = nbThreads;
+#else
+  nbThreads_ = 1;
+#endif
+}
+
+/******************************************************************************/
+
+void NewickBatchReader::split_(istream& in, vector<string>& descriptions) const
+{
+  descriptions.clear();
+  size_t batchSize = max(batchSize_, static_cast<size_t>(1));
+  string description, next;
+  while (descriptions.size() < batchSize && getline(in, description, ';'))
+  {
+    if (allowComments_)
+    {
+      // A semi-colon within a comment does not end the tree:
+      int level = 0;
+      size_t checked = 0;
+      while (true)
+      {
+        for ( ; checked < description.size(); ++checked)
+        {
+          if (description[checked] == '[') level++;
+          else if (description[checked] == ']') level--;
+        }
+        if (level <= 0 || in.eof() || !getline(in, next, ';'))
+          break;
+        description += ';';
+        description += next;
+      }
+    }
+    // The semi-colon is not present if the end of the stream was reached:
+    if (!in.eof())
+      description += ';';
+    descriptions.push_back(description);
+  }
+}
+
+/******************************************************************************/
+
+size_t NewickBatchReader::read(istream& in, vector<Tree*>& trees) const throw (Exception)
+{
+  if (in.eof()) return 0;
+  if (!in) throw IOException("NewickBatchReader::read. Failed to read from stream.");
+  vector<string> descriptions;
+  split_(in, descriptions);
+
+  vector<Tree*> batch(descriptions.size(), 0);
+  size_t errorIndex = descriptions.size();
+  string error;
+  long n = static_cast<long>(descriptions.size());
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads_))
+#endif
+  for (long li = 0; li < n; ++li)
+  {
+    size_t i = static_cast<size_t>(li);
+    try
+    {
+      const char* pos = descriptions[i].data();
+      const char* end = pos + descriptions[i].size();
+      batch[i] = parser_.parse(pos, end);
+    }
+    catch (std::exception& ex)
+    {
+#ifdef _OPENMP
+#  pragma omp critical
+#endif
+      {
+        // Report the first error in the batch:
+        if (i < errorIndex)
+        {
+          errorIndex = i;
+          error = ex.what();
+        }
+      }
+    }
+  }
+  if (errorIndex < descriptions.size())
+  {
+    for (size_t i = 0; i < batch.size(); ++i)
+      delete batch[i];
+    throw IOException("NewickBatchReader::read. Error in tree " + TextTools::toString(errorIndex + 1) + " of the batch: " + error);
+  }
+
+  size_t nbTrees = 0;
+  for (size_t i = 0; i < batch.size(); ++i)
+  {
+    if (batch[i])
+    {
+      trees.push_back(batch[i]);
+      nbTrees++;
+    }
+  }
+  return nbTrees;
+}
+
+/******************************************************************************/
+
+size_t NewickBatchReader::read(istream& in, vector<CompactTree>& trees) throw (Exception)
+{
+  if (in.eof())
+  {
+    trees.clear();
+    return 0;
+  }
+  if (!in) throw IOException("NewickBatchReader::read. Failed to read from stream.");
+  vector<string> descriptions;
+  split_(in, descriptions);
+  trees.resize(descriptions.size());
+  vector<char> found(descriptions.size(), 0);
+  size_t errorIndex = descriptions.size();
+  string error;
+
+  // Leaf names are indexed from the first tree, so that the other ones can be parsed concurrently:
+  long first = 0;
+  if (leafIndex_.empty() && descriptions.size() > 0)
+  {
+    try
+    {
+      const char* pos = descriptions[0].data();
+      found[0] = parser_.parse(pos, pos + descriptions[0].size(), trees[0], leafIndex_, true);
+    }
+    catch (std::exception& ex)
+    {
+      throw IOException("NewickBatchReader::read. Error in tree 1 of the batch: " + string(ex.what()));
+    }
+    leavesNames_.resize(leafIndex_.size());
+    for (map<string, int>::const_iterator it = leafIndex_.begin(); it != leafIndex_.end(); ++it)
+      leavesNames_[static_cast<size_t>(it->second)] = it->first;
+    first = 1;
+  }
+
+  long n = static_cast<long>(descriptions.size());
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads_))
+#endif
+  for (long li = first; li < n; ++li)
+  {
+    size_t i = static_cast<size_t>(li);
+    try
+    {
+      const char* pos = descriptions[i].data();
+      const char* end = pos + descriptions[i].size();
+      found[i] = parser_.parse(pos, end, trees[i], leafIndex_, false);
+    }
+    catch (std::exception& ex)
+    {
+#ifdef _OPENMP
+#  pragma omp critical
+#endif
+      {
+        // Report the first error in the batch:
+        if (i < errorIndex)
+        {
+          errorIndex = i;
+          error = ex.what();
+        }
+      }
+    }
+  }
+  if (errorIndex < descriptions.size())
+    throw IOException("NewickBatchReader::read. Error in tree " + TextTools::toString(errorIndex + 1) + " of the batch: " + error);
+
+  // Only blanks may be found after the last tree:
+  size_t nbTrees = 0;
+  for (size_t i = 0; i < found.size(); ++i)
+  {
+    if (found[i])
+    {
+      if (nbTrees != i)
+        swap(trees[nbTrees], trees[i]);
+      nbTrees++;
+    }
+  }
+  trees.resize(nbTrees);
+  return nbTrees;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,164 @@
+//
+// File: NewickBatchReader.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _NEWICKBATCHREADER_H_
+#define _NEWICKBATCHREADER_H_
+
+#include "NewickParser.h"
+#include "../Tree.h"
+#include "../CompactTree.h"
+
+// From the STL:
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+namespace bpp
+{
+
+/**
+ * @brief Read large multi-tree Newick files by batches, in parallel.
+ *
+ * Trees are read by batches of a given size: the descriptions of the trees of a batch
+ * are first extracted from the stream, by splitting it on semi-colons, and then parsed
+ * in parallel with a NewickParser.
+ *
+ * Trees can be read either as Tree objects, or in compact form (CompactTree), which only
+ * stores the topology and the branch lengths and does not allocate any object per node.
+ * The compact form is meant for posterior or bootstrap samples, which are only used to
+ * compute bipartitions, consensus trees or tree distances.
+ * In this case, all trees must share the same leaf names: the names are indexed from the
+ * first tree read, and available with getLeavesNames().
+ *
+ * Code example:
+ * @code
+ * NewickBatchReader reader(1000);
+ * reader.setNumberOfThreads(0);
+ * ifstream in("trees.dnd");
+ * vector<CompactTree> trees;
+ * while (reader.read(in, trees) > 0)
+ * {
+ *   // Process the batch...
+ * }
+ * @endcode
+ */
+class NewickBatchReader
+{
+  private:
+    NewickParser parser_;
+    bool allowComments_;
+    size_t batchSize_;
+    size_t nbThreads_;
+    std::map<std::string, int> leafIndex_;
+    std::vector<std::string> leavesNames_;
+
+  public:
+    /**
+     * @param batchSize     The maximum number of trees read at once.
+     * @param allowComments Tell if comments between [] are allowed in file.
+     * @param bootstrap     Tell if real bootstrap values are expected, see NewickParser. Not used in compact form.
+     * @param propertyName  The name of the property to store labels of internal nodes in, if bootstrap = false.
+     */
+    NewickBatchReader(size_t batchSize = 1000, bool allowComments = false, bool bootstrap = true, const std::string& propertyName = TreeTools::BOOTSTRAP) :
+      parser_(allowComments, bootstrap, propertyName),
+      allowComments_(allowComments),
+      batchSize_(batchSize),
+      nbThreads_(1),
+      leafIndex_(),
+      leavesNames_() {}
+
+    virtual ~NewickBatchReader() {}
+
+  public:
+    void setBatchSize(size_t batchSize) { batchSize_ = batchSize; }
+
+    size_t getBatchSize() const { return batchSize_; }
+
+    /**
+     * @brief Set the number of threads used to parse trees.
+     *
+     * @param nbThreads The number of threads, 0 meaning all available processors.
+     * Without OpenMP support, trees are parsed by a single thread.
+     */
+    void setNumberOfThreads(size_t nbThreads);
+
+    size_t getNumberOfThreads() const { return nbThreads_; }
+
+    /**
+     * @brief Read the next batch of trees.
+     *
+     * @param in The input stream.
+     * @param trees [out] The trees read are appended to this vector.
+     * @return The number of trees read, 0 at the end of the stream.
+     * @throw IOException in case of bad format.
+     */
+    size_t read(std::istream& in, std::vector<Tree*>& trees) const throw (Exception);
+
+    /**
+     * @brief Read the next batch of trees, in compact form.
+     *
+     * The content of the vector is replaced by the trees of the batch.
+     * Trees already in the vector are reused, so that reading successive batches in the same
+     * vector does not require new memory allocations.
+     *
+     * @param in The input stream.
+     * @param trees [out] The trees read.
+     * @return The number of trees read, 0 at the end of the stream.
+     * @throw IOException in case of bad format, or if a leaf name is not present in the first tree read.
+     */
+    size_t read(std::istream& in, std::vector<CompactTree>& trees) throw (Exception);
+
+    /**
+     * @return The names of the leaves of the trees read in compact form, in the order of their indices.
+     */
+    const std::vector<std::string>& getLeavesNames() const { return leavesNames_; }
+
+  private:
+    /**
+     * @brief Extract the descriptions of the trees of the next batch.
+     */
+    void split_(std::istream& in, std::vector<std::string>& descriptions) const;
+
+};
+
+} //end of namespace bpp.
+
+#endif //_NEWICKBATCHREADER_H_
+
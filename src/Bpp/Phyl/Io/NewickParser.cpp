@@ -0,0 +1,532 @@
+//
+// File: NewickParser.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "NewickParser.h"
+#include "../TreeTemplateTools.h"
+
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/BppString.h>
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <cstdlib>
+#include <vector>
+#include <map>
+#include <limits>
+#include <utility>
+
+using namespace std;
+
+/******************************************************************************/
+
+namespace
+{
+  // Character sources for the parser, returning -1 at the end of the input:
+
+  class StreamSource
+  {
+    private:
+      istream* in_;
+      streambuf* buffer_;
+
+    public:
+      StreamSource(istream& in) : in_(&in), buffer_(in.rdbuf()) {}
+      StreamSource(const StreamSource& src) : in_(src.in_), buffer_(src.buffer_) {}
+      StreamSource& operator=(const StreamSource& src)
+      {
+        in_ = src.in_;
+        buffer_ = src.buffer_;
+        return *this;
+      }
+
+    public:
+      int get()
+      {
+        int c = buffer_->sbumpc();
+        if (c == char_traits<char>::eof())
+        {
+          in_->setstate(ios::eofbit);
+          return -1;
+        }
+        return c;
+      }
+  };
+
+  class BufferSource
+  {
+    private:
+      const char* pos_;
+      const char* end_;
+
+    public:
+      BufferSource(const char* pos, const char* end) : pos_(pos), end_(end) {}
+
+    public:
+      int get() { return pos_ < end_ ? static_cast<unsigned char>(*pos_++) : -1; }
+      const char* getPosition() const { return pos_; }
+  };
+}
+
+/******************************************************************************/
+
+/**
+ * @brief Builds a tree made of Node objects.
+ */
+class NewickParser::NodeBuilder_
+{
+  private:
+    const NewickParser* parser_;
+    Node* root_;
+    Node* current_;
+    // The ancestors of the current node, from the root:
+    vector<Node*> ancestors_;
+
+  public:
+    NodeBuilder_(const NewickParser& parser) :
+      parser_(&parser), root_(new Node()), current_(root_), ancestors_() {}
+
+    ~NodeBuilder_()
+    {
+      if (root_)
+      {
+        TreeTemplateTools::deleteSubtree(root_);
+        delete root_;
+      }
+    }
+
+  private:
+    NodeBuilder_(const NodeBuilder_&);
+    NodeBuilder_& operator=(const NodeBuilder_&);
+
+  public:
+    Node* release()
+    {
+      Node* root = root_;
+      root_ = 0;
+      return root;
+    }
+
+    void down()
+    {
+      ancestors_.push_back(current_);
+      current_ = new Node();
+      ancestors_.back()->addSon(current_);
+    }
+
+    void next()
+    {
+      current_ = new Node();
+      ancestors_.back()->addSon(current_);
+    }
+
+    void up()
+    {
+      current_ = ancestors_.back();
+      ancestors_.pop_back();
+    }
+
+    void setElement(const string& label, const string& length, const string& annotation)
+    {
+      parser_->setElement_(*current_, label, length, annotation);
+    }
+};
+
+/******************************************************************************/
+
+/**
+ * @brief Builds a CompactTree.
+ *
+ * Nodes are added when they are complete, that is in post-order.
+ */
+class NewickParser::CompactBuilder_
+{
+  private:
+    CompactTree* tree_;
+    map<string, int>* leafIndex_;
+    bool newLeaves_;
+    // For each open node, the number of sons already added:
+    vector<size_t> nbSons_;
+    // Nodes already added, waiting for their father:
+    vector<size_t> pending_;
+    // Number of sons of the current node, if it is an internal one:
+    size_t nbSonsOfCurrent_;
+
+  public:
+    CompactBuilder_(CompactTree& tree, map<string, int>& leafIndex, bool newLeaves) :
+      tree_(&tree), leafIndex_(&leafIndex), newLeaves_(newLeaves), nbSons_(), pending_(), nbSonsOfCurrent_(0)
+    {
+      tree_->clear();
+    }
+
+  private:
+    CompactBuilder_(const CompactBuilder_&);
+    CompactBuilder_& operator=(const CompactBuilder_&);
+
+  public:
+    void down() { nbSons_.push_back(0); }
+
+    void next() {}
+
+    void up()
+    {
+      nbSonsOfCurrent_ = nbSons_.back();
+      nbSons_.pop_back();
+    }
+
+    void setElement(const string& label, const string& length, const string& annotation)
+    {
+      double distance = length.empty() ? numeric_limits<double>::quiet_NaN() : toDouble_(length);
+      size_t node;
+      if (nbSonsOfCurrent_ > 0)
+      {
+        node = tree_->addNode(-1, distance);
+        for (size_t i = pending_.size() - nbSonsOfCurrent_; i < pending_.size(); ++i)
+          tree_->setFather(pending_[i], node);
+        pending_.resize(pending_.size() - nbSonsOfCurrent_);
+        nbSonsOfCurrent_ = 0;
+      }
+      else
+      {
+        map<string, int>::const_iterator it = leafIndex_->find(label);
+        int leaf;
+        if (it != leafIndex_->end())
+          leaf = it->second;
+        else if (newLeaves_)
+        {
+          leaf = static_cast<int>(leafIndex_->size());
+          (*leafIndex_)[label] = leaf;
+        }
+        else
+          throw Exception("NewickParser::parse. Unknown leaf name: " + label);
+        node = tree_->addNode(leaf, distance);
+      }
+      pending_.push_back(node);
+      if (!nbSons_.empty())
+        nbSons_.back()++;
+    }
+};
+
+/******************************************************************************/
+
+TreeTemplate<Node>* NewickParser::parse(istream& in) const throw (Exception)
+{
+  if (!in) throw IOException("NewickParser::parse. Failed to read from stream.");
+  StreamSource source(in);
+  beginTree_();
+  NodeBuilder_ builder(*this);
+  unsigned int nodeCounter = 0;
+  return parse_(source, builder, nodeCounter, true) ? makeTree_(builder.release()) : 0;
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* NewickParser::parse(const char*& pos, const char* end) const throw (Exception)
+{
+  BufferSource source(pos, end);
+  beginTree_();
+  NodeBuilder_ builder(*this);
+  unsigned int nodeCounter = 0;
+  bool found = parse_(source, builder, nodeCounter, true);
+  pos = source.getPosition();
+  return found ? makeTree_(builder.release()) : 0;
+}
+
+/******************************************************************************/
+
+bool NewickParser::parse(const char*& pos, const char* end, CompactTree& tree, map<string, int>& leafIndex, bool newLeaves) const throw (Exception)
+{
+  BufferSource source(pos, end);
+  CompactBuilder_ builder(tree, leafIndex, newLeaves);
+  unsigned int nodeCounter = 0;
+  bool found = parse_(source, builder, nodeCounter, true);
+  pos = source.getPosition();
+  return found;
+}
+
+/******************************************************************************/
+
+Node* NewickParser::parseNode(const string& description, unsigned int& nodeCounter) const throw (Exception)
+{
+  BufferSource source(description.data(), description.data() + description.size());
+  NodeBuilder_ builder(*this);
+  if (!parse_(source, builder, nodeCounter, false))
+    throw IOException("NewickParser::parseNode. Empty description.");
+  return builder.release();
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* NewickParser::makeTree_(Node* root) const
+{
+  TreeTemplate<Node>* tree = new TreeTemplate<Node>();
+  tree->setRootNode(root);
+  if (!hasNodesId_())
+  {
+    // Same numbering as TreeTemplate::resetNodesId() (post-order), without recursion:
+    int id = 0;
+    vector< pair<Node*, size_t> > path(1, pair<Node*, size_t>(root, 0));
+    while (!path.empty())
+    {
+      pair<Node*, size_t>& last = path.back();
+      if (last.second < last.first->getNumberOfSons())
+      {
+        Node* son = last.first->getSon(last.second++);
+        path.push_back(pair<Node*, size_t>(son, 0));
+      }
+      else
+      {
+        last.first->setId(id++);
+        path.pop_back();
+      }
+    }
+  }
+  if (verbose_ && ApplicationTools::message)
+  {
+    (*ApplicationTools::message) << " nodes loaded.";
+    ApplicationTools::message->endLine();
+  }
+  return tree;
+}
+
+/******************************************************************************/
+
+template<class Source, class Builder>
+bool NewickParser::parse_(Source& source, Builder& builder, unsigned int& nodeCounter, bool needSemiColon) const throw (Exception)
+{
+  // Skip blanks before the tree:
+  int c = source.get();
+  while (c != -1 && TextTools::isWhiteSpaceCharacter(static_cast<char>(c)))
+    c = source.get();
+  if (c == -1)
+    return false;
+
+  bool withComments = allowComments_ || !annotationPrefix_.empty();
+  // Number of open parentheses:
+  size_t depth = 0;
+  // Tells if the sons of the current node have already been read:
+  bool closed = false;
+  bool complete = false;
+  string label, length, annotation, comment;
+  while (c != -1)
+  {
+    switch (c)
+    {
+    case '(':
+      if (closed || !TextTools::isEmpty(label))
+        throw IOException("NewickParser::parse. Invalid format: unexpected '(' after '" + label + "'.");
+      label.clear();
+      depth++;
+      builder.down();
+      break;
+    case ',':
+      if (depth == 0)
+        throw IOException("NewickParser::parse. Invalid format: ',' outside of parentheses.");
+      endElement_(builder, label, length, annotation, nodeCounter);
+      closed = false;
+      builder.next();
+      break;
+    case ')':
+      if (depth == 0)
+        throw IOException("NewickParser::parse. Invalid format: bad closing parenthesis.");
+      endElement_(builder, label, length, annotation, nodeCounter);
+      depth--;
+      closed = true;
+      builder.up();
+      break;
+    case ';':
+      complete = true;
+      break;
+    case '\n':
+      // Lines are concatenated.
+      break;
+    case '[':
+      if (withComments)
+      {
+        // Comments may be nested:
+        comment.clear();
+        int level = 1;
+        while (level > 0)
+        {
+          c = source.get();
+          if (c == -1)
+            throw IOException("NewickParser::parse. Invalid format: unterminated comment.");
+          if (c == '[') level++;
+          else if (c == ']') level--;
+          if (level > 0) comment += static_cast<char>(c);
+        }
+        if (!annotationPrefix_.empty() && comment.compare(0, annotationPrefix_.size(), annotationPrefix_) == 0)
+          annotation = comment.substr(annotationPrefix_.size());
+        break;
+      }
+      label += static_cast<char>(c);
+      break;
+    default:
+      label += static_cast<char>(c);
+    }
+    if (complete) break;
+    c = source.get();
+  }
+  if (!complete && needSemiColon)
+    throw IOException("NewickParser::parse. Bad format: no semi-colon found.");
+  if (depth > 0)
+    throw IOException("NewickParser::parse. Invalid format: missing closing parenthesis.");
+  endElement_(builder, label, length, annotation, nodeCounter);
+  return true;
+}
+
+/******************************************************************************/
+
+template<class Builder>
+void NewickParser::endElement_(Builder& builder, string& label, string& length, string& annotation, unsigned int& nodeCounter) const throw (Exception)
+{
+  // Strings are trimmed in place, so that their memory is reused from one element to the next:
+  string::size_type colon = label.rfind(':');
+  if (colon != string::npos)
+  {
+    length.assign(label, colon + 1, string::npos);
+    label.erase(colon);
+    trim_(length);
+  }
+  trim_(label);
+  builder.setElement(label, length, annotation);
+  label.clear();
+  length.clear();
+  annotation.clear();
+  nodeCounter++;
+  if (verbose_)
+    ApplicationTools::displayUnlimitedGauge(nodeCounter);
+}
+
+/******************************************************************************/
+
+void NewickParser::setElement_(Node& node, const string& label, const string& length, const string& annotation) const throw (Exception)
+{
+  if (!length.empty())
+    node.setDistanceToFather(toDouble_(length));
+  if (node.isLeaf())
+  {
+    if (withId_)
+    {
+      // The id is appended to the name, after the last '_':
+      string::size_type sep = label.rfind('_');
+      node.setName(sep == string::npos ? "" : label.substr(0, sep));
+      node.setId(TextTools::toInt(sep == string::npos ? label : label.substr(sep + 1)));
+    }
+    else
+    {
+      node.setName(label);
+    }
+  }
+  else if (!label.empty())
+  {
+    if (withId_)
+      node.setId(TextTools::toInt(label));
+    else if (bootstrap_)
+      node.setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(toDouble_(label)));
+    else
+      node.setBranchProperty(propertyName_, BppString(label));
+  }
+}
+
+/******************************************************************************/
+
+void NewickParser::trim_(string& s)
+{
+  size_t end = s.size();
+  while (end > 0 && TextTools::isWhiteSpaceCharacter(s[end - 1]))
+    end--;
+  s.erase(end);
+  size_t begin = 0;
+  while (begin < s.size() && TextTools::isWhiteSpaceCharacter(s[begin]))
+    begin++;
+  s.erase(0, begin);
+}
+
+/******************************************************************************/
+
+double NewickParser::toDouble_(const string& s) throw (Exception)
+{
+  // Fast path for plain decimal numbers with at most 15 significant digits, such as most branch lengths:
+  // both the integer made of their digits and the power of ten are exact doubles,
+  // and their quotient is correctly rounded, as with strtod.
+  static const double powersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  const char* p = s.c_str();
+  bool negative = (*p == '-');
+  if (*p == '-' || *p == '+') p++;
+  double digits = 0;
+  int nbDigits = 0, nbDecimals = 0;
+  bool point = false, valid = true, anyDigit = false;
+  for ( ; *p && valid; ++p)
+  {
+    if (*p >= '0' && *p <= '9')
+    {
+      anyDigit = true;
+      if (nbDigits > 0 || *p != '0') nbDigits++;
+      if (point) nbDecimals++;
+      digits = digits * 10. + (*p - '0');
+    }
+    else if (*p == '.' && !point)
+      point = true;
+    else
+      valid = false;
+  }
+  if (valid && anyDigit && nbDigits <= 15 && nbDecimals <= 22)
+  {
+    double x = digits / powersOf10[nbDecimals];
+    return negative ? -x : x;
+  }
+
+  const char* begin = s.c_str();
+  char* end = 0;
+  double x = strtod(begin, &end);
+  // Anything strtod does not fully read (including numbers in another locale)
+  // is left to TextTools, which also reports errors:
+  if (end == begin || *end != '\0')
+    x = TextTools::toDouble(s);
+  return x;
+}
+
+/******************************************************************************/
+
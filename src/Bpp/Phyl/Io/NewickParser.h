@@ -0,0 +1,207 @@
+//
+// File: NewickParser.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _NEWICKPARSER_H_
+#define _NEWICKPARSER_H_
+
+#include "../TreeTemplate.h"
+#include "../TreeTools.h"
+#include "../CompactTree.h"
+
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <string>
+#include <map>
+#include <iostream>
+
+namespace bpp
+{
+
+/**
+ * @brief Single-pass parser for trees in the parenthesis format.
+ *
+ * Trees are read character by character, and the nodes are built while reading,
+ * without copying any part of the description nor recursing on the subtrees.
+ * Parsing is hence linear in the size of the description, and deep or
+ * caterpillar trees do not overflow the stack.
+ * Trees can be read directly from a stream, or from a buffer in memory, for instance a memory-mapped file:
+ * @code
+ * NewickParser parser;
+ * const char* pos = buffer;
+ * TreeTemplate<Node>* tree;
+ * while ((tree = parser.parse(pos, buffer + size)))
+ * {
+ *   ...
+ *   delete tree;
+ * }
+ * @endcode
+ *
+ * Results are identical to the ones of the former recursive parser:
+ * leaf names and internal node labels are trimmed, lines are concatenated and
+ * labels of internal nodes are stored as bootstrap values or as another property.
+ *
+ * The way elements are stored in the nodes can be changed in derived classes, see setElement_().
+ */
+class NewickParser
+{
+  protected:
+    bool allowComments_;
+    bool bootstrap_;
+    std::string propertyName_;
+    bool withId_;
+    bool verbose_;
+    std::string annotationPrefix_;
+
+  public:
+    /**
+     * @param allowComments Tell if comments between [] are allowed, in which case they are ignored.
+     * @param bootstrap     Tell if real bootstrap values are expected. If so, a property with name TreeTools::BOOTSTRAP will be created and stored at the corresponding node.
+     * The property value will be of type Number<double>. Otherwise, an object of type String will be created and stored with the property name propertyName.
+     * @param propertyName  The name of the property to store. Only used if bootstrap = false.
+     * @param withId        Tells if node ids have been stored in the tree. See TreeTemplateTools::parenthesisToTree().
+     * @param verbose       Tell if some information should be displayed, like progress bars for large trees.
+     */
+    NewickParser(bool allowComments = false, bool bootstrap = true, const std::string& propertyName = TreeTools::BOOTSTRAP, bool withId = false, bool verbose = false) :
+      allowComments_(allowComments),
+      bootstrap_(bootstrap),
+      propertyName_(propertyName),
+      withId_(withId),
+      verbose_(verbose),
+      annotationPrefix_() {}
+
+    virtual ~NewickParser() {}
+
+  public:
+    /**
+     * @brief Read the next tree from a stream.
+     *
+     * The stream is read up to the semi-colon ending the tree.
+     *
+     * @param in The input stream.
+     * @return A pointer toward a dynamically created tree, or 0 if no tree was found before the end of the stream.
+     * @throw IOException in case of bad format.
+     */
+    TreeTemplate<Node>* parse(std::istream& in) const throw (Exception);
+
+    /**
+     * @brief Read the next tree from a buffer.
+     *
+     * @param pos [in,out] The position where to start reading. After parsing, it points just after the semi-colon ending the tree.
+     * @param end The end of the buffer.
+     * @return A pointer toward a dynamically created tree, or 0 if no tree was found before the end of the buffer.
+     * @throw IOException in case of bad format.
+     */
+    TreeTemplate<Node>* parse(const char*& pos, const char* end) const throw (Exception);
+
+    /**
+     * @brief Read the next tree from a buffer, as a CompactTree.
+     *
+     * Only the topology, the leaf names and the branch lengths are read: no Node object is created.
+     *
+     * @param pos [in,out] The position where to start reading. After parsing, it points just after the semi-colon ending the tree.
+     * @param end The end of the buffer.
+     * @param tree [out] The tree read.
+     * @param leafIndex [in,out] The indices of the leaf names, used as leaf indices in the tree.
+     * @param newLeaves Tell if leaf names which are not in leafIndex should be added to it.
+     * Otherwise an exception is thrown for such names. leafIndex is not modified in this case, so that several threads can share it.
+     * @return False if no tree was found before the end of the buffer.
+     * @throw IOException in case of bad format.
+     */
+    bool parse(const char*& pos, const char* end, CompactTree& tree, std::map<std::string, int>& leafIndex, bool newLeaves = true) const throw (Exception);
+
+    /**
+     * @brief Parse a subtree description, without ending semi-colon.
+     *
+     * @param description The description to parse.
+     * @param nodeCounter [in,out] Incremented by the number of nodes created.
+     * @return A pointer toward a dynamically created subtree.
+     * @throw IOException in case of bad format.
+     */
+    Node* parseNode(const std::string& description, unsigned int& nodeCounter) const throw (Exception);
+
+  protected:
+    /**
+     * @brief Store the information of an element in the corresponding node.
+     *
+     * @param node       The node to set up.
+     * @param label      The trimmed name of a leaf, or label of an internal node.
+     * @param length     The trimmed branch length, if any.
+     * @param annotation The content of the annotation of the node, if any (see annotationPrefix_).
+     */
+    virtual void setElement_(Node& node, const std::string& label, const std::string& length, const std::string& annotation) const throw (Exception);
+
+    /**
+     * @brief Called before each tree is parsed.
+     */
+    virtual void beginTree_() const {}
+
+    /**
+     * @return True if the ids of the nodes are set by the parser, false if they should be reset after parsing.
+     */
+    virtual bool hasNodesId_() const { return withId_; }
+
+    /**
+     * @brief Fast conversion of a number, which does not create any stream.
+     */
+    static double toDouble_(const std::string& s) throw (Exception);
+
+  private:
+    // Builders of the different tree representations, see NewickParser.cpp:
+    class NodeBuilder_;
+    class CompactBuilder_;
+    friend class NodeBuilder_;
+    friend class CompactBuilder_;
+
+    template<class Source, class Builder>
+    bool parse_(Source& source, Builder& builder, unsigned int& nodeCounter, bool needSemiColon) const throw (Exception);
+
+    template<class Builder>
+    void endElement_(Builder& builder, std::string& label, std::string& length, std::string& annotation, unsigned int& nodeCounter) const throw (Exception);
+
+    static void trim_(std::string& s);
+
+    TreeTemplate<Node>* makeTree_(Node* root) const;
+
+};
+
+} //end of namespace bpp.
+
+#endif //_NEWICKPARSER_H_
+
@@ -38,6 +38,7 @@ knowledge of the CeCILL license and that you accept its terms.
 */
 
 #include "Nhx.h"
+#include "NewickParser.h"
 #include "../Tree.h"
 #include "../TreeTemplate.h"
 
@@ -84,6 +85,71 @@ Nhx::Nhx(bool useTagsAsPptNames):
 
 /******************************************************************************/
 
+/**
+ * @brief Parser for Nhx trees.
+ *
+ * Comments are ignored, except the ones starting with "&&NHX:", which are
+ * parsed as node annotations. Node ids are set from the ND tag if present.
+ */
+class Nhx::Parser:
+  public NewickParser
+{
+  private:
+    const Nhx* nhx_;
+    mutable bool hasIds_;
+
+  public:
+    Parser(const Nhx& nhx, bool hasIds = false) :
+      NewickParser(true, false),
+      nhx_(&nhx),
+      hasIds_(hasIds)
+    {
+      annotationPrefix_ = "&&NHX:";
+    }
+
+    Parser(const Parser& parser) :
+      NewickParser(parser),
+      nhx_(parser.nhx_),
+      hasIds_(parser.hasIds_) {}
+
+    Parser& operator=(const Parser& parser)
+    {
+      NewickParser::operator=(parser);
+      nhx_ = parser.nhx_;
+      hasIds_ = parser.hasIds_;
+      return *this;
+    }
+
+    virtual ~Parser() {}
+
+  public:
+    bool hasIds() const { return hasIds_; }
+
+  protected:
+    void beginTree_() const { hasIds_ = false; }
+
+    bool hasNodesId_() const { return hasIds_; }
+
+    void setElement_(Node& node, const string& label, const string& length, const string& annotation) const throw (Exception)
+    {
+      if (!length.empty())
+        node.setDistanceToFather(toDouble_(length));
+      if (!TextTools::isEmpty(annotation))
+      {
+        bool hasId = nhx_->setNodeProperties(node, annotation);
+        if (!hasIds_ && hasId)
+          hasIds_ = true;
+        if (hasIds_ && !hasId)
+          throw Exception("Nhx::parenthesisToNode. At least one one is missing an id (ND tag).");
+      }
+      // Labels of internal nodes are ignored:
+      if (node.isLeaf())
+        node.setName(label);
+    }
+};
+
+/******************************************************************************/
+
 const string Nhx::getFormatName() const { return "Nhx"; }
 
 /******************************************************************************/
@@ -106,24 +172,12 @@ Nhx::read(istream& in) const throw (Exception)
   // Checking the existence of specified file
   if (! in) { throw IOException ("Nhx ::read: failed to read from stream"); }
   
-  //We concatenate all line in file till we reach the ending semi colon:
-  string temp, description;// Initialization
-  // Main loop : for all file lines
-  while (! in.eof())
-  {
-    getline(in, temp, '\n');  // Copy current line in temporary string
-    string::size_type index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      break;
-    }
-    else description += temp;
-  }
-  vector<string> beginnings, endings;
-  beginnings.push_back("[&&NHX:");
-  description = TextTools::removeSubstrings(description, '[', ']', beginnings, endings);
-  return parenthesisToTree(description);
+  Parser parser(*this);
+  TreeTemplate<Node>* tree = parser.parse(in);
+  if (!tree)
+    throw IOException("Nhx::read: no tree was found!");
+  hasIds_ = parser.hasIds();
+  return tree;
 }
 
 /******************************************************************************/
@@ -152,28 +206,15 @@ void Nhx::read(istream& in, vector<Tree*>& trees) const throw (Exception)
   // Checking the existence of specified file
   if (! in) { throw IOException ("Nhx::read: failed to read from stream"); }
   
-  // Main loop : for all file lines
-  string temp, description;// Initialization
-  string::size_type index;
-  vector <string > beginnings, endings;
-  beginnings.push_back("[&&NHX:");
-  while (!in.eof())
+  // Trees are parsed one after the other, directly from the stream:
+  Parser parser(*this);
+  TreeTemplate<Node>* tree = parser.parse(in);
+  while (tree)
   {
-    //We concatenate all line in file till we reach the ending semi colon:
-    while (!in.eof())
-    {
-      getline(in, temp, '\n');  // Copy current line in temporary string
-      index = temp.find(";");
-      if (index != string::npos)
-      {
-        description += temp.substr(0, index + 1);
-        description = TextTools::removeSubstrings(description, '[', ']', beginnings, endings);
-        trees.push_back(parenthesisToTree(description));
-        description = temp.substr(index + 1);
-      }
-      else description += temp;
-    }
+    trees.push_back(tree);
+    tree = parser.parse(in);
   }
+  hasIds_ = parser.hasIds();
 }
 
 /******************************************************************************/
@@ -203,129 +244,12 @@ void Nhx::write_(const vector<TreeTemplate<N>*>& trees, ostream& out) const thro
 
 /******************************************************************************/
 
-Nhx::Element Nhx::getElement(const string& elt) const throw (IOException)
-{
-  Element element;
-  element.length     = ""; //default
-  element.annotation = ""; //default
-  element.isLeaf     = false; // default
- 
-  //cout << "ELT=" << elt << endl;
-  size_t lastP = elt.rfind(")"), firstP;
-  size_t beginAnno = string::npos;
-  if (lastP == string::npos)
-    beginAnno = elt.rfind("[&&NHX:");
-  else
-    beginAnno = elt.find("[&&NHX:", lastP + 1);
-  string elementWithoutAnnotation;
-  if (beginAnno != string::npos) {
-    size_t endAnno = elt.find("]", beginAnno + 7);
-    element.annotation = elt.substr(beginAnno + 7, endAnno - beginAnno - 7);
-    elementWithoutAnnotation = elt.substr(0, beginAnno);
-  } else {
-    element.annotation = "";
-    elementWithoutAnnotation = elt;
-  } 
-  //cout << "ANNO=" << element.annotation << endl;
-  //cout << "ELT =" << elementWithoutAnnotation << endl;
-
-  size_t colonIndex;
-  bool hasColon = false;
-  for (colonIndex = elementWithoutAnnotation.size() - 1; colonIndex > 0 && elementWithoutAnnotation[colonIndex] != ')' && !hasColon; --colonIndex)
-  {
-    if (elementWithoutAnnotation[colonIndex] == ':')
-    {
-      hasColon = true;
-    }
-  }
-  try
-  {
-    string elt2;
-    if (hasColon)
-    {
-      //this is an element with length:
-      elt2 = elementWithoutAnnotation.substr(0, colonIndex + 1);
-      element.length = elementWithoutAnnotation.substr(colonIndex + 2);
-    }
-    else
-    {
-      //this is an element without length;
-      elt2 = elementWithoutAnnotation;
-    }
-  
-    lastP = elt2.rfind(')');
-    firstP = elt2.find('(');
-    if (firstP == string::npos)
-    {
-      //This is a leaf:
-      element.content = elt2;
-      element.isLeaf  = true;
-    }
-    else
-    {
-      //This is a node:
-      if (lastP < firstP) throw IOException("Nhx::getElement(). Invalid format: bad closing parenthesis in " + elt2);
-      element.content = elt2.substr(firstP + 1, lastP - firstP - 1);
-    }
-  }
-  catch (exception& e)
-  {
-    throw IOException("Bad tree description: " + elt);
-  }
-  //cout << endl;
-  //cout << "CONTENT:" << endl << element.content << endl;
-  //cout << endl;
-  //cout << "ANNOTATION:" << endl << element.annotation << endl;
-  //cout << endl;
- 
-  return element;
-}  
-
-/******************************************************************************/
-
-
 Node* Nhx::parenthesisToNode(const string& description) const
 {
-  //cout << "NODE: " << description << endl;
-  Element elt = getElement(description);
-  
-  //New node:
-  Node* node = new Node();
-  if (!TextTools::isEmpty(elt.length))
-  {
-    node->setDistanceToFather(TextTools::toDouble(elt.length));
-  }
-  if (!TextTools::isEmpty(elt.annotation))
-  {
-    bool hasId = setNodeProperties(*node, elt.annotation);
-    if (!hasIds_ && hasId)
-      hasIds_ = true;
-    if (hasIds_ && !hasId)
-      throw Exception("Nhx::parenthesisToNode. At least one one is missing an id (ND tag).");
-  }
- 
-  NestedStringTokenizer nt(elt.content, "(", ")", ",");
-  vector<string> elements;
-  while (nt.hasMoreToken())
-  {
-    elements.push_back(nt.nextToken());
-  }
-  if (elt.isLeaf)
-  {
-    //This is a leaf:
-    string name = TextTools::removeSurroundingWhiteSpaces(elements[0]);
-    node->setName(name);
-  }
-  else
-  {
-    //This is a node:
-    for (size_t i = 0; i < elements.size(); ++i)
-    {
-      //cout << "NODE: SUBNODE: " << i << ", " << elements[i] << endl;
-      Node* son = parenthesisToNode(elements[i]);
-      node->addSon(son);
-    }
-  }
+  Parser parser(*this, hasIds_);
+  unsigned int nodeCounter = 0;
+  Node* node = parser.parseNode(description, nodeCounter);
+  hasIds_ = parser.hasIds();
   return node;
 }
 
@@ -333,18 +257,12 @@ Node* Nhx::parenthesisToNode(const string& description) const
 
 TreeTemplate<Node>* Nhx::parenthesisToTree(const string& description) const throw (Exception) 
 {
-  hasIds_ = false;
-  string::size_type semi = description.rfind(';');
-  if (semi == string::npos)
+  Parser parser(*this);
+  const char* pos = description.data();
+  TreeTemplate<Node>* tree = parser.parse(pos, description.data() + description.size());
+  if (!tree)
     throw Exception("Nhx::parenthesisToTree(). Bad format: no semi-colon found.");
-  string content = description.substr(0, semi);
-  Node* node = parenthesisToNode(content);
-  TreeTemplate<Node>* tree = new TreeTemplate<Node>();
-  tree->setRootNode(node);
-  if (!hasIds_)
-  {
-    tree->resetNodesId();
-  }
+  hasIds_ = parser.hasIds();
   return tree;
 }
 
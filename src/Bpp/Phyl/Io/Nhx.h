@@ -91,17 +91,9 @@ class Nhx:
   public AbstractOMultiTree
 {
   private:
-    struct Element
-    {
-      public:
-        std::string content;
-        std::string length;
-        std::string annotation;
-        bool isLeaf;
-  
-      public:
-        Element() : content(), length(), annotation(), isLeaf(false) {}
-    };
+    // Parser for node annotations, see Nhx.cpp:
+    class Parser;
+    friend class Parser;
   
   public:
     struct Property
@@ -262,8 +254,6 @@ class Nhx:
     template<class N>
     void write_(const std::vector<TreeTemplate<N>*>& trees, std::ostream& out) const throw (Exception);
 
-    Element getElement(const std::string& elt) const throw (IOException);
-
     Node* parenthesisToNode(const std::string& description) const;
   
     std::string propertiesToParenthesis(const Node& node) const;
@@ -0,0 +1,382 @@
+//
+// File: SiteFileChunks.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "SiteFileChunks.h"
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Text/TextTools.h>
+
+//From bpp-seq:
+#include <Bpp/Seq/Sequence.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+
+// From the STL:
+#include <algorithm>
+#include <memory>
+#include <sstream>
+
+using namespace bpp;
+using namespace std;
+
+namespace
+{
+  // Lines are read with getline, and their position is tracked explicitly,
+  // as tellg fails once the end of the file has been reached:
+  bool readLine(istream& input, string& line, streampos& position)
+  {
+    if (!getline(input, line))
+      return false;
+    position += static_cast<streamoff>(line.size() + 1);
+    return true;
+  }
+
+  size_t countCharacters(const string& line, size_t from = 0)
+  {
+    size_t count = 0;
+    for (size_t i = from; i < line.size(); i++)
+    {
+      if (!TextTools::isWhiteSpaceCharacter(line[i]))
+        count++;
+    }
+    return count;
+  }
+
+  void appendCharacters(const string& line, size_t from, string& sequence)
+  {
+    for (size_t i = from; i < line.size(); i++)
+    {
+      if (!TextTools::isWhiteSpaceCharacter(line[i]))
+        sequence += line[i];
+    }
+  }
+}
+
+/******************************************************************************/
+
+AbstractSiteFileChunks::AbstractSiteFileChunks(const string& path, const Alphabet* alphabet, size_t chunkSize) throw (Exception) :
+  path_(path),
+  alphabet_(alphabet),
+  chunkSize_(chunkSize),
+  position_(0),
+  numberOfSites_(0),
+  names_(),
+  starts_(),
+  positions_(),
+  input_(path.c_str(), ios::in | ios::binary)
+{
+  if (chunkSize_ == 0)
+    throw Exception("AbstractSiteFileChunks. Chunk size must be positive.");
+  if (!input_)
+    throw IOException("AbstractSiteFileChunks. Can't open file: " + path);
+}
+
+AbstractSiteFileChunks::AbstractSiteFileChunks(const AbstractSiteFileChunks& chunks) throw (Exception) :
+  SiteContainerChunkReader(chunks),
+  path_(chunks.path_),
+  alphabet_(chunks.alphabet_),
+  chunkSize_(chunks.chunkSize_),
+  position_(chunks.position_),
+  numberOfSites_(chunks.numberOfSites_),
+  names_(chunks.names_),
+  starts_(chunks.starts_),
+  positions_(chunks.positions_),
+  input_(chunks.path_.c_str(), ios::in | ios::binary)
+{
+  if (!input_)
+    throw IOException("AbstractSiteFileChunks. Can't open file: " + path_);
+}
+
+AbstractSiteFileChunks& AbstractSiteFileChunks::operator=(const AbstractSiteFileChunks& chunks) throw (Exception)
+{
+  path_          = chunks.path_;
+  alphabet_      = chunks.alphabet_;
+  chunkSize_     = chunks.chunkSize_;
+  position_      = chunks.position_;
+  numberOfSites_ = chunks.numberOfSites_;
+  names_         = chunks.names_;
+  starts_        = chunks.starts_;
+  positions_     = chunks.positions_;
+  input_.close();
+  input_.clear();
+  input_.open(path_.c_str(), ios::in | ios::binary);
+  if (!input_)
+    throw IOException("AbstractSiteFileChunks::operator=. Can't open file: " + path_);
+  return *this;
+}
+
+/******************************************************************************/
+
+void AbstractSiteFileChunks::rewind() throw (Exception)
+{
+  position_  = 0;
+  positions_ = starts_;
+}
+
+/******************************************************************************/
+
+SiteContainer* AbstractSiteFileChunks::nextChunk() throw (Exception)
+{
+  if (position_ >= numberOfSites_)
+    return 0;
+  size_t nbSites = min(chunkSize_, numberOfSites_ - position_);
+  vector<string> sequences(names_.size());
+  readChunk_(nbSites, sequences);
+  position_ += nbSites;
+  auto_ptr<VectorSiteContainer> sites(new VectorSiteContainer(alphabet_));
+  for (size_t i = 0; i < names_.size(); i++)
+  {
+    sites->addSequence(BasicSequence(names_[i], sequences[i], alphabet_), false);
+  }
+  return sites.release();
+}
+
+/******************************************************************************/
+
+void AbstractSiteFileChunks::readChunk_(size_t nbSites, vector<string>& sequences) throw (Exception)
+{
+  size_t nbChars = nbSites * alphabet_->getStateCodingSize();
+  char c;
+  for (size_t i = 0; i < names_.size(); i++)
+  {
+    input_.clear();
+    input_.seekg(positions_[i]);
+    string& sequence = sequences[i];
+    sequence.reserve(nbChars);
+    while (sequence.size() < nbChars)
+    {
+      if (!input_.get(c))
+        throw IOException("AbstractSiteFileChunks::readChunk_. Unexpected end of file in sequence " + names_[i] + ".");
+      if (!TextTools::isWhiteSpaceCharacter(c))
+        sequence += c;
+    }
+    positions_[i] = input_.tellg();
+  }
+}
+
+/******************************************************************************/
+
+void AbstractSiteFileChunks::setNumberOfCharacters_(size_t nbChars) throw (Exception)
+{
+  size_t size = alphabet_->getStateCodingSize();
+  if (nbChars % size != 0)
+    throw Exception("AbstractSiteFileChunks. The length of the sequences is not a multiple of the size of the states of the alphabet.");
+  numberOfSites_ = nbChars / size;
+}
+
+/******************************************************************************/
+
+FastaSiteChunks::FastaSiteChunks(const string& path, const Alphabet* alphabet, size_t chunkSize) throw (Exception) :
+  AbstractSiteFileChunks(path, alphabet, chunkSize)
+{
+  string line;
+  streampos position = 0;
+  vector<size_t> lengths;
+  while (readLine(input_, line, position))
+  {
+    if (!line.empty() && line[0] == '>')
+    {
+      names_.push_back(TextTools::removeSurroundingWhiteSpaces(line.substr(1)));
+      starts_.push_back(position);
+      lengths.push_back(0);
+    }
+    else if (!TextTools::isEmpty(line))
+    {
+      if (lengths.empty())
+        throw IOException("FastaSiteChunks. Sequence data found before the first header in file: " + path);
+      lengths.back() += countCharacters(line);
+    }
+  }
+  if (names_.empty())
+    throw IOException("FastaSiteChunks. No sequence found in file: " + path);
+  for (size_t i = 1; i < lengths.size(); i++)
+  {
+    if (lengths[i] != lengths[0])
+      throw IOException("FastaSiteChunks. Sequence " + names_[i] + " does not have the same length as the first sequence.");
+  }
+  setNumberOfCharacters_(lengths[0]);
+  rewind();
+}
+
+/******************************************************************************/
+
+PhylipSiteChunks::PhylipSiteChunks(
+  const string& path,
+  const Alphabet* alphabet,
+  size_t chunkSize,
+  bool extended,
+  bool sequential,
+  const string& split) throw (Exception) :
+  AbstractSiteFileChunks(path, alphabet, chunkSize),
+  extended_(extended),
+  sequential_(sequential),
+  split_(split),
+  firstBlock_(true),
+  buffers_()
+{
+  string line;
+  streampos position = 0;
+  do
+  {
+    if (!readLine(input_, line, position))
+      throw IOException("PhylipSiteChunks. Missing header in file: " + path);
+  }
+  while (TextTools::isEmpty(line));
+  istringstream header(line);
+  size_t nbSequences = 0;
+  size_t nbChars = 0;
+  if (!(header >> nbSequences >> nbChars) || nbSequences == 0)
+    throw IOException("PhylipSiteChunks. Invalid header: " + line);
+  setNumberOfCharacters_(nbChars);
+  names_.resize(nbSequences);
+
+  if (sequential_)
+  {
+    // Each sequence is skipped once its number of characters has been reached:
+    for (size_t i = 0; i < nbSequences; i++)
+    {
+      streampos lineStart;
+      do
+      {
+        lineStart = position;
+        if (!readLine(input_, line, position))
+          throw IOException("PhylipSiteChunks. Unexpected end of file, sequence " + TextTools::toString(i + 1) + " is missing.");
+      }
+      while (TextTools::isEmpty(line));
+      size_t offset = readName_(line, names_[i]);
+      starts_.push_back(lineStart + static_cast<streamoff>(offset));
+      size_t length = countCharacters(line, offset);
+      while (length < nbChars && readLine(input_, line, position))
+      {
+        length += countCharacters(line);
+      }
+      if (length != nbChars)
+        throw IOException("PhylipSiteChunks. Sequence " + names_[i] + " does not have the length given in the header.");
+    }
+  }
+  else
+  {
+    // Only names are needed, blocks are read with the chunks:
+    starts_.push_back(position);
+    for (size_t i = 0; i < nbSequences; )
+    {
+      if (!readLine(input_, line, position))
+        throw IOException("PhylipSiteChunks. Unexpected end of file, sequence " + TextTools::toString(i + 1) + " is missing.");
+      if (TextTools::isEmpty(line))
+        continue;
+      readName_(line, names_[i]);
+      i++;
+    }
+  }
+  rewind();
+}
+
+/******************************************************************************/
+
+void PhylipSiteChunks::rewind() throw (Exception)
+{
+  AbstractSiteFileChunks::rewind();
+  firstBlock_ = true;
+  buffers_.assign(names_.size(), string());
+}
+
+/******************************************************************************/
+
+void PhylipSiteChunks::readChunk_(size_t nbSites, vector<string>& sequences) throw (Exception)
+{
+  if (sequential_)
+  {
+    AbstractSiteFileChunks::readChunk_(nbSites, sequences);
+    return;
+  }
+
+  // Blocks are read until the chunk is complete, remaining characters are kept for the next chunk:
+  size_t nbChars = nbSites * alphabet_->getStateCodingSize();
+  string line;
+  string name;
+  streampos position = positions_[0];
+  input_.clear();
+  input_.seekg(position);
+  while (buffers_[0].size() < nbChars)
+  {
+    for (size_t i = 0; i < names_.size(); i++)
+    {
+      do
+      {
+        if (!readLine(input_, line, position))
+          throw IOException("PhylipSiteChunks::readChunk_. Unexpected end of file in sequence " + names_[i] + ".");
+      }
+      while (TextTools::isEmpty(line));
+      size_t offset = firstBlock_ ? readName_(line, name) : 0;
+      appendCharacters(line, offset, buffers_[i]);
+    }
+    firstBlock_ = false;
+  }
+  positions_[0] = position;
+
+  for (size_t i = 0; i < names_.size(); i++)
+  {
+    if (buffers_[i].size() < nbChars)
+      throw IOException("PhylipSiteChunks::readChunk_. Sequence " + names_[i] + " is shorter than the first sequence.");
+    sequences[i] = buffers_[i].substr(0, nbChars);
+    buffers_[i].erase(0, nbChars);
+  }
+}
+
+/******************************************************************************/
+
+size_t PhylipSiteChunks::readName_(const string& line, string& name) const throw (Exception)
+{
+  if (extended_)
+  {
+    size_t pos = line.find(split_);
+    if (pos == string::npos)
+      throw IOException("PhylipSiteChunks. No name separator found in line: " + line);
+    name = TextTools::removeSurroundingWhiteSpaces(line.substr(0, pos));
+    return pos + split_.size();
+  }
+  else
+  {
+    size_t pos = min(line.size(), static_cast<size_t>(10));
+    name = TextTools::removeSurroundingWhiteSpaces(line.substr(0, pos));
+    return pos;
+  }
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,213 @@
+//
+// File: SiteFileChunks.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _SITEFILECHUNKS_H_
+#define _SITEFILECHUNKS_H_
+
+#include "../Likelihood/StreamingSiteLikelihoods.h"
+
+//From bpp-seq:
+#include <Bpp/Seq/Alphabet/Alphabet.h>
+#include <Bpp/Seq/Container/SiteContainer.h>
+
+// From the STL:
+#include <vector>
+#include <string>
+#include <fstream>
+
+namespace bpp
+{
+
+/**
+ * @brief Partial implementation of the SiteContainerChunkReader interface for alignment files.
+ *
+ * The file is kept open, and only the sites of the current chunk are read from it.
+ * By default, each sequence is read from its own position in the file, which suits formats where
+ * sequences are stored one after the other (FASTA, sequential PHYLIP).
+ * Derived classes build the index of the file (names, number of sites and start position of each sequence)
+ * in their constructor.
+ */
+class AbstractSiteFileChunks :
+  public virtual SiteContainerChunkReader
+{
+  protected:
+    std::string path_;
+    const Alphabet* alphabet_;
+    size_t chunkSize_;
+    size_t position_;
+    size_t numberOfSites_;
+    std::vector<std::string> names_;
+    std::vector<std::streampos> starts_;
+    std::vector<std::streampos> positions_;
+    std::ifstream input_;
+
+  public:
+    /**
+     * @param path      The path of the file to read.
+     * @param alphabet  The alphabet of the sequences.
+     * @param chunkSize The maximum number of sites in each chunk.
+     * @throw IOException If the file cannot be opened.
+     */
+    AbstractSiteFileChunks(const std::string& path, const Alphabet* alphabet, size_t chunkSize) throw (Exception);
+
+    AbstractSiteFileChunks(const AbstractSiteFileChunks& chunks) throw (Exception);
+
+    AbstractSiteFileChunks& operator=(const AbstractSiteFileChunks& chunks) throw (Exception);
+
+    virtual ~AbstractSiteFileChunks() {}
+
+  public:
+    size_t getNumberOfSites() const { return numberOfSites_; }
+
+    void rewind() throw (Exception);
+
+    SiteContainer* nextChunk() throw (Exception);
+
+    /**
+     * @return The names of the sequences in the file.
+     */
+    const std::vector<std::string>& getSequencesNames() const { return names_; }
+
+  protected:
+    /**
+     * @brief Read the next sites of all sequences.
+     *
+     * The default implementation reads each sequence from its current position in positions_.
+     *
+     * @param nbSites   The number of sites to read.
+     * @param sequences The sequences to fill, one for each name.
+     */
+    virtual void readChunk_(size_t nbSites, std::vector<std::string>& sequences) throw (Exception);
+
+    /**
+     * @brief Set the number of sites from the number of characters of the sequences.
+     *
+     * @param nbChars The number of characters of each sequence.
+     * @throw Exception If the number of characters does not fit the alphabet.
+     */
+    void setNumberOfCharacters_(size_t nbChars) throw (Exception);
+};
+
+
+/**
+ * @brief Read a FASTA alignment chunk by chunk.
+ *
+ * The file is parsed once when the object is created, in order to retrieve the sequence names
+ * and the position of each sequence.
+ * Sequences may span several lines, and must all have the same length.
+ */
+class FastaSiteChunks :
+  public AbstractSiteFileChunks
+{
+  public:
+    /**
+     * @param path      The path of the FASTA file to read.
+     * @param alphabet  The alphabet of the sequences.
+     * @param chunkSize The maximum number of sites in each chunk.
+     * @throw Exception If the file cannot be opened, or sequences do not have the same length.
+     */
+    FastaSiteChunks(const std::string& path, const Alphabet* alphabet, size_t chunkSize) throw (Exception);
+
+    virtual ~FastaSiteChunks() {}
+};
+
+
+/**
+ * @brief Read a PHYLIP alignment chunk by chunk.
+ *
+ * Both sequential and interleaved files are supported.
+ * In the sequential format, sequences are read from their own position, like in FastaSiteChunks.
+ * In the interleaved format, blocks are read in order, and characters read beyond the current chunk
+ * are kept for the next one.
+ *
+ * Names are read as in the Phylip class from bpp-seq: in the strict format they are made of
+ * the first 10 characters of the line, in the extended format they are separated from the sequence
+ * by a given string.
+ */
+class PhylipSiteChunks :
+  public AbstractSiteFileChunks
+{
+  private:
+    bool extended_;
+    bool sequential_;
+    std::string split_;
+    bool firstBlock_;
+    std::vector<std::string> buffers_;
+
+  public:
+    /**
+     * @param path       The path of the PHYLIP file to read.
+     * @param alphabet   The alphabet of the sequences.
+     * @param chunkSize  The maximum number of sites in each chunk.
+     * @param extended   Tell if names are in the extended format.
+     * @param sequential Tell if the file is sequential or interleaved.
+     * @param split      The string separating names from sequences in the extended format.
+     * @throw Exception If the file cannot be opened or is not a valid PHYLIP file.
+     */
+    PhylipSiteChunks(
+      const std::string& path,
+      const Alphabet* alphabet,
+      size_t chunkSize,
+      bool extended = true,
+      bool sequential = true,
+      const std::string& split = "  ") throw (Exception);
+
+    virtual ~PhylipSiteChunks() {}
+
+  public:
+    void rewind() throw (Exception);
+
+  protected:
+    void readChunk_(size_t nbSites, std::vector<std::string>& sequences) throw (Exception);
+
+  private:
+    /**
+     * @brief Parse the name of a sequence.
+     *
+     * @param line The first line of the sequence.
+     * @param name The name to set.
+     * @return The position of the first character of the sequence in the line.
+     */
+    size_t readName_(const std::string& line, std::string& name) const throw (Exception);
+};
+
+} //end of namespace bpp.
+
+#endif //_SITEFILECHUNKS_H_
+
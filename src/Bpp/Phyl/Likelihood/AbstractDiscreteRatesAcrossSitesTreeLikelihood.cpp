@@ -45,6 +45,7 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <cmath>
 
 using namespace std;
 
@@ -308,6 +309,60 @@ void AbstractDiscreteRatesAcrossSitesTreeLikelihood::displayLikelihoodArray(
 
 /******************************************************************************/
 
+void AbstractDiscreteRatesAcrossSitesTreeLikelihood::displayLikelihoodArray(
+  const LikelihoodArray& likelihoodArray)
+{
+  size_t nbSites   = likelihoodArray.getNumberOfSites();
+  size_t nbClasses = likelihoodArray.getNumberOfClasses();
+  size_t nbStates  = likelihoodArray.getNumberOfStates();
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    cout << "Site " << i << ":" << endl;
+    for (size_t c = 0; c < nbClasses; c++)
+    {
+      cout << "Rate class " << c;
+      for (size_t s = 0; s < nbStates; s++)
+      {
+        cout << "\t" << likelihoodArray(i, c, s);
+      }
+      cout << endl;
+    }
+    cout << endl;
+  }
+}
+
+/******************************************************************************/
+
+double AbstractDiscreteRatesAcrossSitesTreeLikelihood::rescaleLikelihoods(
+  VVdouble& siteLikelihoods)
+{
+  size_t nbClasses = siteLikelihoods.size();
+  double maxL = 0.;
+  for (size_t c = 0; c < nbClasses; c++)
+  {
+    const Vdouble* l_c = &siteLikelihoods[c];
+    for (size_t s = 0; s < l_c->size(); s++)
+    {
+      if ((*l_c)[s] > maxL) maxL = (*l_c)[s];
+    }
+  }
+  if (maxL <= 0. || maxL >= LikelihoodArray::getScalingThreshold()) return 0.;
+  int exponent;
+  frexp(maxL, &exponent);
+  double factor = ldexp(1., -exponent);
+  for (size_t c = 0; c < nbClasses; c++)
+  {
+    Vdouble* l_c = &siteLikelihoods[c];
+    for (size_t s = 0; s < l_c->size(); s++)
+    {
+      (*l_c)[s] *= factor;
+    }
+  }
+  return static_cast<double>(exponent) * log(2.);
+}
+
+/******************************************************************************/
+
 VVdouble AbstractDiscreteRatesAcrossSitesTreeLikelihood::getTransitionProbabilities(int nodeId, size_t siteIndex) const
 {
   VVVdouble p3 = getTransitionProbabilitiesPerRateClass(nodeId, siteIndex);
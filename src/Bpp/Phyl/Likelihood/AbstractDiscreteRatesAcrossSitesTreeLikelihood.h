@@ -42,6 +42,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "AbstractTreeLikelihood.h"
 #include "DiscreteRatesAcrossSitesTreeLikelihood.h"
+#include "LikelihoodArray.h"
 #include "../Model/SubstitutionModel.h"
 
 namespace bpp
@@ -129,6 +130,7 @@ class AbstractDiscreteRatesAcrossSitesTreeLikelihood:
      * @param likelihoodArray the likelihood array.
      */
     static void resetLikelihoodArray(VVVdouble & likelihoodArray);
+    static void resetLikelihoodArray(LikelihoodArray & likelihoodArray) { likelihoodArray.fill(1.); }
 
     /**
      * @brief Print the likelihood array to terminal (debugging tool).
@@ -136,6 +138,18 @@ class AbstractDiscreteRatesAcrossSitesTreeLikelihood:
      * @param likelihoodArray the likelihood array.
      */
     static void displayLikelihoodArray(const VVVdouble & likelihoodArray);
+    static void displayLikelihoodArray(const LikelihoodArray & likelihoodArray);
+
+    /**
+     * @brief Rescale the conditional likelihoods of one site if they are close to underflow.
+     *
+     * If the maximum value over all classes and states is below LikelihoodArray::getScalingThreshold(),
+     * all values are multiplied by the power of 2 bringing this maximum into [0.5, 1).
+     *
+     * @param siteLikelihoods the class x state likelihoods for one site.
+     * @return The log of the factor the likelihoods were divided by (0 if nothing was done).
+     */
+    static double rescaleLikelihoods(VVdouble & siteLikelihoods);
 
     /** @} */
     
@@ -77,6 +77,10 @@ throw (Exception) :
   nbStates_(),
   nbNodes_(),
   verbose_(),
+  scaling_(false),
+  updatedBranches_(),
+  nbUpdatedBranchesBelow_(),
+  fullUpdate_(true),
   minimumBrLen_(),
   maximumBrLen_(),
   brLenConstraint_()
@@ -102,6 +106,10 @@ AbstractHomogeneousTreeLikelihood::AbstractHomogeneousTreeLikelihood(
   nbStates_(lik.nbStates_),
   nbNodes_(lik.nbNodes_),
   verbose_(lik.verbose_),
+  scaling_(lik.scaling_),
+  updatedBranches_(lik.updatedBranches_),
+  nbUpdatedBranchesBelow_(lik.nbUpdatedBranchesBelow_),
+  fullUpdate_(lik.fullUpdate_),
   minimumBrLen_(lik.minimumBrLen_),
   maximumBrLen_(lik.maximumBrLen_),
   brLenConstraint_(lik.brLenConstraint_->clone())
@@ -130,6 +138,10 @@ AbstractHomogeneousTreeLikelihood& AbstractHomogeneousTreeLikelihood::operator=(
   nbStates_        = lik.nbStates_;
   nbNodes_         = lik.nbNodes_;
   verbose_         = lik.verbose_;
+  scaling_         = lik.scaling_;
+  updatedBranches_ = lik.updatedBranches_;
+  nbUpdatedBranchesBelow_ = lik.nbUpdatedBranchesBelow_;
+  fullUpdate_      = lik.fullUpdate_;
   minimumBrLen_    = lik.minimumBrLen_;
   maximumBrLen_    = lik.maximumBrLen_;
   if (brLenConstraint_.get()) brLenConstraint_.release();
@@ -169,6 +181,16 @@ void AbstractHomogeneousTreeLikelihood::init_(
 
 /******************************************************************************/
 
+void AbstractHomogeneousTreeLikelihood::enableScaling(bool yn)
+{
+  if (yn == scaling_) return;
+  scaling_ = yn;
+  if (initialized_)
+    fireParameterChanged(getParameters());
+}
+
+/******************************************************************************/
+
 void AbstractHomogeneousTreeLikelihood::setSubstitutionModel(SubstitutionModel* model) throw (Exception)
 {
   // Check:
@@ -349,6 +371,7 @@ void AbstractHomogeneousTreeLikelihood::computeAllTransitionProbabilities()
     computeTransitionProbabilitiesForNode(node);
   }
   rootFreqs_ = model_->getFrequencies();
+  flagAllNodesForUpdate();
 }
 
 /*******************************************************************************/
@@ -357,58 +380,36 @@ void AbstractHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(co
 {
   double l = node->getDistanceToFather();
 
-  // Computes all pxy and pyx once for all:
-  VVVdouble* pxy__node = &pxy_[node->getId()];
-  for (unsigned int c = 0; c < nbClasses_; c++)
+  // Computes all pxy, dpxy/dt and d2pxy/dt2 once for all, for all rate classes in a single call:
+  vector<double> times(nbClasses_);
+  for (size_t c = 0; c < nbClasses_; c++)
   {
-    VVdouble* pxy__node_c = &(*pxy__node)[c];
-    RowMatrix<double> Q = model_->getPij_t(l * rateDistribution_->getCategory(c));
-
-    for (unsigned int x = 0; x < nbStates_; x++)
-    {
-      Vdouble* pxy__node_c_x = &(*pxy__node_c)[x];
-      for (unsigned int y = 0; y < nbStates_; y++)
-      {
-        (*pxy__node_c_x)[y] = Q(x, y);
-      }
-    }
+    times[c] = l * rateDistribution_->getCategory(c);
   }
-  
-  if (computeFirstOrderDerivatives_)
+  VVVdouble* dpxy__node  = computeFirstOrderDerivatives_  ? &dpxy_[node->getId()]  : 0;
+  VVVdouble* d2pxy__node = computeSecondOrderDerivatives_ ? &d2pxy_[node->getId()] : 0;
+  model_->getTransitionProbabilities(times, pxy_[node->getId()], dpxy__node, d2pxy__node);
+
+  // Derivatives are computed with respect to l * rc:
+  for (size_t c = 0; c < nbClasses_; c++)
   {
-    // Computes all dpxy/dt once for all:
-    VVVdouble* dpxy__node = &dpxy_[node->getId()];
-    for (unsigned int c = 0; c < nbClasses_; c++)
+    double rc = rateDistribution_->getCategory(c);
+    for (size_t x = 0; x < nbStates_; x++)
     {
-      VVdouble* dpxy__node_c = &(*dpxy__node)[c];
-      double rc = rateDistribution_->getCategory(c);
-      RowMatrix<double> dQ = model_->getdPij_dt(l * rc);
-      for (unsigned int x = 0; x < nbStates_; x++)
+      if (dpxy__node)
       {
-        Vdouble* dpxy__node_c_x = &(*dpxy__node_c)[x];
-        for (unsigned int y = 0; y < nbStates_; y++)
+        Vdouble* dpxy__node_c_x = &(*dpxy__node)[c][x];
+        for (size_t y = 0; y < nbStates_; y++)
         {
-          (*dpxy__node_c_x)[y] = rc * dQ(x, y);
+          (*dpxy__node_c_x)[y] *= rc;
         }
       }
-    }
-  }
-
-  if (computeSecondOrderDerivatives_)
-  {
-    // Computes all d2pxy/dt2 once for all:
-    VVVdouble* d2pxy__node = &d2pxy_[node->getId()];
-    for (unsigned int c = 0; c < nbClasses_; c++)
-    {
-      VVdouble* d2pxy__node_c = &(*d2pxy__node)[c];
-      double rc =  rateDistribution_->getCategory(c);
-      RowMatrix<double> d2Q = model_->getd2Pij_dt2(l * rc);
-      for (unsigned int x = 0; x < nbStates_; x++)
+      if (d2pxy__node)
       {
-        Vdouble* d2pxy__node_c_x = &(*d2pxy__node_c)[x];
-        for (unsigned int y = 0; y < nbStates_; y++)
+        Vdouble* d2pxy__node_c_x = &(*d2pxy__node)[c][x];
+        for (size_t y = 0; y < nbStates_; y++)
         {
-          (*d2pxy__node_c_x)[y] = rc * rc * d2Q(x, y);
+          (*d2pxy__node_c_x)[y] *= rc * rc;
         }
       }
     }
@@ -417,3 +418,48 @@ void AbstractHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(co
 
 /*******************************************************************************/
 
+void AbstractHomogeneousTreeLikelihood::flagBranchForUpdate(const Node* node)
+{
+  if (!updatedBranches_.insert(node->getId()).second)
+    return; // Already flagged.
+  while (node->hasFather())
+  {
+    node = node->getFather();
+    nbUpdatedBranchesBelow_[node->getId()]++;
+  }
+}
+
+/*******************************************************************************/
+
+void AbstractHomogeneousTreeLikelihood::resetUpdateFlags()
+{
+  updatedBranches_.clear();
+  nbUpdatedBranchesBelow_.clear();
+  fullUpdate_ = false;
+}
+
+/*******************************************************************************/
+
+bool AbstractHomogeneousTreeLikelihood::isUpdateNeededBelow(const Node* node) const
+{
+  if (fullUpdate_ || updatedBranches_.size() == 0)
+    return true;
+  map<int, size_t>::const_iterator it = nbUpdatedBranchesBelow_.find(node->getId());
+  return it != nbUpdatedBranchesBelow_.end() && it->second > 0;
+}
+
+/*******************************************************************************/
+
+bool AbstractHomogeneousTreeLikelihood::isUpdateNeededAbove(const Node* node) const
+{
+  if (fullUpdate_ || updatedBranches_.size() == 0)
+    return true;
+  size_t nbInSubtree = updatedBranches_.count(node->getId());
+  map<int, size_t>::const_iterator it = nbUpdatedBranchesBelow_.find(node->getId());
+  if (it != nbUpdatedBranchesBelow_.end())
+    nbInSubtree += it->second;
+  return updatedBranches_.size() > nbInSubtree;
+}
+
+/*******************************************************************************/
+
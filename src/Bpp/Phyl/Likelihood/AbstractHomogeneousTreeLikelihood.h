@@ -45,6 +45,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 //From STL:
 #include<memory>
+#include<set>
 
 namespace bpp
 {
@@ -113,6 +114,24 @@ class AbstractHomogeneousTreeLikelihood:
 
     bool verbose_;
 
+    /**
+     * @brief Tell if conditional likelihoods should be rescaled to avoid numerical underflow.
+     */
+    bool scaling_;
+
+    /**
+     * @name Incremental updates
+     *
+     * Ids of the nodes whose branch transition probabilities changed since the last likelihood computation,
+     * and for each node the number of such branches in its subtree (its own branch excluded).
+     * If fullUpdate_ is true, or if no branch was flagged, all conditional likelihoods are recomputed.
+     * @{
+     */
+    std::set<int> updatedBranches_;
+    std::map<int, size_t> nbUpdatedBranchesBelow_;
+    bool fullUpdate_;
+    /** @} */
+
     double minimumBrLen_;
     double maximumBrLen_;
     std::auto_ptr<Constraint> brLenConstraint_;
@@ -215,6 +234,24 @@ class AbstractHomogeneousTreeLikelihood:
     
   public: //Specific methods:
 
+    /**
+     * @brief Enable or disable the scaling of conditional likelihoods.
+     *
+     * When enabled, the conditional likelihoods of a site are rescaled each time they get too small,
+     * and the corresponding factors are stored in log space next to the likelihood arrays.
+     * This is required to get finite log-likelihoods on large trees, at the cost of a small overhead.
+     * Scaling is disabled by default.
+     * If the object is already initialized, the likelihood is recomputed.
+     *
+     * @param yn Tell if scaling should be used.
+     */
+    virtual void enableScaling(bool yn);
+
+    /**
+     * @return True if conditional likelihoods are rescaled.
+     */
+    bool isScalingEnabled() const { return scaling_; }
+
     /**
      * @brief This builds the <i>parameters</i> list from all parametrizable objects,
      * <i>i.e.</i> substitution model, rate distribution and tree.
@@ -263,6 +300,46 @@ class AbstractHomogeneousTreeLikelihood:
      */
     virtual void computeTransitionProbabilitiesForNode(const Node * node);
 
+    /**
+     * @name Incremental updates
+     *
+     * These methods allow to recompute only the conditional likelihoods that depend on modified branches.
+     * Branches are flagged by fireParameterChanged, the flags are reset once the likelihood has been computed.
+     * @{
+     */
+
+    /**
+     * @brief Flag a branch whose transition probabilities have changed.
+     *
+     * @param node The node defining the branch.
+     */
+    void flagBranchForUpdate(const Node* node);
+
+    /**
+     * @brief Require all conditional likelihoods to be recomputed, for instance after a change of topology.
+     */
+    void flagAllNodesForUpdate() { fullUpdate_ = true; }
+
+    /**
+     * @brief Clear all update flags, once the conditional likelihoods are up to date.
+     */
+    void resetUpdateFlags();
+
+    /**
+     * @return True if the subtree below a node contains a flagged branch, or if all nodes have to be updated.
+     * @param node The node to check.
+     */
+    bool isUpdateNeededBelow(const Node* node) const;
+
+    /**
+     * @return True if the part of the tree that is not in the subtree defined by a node
+     * (its own branch excluded) contains a flagged branch, or if all nodes have to be updated.
+     * @param node The node to check.
+     */
+    bool isUpdateNeededAbove(const Node* node) const;
+
+    /** @} */
+
 };
 
 } //end of namespace bpp.
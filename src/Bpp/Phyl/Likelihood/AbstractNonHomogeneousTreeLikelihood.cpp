@@ -37,6 +37,7 @@
 */
 
 #include "AbstractNonHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 //From SeqLib:
@@ -68,6 +69,8 @@ AbstractNonHomogeneousTreeLikelihood::AbstractNonHomogeneousTreeLikelihood(
   pxy_(),
   dpxy_(),
   d2pxy_(),
+  packedPxy_(),
+  packedReversePxy_(),
   rootFreqs_(),
   nodes_(),
   idToNode_(),
@@ -97,6 +100,8 @@ AbstractNonHomogeneousTreeLikelihood::AbstractNonHomogeneousTreeLikelihood(
   pxy_(lik.pxy_),
   dpxy_(lik.dpxy_),
   d2pxy_(lik.d2pxy_),
+  packedPxy_(lik.packedPxy_),
+  packedReversePxy_(lik.packedReversePxy_),
   rootFreqs_(lik.rootFreqs_),
   nodes_(),
   idToNode_(),
@@ -134,6 +139,8 @@ AbstractNonHomogeneousTreeLikelihood& AbstractNonHomogeneousTreeLikelihood::oper
   pxy_               = lik.pxy_;
   dpxy_              = lik.dpxy_;
   d2pxy_             = lik.d2pxy_;
+  packedPxy_         = lik.packedPxy_;
+  packedReversePxy_  = lik.packedReversePxy_;
   rootFreqs_         = lik.rootFreqs_;
   nodes_             = tree_->getNodes();
   nodes_.pop_back(); //Remove the root node (the last added!).  
@@ -395,12 +402,15 @@ void AbstractNonHomogeneousTreeLikelihood::initBranchLengthsParameters(bool verb
 
 void AbstractNonHomogeneousTreeLikelihood::computeAllTransitionProbabilities()
 {
+  //Branches are updated model by model:
+  map<size_t, vector<const Node*> > nodesPerModel;
   for(unsigned int l = 0; l < nbNodes_; l++)
     {
-      //For each node,
-      Node * node = nodes_[l];
-      computeTransitionProbabilitiesForNode(node);
+      const Node * node = nodes_[l];
+      nodesPerModel[modelSet_->getModelIndexForNode(node->getId())].push_back(node);
     }
+  for(map<size_t, vector<const Node*> >::iterator it = nodesPerModel.begin(); it != nodesPerModel.end(); it++)
+    computeTransitionProbabilitiesForModel(it->first, it->second);
   rootFreqs_ = modelSet_->getRootFrequencies();
 }
 
@@ -408,65 +418,144 @@ void AbstractNonHomogeneousTreeLikelihood::computeAllTransitionProbabilities()
 
 void AbstractNonHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(const Node* node)
 {
-  const SubstitutionModel* model = modelSet_->getModelForNode(node->getId());
-  double l = node->getDistanceToFather(); 
+  computeTransitionProbabilitiesForModel(modelSet_->getModelIndexForNode(node->getId()), vector<const Node*>(1, node));
+}
+
+/*******************************************************************************/
 
-  //Computes all pxy and pyx once for all:
-  VVVdouble * pxy__node = & pxy_[node->getId()];
-  for(unsigned int c = 0; c < nbClasses_; c++)
+void AbstractNonHomogeneousTreeLikelihood::computeTransitionProbabilitiesForModel(size_t modelIndex, const vector<const Node*>& nodes)
+{
+  const SubstitutionModel* model = modelSet_->getModel(modelIndex);
+
+  //Each distinct length × rate is only computed once:
+  vector<double> times;
+  map<double, size_t> timeIndex;
+  vector< vector<size_t> > index(nodes.size(), vector<size_t>(nbClasses_));
+  for(size_t i = 0; i < nodes.size(); i++)
     {
-      VVdouble * pxy__node_c = & (* pxy__node)[c];
-      RowMatrix<double> Q = model->getPij_t(l * rateDistribution_->getCategory(c));
-      for(unsigned int x = 0; x < nbStates_; x++)
+      double l = nodes[i]->getDistanceToFather();
+      for(unsigned int c = 0; c < nbClasses_; c++)
         {
-          Vdouble * pxy__node_c_x = & (* pxy__node_c)[x];
-          for(unsigned int y = 0; y < nbStates_; y++)
+          double t = l * rateDistribution_->getCategory(c);
+          map<double, size_t>::iterator it = timeIndex.find(t);
+          if(it == timeIndex.end())
             {
-              (* pxy__node_c_x)[y] = Q(x, y);
+              it = timeIndex.insert(make_pair(t, times.size())).first;
+              times.push_back(t);
             }
+          index[i][c] = it->second;
         }
     }
-  
-  if(computeFirstOrderDerivatives_)
-    {
-      //Computes all dpxy/dt once for all:
-      VVVdouble * dpxy__node = & dpxy_[node->getId()];
 
+  VVVdouble p, dp, d2p;
+  model->getTransitionProbabilities(times, p,
+      computeFirstOrderDerivatives_ ? &dp : 0,
+      computeSecondOrderDerivatives_ ? &d2p : 0);
+
+  for(size_t i = 0; i < nodes.size(); i++)
+    {
+      //Computes all pxy and pyx once for all:
+      VVVdouble * pxy__node = & pxy_[nodes[i]->getId()];
       for(unsigned int c = 0; c < nbClasses_; c++)
-        {
-          VVdouble * dpxy__node_c = & (* dpxy__node)[c];
-          double rc = rateDistribution_->getCategory(c);
+        (* pxy__node)[c] = p[index[i][c]];
+      LikelihoodKernels::packTransitionProbabilities(* pxy__node, packedPxy_[nodes[i]->getId()]);
+      LikelihoodKernels::packTransitionProbabilities(* pxy__node, packedReversePxy_[nodes[i]->getId()], true);
 
-          RowMatrix<double> dQ = model->getdPij_dt(l * rc);  
+      if(computeFirstOrderDerivatives_)
+        {
+          //Computes all dpxy/dt once for all:
+          VVVdouble * dpxy__node = & dpxy_[nodes[i]->getId()];
+          for(unsigned int c = 0; c < nbClasses_; c++)
+            {
+              VVdouble * dpxy__node_c = & (* dpxy__node)[c];
+              const VVdouble * dQ = & dp[index[i][c]];
+              double rc = rateDistribution_->getCategory(c);
+              for(unsigned int x = 0; x < nbStates_; x++)
+                {
+                  Vdouble * dpxy__node_c_x = & (* dpxy__node_c)[x];
+                  for(unsigned int y = 0; y < nbStates_; y++)
+                    (* dpxy__node_c_x)[y] = rc * (* dQ)[x][y];
+                }
+            }
+        }
 
-          for(unsigned int x = 0; x < nbStates_; x++)
+      if(computeSecondOrderDerivatives_)
+        {
+          //Computes all d2pxy/dt2 once for all:
+          VVVdouble * d2pxy__node = & d2pxy_[nodes[i]->getId()];
+          for(unsigned int c = 0; c < nbClasses_; c++)
             {
-              Vdouble * dpxy__node_c_x = & (* dpxy__node_c)[x];
-              for(unsigned int y = 0; y < nbStates_; y++)
-                (* dpxy__node_c_x)[y] = rc * dQ(x, y); 
+              VVdouble * d2pxy__node_c = & (* d2pxy__node)[c];
+              const VVdouble * d2Q = & d2p[index[i][c]];
+              double rc = rateDistribution_->getCategory(c);
+              for(unsigned int x = 0; x < nbStates_; x++)
+                {
+                  Vdouble * d2pxy__node_c_x = & (* d2pxy__node_c)[x];
+                  for(unsigned int y = 0; y < nbStates_; y++)
+                    (* d2pxy__node_c_x)[y] = rc * rc * (* d2Q)[x][y];
+                }
             }
         }
     }
-      
-  if(computeSecondOrderDerivatives_)
+}
+
+/*******************************************************************************/
+
+void AbstractNonHomogeneousTreeLikelihood::computeTransitionProbabilitiesForParameters(const ParameterList& params)
+{
+  if (params.getCommonParametersWith(rateDistribution_->getIndependentParameters()).size() > 0)
     {
-      //Computes all d2pxy/dt2 once for all:
-      VVVdouble * d2pxy__node = & d2pxy_[node->getId()];
-      for(unsigned int c = 0; c < nbClasses_; c++)
+      computeAllTransitionProbabilities();
+      return;
+    }
+
+  //Models depending on a modified parameter have all their branches updated:
+  vector<bool> modelChanged(modelSet_->getNumberOfModels(), false);
+  vector<string> tmp = params.getCommonParametersWith(modelSet_->getNodeParameters()).getParameterNames();
+  for (size_t i = 0; i < tmp.size(); i++)
+    {
+      vector<size_t> models = modelSet_->getModelsWithParameter(tmp[i]);
+      for (size_t j = 0; j < models.size(); j++)
+        modelChanged[models[j]] = true;
+    }
+
+  //Other models only have the branches which length changed updated:
+  map<size_t, vector<const Node*> > nodesPerModel;
+  tmp = params.getCommonParametersWith(brLenParameters_).getParameterNames();
+  vector<const Node*> brLenNodes;
+  bool test = false;
+  for (size_t i = 0; i < tmp.size(); i++)
+    {
+      if (tmp[i] == "BrLenRoot" || tmp[i] == "RootPosition")
         {
-          VVdouble * d2pxy__node_c = & (* d2pxy__node)[c];
-          double rc =  rateDistribution_->getCategory(c);
-          RowMatrix<double> d2Q = model->getd2Pij_dt2(l * rc);
-          for(unsigned int x = 0; x < nbStates_; x++)
+          if (!test)
             {
-              Vdouble * d2pxy__node_c_x = & (* d2pxy__node_c)[x];
-              for(unsigned int y = 0; y < nbStates_; y++)
-                {
-                  (* d2pxy__node_c_x)[y] = rc * rc * d2Q(x, y);
-                }
+              brLenNodes.push_back(tree_->getRootNode()->getSon(0));
+              brLenNodes.push_back(tree_->getRootNode()->getSon(1));
+              test = true; //Add only once.
             }
         }
+      else
+        brLenNodes.push_back(nodes_[TextTools::to < size_t > (tmp[i].substr(5))]);
     }
+  for (size_t i = 0; i < brLenNodes.size(); i++)
+    {
+      size_t m = modelSet_->getModelIndexForNode(brLenNodes[i]->getId());
+      if (!modelChanged[m])
+        nodesPerModel[m].push_back(brLenNodes[i]);
+    }
+  for (size_t m = 0; m < modelChanged.size(); m++)
+    {
+      if (!modelChanged[m]) continue;
+      const vector<int>& ids = modelSet_->getNodesWithModel(m);
+      vector<const Node*>& nodes = nodesPerModel[m];
+      for (size_t i = 0; i < ids.size(); i++)
+        nodes.push_back(idToNode_[ids[i]]);
+    }
+
+  for (map<size_t, vector<const Node*> >::iterator it = nodesPerModel.begin(); it != nodesPerModel.end(); it++)
+    computeTransitionProbabilitiesForModel(it->first, it->second);
+  rootFreqs_ = modelSet_->getRootFrequencies();
 }
 
 /*******************************************************************************/
@@ -43,6 +43,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "NonHomogeneousTreeLikelihood.h"
 #include "AbstractDiscreteRatesAcrossSitesTreeLikelihood.h"
+#include "LikelihoodArray.h"
 
 //From the STL:
 #include <memory>
@@ -97,6 +98,16 @@ class AbstractNonHomogeneousTreeLikelihood:
     mutable std::map<int, VVVdouble> dpxy_;
 
     mutable std::map<int, VVVdouble> d2pxy_;
+
+    /**
+     * @brief Transition probabilities for each node, packed for LikelihoodKernels.
+     *
+     * These are updated together with pxy_ by computeTransitionProbabilitiesForModel(),
+     * so that they are not repacked at each likelihood computation.
+     * The reverse arrays store the transposed matrices, used when the subtree containing the root is a neighbor.
+     */
+    mutable std::map<int, LikelihoodArray> packedPxy_;
+    mutable std::map<int, LikelihoodArray> packedReversePxy_;
         
     std::vector<double> rootFreqs_;
         
@@ -289,6 +300,27 @@ class AbstractNonHomogeneousTreeLikelihood:
      */
     virtual void computeTransitionProbabilitiesForNode(const Node * node);
 
+    /**
+     * @brief Fill the pxy_, dpxy_ and d2pxy_ arrays for several nodes sharing the same model, and update the corresponding packed arrays.
+     *
+     * All matrices are obtained in a single call to SubstitutionModel::getTransitionProbabilities(),
+     * and branches with identical length × rate share the same matrices.
+     *
+     * @param modelIndex The index of the model in the set.
+     * @param nodes      The nodes to update, which must all be associated to this model.
+     */
+    virtual void computeTransitionProbabilitiesForModel(size_t modelIndex, const std::vector<const Node*>& nodes);
+
+    /**
+     * @brief Fill the pxy_, dpxy_ and d2pxy_ arrays for the nodes depending on the given parameters.
+     *
+     * The branches of all models depending on a modified substitution parameter are updated,
+     * together with the branches which length has changed. All nodes are updated if a rate distribution parameter changed.
+     *
+     * @param params The modified parameters.
+     */
+    void computeTransitionProbabilitiesForParameters(const ParameterList& params);
+
 };
 
 } //end of namespace bpp.
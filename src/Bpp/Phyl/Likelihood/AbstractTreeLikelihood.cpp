@@ -39,10 +39,27 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "AbstractTreeLikelihood.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace bpp;
 
 /******************************************************************************/
 
+void AbstractTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+#ifdef _OPENMP
+  if (nbThreads == 0)
+    nbThreads = static_cast<size_t>(omp_get_num_procs());
+  nbThreads_ = nbThreads;
+#else
+  nbThreads_ = 1;
+#endif
+}
+
+/******************************************************************************/
+
 Vdouble AbstractTreeLikelihood::getLikelihoodForEachSite() const
 {
 	Vdouble l(getNumberOfSites());
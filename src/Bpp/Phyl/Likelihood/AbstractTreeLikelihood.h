@@ -65,6 +65,9 @@ namespace bpp
  * - The getTree() method;
  * 
  * It also adds an abstract method for recursive computations.
+ *
+ * Implementations may split independent per-site computations across several threads,
+ * see setNumberOfThreads(). Results do not depend on the number of threads used.
  */
 class AbstractTreeLikelihood :
   public virtual TreeLikelihood,
@@ -227,6 +230,7 @@ class AbstractTreeLikelihood :
     bool computeFirstOrderDerivatives_;
     bool computeSecondOrderDerivatives_;
     bool initialized_;
+    size_t nbThreads_;
 
   public:
     AbstractTreeLikelihood():
@@ -235,7 +239,8 @@ class AbstractTreeLikelihood :
       tree_(0),
       computeFirstOrderDerivatives_(true),
       computeSecondOrderDerivatives_(true),
-      initialized_(false) {}
+      initialized_(false),
+      nbThreads_(1) {}
 
     AbstractTreeLikelihood(const AbstractTreeLikelihood & lik):
       AbstractParametrizable(lik),
@@ -243,7 +248,8 @@ class AbstractTreeLikelihood :
       tree_(0),
       computeFirstOrderDerivatives_(lik.computeFirstOrderDerivatives_),
       computeSecondOrderDerivatives_(lik.computeSecondOrderDerivatives_),
-      initialized_(lik.initialized_) 
+      initialized_(lik.initialized_),
+      nbThreads_(lik.nbThreads_)
     {
       if (lik.data_) data_ = dynamic_cast<SiteContainer*>(lik.data_->clone());
       if (lik.tree_) tree_ = lik.tree_->clone();
@@ -261,6 +267,7 @@ class AbstractTreeLikelihood :
       computeFirstOrderDerivatives_ = lik.computeFirstOrderDerivatives_;
       computeSecondOrderDerivatives_ = lik.computeSecondOrderDerivatives_;
       initialized_ = lik.initialized_;
+      nbThreads_ = lik.nbThreads_;
       return *this;
     }
 
@@ -298,6 +305,21 @@ class AbstractTreeLikelihood :
     void initialize() throw (Exception) { initialized_ = true; }
     /** @} */
 
+    /**
+     * @brief Set the number of threads used for likelihood computations.
+     *
+     * Sites are split into blocks which are distributed over the threads.
+     * If the library was built without OpenMP support, computations are always single-threaded.
+     *
+     * @param nbThreads The number of threads to use. 0 means one thread per available processor.
+     */
+    virtual void setNumberOfThreads(size_t nbThreads);
+
+    /**
+     * @return The number of threads used for likelihood computations.
+     */
+    size_t getNumberOfThreads() const { return nbThreads_; }
+
 //  protected:
 //    
 //    /**
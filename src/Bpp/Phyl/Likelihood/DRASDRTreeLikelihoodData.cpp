@@ -78,24 +78,13 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const SiteContainer& sites, const
   delete sequences;
 
   // Now initialize root likelihoods and derivatives:
-  rootLikelihoods_.resize(nbDistinctSites_);
+  rootLikelihoods_.resize(nbDistinctSites_, nbClasses_, nbStates_);
+  rootLikelihoods_.fill(1.);
   rootLikelihoodsS_.resize(nbDistinctSites_);
   rootLikelihoodsSR_.resize(nbDistinctSites_);
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    VVdouble* rootLikelihoods_i_ = &rootLikelihoods_[i];
-    Vdouble* rootLikelihoodsS_i_ = &rootLikelihoodsS_[i];
-    rootLikelihoods_i_->resize(nbClasses_);
-    rootLikelihoodsS_i_->resize(nbClasses_);
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      Vdouble* rootLikelihoods_i_c_ = &(*rootLikelihoods_i_)[c];
-      rootLikelihoods_i_c_->resize(nbStates_);
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        (*rootLikelihoods_i_c_)[x] = 1.;
-      }
-    }
+    rootLikelihoodsS_[i].resize(nbClasses_);
   }
 }
 
@@ -147,7 +136,6 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const Node* node, const SiteConta
 
   // Initialize likelihood vector:
   DRASDRTreeLikelihoodNodeData* nodeData = &nodeData_[node->getId()];
-  std::map<int, VVVdouble>* likelihoods_node_ = &nodeData->getLikelihoodArrays();
   nodeData->setNode(node);
 
   int nbSons = static_cast<int>(node->getNumberOfSons());
@@ -155,9 +143,9 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const Node* node, const SiteConta
   for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
   {
     const Node* neighbor = (*node)[n];
-    VVVdouble* likelihoods_node_neighbor_ = &(*likelihoods_node_)[neighbor->getId()];
+    LikelihoodArray* likelihoods_node_neighbor_ = &nodeData->getLikelihoodBufferForNeighbor(neighbor->getId());
 
-    likelihoods_node_neighbor_->resize(nbDistinctSites_);
+    likelihoods_node_neighbor_->resize(nbDistinctSites_, nbClasses_, nbStates_);
 
     if (neighbor->isLeaf())
     {
@@ -165,35 +153,19 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const Node* node, const SiteConta
       for (size_t i = 0; i < nbDistinctSites_; i++)
       {
         Vdouble* leavesLikelihoods_leaf_i_ = &(*leavesLikelihoods_leaf_)[i];
-        VVdouble* likelihoods_node_neighbor_i_ = &(*likelihoods_node_neighbor_)[i];
-        likelihoods_node_neighbor_i_->resize(nbClasses_);
         for (size_t c = 0; c < nbClasses_; c++)
         {
-          Vdouble* likelihoods_node_neighbor_i_c_ = &(*likelihoods_node_neighbor_i_)[c];
-          likelihoods_node_neighbor_i_c_->resize(nbStates_);
+          double* likelihoods_node_neighbor_i_c_ = (*likelihoods_node_neighbor_)(i, c);
           for (size_t s = 0; s < nbStates_; s++)
           {
-            (*likelihoods_node_neighbor_i_c_)[s] = (*leavesLikelihoods_leaf_i_)[s];
+            likelihoods_node_neighbor_i_c_[s] = (*leavesLikelihoods_leaf_i_)[s];
           }
         }
       }
     }
     else
     {
-      for (size_t i = 0; i < nbDistinctSites_; i++)
-      {
-        VVdouble* likelihoods_node_neighbor_i_ = &(*likelihoods_node_neighbor_)[i];
-        likelihoods_node_neighbor_i_->resize(nbClasses_);
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* likelihoods_node_neighbor_i_c_ = &(*likelihoods_node_neighbor_i_)[c];
-          likelihoods_node_neighbor_i_c_->resize(nbStates_);
-          for (size_t s = 0; s < nbStates_; s++)
-          {
-            (*likelihoods_node_neighbor_i_c_)[s] = 1.; // All likelihoods are initialized to 1.
-          }
-        }
-      }
+      likelihoods_node_neighbor_->fill(1.); // All likelihoods are initialized to 1.
     }
   }
 
@@ -228,23 +200,9 @@ void DRASDRTreeLikelihoodData::reInit(const Node* node) throw (Exception)
   for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
   {
     const Node* neighbor = (*node)[n];
-    VVVdouble* array = &nodeData->getLikelihoodArrayForNeighbor(neighbor->getId());
-
-    array->resize(nbDistinctSites_);
-    for (size_t i = 0; i < nbDistinctSites_; i++)
-    {
-      VVdouble* array_i = &(*array)[i];
-      array_i->resize(nbClasses_);
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        Vdouble* array_i_c = &(*array_i)[c];
-        array_i_c->resize(nbStates_);
-        for (size_t s = 0; s < nbStates_; s++)
-        {
-          (*array_i_c)[s] = 1.; // All likelihoods are initialized to 1.
-        }
-      }
-    }
+    LikelihoodArray* array = &nodeData->getLikelihoodBufferForNeighbor(neighbor->getId());
+    array->resize(nbDistinctSites_, nbClasses_, nbStates_);
+    array->fill(1.); // All likelihoods are initialized to 1.
   }
 
   // We re-initialize each son node:
@@ -42,15 +42,20 @@ knowledge of the CeCILL license and that you accept its terms.
 #define _DRASDRHOMOGENEOUSTREELIKELIHOODDATA_H_
 
 #include "AbstractTreeLikelihoodData.h"
+#include "LikelihoodArray.h"
 #include "../Model/SubstitutionModel.h"
 #include "../PatternTools.h"
 #include "../SitePatterns.h"
 
+#include <Bpp/Text/TextTools.h>
+
 //From SeqLib:
 #include <Bpp/Seq/Container/AlignedSequenceContainer.h>
 
 // From the STL:
 #include <map>
+#include <vector>
+#include <algorithm>
 
 namespace bpp
 {
@@ -107,6 +112,13 @@ class DRASDRTreeLikelihoodLeafData :
  * This class is for use with the DRASDRTreeLikelihoodData class.
  * 
  * Store for each neighbor node an array with conditionnal likelihoods.
+ * Arrays are stored in a vector, in the order in which the neighbors were added
+ * (father node first, if any, then son nodes), and the neighbor ids are kept in
+ * a parallel vector. As a node has only a few neighbors, looking an array up
+ * is a short linear scan, without any allocation nor tree traversal.
+ *
+ * Arrays are LikelihoodArray objects, accessed with the getLikelihoodBuffer...() methods.
+ * The former VVVdouble accessors are kept for compatibility, but only return read-only copies.
  *
  * @see DRASDRTreeLikelihoodData
  */
@@ -118,16 +130,21 @@ class DRASDRTreeLikelihoodNodeData :
      * @brief This contains all likelihood values used for computation.
      *
      * <pre>
-     * x[b][i][c][s]
-     *   |------------> Neighbor node of n (id)
-      *     |---------> Site i
+     * x[b](i, c)[s]
+     *   |------------> Neighbor node of n (index in neighborIds_)
+     *     |---------> Site i
      *         |------> Rate class c
      *            |---> Ancestral state s
      * </pre>
      * We call this the <i>likelihood array</i> for each node.
      */
+    mutable std::vector<LikelihoodArray> nodeLikelihoods_;
+
+    /**
+     * @brief Ids of the neighbor nodes, in the same order as nodeLikelihoods_.
+     */
+    std::vector<int> neighborIds_;
 
-    mutable std::map<int, VVVdouble> nodeLikelihoods_;
     /**
      * @brief This contains all likelihood first order derivatives values used for computation.
      *
@@ -152,22 +169,31 @@ class DRASDRTreeLikelihoodNodeData :
     
     const Node* node_;
 
+    /**
+     * @brief Copies returned by the deprecated VVVdouble accessors.
+     */
+    mutable std::map<int, VVVdouble> legacyLikelihoods_;
+
   public:
-    DRASDRTreeLikelihoodNodeData() : nodeLikelihoods_(), nodeDLikelihoods_(), nodeD2Likelihoods_(), node_(0) {}
+    DRASDRTreeLikelihoodNodeData() : nodeLikelihoods_(), neighborIds_(), nodeDLikelihoods_(), nodeD2Likelihoods_(), node_(0), legacyLikelihoods_() {}
     
     DRASDRTreeLikelihoodNodeData(const DRASDRTreeLikelihoodNodeData& data) :
       nodeLikelihoods_(data.nodeLikelihoods_),
+      neighborIds_(data.neighborIds_),
       nodeDLikelihoods_(data.nodeDLikelihoods_),
       nodeD2Likelihoods_(data.nodeD2Likelihoods_),
-      node_(data.node_)
+      node_(data.node_),
+      legacyLikelihoods_()
     {}
     
     DRASDRTreeLikelihoodNodeData& operator=(const DRASDRTreeLikelihoodNodeData& data)
     {
       nodeLikelihoods_   = data.nodeLikelihoods_;
+      neighborIds_       = data.neighborIds_;
       nodeDLikelihoods_  = data.nodeDLikelihoods_;
       nodeD2Likelihoods_ = data.nodeD2Likelihoods_;
       node_              = data.node_;
+      legacyLikelihoods_.clear();
       return *this;
     }
  
@@ -188,18 +214,96 @@ class DRASDRTreeLikelihoodNodeData :
     
     void setNode(const Node* node) { node_ = node; }
 
-    const std::map<int, VVVdouble>& getLikelihoodArrays() const { return nodeLikelihoods_; }
-    
-    std::map<int, VVVdouble>& getLikelihoodArrays() { return nodeLikelihoods_; }
-    
-    VVVdouble& getLikelihoodArrayForNeighbor(int neighborId)
+    size_t getNumberOfNeighbors() const { return neighborIds_.size(); }
+
+    int getNeighborId(size_t neighborIndex) const { return neighborIds_[neighborIndex]; }
+
+    /**
+     * @return The position of the array associated to a given neighbor.
+     * @param neighborId The id of the neighbor node.
+     * @throw Exception If the node is not a neighbor.
+     */
+    size_t getNeighborIndex(int neighborId) const throw (Exception)
+    {
+      for (size_t k = 0; k < neighborIds_.size(); k++)
+      {
+        if (neighborIds_[k] == neighborId)
+          return k;
+      }
+      throw Exception("DRASDRTreeLikelihoodNodeData::getNeighborIndex. Node " + TextTools::toString(neighborId) + " is not a neighbor.");
+    }
+
+    LikelihoodArray& getLikelihoodBufferForNeighborIndex(size_t neighborIndex)
+    {
+      return nodeLikelihoods_[neighborIndex];
+    }
+
+    const LikelihoodArray& getLikelihoodBufferForNeighborIndex(size_t neighborIndex) const
     {
-      return nodeLikelihoods_[neighborId];
+      return nodeLikelihoods_[neighborIndex];
+    }
+
+    /**
+     * @return The array associated to a given neighbor.
+     * A new, empty, array is created if the node was not already registered as a neighbor.
+     * @param neighborId The id of the neighbor node.
+     */
+    LikelihoodArray& getLikelihoodBufferForNeighbor(int neighborId)
+    {
+      for (size_t k = 0; k < neighborIds_.size(); k++)
+      {
+        if (neighborIds_[k] == neighborId)
+          return nodeLikelihoods_[k];
+      }
+      neighborIds_.push_back(neighborId);
+      nodeLikelihoods_.push_back(LikelihoodArray());
+      return nodeLikelihoods_.back();
     }
     
-    const VVVdouble& getLikelihoodArrayForNeighbor(int neighborId) const
+    const LikelihoodArray& getLikelihoodBufferForNeighbor(int neighborId) const throw (Exception)
+    {
+      return nodeLikelihoods_[getNeighborIndex(neighborId)];
+    }
+
+    /**
+     * @return A copy of the array associated to a given neighbor, as a nested vector.
+     *
+     * The copy holds the actual (unscaled) likelihoods, and is refreshed at each call.
+     * Modifying it has no effect on the likelihood computations, so only const access is provided.
+     * This method is not thread-safe.
+     *
+     * @param neighborId The id of the neighbor node.
+     * @throw Exception If the node is not a neighbor.
+     * @deprecated Likelihoods are stored as LikelihoodArray objects, use getLikelihoodBufferForNeighbor() instead.
+     */
+    const VVVdouble& getLikelihoodArrayForNeighbor(int neighborId) const throw (Exception)
     {
-      return nodeLikelihoods_[neighborId];
+      VVVdouble* array = &legacyLikelihoods_[neighborId];
+      getLikelihoodBufferForNeighbor(neighborId).copyUnscaledTo(*array);
+      return *array;
+    }
+
+    /**
+     * @return Copies of the arrays associated to all neighbors, as nested vectors, indexed by neighbor id.
+     *
+     * Same remarks as for getLikelihoodArrayForNeighbor().
+     *
+     * @deprecated Use getNumberOfNeighbors(), getNeighborId() and getLikelihoodBufferForNeighborIndex() instead.
+     */
+    const std::map<int, VVVdouble>& getLikelihoodArrays() const
+    {
+      for (std::map<int, VVVdouble>::iterator it = legacyLikelihoods_.begin(); it != legacyLikelihoods_.end();)
+      {
+        if (isNeighbor(it->first))
+          it++;
+        else
+          legacyLikelihoods_.erase(it++);
+      }
+      for (size_t k = 0; k < neighborIds_.size(); k++)
+      {
+        nodeLikelihoods_[k].copyUnscaledTo(legacyLikelihoods_[neighborIds_[k]]);
+      }
+      return legacyLikelihoods_;
     }
     
     Vdouble& getDLikelihoodArray() { return nodeDLikelihoods_;  }
@@ -212,12 +316,14 @@ class DRASDRTreeLikelihoodNodeData :
 
     bool isNeighbor(int neighborId) const
     {
-      return nodeLikelihoods_.find(neighborId) != nodeLikelihoods_.end();
+      return std::find(neighborIds_.begin(), neighborIds_.end(), neighborId) != neighborIds_.end();
     }
 
     void eraseNeighborArrays()
     {
-      nodeLikelihoods_.erase(nodeLikelihoods_.begin(), nodeLikelihoods_.end());
+      nodeLikelihoods_.clear();
+      neighborIds_.clear();
+      legacyLikelihoods_.clear();
       nodeDLikelihoods_.erase(nodeDLikelihoods_.begin(), nodeDLikelihoods_.end());
       nodeD2Likelihoods_.erase(nodeD2Likelihoods_.begin(), nodeD2Likelihoods_.end());
     }
@@ -233,9 +339,10 @@ class DRASDRTreeLikelihoodData :
 
     mutable std::map<int, DRASDRTreeLikelihoodNodeData> nodeData_;
     mutable std::map<int, DRASDRTreeLikelihoodLeafData> leafData_;
-    mutable VVVdouble rootLikelihoods_;
+    mutable LikelihoodArray rootLikelihoods_;
     mutable VVdouble  rootLikelihoodsS_;
     mutable Vdouble   rootLikelihoodsSR_;
+    mutable VVVdouble legacyRootLikelihoods_;
 
     SiteContainer* shrunkData_;
     size_t nbSites_; 
@@ -246,7 +353,7 @@ class DRASDRTreeLikelihoodData :
   public:
     DRASDRTreeLikelihoodData(const TreeTemplate<Node>* tree, size_t nbClasses) :
       AbstractTreeLikelihoodData(tree),
-      nodeData_(), leafData_(), rootLikelihoods_(), rootLikelihoodsS_(), rootLikelihoodsSR_(),
+      nodeData_(), leafData_(), rootLikelihoods_(), rootLikelihoodsS_(), rootLikelihoodsSR_(), legacyRootLikelihoods_(),
       shrunkData_(0), nbSites_(0), nbStates_(0), nbClasses_(nbClasses), nbDistinctSites_(0)
     {}
 
@@ -256,6 +363,7 @@ class DRASDRTreeLikelihoodData :
       rootLikelihoods_(data.rootLikelihoods_),
       rootLikelihoodsS_(data.rootLikelihoodsS_),
       rootLikelihoodsSR_(data.rootLikelihoodsSR_),
+      legacyRootLikelihoods_(),
       shrunkData_(0),
       nbSites_(data.nbSites_), nbStates_(data.nbStates_),
       nbClasses_(data.nbClasses_), nbDistinctSites_(data.nbDistinctSites_)
@@ -272,6 +380,7 @@ class DRASDRTreeLikelihoodData :
       rootLikelihoods_   = data.rootLikelihoods_;
       rootLikelihoodsS_  = data.rootLikelihoodsS_;
       rootLikelihoodsSR_ = data.rootLikelihoodsSR_;
+      legacyRootLikelihoods_.clear();
       nbSites_           = data.nbSites_;
       nbStates_          = data.nbStates_;
       nbClasses_         = data.nbClasses_;
@@ -318,9 +427,17 @@ class DRASDRTreeLikelihoodData :
       return nodeData_[nodeId];
     }
     
-    const DRASDRTreeLikelihoodNodeData& getNodeData(int nodeId) const
+    /**
+     * @brief Const accessors never insert in the maps, so that they can be called concurrently.
+     *
+     * @throw Exception If no data is attached to this node.
+     */
+    const DRASDRTreeLikelihoodNodeData& getNodeData(int nodeId) const throw (Exception)
     { 
-      return nodeData_[nodeId];
+      std::map<int, DRASDRTreeLikelihoodNodeData>::const_iterator it = nodeData_.find(nodeId);
+      if (it == nodeData_.end())
+        throw Exception("DRASDRTreeLikelihoodData::getNodeData. No data for node " + TextTools::toString(nodeId) + ".");
+      return it->second;
     }
     
     DRASDRTreeLikelihoodLeafData& getLeafData(int nodeId)
@@ -328,9 +445,12 @@ class DRASDRTreeLikelihoodData :
       return leafData_[nodeId];
     }
     
-    const DRASDRTreeLikelihoodLeafData& getLeafData(int nodeId) const
+    const DRASDRTreeLikelihoodLeafData& getLeafData(int nodeId) const throw (Exception)
     { 
-      return leafData_[nodeId];
+      std::map<int, DRASDRTreeLikelihoodLeafData>::const_iterator it = leafData_.find(nodeId);
+      if (it == leafData_.end())
+        throw Exception("DRASDRTreeLikelihoodData::getLeafData. No data for leaf " + TextTools::toString(nodeId) + ".");
+      return it->second;
     }
     
     size_t getArrayPosition(int parentId, int sonId, size_t currentPosition) const
@@ -338,24 +458,30 @@ class DRASDRTreeLikelihoodData :
       return currentPosition;
     }
 
-    const std::map<int, VVVdouble>& getLikelihoodArrays(int nodeId) const 
+    LikelihoodArray& getLikelihoodBuffer(int parentId, int neighborId)
     {
-      return nodeData_[nodeId].getLikelihoodArrays();
+      return nodeData_[parentId].getLikelihoodBufferForNeighbor(neighborId);
     }
     
-    std::map<int, VVVdouble>& getLikelihoodArrays(int nodeId)
+    const LikelihoodArray& getLikelihoodBuffer(int parentId, int neighborId) const
     {
-      return nodeData_[nodeId].getLikelihoodArrays();
+      return getNodeData(parentId).getLikelihoodBufferForNeighbor(neighborId);
     }
 
-    VVVdouble& getLikelihoodArray(int parentId, int neighborId)
+    /**
+     * @deprecated See DRASDRTreeLikelihoodNodeData::getLikelihoodArrayForNeighbor(), use getLikelihoodBuffer() instead.
+     */
+    const VVVdouble& getLikelihoodArray(int parentId, int neighborId) const
     {
-      return nodeData_[parentId].getLikelihoodArrayForNeighbor(neighborId);
+      return getNodeData(parentId).getLikelihoodArrayForNeighbor(neighborId);
     }
-    
-    const VVVdouble& getLikelihoodArray(int parentId, int neighborId) const
+
+    /**
+     * @deprecated See DRASDRTreeLikelihoodNodeData::getLikelihoodArrays().
+     */
+    const std::map<int, VVVdouble>& getLikelihoodArrays(int nodeId) const
     {
-      return nodeData_[parentId].getLikelihoodArrayForNeighbor(neighborId);
+      return getNodeData(nodeId).getLikelihoodArrays();
     }
     
     Vdouble& getDLikelihoodArray(int nodeId)
@@ -365,7 +491,7 @@ class DRASDRTreeLikelihoodData :
     
     const Vdouble& getDLikelihoodArray(int nodeId) const
     {
-      return nodeData_[nodeId].getDLikelihoodArray();
+      return getNodeData(nodeId).getDLikelihoodArray();
     }
     
     Vdouble& getD2LikelihoodArray(int nodeId)
@@ -388,8 +514,21 @@ class DRASDRTreeLikelihoodData :
       return leafData_[nodeId].getLikelihoodArray();
     }
     
-    VVVdouble& getRootLikelihoodArray() { return rootLikelihoods_; }
-    const VVVdouble & getRootLikelihoodArray() const { return rootLikelihoods_; }
+    LikelihoodArray& getRootLikelihoodBuffer() { return rootLikelihoods_; }
+    const LikelihoodArray& getRootLikelihoodBuffer() const { return rootLikelihoods_; }
+
+    /**
+     * @return A copy of the root array, as a nested vector, with the actual (unscaled) likelihoods.
+     *
+     * The copy is refreshed at each call. This method is not thread-safe.
+     *
+     * @deprecated Use getRootLikelihoodBuffer() instead.
+     */
+    const VVVdouble& getRootLikelihoodArray() const
+    {
+      rootLikelihoods_.copyUnscaledTo(legacyRootLikelihoods_);
+      return legacyRootLikelihoods_;
+    }
     
     VVdouble& getRootSiteLikelihoodArray() { return rootLikelihoodsS_; }
     const VVdouble& getRootSiteLikelihoodArray() const { return rootLikelihoodsS_; }
@@ -68,6 +68,11 @@ namespace bpp
  * We call this the <i>likelihood array</i> for each node.
  * In the same way, we store first and second order derivatives.
  *
+ * When scaling is enabled, the actual likelihoods of site i are the stored values times
+ * exp(s[i]), where s is the vector of log scaling factors of the node. This vector sums the
+ * factors of the son nodes and the factors applied locally at this node, which are also stored
+ * as they are needed to put the derivative arrays on the same scale.
+ *
  * @see DRASRTreeLikelihoodData
  */
 class DRASRTreeLikelihoodNodeData :
@@ -77,15 +82,21 @@ class DRASRTreeLikelihoodNodeData :
     mutable VVVdouble nodeLikelihoods_;
     mutable VVVdouble nodeDLikelihoods_;
     mutable VVVdouble nodeD2Likelihoods_;
+    mutable Vdouble nodeLogScalingFactors_;
+    mutable Vdouble nodeLocalLogScalingFactors_;
     const Node* node_;
 
   public:
-    DRASRTreeLikelihoodNodeData() : nodeLikelihoods_(), nodeDLikelihoods_(), nodeD2Likelihoods_(), node_(0) {}
+    DRASRTreeLikelihoodNodeData() :
+      nodeLikelihoods_(), nodeDLikelihoods_(), nodeD2Likelihoods_(),
+      nodeLogScalingFactors_(), nodeLocalLogScalingFactors_(), node_(0) {}
     
     DRASRTreeLikelihoodNodeData(const DRASRTreeLikelihoodNodeData& data) :
       nodeLikelihoods_(data.nodeLikelihoods_),
       nodeDLikelihoods_(data.nodeDLikelihoods_),
       nodeD2Likelihoods_(data.nodeD2Likelihoods_),
+      nodeLogScalingFactors_(data.nodeLogScalingFactors_),
+      nodeLocalLogScalingFactors_(data.nodeLocalLogScalingFactors_),
       node_(data.node_)
     {}
     
@@ -94,6 +105,8 @@ class DRASRTreeLikelihoodNodeData :
       nodeLikelihoods_   = data.nodeLikelihoods_;
       nodeDLikelihoods_  = data.nodeDLikelihoods_;
       nodeD2Likelihoods_ = data.nodeD2Likelihoods_;
+      nodeLogScalingFactors_      = data.nodeLogScalingFactors_;
+      nodeLocalLogScalingFactors_ = data.nodeLocalLogScalingFactors_;
       node_              = data.node_;
       return *this;
     }
@@ -120,6 +133,12 @@ class DRASRTreeLikelihoodNodeData :
 
     VVVdouble& getD2LikelihoodArray() { return nodeD2Likelihoods_; }
     const VVVdouble& getD2LikelihoodArray() const { return nodeD2Likelihoods_; }
+
+    Vdouble& getLogScalingFactors() { return nodeLogScalingFactors_; }
+    const Vdouble& getLogScalingFactors() const { return nodeLogScalingFactors_; }
+
+    Vdouble& getLocalLogScalingFactors() { return nodeLocalLogScalingFactors_; }
+    const Vdouble& getLocalLogScalingFactors() const { return nodeLocalLogScalingFactors_; }
 };
 
 /**
@@ -261,6 +280,16 @@ class DRASRTreeLikelihoodData :
       return nodeData_[nodeId].getD2LikelihoodArray();
     }
 
+    Vdouble& getLogScalingFactors(int nodeId)
+    {
+      return nodeData_[nodeId].getLogScalingFactors();
+    }
+
+    Vdouble& getLocalLogScalingFactors(int nodeId)
+    {
+      return nodeData_[nodeId].getLocalLogScalingFactors();
+    }
+
     size_t getNumberOfDistinctSites() const { return nbDistinctSites_; }
     size_t getNumberOfSites() const { return nbSites_; }
     size_t getNumberOfStates() const { return nbStates_; }
@@ -169,6 +169,16 @@ void DRHomogeneousMixedTreeLikelihood::setData(const SiteContainer& sites) throw
   }
 }
 
+void DRHomogeneousMixedTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  DRHomogeneousTreeLikelihood::setNumberOfThreads(nbThreads);
+
+  for (unsigned int i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  {
+    treeLikelihoodsContainer_[i]->setNumberOfThreads(nbThreads);
+  }
+}
+
 
 void DRHomogeneousMixedTreeLikelihood::fireParameterChanged(const ParameterList& params)
 {
@@ -349,36 +359,24 @@ void DRHomogeneousMixedTreeLikelihood::computeRootLikelihood()
   }
 }
 
-void DRHomogeneousMixedTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode) const
+void DRHomogeneousMixedTreeLikelihood::computeLikelihoodAtNode_(const Node* node, LikelihoodArray& likelihoodArray, const Node* sonNode) const
 {
-  likelihoodArray.resize(nbDistinctSites_);
-  for (size_t i = 0; i < nbDistinctSites_; i++){
-    VVdouble* likelihoodArray_i = &likelihoodArray[i];
-    likelihoodArray_i->resize(nbClasses_);
-    for (size_t c = 0; c < nbClasses_; c++) {
-      Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-      likelihoodArray_i_c->resize(nbStates_);
-      for (size_t x = 0; x < nbStates_; x++)
-        (*likelihoodArray_i_c)[x] = 0;
-    }
-  }
+  likelihoodArray.resize(nbDistinctSites_, nbClasses_, nbStates_);
+  likelihoodArray.fill(0);
 
-  VVVdouble lArray;
+  LikelihoodArray lArray;
   for (size_t nm = 0; nm < treeLikelihoodsContainer_.size(); nm++)
   {
     treeLikelihoodsContainer_[nm]->computeLikelihoodAtNode_(node, lArray, sonNode);
     
     for (size_t i = 0; i < nbDistinctSites_; i++)
       {
-        VVdouble* likelihoodArray_i = &likelihoodArray[i];
-        VVdouble* lArray_i = &lArray[i];
-        
         for (size_t c = 0; c < nbClasses_; c++)
           {
-            Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-            Vdouble* lArray_i_c = &(*lArray_i)[c];
+            double* likelihoodArray_i_c = likelihoodArray(i, c);
+            const double* lArray_i_c = lArray(i, c);
             for (size_t x = 0; x < nbStates_; x++)
-              (*likelihoodArray_i_c)[x] += (*lArray_i_c)[x] * probas_[nm];
+              likelihoodArray_i_c[x] += lArray_i_c[x] * probas_[nm];
          }
       }
     
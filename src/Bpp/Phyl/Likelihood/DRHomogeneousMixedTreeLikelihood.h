@@ -131,6 +131,18 @@ public:
 
   DRHomogeneousMixedTreeLikelihood* clone() const { return new DRHomogeneousMixedTreeLikelihood(*this); }
 
+  /**
+   * @brief Scaling is not supported for mixture models.
+   *
+   * @throw Exception if yn is true.
+   */
+  void enableScaling(bool yn)
+  {
+    if (yn) throw Exception("DRHomogeneousMixedTreeLikelihood::enableScaling. Scaling is not supported for mixture models.");
+  }
+
+  void setNumberOfThreads(size_t nbThreads);
+
 public:
   /**
    * @name The TreeLikelihood interface.
@@ -187,7 +199,7 @@ public:
   virtual void computeTreeDLikelihoods();
 
 protected:
-  virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode = 0) const;
+  virtual void computeLikelihoodAtNode_(const Node* node, LikelihoodArray& likelihoodArray, const Node* sonNode = 0) const;
 
   /**
    * @brief Compute the likelihood for a subtree defined by the Tree::Node <i>node</i>.
@@ -38,6 +38,7 @@
  */
 
 #include "DRHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 // From SeqLib:
@@ -66,7 +67,9 @@ DRHomogeneousTreeLikelihood::DRHomogeneousTreeLikelihood(
 throw (Exception) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
-  minusLogLik_(-1.)
+  minusLogLik_(-1.),
+  packedPxy_(),
+  packedReversePxy_()
 {
   init_();
 }
@@ -83,7 +86,9 @@ DRHomogeneousTreeLikelihood::DRHomogeneousTreeLikelihood(
 throw (Exception) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
-  minusLogLik_(-1.)
+  minusLogLik_(-1.),
+  packedPxy_(),
+  packedReversePxy_()
 {
   init_();
   setData(data);
@@ -103,7 +108,9 @@ void DRHomogeneousTreeLikelihood::init_() throw (Exception)
 DRHomogeneousTreeLikelihood::DRHomogeneousTreeLikelihood(const DRHomogeneousTreeLikelihood& lik) :
   AbstractHomogeneousTreeLikelihood(lik),
   likelihoodData_(0),
-  minusLogLik_(-1.)
+  minusLogLik_(-1.),
+  packedPxy_(lik.packedPxy_),
+  packedReversePxy_(lik.packedReversePxy_)
 {
   likelihoodData_ = dynamic_cast<DRASDRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
@@ -120,6 +127,8 @@ DRHomogeneousTreeLikelihood& DRHomogeneousTreeLikelihood::operator=(const DRHomo
   likelihoodData_ = dynamic_cast<DRASDRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
   minusLogLik_ = lik.minusLogLik_;
+  packedPxy_ = lik.packedPxy_;
+  packedReversePxy_ = lik.packedReversePxy_;
   return *this;
 }
 
@@ -151,6 +160,7 @@ void DRHomogeneousTreeLikelihood::setData(const SiteContainer& sites) throw (Exc
     ApplicationTools::displayResult("Number of distinct sites",
                                     TextTools::toString(nbDistinctSites_));
   initialized_ = false;
+  flagAllNodesForUpdate();
 }
 
 /******************************************************************************/
@@ -159,10 +169,11 @@ double DRHomogeneousTreeLikelihood::getLikelihood() const
 {
   double l = 1.;
   Vdouble* lik = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const vector<double>* scales = &likelihoodData_->getRootLikelihoodBuffer().getLogScalingFactors();
   const vector<unsigned int>* w = &likelihoodData_->getWeights();
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    l *= std::pow((*lik)[i], (int)(*w)[i]);
+    l *= std::pow((*lik)[i] * exp((*scales)[i]), (int)(*w)[i]);
   }
   return l;
 }
@@ -173,11 +184,12 @@ double DRHomogeneousTreeLikelihood::getLogLikelihood() const
 {
   double ll = 0;
   Vdouble* lik = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const vector<double>* scales = &likelihoodData_->getRootLikelihoodBuffer().getLogScalingFactors();
   const vector<unsigned int>* w = &likelihoodData_->getWeights();
   vector<double> la(nbDistinctSites_);
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    la[i] = (*w)[i] * log((*lik)[i]);
+    la[i] = (*w)[i] * (log((*lik)[i]) + (*scales)[i]);
   }
   sort(la.begin(), la.end());
   for (size_t i = nbDistinctSites_; i > 0; i--)
@@ -191,41 +203,49 @@ double DRHomogeneousTreeLikelihood::getLogLikelihood() const
 
 double DRHomogeneousTreeLikelihood::getLikelihoodForASite(size_t site) const
 {
-  return likelihoodData_->getRootRateSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)];
+  size_t pos = likelihoodData_->getRootArrayPosition(site);
+  return likelihoodData_->getRootRateSiteLikelihoodArray()[pos] * exp(likelihoodData_->getRootLikelihoodBuffer().getLogScalingFactor(pos));
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLogLikelihoodForASite(size_t site) const
 {
-  return log(likelihoodData_->getRootRateSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)]);
+  size_t pos = likelihoodData_->getRootArrayPosition(site);
+  return log(likelihoodData_->getRootRateSiteLikelihoodArray()[pos]) + likelihoodData_->getRootLikelihoodBuffer().getLogScalingFactor(pos);
 }
 
 /******************************************************************************/
 double DRHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
 {
-  return likelihoodData_->getRootSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass];
+  size_t pos = likelihoodData_->getRootArrayPosition(site);
+  return likelihoodData_->getRootSiteLikelihoodArray()[pos][rateClass] * exp(likelihoodData_->getRootLikelihoodBuffer().getLogScalingFactor(pos));
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
 {
-  return log(likelihoodData_->getRootSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass]);
+  size_t pos = likelihoodData_->getRootArrayPosition(site);
+  return log(likelihoodData_->getRootSiteLikelihoodArray()[pos][rateClass]) + likelihoodData_->getRootLikelihoodBuffer().getLogScalingFactor(pos);
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return likelihoodData_->getRootLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  size_t pos = likelihoodData_->getRootArrayPosition(site);
+  const LikelihoodArray* rootLikelihoods = &likelihoodData_->getRootLikelihoodBuffer();
+  return (*rootLikelihoods)(pos, rateClass, static_cast<size_t>(state)) * exp(rootLikelihoods->getLogScalingFactor(pos));
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return log(likelihoodData_->getRootLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)]);
+  size_t pos = likelihoodData_->getRootArrayPosition(site);
+  const LikelihoodArray* rootLikelihoods = &likelihoodData_->getRootLikelihoodBuffer();
+  return log((*rootLikelihoods)(pos, rateClass, static_cast<size_t>(state))) + rootLikelihoods->getLogScalingFactor(pos);
 }
 
 /******************************************************************************/
@@ -257,7 +277,9 @@ void DRHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& para
       if (s.substr(0, 5) == "BrLen")
       {
         // Branch length parameter:
-        computeTransitionProbabilitiesForNode(nodes_[TextTools::to < size_t > (s.substr(5))]);
+        const Node* node = nodes_[TextTools::to < size_t > (s.substr(5))];
+        computeTransitionProbabilitiesForNode(node);
+        flagBranchForUpdate(node);
       }
     }
   }
@@ -277,6 +299,16 @@ void DRHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& para
 
 /******************************************************************************/
 
+void DRHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(const Node* node)
+{
+  AbstractHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(node);
+  const VVVdouble* pxy_node = &pxy_[node->getId()];
+  LikelihoodKernels::packTransitionProbabilities(*pxy_node, packedPxy_[node->getId()]);
+  LikelihoodKernels::packTransitionProbabilities(*pxy_node, packedReversePxy_[node->getId()], true);
+}
+
+/******************************************************************************/
+
 double DRHomogeneousTreeLikelihood::getValue() const
 throw (Exception)
 {
@@ -291,24 +323,26 @@ throw (Exception)
 void DRHomogeneousTreeLikelihood::computeTreeDLikelihoodAtNode(const Node* node)
 {
   const Node* father = node->getFather();
-  VVVdouble* likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  LikelihoodArray* likelihoods_father_node = &likelihoodData_->getLikelihoodBuffer(father->getId(), node->getId());
   Vdouble* dLikelihoods_node = &likelihoodData_->getDLikelihoodArray(node->getId());
   VVVdouble* dpxy_node = &dpxy_[node->getId()];
-  VVVdouble larray;
+  LikelihoodArray larray;
   computeLikelihoodAtNode_(father, larray, node);
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const LikelihoodArray* rootLikelihoods = &likelihoodData_->getRootLikelihoodBuffer();
 
-  double dLi, dLic, dLicx;
-
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+  long nbDistinctSites = static_cast<long>(nbDistinctSites_);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(static) num_threads(static_cast<int>(nbThreads_)) if(nbThreads_ > 1)
+#endif
+  for (long li = 0; li < nbDistinctSites; li++)
   {
-    VVdouble* likelihoods_father_node_i = &(*likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    dLi = 0;
+    size_t i = static_cast<size_t>(li);
+    double dLi = 0, dLic, dLicx;
     for (size_t c = 0; c < nbClasses_; c++)
     {
-      Vdouble* likelihoods_father_node_i_c = &(*likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
+      const double* likelihoods_father_node_i_c = (*likelihoods_father_node)(i, c);
+      const double* larray_i_c = larray(i, c);
       VVdouble* dpxy_node_c = &(*dpxy_node)[c];
       dLic = 0;
       for (size_t x = 0; x < nbStates_; x++)
@@ -317,14 +351,19 @@ void DRHomogeneousTreeLikelihood::computeTreeDLikelihoodAtNode(const Node* node)
         dLicx = 0;
         for (size_t y = 0; y < nbStates_; y++)
         {
-          dLicx += (*dpxy_node_c_x)[y] * (*likelihoods_father_node_i_c)[y];
+          dLicx += (*dpxy_node_c_x)[y] * likelihoods_father_node_i_c[y];
         }
-        dLicx *= (*larray_i_c)[x];
+        dLicx *= larray_i_c[x];
         dLic += dLicx;
       }
       dLi += rateDistribution_->getProbability(c) * dLic;
     }
     (*dLikelihoods_node)[i] = dLi / (*rootLikelihoodsSR)[i];
+    if (scaling_)
+    {
+      // Arrays on both sides of the branch may not have been rescaled in the same way as the root array:
+      (*dLikelihoods_node)[i] *= exp(likelihoods_father_node->getLogScalingFactor(i) + larray.getLogScalingFactor(i) - rootLikelihoods->getLogScalingFactor(i));
+    }
     // cout << dLi << "\t" << (*rootLikelihoodsSR)[i] << endl;
   }
 }
@@ -378,24 +417,26 @@ throw (Exception)
 void DRHomogeneousTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* node)
 {
   const Node* father = node->getFather();
-  VVVdouble* likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  LikelihoodArray* likelihoods_father_node = &likelihoodData_->getLikelihoodBuffer(father->getId(), node->getId());
   Vdouble* d2Likelihoods_node = &likelihoodData_->getD2LikelihoodArray(node->getId());
   VVVdouble* d2pxy_node = &d2pxy_[node->getId()];
-  VVVdouble larray;
+  LikelihoodArray larray;
   computeLikelihoodAtNode_(father, larray, node);
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const LikelihoodArray* rootLikelihoods = &likelihoodData_->getRootLikelihoodBuffer();
 
-  double d2Li, d2Lic, d2Licx;
-
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+  long nbDistinctSites = static_cast<long>(nbDistinctSites_);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(static) num_threads(static_cast<int>(nbThreads_)) if(nbThreads_ > 1)
+#endif
+  for (long li = 0; li < nbDistinctSites; li++)
   {
-    VVdouble* likelihoods_father_node_i = &(*likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    d2Li = 0;
+    size_t i = static_cast<size_t>(li);
+    double d2Li = 0, d2Lic, d2Licx;
     for (size_t c = 0; c < nbClasses_; c++)
     {
-      Vdouble* likelihoods_father_node_i_c = &(*likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
+      const double* likelihoods_father_node_i_c = (*likelihoods_father_node)(i, c);
+      const double* larray_i_c = larray(i, c);
       VVdouble* d2pxy_node_c = &(*d2pxy_node)[c];
       d2Lic = 0;
       for (size_t x = 0; x < nbStates_; x++)
@@ -404,14 +445,19 @@ void DRHomogeneousTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* node
         d2Licx = 0;
         for (size_t y = 0; y < nbStates_; y++)
         {
-          d2Licx += (*d2pxy_node_c_x)[y] * (*likelihoods_father_node_i_c)[y];
+          d2Licx += (*d2pxy_node_c_x)[y] * likelihoods_father_node_i_c[y];
         }
-        d2Licx *= (*larray_i_c)[x];
+        d2Licx *= larray_i_c[x];
         d2Lic += d2Licx;
       }
       d2Li += rateDistribution_->getProbability(c) * d2Lic;
     }
     (*d2Likelihoods_node)[i] = d2Li / (*rootLikelihoodsSR)[i];
+    if (scaling_)
+    {
+      // Arrays on both sides of the branch may not have been rescaled in the same way as the root array:
+      (*d2Likelihoods_node)[i] *= exp(likelihoods_father_node->getLogScalingFactor(i) + larray.getLogScalingFactor(i) - rootLikelihoods->getLogScalingFactor(i));
+    }
   }
 }
 
@@ -466,12 +512,12 @@ void DRHomogeneousTreeLikelihood::resetLikelihoodArrays(const Node* node)
   for (size_t n = 0; n < node->getNumberOfSons(); n++)
   {
     const Node* subNode = node->getSon(n);
-    resetLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), subNode->getId()));
+    resetLikelihoodArray(likelihoodData_->getLikelihoodBuffer(node->getId(), subNode->getId()));
   }
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    resetLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), father->getId()));
+    resetLikelihoodArray(likelihoodData_->getLikelihoodBuffer(node->getId(), father->getId()));
   }
 }
 
@@ -482,6 +528,7 @@ void DRHomogeneousTreeLikelihood::computeTreeLikelihood()
   computeSubtreeLikelihoodPostfix(tree_->getRootNode());
   computeSubtreeLikelihoodPrefix(tree_->getRootNode());
   computeRootLikelihood();
+  resetUpdateFlags();
 }
 
 /******************************************************************************/
@@ -493,17 +540,20 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
   if (node->getNumberOfSons() == 0)
     return;
 
-  // Set all likelihood arrays to 1 for a start:
-  resetLikelihoodArrays(node);
-
-  map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
+  DRASDRTreeLikelihoodNodeData* _data_node = &likelihoodData_->getNodeData(node->getId());
   size_t nbNodes = node->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
   {
     // For each son node...
 
     const Node* son = node->getSon(l);
-    VVVdouble* _likelihoods_node_son = &(*_likelihoods_node)[son->getId()];
+    // Arrays of unmodified subtrees are still valid:
+    if (!isUpdateNeededBelow(son))
+      continue;
+
+    LikelihoodArray* _likelihoods_node_son = &_data_node->getLikelihoodBufferForNeighbor(son->getId());
+    // Set the likelihood array to 1 for a start:
+    resetLikelihoodArray(*_likelihoods_node_son);
 
     if (son->isLeaf())
     {
@@ -512,15 +562,14 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
       {
         // For each site in the sequence,
         Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
-        VVdouble* _likelihoods_node_son_i = &(*_likelihoods_node_son)[i];
         for (size_t c = 0; c < nbClasses_; c++)
         {
           // For each rate classe,
-          Vdouble* _likelihoods_node_son_i_c = &(*_likelihoods_node_son_i)[c];
+          double* _likelihoods_node_son_i_c = (*_likelihoods_node_son)(i, c);
           for (size_t x = 0; x < nbStates_; x++)
           {
             // For each initial state,
-            (*_likelihoods_node_son_i_c)[x] = (*_likelihoods_leaf_i)[x];
+            _likelihoods_node_son_i_c[x] = (*_likelihoods_leaf_i)[x];
           }
         }
       }
@@ -529,17 +578,19 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
     {
       computeSubtreeLikelihoodPostfix(son); // Recursive method:
       size_t nbSons = son->getNumberOfSons();
-      map<int, VVVdouble>* _likelihoods_son = &likelihoodData_->getLikelihoodArrays(son->getId());
+      DRASDRTreeLikelihoodNodeData* _data_son = &likelihoodData_->getNodeData(son->getId());
 
-      vector<const VVVdouble*> iLik(nbSons);
-      vector<const VVVdouble*> tProb(nbSons);
+      vector<const LikelihoodArray*> iLik(nbSons);
+      vector<const LikelihoodArray*> tProb(nbSons);
       for (size_t n = 0; n < nbSons; n++)
       {
         const Node* sonSon = son->getSon(n);
-        tProb[n] = &pxy_[sonSon->getId()];
-        iLik[n] = &(*_likelihoods_son)[sonSon->getId()];
+        tProb[n] = &packedPxy_[sonSon->getId()];
+        iLik[n] = &_data_son->getLikelihoodBufferForNeighbor(sonSon->getId());
       }
-      computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_son, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+      computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_son, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false, nbThreads_);
+      if (scaling_)
+        LikelihoodKernels::rescaleConditionalLikelihoods(*_likelihoods_node_son, nbThreads_);
     }
   }
 }
@@ -562,87 +613,88 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
   else
   {
     const Node* father = node->getFather();
-    map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
-    map<int, VVVdouble>* _likelihoods_father = &likelihoodData_->getLikelihoodArrays(father->getId());
-    VVVdouble* _likelihoods_node_father = &(*_likelihoods_node)[father->getId()];
-    if (node->isLeaf())
+    DRASDRTreeLikelihoodNodeData* _data_father = &likelihoodData_->getNodeData(father->getId());
+    LikelihoodArray* _likelihoods_node_father = &likelihoodData_->getLikelihoodBuffer(node->getId(), father->getId());
+    if (isUpdateNeededAbove(node))
     {
       resetLikelihoodArray(*_likelihoods_node_father);
-    }
 
-    if (father->isLeaf())
-    {
-      // If the tree is rooted by a leaf
-      VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(father->getId());
-      for (size_t i = 0; i < nbDistinctSites_; i++)
+      if (father->isLeaf())
       {
-        // For each site in the sequence,
-        Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
-        VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        // If the tree is rooted by a leaf
+        VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(father->getId());
+        for (size_t i = 0; i < nbDistinctSites_; i++)
         {
-          // For each rate classe,
-          Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          // For each site in the sequence,
+          Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            // For each initial state,
-            (*_likelihoods_node_father_i_c)[x] = (*_likelihoods_leaf_i)[x];
+            // For each rate classe,
+            double* _likelihoods_node_father_i_c = (*_likelihoods_node_father)(i, c);
+            for (size_t x = 0; x < nbStates_; x++)
+            {
+              // For each initial state,
+              _likelihoods_node_father_i_c[x] = (*_likelihoods_leaf_i)[x];
+            }
           }
         }
       }
-    }
-    else
-    {
-      vector<const Node*> nodes;
-      // Add brothers:
-      size_t nbFatherSons = father->getNumberOfSons();
-      for (size_t n = 0; n < nbFatherSons; n++)
+      else
       {
-        const Node* son = father->getSon(n);
-        if (son->getId() != node->getId())
-          nodes.push_back(son);  // This is a real brother, not current node!
-      }
-      // Now the real stuff... We've got to compute the likelihoods for the
-      // subtree defined by node 'father'.
-      // This is the same as postfix method, but with different subnodes.
+        vector<const Node*> nodes;
+        // Add brothers:
+        size_t nbFatherSons = father->getNumberOfSons();
+        for (size_t n = 0; n < nbFatherSons; n++)
+        {
+          const Node* son = father->getSon(n);
+          if (son->getId() != node->getId())
+            nodes.push_back(son);  // This is a real brother, not current node!
+        }
+        // Now the real stuff... We've got to compute the likelihoods for the
+        // subtree defined by node 'father'.
+        // This is the same as postfix method, but with different subnodes.
 
-      size_t nbSons = nodes.size(); // In case of a bifurcating tree, this is equal to 1, excepted for the root.
+        size_t nbSons = nodes.size(); // In case of a bifurcating tree, this is equal to 1, excepted for the root.
 
-      vector<const VVVdouble*> iLik(nbSons);
-      vector<const VVVdouble*> tProb(nbSons);
-      for (size_t n = 0; n < nbSons; n++)
-      {
-        const Node* fatherSon = nodes[n];
-        tProb[n] = &pxy_[fatherSon->getId()];
-        iLik[n] = &(*_likelihoods_father)[fatherSon->getId()];
-      }
+        vector<const LikelihoodArray*> iLik(nbSons);
+        vector<const LikelihoodArray*> tProb(nbSons);
+        for (size_t n = 0; n < nbSons; n++)
+        {
+          const Node* fatherSon = nodes[n];
+          tProb[n] = &packedPxy_[fatherSon->getId()];
+          iLik[n] = &_data_father->getLikelihoodBufferForNeighbor(fatherSon->getId());
+        }
 
-      if (father->hasFather())
-      {
-        const Node* fatherFather = father->getFather();
-        computeLikelihoodFromArrays(iLik, tProb, &(*_likelihoods_father)[fatherFather->getId()], &pxy_[father->getId()], *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
-      }
-      else
-      {
-        computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+        if (father->hasFather())
+        {
+          const Node* fatherFather = father->getFather();
+          iLik.push_back(&_data_father->getLikelihoodBufferForNeighbor(fatherFather->getId()));
+          tProb.push_back(&packedReversePxy_[father->getId()]);
+          computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_father, nbSons + 1, nbDistinctSites_, nbClasses_, nbStates_, false, nbThreads_);
+        }
+        else
+        {
+          computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false, nbThreads_);
+        }
       }
-    }
 
-    if (!father->hasFather())
-    {
-      // We have to account for the root frequencies:
-      for (size_t i = 0; i < nbDistinctSites_; i++)
+      if (!father->hasFather())
       {
-        VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        // We have to account for the root frequencies:
+        for (size_t i = 0; i < nbDistinctSites_; i++)
         {
-          Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            (*_likelihoods_node_father_i_c)[x] *= rootFreqs_[x];
+            double* _likelihoods_node_father_i_c = (*_likelihoods_node_father)(i, c);
+            for (size_t x = 0; x < nbStates_; x++)
+            {
+              _likelihoods_node_father_i_c[x] *= rootFreqs_[x];
+            }
           }
         }
       }
+      if (scaling_)
+        LikelihoodKernels::rescaleConditionalLikelihoods(*_likelihoods_node_father, nbThreads_);
     }
 
     // Call the method on each son node:
@@ -659,61 +711,63 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
 void DRHomogeneousTreeLikelihood::computeRootLikelihood()
 {
   const Node* root = tree_->getRootNode();
-  VVVdouble* rootLikelihoods = &likelihoodData_->getRootLikelihoodArray();
+  LikelihoodArray* rootLikelihoods = &likelihoodData_->getRootLikelihoodBuffer();
   // Set all likelihoods to 1 for a start:
+  resetLikelihoodArray(*rootLikelihoods);
   if (root->isLeaf())
   {
     VVdouble* leavesLikelihoods_root = &likelihoodData_->getLeafLikelihoods(root->getId());
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
       Vdouble* leavesLikelihoods_root_i = &(*leavesLikelihoods_root)[i];
       for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
+        double* rootLikelihoods_i_c = (*rootLikelihoods)(i, c);
         for (size_t x = 0; x < nbStates_; x++)
         {
-          (*rootLikelihoods_i_c)[x] = (*leavesLikelihoods_root_i)[x];
+          rootLikelihoods_i_c[x] = (*leavesLikelihoods_root_i)[x];
         }
       }
     }
   }
-  else
-  {
-    resetLikelihoodArray(*rootLikelihoods);
-  }
 
-  map<int, VVVdouble>* likelihoods_root = &likelihoodData_->getLikelihoodArrays(root->getId());
+  DRASDRTreeLikelihoodNodeData* data_root = &likelihoodData_->getNodeData(root->getId());
   size_t nbNodes = root->getNumberOfSons();
-  vector<const VVVdouble*> iLik(nbNodes);
-  vector<const VVVdouble*> tProb(nbNodes);
+  vector<const LikelihoodArray*> iLik(nbNodes);
+  vector<const LikelihoodArray*> tProb(nbNodes);
   for (size_t n = 0; n < nbNodes; n++)
   {
     const Node* son = root->getSon(n);
-    tProb[n] = &pxy_[son->getId()];
-    iLik[n] = &(*likelihoods_root)[son->getId()];
+    tProb[n] = &packedPxy_[son->getId()];
+    iLik[n] = &data_root->getLikelihoodBufferForNeighbor(son->getId());
   }
-  computeLikelihoodFromArrays(iLik, tProb, *rootLikelihoods, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+  computeLikelihoodFromArrays(iLik, tProb, *rootLikelihoods, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false, nbThreads_);
+  if (scaling_)
+    LikelihoodKernels::rescaleConditionalLikelihoods(*rootLikelihoods, nbThreads_);
 
   Vdouble p = rateDistribution_->getProbabilities();
   VVdouble* rootLikelihoodsS  = &likelihoodData_->getRootSiteLikelihoodArray();
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+  long nbDistinctSites = static_cast<long>(nbDistinctSites_);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(static) num_threads(static_cast<int>(nbThreads_)) if(nbThreads_ > 1)
+#endif
+  for (long li = 0; li < nbDistinctSites; li++)
   {
+    size_t i = static_cast<size_t>(li);
     // For each site in the sequence,
-    VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
     Vdouble* rootLikelihoodsS_i = &(*rootLikelihoodsS)[i];
     (*rootLikelihoodsSR)[i] = 0;
     for (size_t c = 0; c < nbClasses_; c++)
     {
       // For each rate classe,
-      Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
+      const double* rootLikelihoods_i_c = (*rootLikelihoods)(i, c);
       double* rootLikelihoodsS_i_c = &(*rootLikelihoodsS_i)[c];
       (*rootLikelihoodsS_i_c) = 0;
       for (size_t x = 0; x < nbStates_; x++)
       {
         // For each initial state,
-        (*rootLikelihoodsS_i_c) += rootFreqs_[x] * (*rootLikelihoods_i_c)[x];
+        (*rootLikelihoodsS_i_c) += rootFreqs_[x] * rootLikelihoods_i_c[x];
       }
       (*rootLikelihoodsSR)[i] += p[c] * (*rootLikelihoodsS_i_c);
     }
@@ -726,48 +780,27 @@ void DRHomogeneousTreeLikelihood::computeRootLikelihood()
 
 /******************************************************************************/
 
-void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode) const
+void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, LikelihoodArray& likelihoodArray, const Node* sonNode) const
 {
   // const Node * node = tree_->getNode(nodeId);
   int nodeId = node->getId();
-  likelihoodArray.resize(nbDistinctSites_);
-  map<int, VVVdouble>* likelihoods_node = &likelihoodData_->getLikelihoodArrays(nodeId);
+  likelihoodArray.resize(nbDistinctSites_, nbClasses_, nbStates_);
+  const DRASDRTreeLikelihoodNodeData* data_node = &likelihoodData_->getNodeData(nodeId);
 
-  // Initialize likelihood array:
+  // Initialize likelihood array, setting all likelihoods to 1 for a start:
+  likelihoodArray.fill(1.);
   if (node->isLeaf())
   {
     VVdouble* leavesLikelihoods_node = &likelihoodData_->getLeafLikelihoods(nodeId);
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
       Vdouble* leavesLikelihoods_node_i = &(*leavesLikelihoods_node)[i];
-      likelihoodArray_i->resize(nbClasses_);
       for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-        likelihoodArray_i_c->resize(nbStates_);
+        double* likelihoodArray_i_c = likelihoodArray(i, c);
         for (size_t x = 0; x < nbStates_; x++)
         {
-          (*likelihoodArray_i_c)[x] = (*leavesLikelihoods_node_i)[x];
-        }
-      }
-    }
-  }
-  else
-  {
-    // Otherwise:
-    // Set all likelihoods to 1 for a start:
-    for (size_t i = 0; i < nbDistinctSites_; i++)
-    {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
-      likelihoodArray_i->resize(nbClasses_);
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-        likelihoodArray_i_c->resize(nbStates_);
-        for (size_t x = 0; x < nbStates_; x++)
-        {
-          (*likelihoodArray_i_c)[x] = 1.;
+          likelihoodArray_i_c[x] = (*leavesLikelihoods_node_i)[x];
         }
       }
     }
@@ -775,15 +808,15 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVV
 
   size_t nbNodes = node->getNumberOfSons();
 
-  vector<const VVVdouble*> iLik;
-  vector<const VVVdouble*> tProb;
+  vector<const LikelihoodArray*> iLik;
+  vector<const LikelihoodArray*> tProb;
   bool test = false;
   for (size_t n = 0; n < nbNodes; n++)
   {
     const Node* son = node->getSon(n);
     if (son != sonNode) {
-      tProb.push_back(&pxy_[son->getId()]);
-      iLik.push_back(&(*likelihoods_node)[son->getId()]);
+      tProb.push_back(&packedPxy_[son->getId()]);
+      iLik.push_back(&data_node->getLikelihoodBufferForNeighbor(son->getId()));
     } else {
       test = true;
     }
@@ -798,157 +831,110 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVV
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    computeLikelihoodFromArrays(iLik, tProb, &(*likelihoods_node)[father->getId()], &pxy_[nodeId], likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    iLik.push_back(&data_node->getLikelihoodBufferForNeighbor(father->getId()));
+    tProb.push_back(&packedReversePxy_[nodeId]);
+    computeLikelihoodFromArrays(iLik, tProb, likelihoodArray, nbNodes + 1, nbDistinctSites_, nbClasses_, nbStates_, false, nbThreads_);
   }
   else
   {
-    computeLikelihoodFromArrays(iLik, tProb, likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArrays(iLik, tProb, likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false, nbThreads_);
 
     // We have to account for the equilibrium frequencies:
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
       for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
+        double* likelihoodArray_i_c = likelihoodArray(i, c);
         for (size_t x = 0; x < nbStates_; x++)
         {
-          (*likelihoodArray_i_c)[x] *= rootFreqs_[x];
+          likelihoodArray_i_c[x] *= rootFreqs_[x];
         }
       }
     }
   }
+  if (scaling_)
+    LikelihoodKernels::rescaleConditionalLikelihoods(likelihoodArray, nbThreads_);
 }
 
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
-  const vector<const VVVdouble*>& iLik,
+  const vector<const LikelihoodArray*>& iLik,
   const vector<const VVVdouble*>& tProb,
-  VVVdouble& oLik,
+  LikelihoodArray& oLik,
   size_t nbNodes,
   size_t nbDistinctSites,
   size_t nbClasses,
   size_t nbStates,
-  bool reset)
+  bool reset,
+  size_t nbThreads)
 {
   if (reset)
     resetLikelihoodArray(oLik);
 
+  vector<LikelihoodArray> packedP(nbNodes);
+  vector<const LikelihoodArray*> packedPtr(nbNodes);
   for (size_t n = 0; n < nbNodes; n++)
   {
-    const VVVdouble* pxy_n = tProb[n];
-    const VVVdouble* iLik_n = iLik[n];
-
-    for (size_t i = 0; i < nbDistinctSites; i++)
-    {
-      // For each site in the sequence,
-      const VVdouble* iLik_n_i = &(*iLik_n)[i];
-      VVdouble* oLik_i = &(oLik)[i];
-
-      for (size_t c = 0; c < nbClasses; c++)
-      {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
-        {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
-          {
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-          }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
-        }
-      }
-    }
+    LikelihoodKernels::packTransitionProbabilities(*tProb[n], packedP[n]);
+    packedPtr[n] = &packedP[n];
   }
+  computeLikelihoodFromArrays(iLik, packedPtr, oLik, nbNodes, nbDistinctSites, nbClasses, nbStates, false, nbThreads);
 }
 
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
-  const vector<const VVVdouble*>& iLik,
+  const vector<const LikelihoodArray*>& iLik,
   const vector<const VVVdouble*>& tProb,
-  const VVVdouble* iLikR,
+  const LikelihoodArray* iLikR,
   const VVVdouble* tProbR,
-  VVVdouble& oLik,
+  LikelihoodArray& oLik,
   size_t nbNodes,
   size_t nbDistinctSites,
   size_t nbClasses,
   size_t nbStates,
-  bool reset)
+  bool reset,
+  size_t nbThreads)
 {
   if (reset)
     resetLikelihoodArray(oLik);
 
+  vector<LikelihoodArray> packedP(nbNodes + 1);
+  vector<const LikelihoodArray*> packedPtr(nbNodes + 1);
   for (size_t n = 0; n < nbNodes; n++)
   {
-    const VVVdouble* pxy_n = tProb[n];
-    const VVVdouble* iLik_n = iLik[n];
-
-    for (size_t i = 0; i < nbDistinctSites; i++)
-    {
-      // For each site in the sequence,
-      const VVdouble* iLik_n_i = &(*iLik_n)[i];
-      VVdouble* oLik_i = &(oLik)[i];
-
-      for (size_t c = 0; c < nbClasses; c++)
-      {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
-        {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
-          {
-            // cout << "1:" << (* pxy_n_c_x)[y]  << endl;
-            // cout << "2:" << (* iLik_n_i_c)[y] << endl;
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-            // cout << i << "\t" << c << "\t" << x << "\t" << y << "\t" <<  (* pxy__son_c_x)[y] << "\t" << (* likelihoods_root_son_i_c)[y] << endl;
-          }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
-        }
-      }
-    }
+    LikelihoodKernels::packTransitionProbabilities(*tProb[n], packedP[n]);
+    packedPtr[n] = &packedP[n];
   }
+  vector<const LikelihoodArray*> iLikPtr(iLik.begin(), iLik.begin() + static_cast<ptrdiff_t>(nbNodes));
 
   // Now deal with the subtree containing the root:
-  for (size_t i = 0; i < nbDistinctSites; i++)
-  {
-    // For each site in the sequence,
-    const VVdouble* iLikR_i = &(*iLikR)[i];
-    VVdouble* oLik_i = &(oLik)[i];
+  LikelihoodKernels::packTransitionProbabilities(*tProbR, packedP[nbNodes], true);
+  packedPtr[nbNodes] = &packedP[nbNodes];
+  iLikPtr.push_back(iLikR);
+  computeLikelihoodFromArrays(iLikPtr, packedPtr, oLik, nbNodes + 1, nbDistinctSites, nbClasses, nbStates, false, nbThreads);
+}
 
-    for (size_t c = 0; c < nbClasses; c++)
-    {
-      // For each rate classe,
-      const Vdouble* iLikR_i_c = &(*iLikR_i)[c];
-      Vdouble* oLik_i_c = &(*oLik_i)[c];
-      const VVdouble* pxyR_c = &(*tProbR)[c];
-      for (size_t x = 0; x < nbStates; x++)
-      {
-        double likelihood = 0;
-        for (size_t y = 0; y < nbStates; y++)
-        {
-          // For each final state,
-          const Vdouble* pxyR_c_y = &(*pxyR_c)[y];
-          likelihood += (*pxyR_c_y)[x] * (*iLikR_i_c)[y];
-        }
-        // We store this conditionnal likelihood into the corresponding array:
-        (*oLik_i_c)[x] *= likelihood;
-      }
-    }
-  }
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
+  const vector<const LikelihoodArray*>& iLik,
+  const vector<const LikelihoodArray*>& packedP,
+  LikelihoodArray& oLik,
+  size_t nbNodes,
+  size_t nbDistinctSites,
+  size_t nbClasses,
+  size_t nbStates,
+  bool reset,
+  size_t nbThreads)
+{
+  if (reset)
+    resetLikelihoodArray(oLik);
+
+  vector<const LikelihoodArray*> packedPtr(packedP.begin(), packedP.begin() + static_cast<ptrdiff_t>(nbNodes));
+  vector<const LikelihoodArray*> iLikPtr(iLik.begin(), iLik.begin() + static_cast<ptrdiff_t>(nbNodes));
+  LikelihoodKernels::multiplyConditionalLikelihoods(packedPtr, iLikPtr, oLik, nbDistinctSites, nbClasses, nbStates, nbThreads);
 }
 
 /******************************************************************************/
@@ -960,13 +946,13 @@ void DRHomogeneousTreeLikelihood::displayLikelihood(const Node* node)
   {
     const Node* subNode = node->getSon(n);
     cout << "Array for sub-node " << subNode->getId() << endl;
-    displayLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), subNode->getId()));
+    displayLikelihoodArray(likelihoodData_->getLikelihoodBuffer(node->getId(), subNode->getId()));
   }
   if (node->hasFather())
   {
     const Node* father = node->getFather();
     cout << "Array for father node " << father->getId() << endl;
-    displayLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), father->getId()));
+    displayLikelihoodArray(likelihoodData_->getLikelihoodBuffer(node->getId(), father->getId()));
   }
   cout << "                                         ***" << endl;
 }
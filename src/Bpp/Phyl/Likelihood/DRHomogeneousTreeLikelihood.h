@@ -70,6 +70,16 @@ class DRHomogeneousTreeLikelihood:
 
   protected:
     double minusLogLik_;
+
+    /**
+     * @brief Transition probabilities for each node, packed for LikelihoodKernels.
+     *
+     * These are updated together with pxy_ by computeTransitionProbabilitiesForNode(),
+     * so that they are not repacked at each likelihood computation.
+     * The reverse arrays store the transposed matrices, used when the subtree containing the root is a neighbor.
+     */
+    mutable std::map<int, LikelihoodArray> packedPxy_;
+    mutable std::map<int, LikelihoodArray> packedReversePxy_;
     
   public:
     /**
@@ -206,23 +216,54 @@ class DRHomogeneousTreeLikelihood:
     DRASDRTreeLikelihoodData* getLikelihoodData() { return likelihoodData_; }
     const DRASDRTreeLikelihoodData* getLikelihoodData() const { return likelihoodData_; }
   
+    /**
+     * @brief Compute the conditional likelihoods at a node, using all its neighbors.
+     *
+     * If scaling is enabled, values are multiplied back by their scaling factors,
+     * and may therefore underflow on large trees (see computeScaledLikelihoodAtNode()).
+     *
+     * @param nodeId          The node id.
+     * @param likelihoodArray The array where to store the likelihoods (site x class x state).
+     */
     virtual void computeLikelihoodAtNode(int nodeId, VVVdouble& likelihoodArray) const
     {
-      computeLikelihoodAtNode_(tree_->getNode(nodeId), likelihoodArray);
+      LikelihoodArray array;
+      computeLikelihoodAtNode_(tree_->getNode(nodeId), array);
+      array.unscale();
+      array.copyTo(likelihoodArray);
+    }
+
+    /**
+     * @brief Compute the conditional likelihoods at a node, together with their scaling factors.
+     *
+     * The actual likelihoods of site i are the values in likelihoodArray times exp(logScalingFactors[i]).
+     *
+     * @param nodeId            The node id.
+     * @param likelihoodArray   The array where to store the scaled likelihoods (site x class x state).
+     * @param logScalingFactors The vector where to store the log scaling factor of each site (all 0 if scaling is disabled).
+     */
+    void computeScaledLikelihoodAtNode(int nodeId, VVVdouble& likelihoodArray, Vdouble& logScalingFactors) const
+    {
+      LikelihoodArray array;
+      computeLikelihoodAtNode_(tree_->getNode(nodeId), array);
+      array.copyTo(likelihoodArray);
+      logScalingFactors = array.getLogScalingFactors();
     }
       
   protected:
-    virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode = 0) const;
+    virtual void computeLikelihoodAtNode_(const Node* node, LikelihoodArray& likelihoodArray, const Node* sonNode = 0) const;
   
     /**
      * Initialize the arrays corresponding to each son node for the node passed as argument.
      * The method is called for each son node and the result stored in the corresponding array.
+     * Arrays of subtrees that do not contain any branch flagged for update are not recomputed.
      */
     virtual void computeSubtreeLikelihoodPostfix(const Node* node); //Recursive method.
     /**
      * This method initilize the remaining likelihood arrays, corresponding to father nodes.
      * It must be called after the postfix method because it requires that the arrays for
      * son nodes to be be computed.
+     * Arrays that do not depend on any branch flagged for update are not recomputed.
      */
     virtual void computeSubtreeLikelihoodPrefix(const Node* node); //Recursive method.
 
@@ -236,6 +277,11 @@ class DRHomogeneousTreeLikelihood:
 
     virtual void fireParameterChanged(const ParameterList& params);
 
+    /**
+     * @brief Fill the pxy_, dpxy_ and d2pxy_ arrays for one node, and update the corresponding packed arrays.
+     */
+    virtual void computeTransitionProbabilitiesForNode(const Node* node);
+
     virtual void resetLikelihoodArrays(const Node* node);
   
     /**
@@ -250,6 +296,7 @@ class DRHomogeneousTreeLikelihood:
      *
      * This method is the "core" likelihood computation function, performing all the product uppon all nodes, the summation for each ancestral state and each rate class.
      * It is designed for inner usage, and a maximum efficiency, so no checking is performed on the input parameters.
+     * The summation over states is performed by LikelihoodKernels, which uses vectorized code when available.
      * Use with care!
      * 
      * @param iLik A vector of likelihood arrays, one for each conditional node.
@@ -261,15 +308,17 @@ class DRHomogeneousTreeLikelihood:
      * @param nbStates The number of states (the third dimension of the likelihood array).
      * @param reset Tell if the output likelihood array must be initalized prior to computation.
      * If true, the resetLikelihoodArray method will be called.
+     * @param nbThreads The number of threads to use.
      */
     static void computeLikelihoodFromArrays(
-        const std::vector<const VVVdouble*>& iLik,
+        const std::vector<const LikelihoodArray*>& iLik,
         const std::vector<const VVVdouble*>& tProb,
-        VVVdouble& oLik, size_t nbNodes,
+        LikelihoodArray& oLik, size_t nbNodes,
         size_t nbDistinctSites,
         size_t nbClasses,
         size_t nbStates,
-        bool reset = true);
+        bool reset = true,
+        size_t nbThreads = 1);
 
     /**
      * @brief Compute conditional likelihoods.
@@ -277,6 +326,7 @@ class DRHomogeneousTreeLikelihood:
      * This method is the "core" likelihood computation function, performing all the product uppon all nodes, the summation for each ancestral state and each rate class.
      * This function is specific to non-reversible models: the subtree containing the root is specified separately.
      * It is designed for inner usage, and a maximum efficiency, so no checking is performed on the input parameters.
+     * The summation over states is performed by LikelihoodKernels, which uses vectorized code when available.
      * Use with care!
      * 
      * @param iLik A vector of likelihood arrays, one for each conditional node.
@@ -290,18 +340,49 @@ class DRHomogeneousTreeLikelihood:
      * @param nbStates The number of states (the third dimension of the likelihood array).
      * @param reset Tell if the output likelihood array must be initalized prior to computation.
      * If true, the resetLikelihoodArray method will be called.
+     * @param nbThreads The number of threads to use.
      */
     static void computeLikelihoodFromArrays(
-        const std::vector<const VVVdouble*>& iLik,
+        const std::vector<const LikelihoodArray*>& iLik,
         const std::vector<const VVVdouble*>& tProb,
-        const VVVdouble* iLikR,
+        const LikelihoodArray* iLikR,
         const VVVdouble* tProbR,
-        VVVdouble& oLik,
+        LikelihoodArray& oLik,
+        size_t nbNodes,
+        size_t nbDistinctSites,
+        size_t nbClasses,
+        size_t nbStates,
+        bool reset = true,
+        size_t nbThreads = 1);
+
+    /**
+     * @brief Compute conditional likelihoods from packed transition probabilities.
+     *
+     * Same as the other computeLikelihoodFromArrays() methods, but with transition matrices
+     * already packed by LikelihoodKernels::packTransitionProbabilities().
+     * The subtree containing the root, if any, is passed as an additional node with reverse-packed matrices.
+     * 
+     * @param iLik A vector of likelihood arrays, one for each conditional node.
+     * @param packedP A vector of packed transition probabilities, one for each node.
+     * @param oLik The likelihood array to store the computed likelihoods.
+     * @param nbNodes The number of nodes = the size of the input vectors.
+     * @param nbDistinctSites The number of distinct sites (the first dimension of the likelihood array).
+     * @param nbClasses The number of rate classes (the second dimension of the likelihood array).
+     * @param nbStates The number of states (the third dimension of the likelihood array).
+     * @param reset Tell if the output likelihood array must be initalized prior to computation.
+     * If true, the resetLikelihoodArray method will be called.
+     * @param nbThreads The number of threads to use.
+     */
+    static void computeLikelihoodFromArrays(
+        const std::vector<const LikelihoodArray*>& iLik,
+        const std::vector<const LikelihoodArray*>& packedP,
+        LikelihoodArray& oLik,
         size_t nbNodes,
         size_t nbDistinctSites,
         size_t nbClasses,
         size_t nbStates,
-        bool reset = true);
+        bool reset = true,
+        size_t nbThreads = 1);
 
   friend class DRHomogeneousMixedTreeLikelihood;
 };
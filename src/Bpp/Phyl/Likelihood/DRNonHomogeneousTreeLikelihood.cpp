@@ -38,6 +38,7 @@
  */
 
 #include "DRNonHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -222,14 +223,14 @@ double DRNonHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(siz
 
 double DRNonHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return likelihoodData_->getRootLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  return likelihoodData_->getRootLikelihoodBuffer()(likelihoodData_->getRootArrayPosition(site), rateClass, static_cast<size_t>(state));
 }
 
 /******************************************************************************/
 
 double DRNonHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return log(likelihoodData_->getRootLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)]);
+  return log(likelihoodData_->getRootLikelihoodBuffer()(likelihoodData_->getRootArrayPosition(site), rateClass, static_cast<size_t>(state)));
 }
 
 /******************************************************************************/
@@ -246,49 +247,7 @@ void DRNonHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& p
 {
   applyParameters();
 
-  if (params.getCommonParametersWith(rateDistribution_->getIndependentParameters()).size() > 0)
-  {
-    computeAllTransitionProbabilities();
-  }
-  else
-  {
-    vector<int> ids;
-    vector<string> tmp = params.getCommonParametersWith(modelSet_->getNodeParameters()).getParameterNames();
-    for (size_t i = 0; i < tmp.size(); i++)
-    {
-      vector<int> tmpv = modelSet_->getNodesWithParameter(tmp[i]);
-      ids = VectorTools::vectorUnion(ids, tmpv);
-    }
-    tmp = params.getCommonParametersWith(brLenParameters_).getParameterNames();
-    vector<const Node*> nodes;
-    for (size_t i = 0; i < ids.size(); i++)
-    {
-      nodes.push_back(idToNode_[ids[i]]);
-    }
-    vector<const Node*> tmpv;
-    bool test = false;
-    for (size_t i = 0; i < tmp.size(); i++)
-    {
-      if (tmp[i] == "BrLenRoot" || tmp[i] == "RootPosition")
-      {
-        if (!test)
-        {
-          tmpv.push_back(tree_->getRootNode()->getSon(0));
-          tmpv.push_back(tree_->getRootNode()->getSon(1));
-          test = true; // Add only once.
-        }
-      }
-      else
-        tmpv.push_back(nodes_[TextTools::to < size_t > (tmp[i].substr(5))]);
-    }
-    nodes = VectorTools::vectorUnion(nodes, tmpv);
-
-    for (size_t i = 0; i < nodes.size(); i++)
-    {
-      computeTransitionProbabilitiesForNode(nodes[i]);
-    }
-    rootFreqs_ = modelSet_->getRootFrequencies();
-  }
+  computeTransitionProbabilitiesForParameters(params);
   computeTreeLikelihood();
   if (computeFirstOrderDerivatives_)
   {
@@ -316,24 +275,22 @@ throw (Exception)
 void DRNonHomogeneousTreeLikelihood::computeTreeDLikelihoodAtNode(const Node* node)
 {
   const Node* father = node->getFather();
-  VVVdouble* _likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  LikelihoodArray* _likelihoods_father_node = &likelihoodData_->getLikelihoodBuffer(father->getId(), node->getId());
   Vdouble* _dLikelihoods_node = &likelihoodData_->getDLikelihoodArray(node->getId());
   VVVdouble*  pxy__node = &pxy_[node->getId()];
   VVVdouble* dpxy__node = &dpxy_[node->getId()];
-  VVVdouble larray;
+  LikelihoodArray larray;
   computeLikelihoodAtNode_(father, larray);
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
 
   double dLi, dLic, dLicx, numerator, denominator;
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    VVdouble* _likelihoods_father_node_i = &(*_likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
     dLi = 0;
     for (size_t c = 0; c < nbClasses_; c++)
     {
-      Vdouble* _likelihoods_father_node_i_c = &(*_likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
+      const double* _likelihoods_father_node_i_c = (*_likelihoods_father_node)(i, c);
+      const double* larray_i_c = larray(i, c);
       VVdouble*  pxy__node_c = &(*pxy__node)[c];
       VVdouble* dpxy__node_c = &(*dpxy__node)[c];
       dLic = 0;
@@ -346,10 +303,10 @@ void DRNonHomogeneousTreeLikelihood::computeTreeDLikelihoodAtNode(const Node* no
         dLicx = 0;
         for (size_t y = 0; y < nbStates_; y++)
         {
-          numerator   += (*dpxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
-          denominator += (*pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
+          numerator   += (*dpxy__node_c_x)[y] * _likelihoods_father_node_i_c[y];
+          denominator += (*pxy__node_c_x)[y] * _likelihoods_father_node_i_c[y];
         }
-        dLicx = denominator == 0. ? 0. : (*larray_i_c)[x] * numerator / denominator;
+        dLicx = denominator == 0. ? 0. : larray_i_c[x] * numerator / denominator;
         dLic += dLicx;
       }
       dLi += rateDistribution_->getProbability(c) * dLic;
@@ -444,11 +401,11 @@ throw (Exception)
 void DRNonHomogeneousTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* node)
 {
   const Node* father = node->getFather();
-  VVVdouble* _likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  LikelihoodArray* _likelihoods_father_node = &likelihoodData_->getLikelihoodBuffer(father->getId(), node->getId());
   Vdouble* _d2Likelihoods_node = &likelihoodData_->getD2LikelihoodArray(node->getId());
   VVVdouble*   pxy__node = &pxy_[node->getId()];
   VVVdouble* d2pxy__node = &d2pxy_[node->getId()];
-  VVVdouble larray;
+  LikelihoodArray larray;
   computeLikelihoodAtNode_(father, larray);
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
 
@@ -456,13 +413,11 @@ void DRNonHomogeneousTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* n
 
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    VVdouble* _likelihoods_father_node_i = &(*_likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
     d2Li = 0;
     for (size_t c = 0; c < nbClasses_; c++)
     {
-      Vdouble* _likelihoods_father_node_i_c = &(*_likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
+      const double* _likelihoods_father_node_i_c = (*_likelihoods_father_node)(i, c);
+      const double* larray_i_c = larray(i, c);
       VVdouble*   pxy__node_c = &(*pxy__node)[c];
       VVdouble* d2pxy__node_c = &(*d2pxy__node)[c];
       d2Lic = 0;
@@ -475,10 +430,10 @@ void DRNonHomogeneousTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* n
         d2Licx = 0;
         for (size_t y = 0; y < nbStates_; y++)
         {
-          numerator   += (*d2pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
-          denominator += (*pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
+          numerator   += (*d2pxy__node_c_x)[y] * _likelihoods_father_node_i_c[y];
+          denominator += (*pxy__node_c_x)[y] * _likelihoods_father_node_i_c[y];
         }
-        d2Licx = denominator == 0. ? 0. : (*larray_i_c)[x] * numerator / denominator;
+        d2Licx = denominator == 0. ? 0. : larray_i_c[x] * numerator / denominator;
         d2Lic += d2Licx;
       }
       d2Li += rateDistribution_->getProbability(c) * d2Lic;
@@ -556,8 +511,8 @@ throw (Exception)
 
       if (son->getId() == root1_)
       {
-        VVVdouble* _likelihoodsroot1_ = &likelihoodData_->getLikelihoodArray(father->getId(), root1_);
-        VVVdouble* _likelihoodsroot2_ = &likelihoodData_->getLikelihoodArray(father->getId(), root2_);
+        LikelihoodArray* _likelihoodsroot1_ = &likelihoodData_->getLikelihoodBuffer(father->getId(), root1_);
+        LikelihoodArray* _likelihoodsroot2_ = &likelihoodData_->getLikelihoodBuffer(father->getId(), root2_);
         double pos = getParameterValue("RootPosition");
 
         VVVdouble* d2pxy_root1_ = &d2pxy_[root1_];
@@ -568,14 +523,12 @@ throw (Exception)
         VVVdouble* pxy_root2_   = &pxy_[root2_];
         for (size_t i = 0; i < nbDistinctSites_; i++)
         {
-          VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[i];
-          VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[i];
           VVdouble* dLikelihoods_father_i = &dLikelihoods_father[i];
           VVdouble* d2Likelihoods_father_i = &d2Likelihoods_father[i];
           for (size_t c = 0; c < nbClasses_; c++)
           {
-            Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
-            Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
+            const double* _likelihoodsroot1__i_c = (*_likelihoodsroot1_)(i, c);
+            const double* _likelihoodsroot2__i_c = (*_likelihoodsroot2_)(i, c);
             Vdouble* dLikelihoods_father_i_c = &(*dLikelihoods_father_i)[c];
             Vdouble* d2Likelihoods_father_i_c = &(*d2Likelihoods_father_i)[c];
             VVdouble* d2pxy_root1__c = &(*d2pxy_root1_)[c];
@@ -595,12 +548,12 @@ throw (Exception)
               double d2l1 = 0, d2l2 = 0, dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
               for (size_t y = 0; y < nbStates_; y++)
               {
-                d2l1 += (*d2pxy_root1__c_x)[y] * (*_likelihoodsroot1__i_c)[y];
-                d2l2 += (*d2pxy_root2__c_x)[y] * (*_likelihoodsroot2__i_c)[y];
-                dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
-                dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
-                l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
-                l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                d2l1 += (*d2pxy_root1__c_x)[y] * _likelihoodsroot1__i_c[y];
+                d2l2 += (*d2pxy_root2__c_x)[y] * _likelihoodsroot2__i_c[y];
+                dl1  += (*dpxy_root1__c_x)[y]  * _likelihoodsroot1__i_c[y];
+                dl2  += (*dpxy_root2__c_x)[y]  * _likelihoodsroot2__i_c[y];
+                l1   += (*pxy_root1__c_x)[y]   * _likelihoodsroot1__i_c[y];
+                l2   += (*pxy_root2__c_x)[y]   * _likelihoodsroot2__i_c[y];
               }
               double dl = pos * dl1 * l2 + (1. - pos) * dl2 * l1;
               double d2l = pos * pos * d2l1 * l2 + (1. - pos) * (1. - pos) * d2l2 * l1 + 2 * pos * (1. - pos) * dl1 * dl2;
@@ -617,17 +570,16 @@ throw (Exception)
       else
       {
         // Account for a putative multifurcation:
-        VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(father->getId(), son->getId());
+        LikelihoodArray* _likelihoods_son = &likelihoodData_->getLikelihoodBuffer(father->getId(), son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
         for (size_t i = 0; i < nbDistinctSites_; i++)
         {
-          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[i];
           VVdouble* dLikelihoods_father_i = &dLikelihoods_father[i];
           VVdouble* d2Likelihoods_father_i = &d2Likelihoods_father[i];
           for (size_t c = 0; c < nbClasses_; c++)
           {
-            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            const double* _likelihoods_son_i_c = (*_likelihoods_son)(i, c);
             Vdouble* dLikelihoods_father_i_c = &(*dLikelihoods_father_i)[c];
             Vdouble* d2Likelihoods_father_i_c = &(*d2Likelihoods_father_i)[c];
             VVdouble* pxy__son_c = &(*pxy__son)[c];
@@ -637,7 +589,7 @@ throw (Exception)
               Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
               for (size_t y = 0; y < nbStates_; y++)
               {
-                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                dl += (*pxy__son_c_x)[y] * _likelihoods_son_i_c[y];
               }
               (*dLikelihoods_father_i_c)[x] *= dl;
               (*d2Likelihoods_father_i_c)[x] *= dl;
@@ -702,8 +654,8 @@ throw (Exception)
 
       if (son->getId() == root1_)
       {
-        VVVdouble* _likelihoodsroot1_ = &likelihoodData_->getLikelihoodArray(father->getId(), root1_);
-        VVVdouble* _likelihoodsroot2_ = &likelihoodData_->getLikelihoodArray(father->getId(), root2_);
+        LikelihoodArray* _likelihoodsroot1_ = &likelihoodData_->getLikelihoodBuffer(father->getId(), root1_);
+        LikelihoodArray* _likelihoodsroot2_ = &likelihoodData_->getLikelihoodBuffer(father->getId(), root2_);
         double len = getParameterValue("BrLenRoot");
 
         VVVdouble* d2pxy_root1_ = &d2pxy_[root1_];
@@ -714,14 +666,12 @@ throw (Exception)
         VVVdouble* pxy_root2_   = &pxy_[root2_];
         for (size_t i = 0; i < nbDistinctSites_; i++)
         {
-          VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[i];
-          VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[i];
           VVdouble* dLikelihoods_father_i = &dLikelihoods_father[i];
           VVdouble* d2Likelihoods_father_i = &d2Likelihoods_father[i];
           for (size_t c = 0; c < nbClasses_; c++)
           {
-            Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
-            Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
+            const double* _likelihoodsroot1__i_c = (*_likelihoodsroot1_)(i, c);
+            const double* _likelihoodsroot2__i_c = (*_likelihoodsroot2_)(i, c);
             Vdouble* dLikelihoods_father_i_c = &(*dLikelihoods_father_i)[c];
             Vdouble* d2Likelihoods_father_i_c = &(*d2Likelihoods_father_i)[c];
             VVdouble* d2pxy_root1__c = &(*d2pxy_root1_)[c];
@@ -741,12 +691,12 @@ throw (Exception)
               double d2l1 = 0, d2l2 = 0, dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
               for (size_t y = 0; y < nbStates_; y++)
               {
-                d2l1 += (*d2pxy_root1__c_x)[y] * (*_likelihoodsroot1__i_c)[y];
-                d2l2 += (*d2pxy_root2__c_x)[y] * (*_likelihoodsroot2__i_c)[y];
-                dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
-                dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
-                l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
-                l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                d2l1 += (*d2pxy_root1__c_x)[y] * _likelihoodsroot1__i_c[y];
+                d2l2 += (*d2pxy_root2__c_x)[y] * _likelihoodsroot2__i_c[y];
+                dl1  += (*dpxy_root1__c_x)[y]  * _likelihoodsroot1__i_c[y];
+                dl2  += (*dpxy_root2__c_x)[y]  * _likelihoodsroot2__i_c[y];
+                l1   += (*pxy_root1__c_x)[y]   * _likelihoodsroot1__i_c[y];
+                l2   += (*pxy_root2__c_x)[y]   * _likelihoodsroot2__i_c[y];
               }
               double dl = len * (dl1 * l2 - dl2 * l1);
               double d2l = len * len * (d2l1 * l2 + d2l2 * l1 - 2 * dl1 * dl2);
@@ -763,17 +713,16 @@ throw (Exception)
       else
       {
         // Account for a putative multifurcation:
-        VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(father->getId(), son->getId());
+        LikelihoodArray* _likelihoods_son = &likelihoodData_->getLikelihoodBuffer(father->getId(), son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
         for (size_t i = 0; i < nbDistinctSites_; i++)
         {
-          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[i];
           VVdouble* dLikelihoods_father_i = &dLikelihoods_father[i];
           VVdouble* d2Likelihoods_father_i = &d2Likelihoods_father[i];
           for (size_t c = 0; c < nbClasses_; c++)
           {
-            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            const double* _likelihoods_son_i_c = (*_likelihoods_son)(i, c);
             Vdouble* dLikelihoods_father_i_c = &(*dLikelihoods_father_i)[c];
             Vdouble* d2Likelihoods_father_i_c = &(*d2Likelihoods_father_i)[c];
             VVdouble* pxy__son_c = &(*pxy__son)[c];
@@ -783,7 +732,7 @@ throw (Exception)
               Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
               for (size_t y = 0; y < nbStates_; y++)
               {
-                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                dl += (*pxy__son_c_x)[y] * _likelihoods_son_i_c[y];
               }
               (*dLikelihoods_father_i_c)[x] *= dl;
               (*d2Likelihoods_father_i_c)[x] *= dl;
@@ -838,12 +787,12 @@ void DRNonHomogeneousTreeLikelihood::resetLikelihoodArrays(const Node* node)
   for (size_t n = 0; n < node->getNumberOfSons(); n++)
   {
     const Node* subNode = node->getSon(n);
-    resetLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), subNode->getId()));
+    resetLikelihoodArray(likelihoodData_->getLikelihoodBuffer(node->getId(), subNode->getId()));
   }
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    resetLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), father->getId()));
+    resetLikelihoodArray(likelihoodData_->getLikelihoodBuffer(node->getId(), father->getId()));
   }
 }
 
@@ -868,14 +817,14 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node*
   // Set all likelihood arrays to 1 for a start:
   resetLikelihoodArrays(node);
 
-  map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
+  DRASDRTreeLikelihoodNodeData* _data_node = &likelihoodData_->getNodeData(node->getId());
   size_t nbNodes = node->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
   {
     // For each son node...
 
     const Node* son = node->getSon(l);
-    VVVdouble* _likelihoods_node_son = &(*_likelihoods_node)[son->getId()];
+    LikelihoodArray* _likelihoods_node_son = &_data_node->getLikelihoodBufferForNeighbor(son->getId());
 
     if (son->isLeaf())
     {
@@ -884,15 +833,14 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node*
       {
         // For each site in the sequence,
         Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
-        VVdouble* _likelihoods_node_son_i = &(*_likelihoods_node_son)[i];
         for (size_t c = 0; c < nbClasses_; c++)
         {
           // For each rate classe,
-          Vdouble* _likelihoods_node_son_i_c = &(*_likelihoods_node_son_i)[c];
+          double* _likelihoods_node_son_i_c = (*_likelihoods_node_son)(i, c);
           for (size_t x = 0; x < nbStates_; x++)
           {
             // For each initial state,
-            (*_likelihoods_node_son_i_c)[x] = (*_likelihoods_leaf_i)[x];
+            _likelihoods_node_son_i_c[x] = (*_likelihoods_leaf_i)[x];
           }
         }
       }
@@ -901,15 +849,15 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node*
     {
       computeSubtreeLikelihoodPostfix(son); // Recursive method:
       size_t nbSons = son->getNumberOfSons();
-      map<int, VVVdouble>* _likelihoods_son = &likelihoodData_->getLikelihoodArrays(son->getId());
+      DRASDRTreeLikelihoodNodeData* _data_son = &likelihoodData_->getNodeData(son->getId());
 
-      vector<const VVVdouble*> iLik(nbSons);
-      vector<const VVVdouble*> tProb(nbSons);
+      vector<const LikelihoodArray*> iLik(nbSons);
+      vector<const LikelihoodArray*> tProb(nbSons);
       for (size_t n = 0; n < nbSons; n++)
       {
         const Node* sonSon = son->getSon(n);
-        tProb[n] = &pxy_[sonSon->getId()];
-        iLik[n] = &(*_likelihoods_son)[sonSon->getId()];
+        tProb[n] = &packedPxy_[sonSon->getId()];
+        iLik[n] = &_data_son->getLikelihoodBufferForNeighbor(sonSon->getId());
       }
       computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_son, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
     }
@@ -934,9 +882,8 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
   else
   {
     const Node* father = node->getFather();
-    map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
-    map<int, VVVdouble>* _likelihoods_father = &likelihoodData_->getLikelihoodArrays(father->getId());
-    VVVdouble* _likelihoods_node_father = &(*_likelihoods_node)[father->getId()];
+    DRASDRTreeLikelihoodNodeData* _data_father = &likelihoodData_->getNodeData(father->getId());
+    LikelihoodArray* _likelihoods_node_father = &likelihoodData_->getLikelihoodBuffer(node->getId(), father->getId());
     if (node->isLeaf())
     {
       resetLikelihoodArray(*_likelihoods_node_father);
@@ -950,15 +897,14 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
       {
         // For each site in the sequence,
         Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
-        VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
         for (size_t c = 0; c < nbClasses_; c++)
         {
           // For each rate classe,
-          Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
+          double* _likelihoods_node_father_i_c = (*_likelihoods_node_father)(i, c);
           for (size_t x = 0; x < nbStates_; x++)
           {
             // For each initial state,
-            (*_likelihoods_node_father_i_c)[x] = (*_likelihoods_leaf_i)[x];
+            _likelihoods_node_father_i_c[x] = (*_likelihoods_leaf_i)[x];
           }
         }
       }
@@ -980,19 +926,21 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
 
       size_t nbSons = nodes.size(); // In case of a bifurcating tree this is equal to 1.
 
-      vector<const VVVdouble*> iLik(nbSons);
-      vector<const VVVdouble*> tProb(nbSons);
+      vector<const LikelihoodArray*> iLik(nbSons);
+      vector<const LikelihoodArray*> tProb(nbSons);
       for (size_t n = 0; n < nbSons; n++)
       {
         const Node* fatherSon = nodes[n];
-        tProb[n] = &pxy_[fatherSon->getId()];
-        iLik[n] = &(*_likelihoods_father)[fatherSon->getId()];
+        tProb[n] = &packedPxy_[fatherSon->getId()];
+        iLik[n] = &_data_father->getLikelihoodBufferForNeighbor(fatherSon->getId());
       }
 
       if (father->hasFather())
       {
         const Node* fatherFather = father->getFather();
-        computeLikelihoodFromArrays(iLik, tProb, &(*_likelihoods_father)[fatherFather->getId()], &pxy_[father->getId()], *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+        iLik.push_back(&_data_father->getLikelihoodBufferForNeighbor(fatherFather->getId()));
+        tProb.push_back(&packedReversePxy_[father->getId()]);
+        computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_father, nbSons + 1, nbDistinctSites_, nbClasses_, nbStates_, false);
       }
       else
       {
@@ -1005,13 +953,12 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
       // We have to account for the root frequencies:
       for (size_t i = 0; i < nbDistinctSites_; i++)
       {
-        VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
         for (size_t c = 0; c < nbClasses_; c++)
         {
-          Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
+          double* _likelihoods_node_father_i_c = (*_likelihoods_node_father)(i, c);
           for (size_t x = 0; x < nbStates_; x++)
           {
-            (*_likelihoods_node_father_i_c)[x] *= rootFreqs_[x];
+            _likelihoods_node_father_i_c[x] *= rootFreqs_[x];
           }
         }
       }
@@ -1031,21 +978,20 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
 void DRNonHomogeneousTreeLikelihood::computeRootLikelihood()
 {
   const Node* root = tree_->getRootNode();
-  VVVdouble* rootLikelihoods = &likelihoodData_->getRootLikelihoodArray();
+  LikelihoodArray* rootLikelihoods = &likelihoodData_->getRootLikelihoodBuffer();
   // Set all likelihoods to 1 for a start:
   if (root->isLeaf())
   {
     VVdouble* leavesLikelihoods_root = &likelihoodData_->getLeafLikelihoods(root->getId());
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
       Vdouble* leavesLikelihoods_root_i = &(*leavesLikelihoods_root)[i];
       for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
+        double* rootLikelihoods_i_c = (*rootLikelihoods)(i, c);
         for (size_t x = 0; x < nbStates_; x++)
         {
-          (*rootLikelihoods_i_c)[x] = (*leavesLikelihoods_root_i)[x];
+          rootLikelihoods_i_c[x] = (*leavesLikelihoods_root_i)[x];
         }
       }
     }
@@ -1055,15 +1001,15 @@ void DRNonHomogeneousTreeLikelihood::computeRootLikelihood()
     resetLikelihoodArray(*rootLikelihoods);
   }
 
-  map<int, VVVdouble>* likelihoods_root = &likelihoodData_->getLikelihoodArrays(root->getId());
+  DRASDRTreeLikelihoodNodeData* data_root = &likelihoodData_->getNodeData(root->getId());
   size_t nbNodes = root->getNumberOfSons();
-  vector<const VVVdouble*> iLik(nbNodes);
-  vector<const VVVdouble*> tProb(nbNodes);
+  vector<const LikelihoodArray*> iLik(nbNodes);
+  vector<const LikelihoodArray*> tProb(nbNodes);
   for (size_t n = 0; n < nbNodes; n++)
   {
     const Node* son = root->getSon(n);
-    tProb[n] = &pxy_[son->getId()];
-    iLik[n] = &(*likelihoods_root)[son->getId()];
+    tProb[n] = &packedPxy_[son->getId()];
+    iLik[n] = &data_root->getLikelihoodBufferForNeighbor(son->getId());
   }
   computeLikelihoodFromArrays(iLik, tProb, *rootLikelihoods, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
 
@@ -1073,19 +1019,18 @@ void DRNonHomogeneousTreeLikelihood::computeRootLikelihood()
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
     // For each site in the sequence,
-    VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
     Vdouble* rootLikelihoodsS_i = &(*rootLikelihoodsS)[i];
     (*rootLikelihoodsSR)[i] = 0;
     for (size_t c = 0; c < nbClasses_; c++)
     {
       // For each rate classe,
-      Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
+      const double* rootLikelihoods_i_c = (*rootLikelihoods)(i, c);
       double* rootLikelihoodsS_i_c = &(*rootLikelihoodsS_i)[c];
       (*rootLikelihoodsS_i_c) = 0;
       for (size_t x = 0; x < nbStates_; x++)
       {
         // For each initial state,
-        (*rootLikelihoodsS_i_c) += rootFreqs_[x] * (*rootLikelihoods_i_c)[x];
+        (*rootLikelihoodsS_i_c) += rootFreqs_[x] * rootLikelihoods_i_c[x];
       }
       (*rootLikelihoodsSR)[i] += p[c] * (*rootLikelihoodsS_i_c);
     }
@@ -1098,12 +1043,12 @@ void DRNonHomogeneousTreeLikelihood::computeRootLikelihood()
 
 /******************************************************************************/
 
-void DRNonHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray) const
+void DRNonHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, LikelihoodArray& likelihoodArray) const
 {
 //  const Node * node = tree_->getNode(nodeId);
   int nodeId = node->getId();
-  likelihoodArray.resize(nbDistinctSites_);
-  map<int, VVVdouble>* likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
+  likelihoodArray.resize(nbDistinctSites_, nbClasses_, nbStates_);
+  const DRASDRTreeLikelihoodNodeData* data_node = &likelihoodData_->getNodeData(nodeId);
 
   // Initialize likelihood array:
   if (node->isLeaf())
@@ -1111,16 +1056,13 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node,
     VVdouble* leavesLikelihoods_node = &likelihoodData_->getLeafLikelihoods(nodeId);
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
       Vdouble* leavesLikelihoods_node_i = &(*leavesLikelihoods_node)[i];
-      likelihoodArray_i->resize(nbClasses_);
       for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-        likelihoodArray_i_c->resize(nbStates_);
+        double* likelihoodArray_i_c = likelihoodArray(i, c);
         for (size_t x = 0; x < nbStates_; x++)
         {
-          (*likelihoodArray_i_c)[x] = (*leavesLikelihoods_node_i)[x];
+          likelihoodArray_i_c[x] = (*leavesLikelihoods_node_i)[x];
         }
       }
     }
@@ -1129,37 +1071,26 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node,
   {
     // Otherwise:
     // Set all likelihoods to 1 for a start:
-    for (size_t i = 0; i < nbDistinctSites_; i++)
-    {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
-      likelihoodArray_i->resize(nbClasses_);
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-        likelihoodArray_i_c->resize(nbStates_);
-        for (size_t x = 0; x < nbStates_; x++)
-        {
-          (*likelihoodArray_i_c)[x] = 1.;
-        }
-      }
-    }
+    likelihoodArray.fill(1.);
   }
 
   size_t nbNodes = node->getNumberOfSons();
 
-  vector<const VVVdouble*> iLik(nbNodes);
-  vector<const VVVdouble*> tProb(nbNodes);
+  vector<const LikelihoodArray*> iLik(nbNodes);
+  vector<const LikelihoodArray*> tProb(nbNodes);
   for (size_t n = 0; n < nbNodes; n++)
   {
     const Node* son = node->getSon(n);
-    tProb[n] = &pxy_[son->getId()];
-    iLik[n] = &(*likelihoods_node)[son->getId()];
+    tProb[n] = &packedPxy_[son->getId()];
+    iLik[n] = &data_node->getLikelihoodBufferForNeighbor(son->getId());
   }
 
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    computeLikelihoodFromArrays(iLik, tProb, &(*likelihoods_node)[father->getId()], &pxy_[nodeId], likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    iLik.push_back(&data_node->getLikelihoodBufferForNeighbor(father->getId()));
+    tProb.push_back(&packedReversePxy_[nodeId]);
+    computeLikelihoodFromArrays(iLik, tProb, likelihoodArray, nbNodes + 1, nbDistinctSites_, nbClasses_, nbStates_, false);
   }
   else
   {
@@ -1168,13 +1099,12 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node,
     // We have to account for the root frequencies:
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
       for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
+        double* likelihoodArray_i_c = likelihoodArray(i, c);
         for (size_t x = 0; x < nbStates_; x++)
         {
-          (*likelihoodArray_i_c)[x] *= rootFreqs_[x];
+          likelihoodArray_i_c[x] *= rootFreqs_[x];
         }
       }
     }
@@ -1184,9 +1114,9 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node,
 /******************************************************************************/
 
 void DRNonHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
-  const vector<const VVVdouble*>& iLik,
+  const vector<const LikelihoodArray*>& iLik,
   const vector<const VVVdouble*>& tProb,
-  VVVdouble& oLik,
+  LikelihoodArray& oLik,
   size_t nbNodes,
   size_t nbDistinctSites,
   size_t nbClasses,
@@ -1196,48 +1126,24 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
   if (reset)
     resetLikelihoodArray(oLik);
 
+  vector<LikelihoodArray> packedP(nbNodes);
+  vector<const LikelihoodArray*> packedPtr(nbNodes);
   for (size_t n = 0; n < nbNodes; n++)
   {
-    const VVVdouble* pxy_n = tProb[n];
-    const VVVdouble* iLik_n = iLik[n];
-
-    for (size_t i = 0; i < nbDistinctSites; i++)
-    {
-      // For each site in the sequence,
-      const VVdouble* iLik_n_i = &(*iLik_n)[i];
-      VVdouble* oLik_i = &(oLik)[i];
-
-      for (size_t c = 0; c < nbClasses; c++)
-      {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
-        {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
-          {
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-          }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
-        }
-      }
-    }
+    LikelihoodKernels::packTransitionProbabilities(*tProb[n], packedP[n]);
+    packedPtr[n] = &packedP[n];
   }
+  computeLikelihoodFromArrays(iLik, packedPtr, oLik, nbNodes, nbDistinctSites, nbClasses, nbStates, false);
 }
 
 /******************************************************************************/
 
 void DRNonHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
-  const vector<const VVVdouble*>& iLik,
+  const vector<const LikelihoodArray*>& iLik,
   const vector<const VVVdouble*>& tProb,
-  const VVVdouble* iLikR,
+  const LikelihoodArray* iLikR,
   const VVVdouble* tProbR,
-  VVVdouble& oLik,
+  LikelihoodArray& oLik,
   size_t nbNodes,
   size_t nbDistinctSites,
   size_t nbClasses,
@@ -1247,69 +1153,40 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
   if (reset)
     resetLikelihoodArray(oLik);
 
+  vector<LikelihoodArray> packedP(nbNodes + 1);
+  vector<const LikelihoodArray*> packedPtr(nbNodes + 1);
+  vector<const LikelihoodArray*> iLikPtr(iLik.begin(), iLik.begin() + static_cast<ptrdiff_t>(nbNodes));
   for (size_t n = 0; n < nbNodes; n++)
   {
-    const VVVdouble* pxy_n = tProb[n];
-    const VVVdouble* iLik_n = iLik[n];
-
-    for (size_t i = 0; i < nbDistinctSites; i++)
-    {
-      // For each site in the sequence,
-      const VVdouble* iLik_n_i = &(*iLik_n)[i];
-      VVdouble* oLik_i = &(oLik)[i];
-
-      for (size_t c = 0; c < nbClasses; c++)
-      {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
-        {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
-          {
-            // cout << "1:" << (* pxy_n_c_x)[y]  << endl;
-            // cout << "2:" << (* iLik_n_i_c)[y] << endl;
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-            // cout << i << "\t" << c << "\t" << x << "\t" << y << "\t" <<  (* pxy__son_c_x)[y] << "\t" << (* likelihoods_root_son_i_c)[y] << endl;
-          }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
-        }
-      }
-    }
+    LikelihoodKernels::packTransitionProbabilities(*tProb[n], packedP[n]);
+    packedPtr[n] = &packedP[n];
   }
 
   // Now deal with the subtree containing the root:
-  for (size_t i = 0; i < nbDistinctSites; i++)
-  {
-    // For each site in the sequence,
-    const VVdouble* iLikR_i = &(*iLikR)[i];
-    VVdouble* oLik_i = &(oLik)[i];
+  LikelihoodKernels::packTransitionProbabilities(*tProbR, packedP[nbNodes], true);
+  packedPtr[nbNodes] = &packedP[nbNodes];
+  iLikPtr.push_back(iLikR);
+  computeLikelihoodFromArrays(iLikPtr, packedPtr, oLik, nbNodes + 1, nbDistinctSites, nbClasses, nbStates, false);
+}
 
-    for (size_t c = 0; c < nbClasses; c++)
-    {
-      // For each rate classe,
-      const Vdouble* iLikR_i_c = &(*iLikR_i)[c];
-      Vdouble* oLik_i_c = &(*oLik_i)[c];
-      const VVdouble* pxyR_c = &(*tProbR)[c];
-      for (size_t x = 0; x < nbStates; x++)
-      {
-        double likelihood = 0;
-        for (size_t y = 0; y < nbStates; y++)
-        {
-          // For each final state,
-          const Vdouble* pxyR_c_y = &(*pxyR_c)[y];
-          likelihood += (*pxyR_c_y)[x] * (*iLikR_i_c)[y];
-        }
-        // We store this conditionnal likelihood into the corresponding array:
-        (*oLik_i_c)[x] *= likelihood;
-      }
-    }
-  }
+/******************************************************************************/
+
+void DRNonHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
+  const vector<const LikelihoodArray*>& iLik,
+  const vector<const LikelihoodArray*>& packedP,
+  LikelihoodArray& oLik,
+  size_t nbNodes,
+  size_t nbDistinctSites,
+  size_t nbClasses,
+  size_t nbStates,
+  bool reset)
+{
+  if (reset)
+    resetLikelihoodArray(oLik);
+
+  vector<const LikelihoodArray*> packedPtr(packedP.begin(), packedP.begin() + static_cast<ptrdiff_t>(nbNodes));
+  vector<const LikelihoodArray*> iLikPtr(iLik.begin(), iLik.begin() + static_cast<ptrdiff_t>(nbNodes));
+  LikelihoodKernels::multiplyConditionalLikelihoods(packedPtr, iLikPtr, oLik, nbDistinctSites, nbClasses, nbStates, 1);
 }
 
 /******************************************************************************/
@@ -1321,13 +1198,13 @@ void DRNonHomogeneousTreeLikelihood::displayLikelihood(const Node* node)
   {
     const Node* subNode = node->getSon(n);
     cout << "Array for sub-node " << subNode->getId() << endl;
-    displayLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), subNode->getId()));
+    displayLikelihoodArray(likelihoodData_->getLikelihoodBuffer(node->getId(), subNode->getId()));
   }
   if (node->hasFather())
   {
     const Node* father = node->getFather();
     cout << "Array for father node " << father->getId() << endl;
-    displayLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), father->getId()));
+    displayLikelihoodArray(likelihoodData_->getLikelihoodBuffer(node->getId(), father->getId()));
   }
   cout << "                                         ***" << endl;
 }
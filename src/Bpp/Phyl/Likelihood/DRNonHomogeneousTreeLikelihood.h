@@ -210,11 +210,13 @@ class DRNonHomogeneousTreeLikelihood:
   
     virtual void computeLikelihoodAtNode(int nodeId, VVVdouble& likelihoodArray) const
     {
-      computeLikelihoodAtNode_(tree_->getNode(nodeId), likelihoodArray);
+      LikelihoodArray array;
+      computeLikelihoodAtNode_(tree_->getNode(nodeId), array);
+      array.copyTo(likelihoodArray);
     }
       
   protected:
-    virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray) const;
+    virtual void computeLikelihoodAtNode_(const Node* node, LikelihoodArray& likelihoodArray) const;
 
   
     /**
@@ -253,6 +255,7 @@ class DRNonHomogeneousTreeLikelihood:
      *
      * This method is the "core" likelihood computation function, performing all the product uppon all nodes, the summation for each ancestral state and each rate class.
      * It is designed for inner usage, and a maximum efficiency, so no checking is performed on the input parameters.
+     * The summation over states is performed by LikelihoodKernels, which uses vectorized code when available.
      * Use with care!
      * 
      * @param iLik A vector of likelihood arrays, one for each conditional node.
@@ -266,9 +269,9 @@ class DRNonHomogeneousTreeLikelihood:
      * If true, the resetLikelihoodArray method will be called.
      */
     static void computeLikelihoodFromArrays(
-        const std::vector<const VVVdouble*>& iLik,
+        const std::vector<const LikelihoodArray*>& iLik,
         const std::vector<const VVVdouble*>& tProb,
-        VVVdouble& oLik, size_t nbNodes,
+        LikelihoodArray& oLik, size_t nbNodes,
         size_t nbDistinctSites,
         size_t nbClasses,
         size_t nbStates,
@@ -280,6 +283,7 @@ class DRNonHomogeneousTreeLikelihood:
      * This method is the "core" likelihood computation function, performing all the product uppon all nodes, the summation for each ancestral state and each rate class.
      * This function is specific to non-reversible models: the subtree containing the root is specified separately.
      * It is designed for inner usage, and a maximum efficiency, so no checking is performed on the input parameters.
+     * The summation over states is performed by LikelihoodKernels, which uses vectorized code when available.
      * Use with care!
      * 
      * @param iLik A vector of likelihood arrays, one for each conditional node.
@@ -295,11 +299,38 @@ class DRNonHomogeneousTreeLikelihood:
      * If true, the resetLikelihoodArray method will be called.
      */
     static void computeLikelihoodFromArrays(
-        const std::vector<const VVVdouble*>& iLik,
+        const std::vector<const LikelihoodArray*>& iLik,
         const std::vector<const VVVdouble*>& tProb,
-        const VVVdouble* iLikR,
+        const LikelihoodArray* iLikR,
         const VVVdouble* tProbR,
-        VVVdouble& oLik,
+        LikelihoodArray& oLik,
+        size_t nbNodes,
+        size_t nbDistinctSites,
+        size_t nbClasses,
+        size_t nbStates,
+        bool reset = true);
+
+    /**
+     * @brief Compute conditional likelihoods from packed transition probabilities.
+     *
+     * Same as the other computeLikelihoodFromArrays() methods, but with transition matrices
+     * already packed by LikelihoodKernels::packTransitionProbabilities().
+     * The subtree containing the root, if any, is passed as an additional node with reverse-packed matrices.
+     * 
+     * @param iLik A vector of likelihood arrays, one for each conditional node.
+     * @param packedP A vector of packed transition probabilities, one for each node.
+     * @param oLik The likelihood array to store the computed likelihoods.
+     * @param nbNodes The number of nodes = the size of the input vectors.
+     * @param nbDistinctSites The number of distinct sites (the first dimension of the likelihood array).
+     * @param nbClasses The number of rate classes (the second dimension of the likelihood array).
+     * @param nbStates The number of states (the third dimension of the likelihood array).
+     * @param reset Tell if the output likelihood array must be initalized prior to computation.
+     * If true, the resetLikelihoodArray method will be called.
+     */
+    static void computeLikelihoodFromArrays(
+        const std::vector<const LikelihoodArray*>& iLik,
+        const std::vector<const LikelihoodArray*>& packedP,
+        LikelihoodArray& oLik,
         size_t nbNodes,
         size_t nbDistinctSites,
         size_t nbClasses,
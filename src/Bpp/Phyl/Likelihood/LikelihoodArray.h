@@ -0,0 +1,353 @@
+//
+// File: LikelihoodArray.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _LIKELIHOODARRAY_H_
+#define _LIKELIHOODARRAY_H_
+
+#include <Bpp/Numeric/VectorTools.h>
+
+// From the STL:
+#include <algorithm>
+#include <cstddef>
+#include <cmath>
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Contiguous storage for conditional likelihoods.
+ *
+ * All values for a given (node, neighbor) pair are stored in a single buffer,
+ * site by site, then rate class by rate class:
+ * <pre>
+ * x(i, c)[s] = data[(i * nbClasses + c) * stride + s]
+ *   |-------------> Site i
+ *      |----------> Rate class c
+ *          |------> Ancestral state s
+ * </pre>
+ * The stride is the number of states rounded up to a multiple of 4, and the buffer
+ * is aligned on 32 bytes, so that each (site, class) row starts on an aligned address.
+ * Padding values are always equal to 0, vectorized kernels can therefore work on the
+ * full stride without having to deal with the remainder.
+ *
+ * Compared to a VVVdouble, this saves one indirection per loop level and keeps the
+ * values of consecutive sites next to each other in memory.
+ *
+ * Each site also has a scaling factor @f$s_i@f$, stored in log space: the actual conditional
+ * likelihoods are the stored values times @f$e^{s_i}@f$. Scaling factors are all 0 unless
+ * rescale() is called, which is used to prevent numerical underflow on large trees.
+ */
+class LikelihoodArray
+{
+  private:
+    double* buffer_;
+    double* data_;
+    size_t capacity_;
+    size_t nbSites_;
+    size_t nbClasses_;
+    size_t nbStates_;
+    size_t stride_;
+    std::vector<double> logScalingFactors_;
+
+  public:
+    LikelihoodArray() :
+      buffer_(0), data_(0), capacity_(0), nbSites_(0), nbClasses_(0), nbStates_(0), stride_(0), logScalingFactors_()
+    {}
+
+    LikelihoodArray(size_t nbSites, size_t nbClasses, size_t nbStates) :
+      buffer_(0), data_(0), capacity_(0), nbSites_(0), nbClasses_(0), nbStates_(0), stride_(0), logScalingFactors_()
+    {
+      resize(nbSites, nbClasses, nbStates);
+    }
+
+    LikelihoodArray(const LikelihoodArray& array) :
+      buffer_(0), data_(0), capacity_(0), nbSites_(0), nbClasses_(0), nbStates_(0), stride_(0), logScalingFactors_()
+    {
+      resize(array.nbSites_, array.nbClasses_, array.nbStates_);
+      std::copy(array.data_, array.data_ + getSize(), data_);
+      logScalingFactors_ = array.logScalingFactors_;
+    }
+
+    LikelihoodArray& operator=(const LikelihoodArray& array)
+    {
+      if (this == &array) return *this;
+      resize(array.nbSites_, array.nbClasses_, array.nbStates_);
+      std::copy(array.data_, array.data_ + getSize(), data_);
+      logScalingFactors_ = array.logScalingFactors_;
+      return *this;
+    }
+
+    ~LikelihoodArray() { delete[] buffer_; }
+
+  public:
+    /**
+     * @brief Set the dimensions of the array.
+     *
+     * The content of the array is lost if the dimensions change, and all values and scaling factors are set to 0.
+     * Nothing is done if the dimensions are unchanged.
+     * Memory is only reallocated if the current buffer is too small, so that an array can be reused as a scratch buffer for arrays of different sizes.
+     *
+     * @param nbSites   The number of sites.
+     * @param nbClasses The number of rate classes.
+     * @param nbStates  The number of states.
+     */
+    void resize(size_t nbSites, size_t nbClasses, size_t nbStates)
+    {
+      if (buffer_ && nbSites == nbSites_ && nbClasses == nbClasses_ && nbStates == nbStates_)
+        return;
+      nbSites_   = nbSites;
+      nbClasses_ = nbClasses;
+      nbStates_  = nbStates;
+      stride_    = getStrideFor(nbStates);
+      logScalingFactors_.assign(nbSites, 0.);
+      size_t size = getSize();
+      if (buffer_ && size <= capacity_)
+      {
+        std::fill(buffer_, buffer_ + capacity_ + 3, 0.);
+        return;
+      }
+      delete[] buffer_;
+      buffer_   = 0;
+      data_     = 0;
+      capacity_ = 0;
+      if (size == 0)
+        return;
+      // Allocate 3 more doubles, so that we can shift the pointer to a 32 bytes boundary:
+      buffer_ = new double[size + 3];
+      capacity_ = size;
+      size_t misalignment = (reinterpret_cast<size_t>(buffer_) % 32) / sizeof(double);
+      data_ = buffer_ + (misalignment == 0 ? 0 : 4 - misalignment);
+      std::fill(buffer_, buffer_ + size + 3, 0.);
+    }
+
+    size_t getNumberOfSites() const { return nbSites_; }
+    size_t getNumberOfClasses() const { return nbClasses_; }
+    size_t getNumberOfStates() const { return nbStates_; }
+
+    /**
+     * @return The distance between two consecutive (site, class) rows, in number of doubles.
+     */
+    size_t getStride() const { return stride_; }
+
+    /**
+     * @return The row stride used for a given number of states.
+     * @param nbStates The number of states.
+     */
+    static size_t getStrideFor(size_t nbStates) { return (nbStates + 3) / 4 * 4; }
+
+    /**
+     * @return The total number of doubles in the array, padding included.
+     */
+    size_t getSize() const { return nbSites_ * nbClasses_ * stride_; }
+
+    double* getData() { return data_; }
+    const double* getData() const { return data_; }
+
+    /**
+     * @return A pointer toward the conditional likelihoods of all states, for a given site and rate class.
+     */
+    double* operator()(size_t site, size_t rateClass)
+    {
+      return data_ + (site * nbClasses_ + rateClass) * stride_;
+    }
+
+    const double* operator()(size_t site, size_t rateClass) const
+    {
+      return data_ + (site * nbClasses_ + rateClass) * stride_;
+    }
+
+    double& operator()(size_t site, size_t rateClass, size_t state)
+    {
+      return data_[(site * nbClasses_ + rateClass) * stride_ + state];
+    }
+
+    const double& operator()(size_t site, size_t rateClass, size_t state) const
+    {
+      return data_[(site * nbClasses_ + rateClass) * stride_ + state];
+    }
+
+    /**
+     * @brief Set all conditional likelihoods to a given value.
+     *
+     * Padding values are left untouched, scaling factors are reset to 0.
+     *
+     * @param value The value to use.
+     */
+    void fill(double value)
+    {
+      std::fill(logScalingFactors_.begin(), logScalingFactors_.end(), 0.);
+      size_t nbRows = nbSites_ * nbClasses_;
+      for (size_t r = 0; r < nbRows; r++)
+      {
+        double* row = data_ + r * stride_;
+        for (size_t s = 0; s < nbStates_; s++)
+        {
+          row[s] = value;
+        }
+      }
+    }
+
+    /**
+     * @return The log scaling factor of a given site.
+     * @param site The site index.
+     */
+    double getLogScalingFactor(size_t site) const { return logScalingFactors_[site]; }
+
+    std::vector<double>& getLogScalingFactors() { return logScalingFactors_; }
+    const std::vector<double>& getLogScalingFactors() const { return logScalingFactors_; }
+
+    /**
+     * @return The value under which conditional likelihoods are rescaled, see rescale().
+     */
+    static double getScalingThreshold() { return std::ldexp(1., -256); }
+
+    /**
+     * @brief Rescale sites with small conditional likelihoods.
+     *
+     * For each site where all conditional likelihoods are lower than getScalingThreshold(),
+     * values are multiplied by a power of 2 so that the largest one falls in [0.5, 1[,
+     * and the scaling factor of the site is updated accordingly.
+     * As multiplications by powers of 2 are exact, this does not introduce any rounding error.
+     */
+    void rescale() { rescale(0, nbSites_); }
+
+    /**
+     * @brief Rescale sites with small conditional likelihoods, in the range [firstSite, lastSite[.
+     *
+     * @see rescale()
+     */
+    void rescale(size_t firstSite, size_t lastSite)
+    {
+      double threshold = getScalingThreshold();
+      size_t siteSize = nbClasses_ * stride_;
+      for (size_t i = firstSite; i < lastSite; i++)
+      {
+        double* site = data_ + i * siteSize;
+        double max = *std::max_element(site, site + siteSize);
+        if (max >= threshold || max <= 0.)
+          continue;
+        int exponent;
+        std::frexp(max, &exponent);
+        double factor = std::ldexp(1., -exponent);
+        for (size_t j = 0; j < siteSize; j++)
+        {
+          site[j] *= factor;
+        }
+        logScalingFactors_[i] += static_cast<double>(exponent) * std::log(2.);
+      }
+    }
+
+    /**
+     * @brief Multiply the stored values by their scaling factors, and reset the factors to 0.
+     *
+     * Values are then the actual conditional likelihoods, and may underflow to 0 on large trees.
+     */
+    void unscale()
+    {
+      size_t siteSize = nbClasses_ * stride_;
+      for (size_t i = 0; i < nbSites_; i++)
+      {
+        if (logScalingFactors_[i] == 0.)
+          continue;
+        double factor = std::exp(logScalingFactors_[i]);
+        double* site = data_ + i * siteSize;
+        for (size_t j = 0; j < siteSize; j++)
+        {
+          site[j] *= factor;
+        }
+        logScalingFactors_[i] = 0.;
+      }
+    }
+
+    /**
+     * @brief Copy the content of this array into a nested vector.
+     *
+     * Stored values are copied, scaling factors are ignored.
+     *
+     * @param array The output array, resized if needed.
+     */
+    void copyTo(VVVdouble& array) const
+    {
+      array.resize(nbSites_);
+      for (size_t i = 0; i < nbSites_; i++)
+      {
+        VVdouble* array_i = &array[i];
+        array_i->resize(nbClasses_);
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          const double* row = (*this)(i, c);
+          (*array_i)[c].assign(row, row + nbStates_);
+        }
+      }
+    }
+
+    /**
+     * @brief Copy the actual conditional likelihoods into a nested vector.
+     *
+     * Stored values are multiplied by their scaling factors, as with unscale(), but this array is left unchanged.
+     *
+     * @param array The output array, resized if needed.
+     */
+    void copyUnscaledTo(VVVdouble& array) const
+    {
+      copyTo(array);
+      for (size_t i = 0; i < nbSites_; i++)
+      {
+        if (logScalingFactors_[i] == 0.)
+          continue;
+        double factor = std::exp(logScalingFactors_[i]);
+        VVdouble* array_i = &array[i];
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          Vdouble* array_i_c = &(*array_i)[c];
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            (*array_i_c)[x] *= factor;
+          }
+        }
+      }
+    }
+
+};
+
+} //end of namespace bpp.
+
+#endif //_LIKELIHOODARRAY_H_
+
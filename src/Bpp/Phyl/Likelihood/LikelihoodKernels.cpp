@@ -0,0 +1,425 @@
+//
+// File: LikelihoodKernels.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "LikelihoodKernels.h"
+
+// From the STL:
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define BPP_LIKELIHOOD_KERNELS_X86 1
+#  include <immintrin.h>
+#  define BPP_TARGET_SSE2 __attribute__((target("sse2")))
+#  define BPP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+namespace
+{
+
+typedef void (*Kernel)(const double*, const double*, size_t, double*, size_t, size_t);
+
+void multiplyGeneric(
+  const double* packedP,
+  const double* iLik,
+  size_t iLikStep,
+  double* oLik,
+  size_t oLikStep,
+  size_t nbRows,
+  size_t nbStates)
+{
+  size_t stride = LikelihoodArray::getStrideFor(nbStates);
+  for (size_t r = 0; r < nbRows; r++)
+  {
+    const double* iLik_r = iLik + r * iLikStep;
+    double* oLik_r = oLik + r * oLikStep;
+    for (size_t x = 0; x < nbStates; x++)
+    {
+      double likelihood = 0;
+      for (size_t y = 0; y < nbStates; y++)
+      {
+        likelihood += packedP[y * stride + x] * iLik_r[y];
+      }
+      oLik_r[x] *= likelihood;
+    }
+  }
+}
+
+#ifdef BPP_LIKELIHOOD_KERNELS_X86
+
+/*
+ * The input likelihood of state y is broadcast and multiplied by row y of the packed matrix,
+ * so that all accumulators for one row of the output stay in registers.
+ * N % W trailing states (61 states only) are dealt with in scalar mode.
+ */
+
+template<size_t N>
+BPP_TARGET_SSE2 void multiplySse2(
+  const double* packedP,
+  const double* iLik,
+  size_t iLikStep,
+  double* oLik,
+  size_t oLikStep,
+  size_t nbRows)
+{
+  const size_t stride = (N + 3) / 4 * 4;
+  const size_t nbBlocks = N / 2;
+  const size_t nbTail = N % 2;
+  for (size_t r = 0; r < nbRows; r++)
+  {
+    const double* iLik_r = iLik + r * iLikStep;
+    double* oLik_r = oLik + r * oLikStep;
+    __m128d acc[nbBlocks];
+    double tail[nbTail > 0 ? nbTail : 1];
+    for (size_t b = 0; b < nbBlocks; b++)
+      acc[b] = _mm_setzero_pd();
+    for (size_t t = 0; t < nbTail; t++)
+      tail[t] = 0;
+    for (size_t y = 0; y < N; y++)
+    {
+      const double* p_y = packedP + y * stride;
+      __m128d l_y = _mm_set1_pd(iLik_r[y]);
+      for (size_t b = 0; b < nbBlocks; b++)
+        acc[b] = _mm_add_pd(acc[b], _mm_mul_pd(l_y, _mm_load_pd(p_y + 2 * b)));
+      for (size_t t = 0; t < nbTail; t++)
+        tail[t] += p_y[2 * nbBlocks + t] * iLik_r[y];
+    }
+    for (size_t b = 0; b < nbBlocks; b++)
+      _mm_storeu_pd(oLik_r + 2 * b, _mm_mul_pd(_mm_loadu_pd(oLik_r + 2 * b), acc[b]));
+    for (size_t t = 0; t < nbTail; t++)
+      oLik_r[2 * nbBlocks + t] *= tail[t];
+  }
+}
+
+template<size_t N>
+BPP_TARGET_AVX2 void multiplyAvx2(
+  const double* packedP,
+  const double* iLik,
+  size_t iLikStep,
+  double* oLik,
+  size_t oLikStep,
+  size_t nbRows)
+{
+  const size_t stride = (N + 3) / 4 * 4;
+  const size_t nbBlocks = N / 4;
+  const size_t nbTail = N % 4;
+  for (size_t r = 0; r < nbRows; r++)
+  {
+    const double* iLik_r = iLik + r * iLikStep;
+    double* oLik_r = oLik + r * oLikStep;
+    __m256d acc[nbBlocks];
+    double tail[nbTail > 0 ? nbTail : 1];
+    for (size_t b = 0; b < nbBlocks; b++)
+      acc[b] = _mm256_setzero_pd();
+    for (size_t t = 0; t < nbTail; t++)
+      tail[t] = 0;
+    for (size_t y = 0; y < N; y++)
+    {
+      const double* p_y = packedP + y * stride;
+      __m256d l_y = _mm256_broadcast_sd(iLik_r + y);
+      for (size_t b = 0; b < nbBlocks; b++)
+        acc[b] = _mm256_fmadd_pd(l_y, _mm256_load_pd(p_y + 4 * b), acc[b]);
+      for (size_t t = 0; t < nbTail; t++)
+        tail[t] += p_y[4 * nbBlocks + t] * iLik_r[y];
+    }
+    for (size_t b = 0; b < nbBlocks; b++)
+      _mm256_storeu_pd(oLik_r + 4 * b, _mm256_mul_pd(_mm256_loadu_pd(oLik_r + 4 * b), acc[b]));
+    for (size_t t = 0; t < nbTail; t++)
+      oLik_r[4 * nbBlocks + t] *= tail[t];
+  }
+}
+
+#endif //BPP_LIKELIHOOD_KERNELS_X86
+
+Kernel getKernel(LikelihoodKernels::InstructionSet instructionSet, size_t nbStates)
+{
+#ifdef BPP_LIKELIHOOD_KERNELS_X86
+  if (instructionSet == LikelihoodKernels::AVX2)
+  {
+    switch (nbStates)
+    {
+      case 4:  return &multiplyAvx2<4>;
+      case 20: return &multiplyAvx2<20>;
+      case 61: return &multiplyAvx2<61>;
+      default: return 0;
+    }
+  }
+  if (instructionSet == LikelihoodKernels::SSE2)
+  {
+    switch (nbStates)
+    {
+      case 4:  return &multiplySse2<4>;
+      case 20: return &multiplySse2<20>;
+      case 61: return &multiplySse2<61>;
+      default: return 0;
+    }
+  }
+#endif
+  return 0;
+}
+
+} //end of anonymous namespace.
+
+/******************************************************************************/
+
+LikelihoodKernels::InstructionSet LikelihoodKernels::instructionSet_ = LikelihoodKernels::getBestInstructionSet();
+
+/******************************************************************************/
+
+LikelihoodKernels::InstructionSet LikelihoodKernels::getBestInstructionSet()
+{
+#ifdef BPP_LIKELIHOOD_KERNELS_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return AVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return SSE2;
+#endif
+  return GENERIC;
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::setInstructionSet(InstructionSet instructionSet)
+{
+  InstructionSet best = getBestInstructionSet();
+  instructionSet_ = (instructionSet > best ? best : instructionSet);
+}
+
+/******************************************************************************/
+
+string LikelihoodKernels::getInstructionSetName(InstructionSet instructionSet)
+{
+  switch (instructionSet)
+  {
+    case AVX2: return "AVX2";
+    case SSE2: return "SSE2";
+    default:   return "generic";
+  }
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::packTransitionProbabilities(const VVVdouble& pxy, LikelihoodArray& packed, bool reverse)
+{
+  size_t nbClasses = pxy.size();
+  size_t nbStates  = (nbClasses > 0 ? pxy[0].size() : 0);
+  packed.resize(nbClasses, nbStates, nbStates);
+  for (size_t c = 0; c < nbClasses; c++)
+  {
+    const VVdouble* pxy_c = &pxy[c];
+    for (size_t y = 0; y < nbStates; y++)
+    {
+      double* packed_c_y = packed(c, y);
+      for (size_t x = 0; x < nbStates; x++)
+      {
+        packed_c_y[x] = reverse ? (*pxy_c)[y][x] : (*pxy_c)[x][y];
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::multiplyConditionalLikelihoods(
+  const double* packedP,
+  const double* iLik,
+  size_t iLikStep,
+  double* oLik,
+  size_t oLikStep,
+  size_t nbRows,
+  size_t nbStates)
+{
+  Kernel kernel = getKernel(instructionSet_, nbStates);
+  if (kernel)
+    kernel(packedP, iLik, iLikStep, oLik, oLikStep, nbRows);
+  else
+    multiplyGeneric(packedP, iLik, iLikStep, oLik, oLikStep, nbRows, nbStates);
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::multiplyConditionalLikelihoods(
+  const LikelihoodArray& packedP,
+  const LikelihoodArray& iLik,
+  LikelihoodArray& oLik,
+  size_t nbSites,
+  size_t nbClasses,
+  size_t nbStates)
+{
+  multiplyConditionalLikelihoods_(packedP, iLik, oLik, 0, nbSites, nbClasses, nbStates);
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::multiplyConditionalLikelihoods_(
+  const LikelihoodArray& packedP,
+  const LikelihoodArray& iLik,
+  LikelihoodArray& oLik,
+  size_t firstSite,
+  size_t lastSite,
+  size_t nbClasses,
+  size_t nbStates)
+{
+  if (lastSite <= firstSite)
+    return;
+  // Rows of a given rate class are regularly spaced in both arrays:
+  size_t iLikStep = nbClasses * iLik.getStride();
+  size_t oLikStep = nbClasses * oLik.getStride();
+  for (size_t c = 0; c < nbClasses; c++)
+  {
+    multiplyConditionalLikelihoods(packedP(c, 0), iLik(firstSite, c), iLikStep, oLik(firstSite, c), oLikStep, lastSite - firstSite, nbStates);
+  }
+  // Scaling factors are multiplied too:
+  const vector<double>* iScales = &iLik.getLogScalingFactors();
+  vector<double>* oScales = &oLik.getLogScalingFactors();
+  for (size_t i = firstSite; i < lastSite; i++)
+  {
+    (*oScales)[i] += (*iScales)[i];
+  }
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::multiplyConditionalLikelihoods(
+  const vector<const LikelihoodArray*>& packedP,
+  const vector<const LikelihoodArray*>& iLik,
+  LikelihoodArray& oLik,
+  size_t nbSites,
+  size_t nbClasses,
+  size_t nbStates,
+  size_t nbThreads)
+{
+  size_t nbNeighbors = packedP.size();
+  size_t blockSize = getSiteBlockSize(nbClasses, nbStates);
+  long nbBlocks = static_cast<long>((nbSites + blockSize - 1) / blockSize);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads)) if(nbThreads > 1 && nbBlocks > 1)
+#endif
+  for (long b = 0; b < nbBlocks; b++)
+  {
+    size_t firstSite = static_cast<size_t>(b) * blockSize;
+    size_t lastSite  = min(firstSite + blockSize, nbSites);
+    for (size_t n = 0; n < nbNeighbors; n++)
+    {
+      multiplyConditionalLikelihoods_(*packedP[n], *iLik[n], oLik, firstSite, lastSite, nbClasses, nbStates);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::multiplyConditionalLikelihoods(
+  const LikelihoodArray& packedP,
+  const VVVdouble& iLik,
+  const vector<size_t>& positions,
+  LikelihoodArray& oLik,
+  size_t nbThreads)
+{
+  size_t nbSites   = oLik.getNumberOfSites();
+  size_t nbClasses = oLik.getNumberOfClasses();
+  size_t nbStates  = oLik.getNumberOfStates();
+  size_t blockSize = getSiteBlockSize(nbClasses, nbStates);
+  long nbBlocks = static_cast<long>((nbSites + blockSize - 1) / blockSize);
+  size_t oLikStep = nbClasses * oLik.getStride();
+#ifdef _OPENMP
+#  pragma omp parallel num_threads(static_cast<int>(nbThreads)) if(nbThreads > 1 && nbBlocks > 1)
+#endif
+  {
+    // Each thread has its own buffer:
+    LikelihoodArray buffer(blockSize, nbClasses, nbStates);
+    size_t bufferStep = nbClasses * buffer.getStride();
+#ifdef _OPENMP
+#  pragma omp for schedule(dynamic)
+#endif
+    for (long b = 0; b < nbBlocks; b++)
+    {
+      size_t firstSite = static_cast<size_t>(b) * blockSize;
+      size_t lastSite  = min(firstSite + blockSize, nbSites);
+      for (size_t i = firstSite; i < lastSite; i++)
+      {
+        const VVdouble* iLik_i = &iLik[positions[i]];
+        for (size_t c = 0; c < nbClasses; c++)
+        {
+          const double* iLik_i_c = &(*iLik_i)[c][0];
+          copy(iLik_i_c, iLik_i_c + nbStates, buffer(i - firstSite, c));
+        }
+      }
+      for (size_t c = 0; c < nbClasses; c++)
+      {
+        multiplyConditionalLikelihoods(packedP(c, 0), buffer(0, c), bufferStep, oLik(firstSite, c), oLikStep, lastSite - firstSite, nbStates);
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::rescaleConditionalLikelihoods(LikelihoodArray& lik, size_t nbThreads)
+{
+  size_t nbSites = lik.getNumberOfSites();
+  size_t blockSize = getSiteBlockSize(lik.getNumberOfClasses(), lik.getNumberOfStates());
+  long nbBlocks = static_cast<long>((nbSites + blockSize - 1) / blockSize);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(static) num_threads(static_cast<int>(nbThreads)) if(nbThreads > 1 && nbBlocks > 1)
+#endif
+  for (long b = 0; b < nbBlocks; b++)
+  {
+    size_t firstSite = static_cast<size_t>(b) * blockSize;
+    lik.rescale(firstSite, min(firstSite + blockSize, nbSites));
+  }
+}
+
+/******************************************************************************/
+
+size_t LikelihoodKernels::getSiteBlockSize(size_t nbClasses, size_t nbStates)
+{
+  // 32 kb of output conditional likelihoods:
+  size_t siteSize = nbClasses * LikelihoodArray::getStrideFor(nbStates);
+  if (siteSize == 0 || siteSize > 4096)
+    return 1;
+  return 4096 / siteSize;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,245 @@
+//
+// File: LikelihoodKernels.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _LIKELIHOODKERNELS_H_
+#define _LIKELIHOODKERNELS_H_
+
+#include "LikelihoodArray.h"
+
+#include <Bpp/Numeric/VectorTools.h>
+
+// From the STL:
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Low-level routines for the propagation of conditional likelihoods along a branch.
+ *
+ * The core operation of all likelihood computations is, for each site and rate class,
+ * @f[
+ * L_{out}(x) \leftarrow L_{out}(x) \times \sum_y P_{x,y} L_{in}(y).
+ * @f]
+ * This class provides vectorized implementations of this operation, specialized at compile
+ * time for nucleotides (4 states), proteins (20 states) and codons (61 states).
+ * The implementation to use is chosen at runtime according to the features of the CPU
+ * (AVX2 + FMA, then SSE2). Other alphabet sizes, or CPUs without any of these instructions,
+ * use a generic scalar loop.
+ *
+ * Transition probabilities have first to be packed with packTransitionProbabilities().
+ * The packed matrices are stored in a LikelihoodArray, with dimensions (class, y, x),
+ * so that the inner loop runs over contiguous, aligned memory.
+ *
+ * When OpenMP is available, whole arrays can be processed with several threads.
+ * Sites are then split into blocks small enough to stay in cache, and each block is processed
+ * by a single thread. As the computations for a given site do not depend on the block it belongs to,
+ * results are identical whatever the number of threads.
+ */
+class LikelihoodKernels
+{
+  public:
+    enum InstructionSet { GENERIC = 0, SSE2 = 1, AVX2 = 2 };
+
+  private:
+    static InstructionSet instructionSet_;
+
+  public:
+    /**
+     * @return The most efficient instruction set supported by this CPU.
+     */
+    static InstructionSet getBestInstructionSet();
+
+    /**
+     * @return The instruction set currently used.
+     */
+    static InstructionSet getInstructionSet() { return instructionSet_; }
+
+    /**
+     * @brief Change the instruction set to use.
+     *
+     * This is mostly useful for testing and benchmarking.
+     * If the requested set is not supported by the CPU, the best supported one is used instead.
+     *
+     * @param instructionSet The instruction set to use.
+     */
+    static void setInstructionSet(InstructionSet instructionSet);
+
+    /**
+     * @return The name of an instruction set.
+     * @param instructionSet The instruction set.
+     */
+    static std::string getInstructionSetName(InstructionSet instructionSet);
+
+    /**
+     * @brief Pack transition probabilities for use with multiplyConditionalLikelihoods().
+     *
+     * @param pxy     The transition probabilities, for each rate class.
+     * @param packed  The output array, resized if needed.
+     * @param reverse If false, the packed matrices compute @f$\sum_y P_{x,y} L(y)@f$
+     * (conditional likelihoods of a son node). If true, they compute @f$\sum_y P_{y,x} L(y)@f$
+     * (conditional likelihoods of a father node).
+     */
+    static void packTransitionProbabilities(const VVVdouble& pxy, LikelihoodArray& packed, bool reverse = false);
+
+    /**
+     * @brief Multiply conditional likelihoods by the propagated likelihoods of a neighbor.
+     *
+     * For each row r < nbRows, compute
+     * oLik[r * oLikStep + x] *= sum_y packedP[y * stride + x] * iLik[r * iLikStep + y],
+     * with stride = LikelihoodArray::getStrideFor(nbStates).
+     *
+     * @param packedP  The packed transition matrix for one rate class. Must be aligned on 32 bytes.
+     * @param iLik     The input conditional likelihoods.
+     * @param iLikStep The distance between two input rows.
+     * @param oLik     The output conditional likelihoods.
+     * @param oLikStep The distance between two output rows.
+     * @param nbRows   The number of rows to process.
+     * @param nbStates The number of states.
+     */
+    static void multiplyConditionalLikelihoods(
+        const double* packedP,
+        const double* iLik,
+        size_t iLikStep,
+        double* oLik,
+        size_t oLikStep,
+        size_t nbRows,
+        size_t nbStates);
+
+    /**
+     * @brief Multiply all conditional likelihoods in an array by the propagated likelihoods of a neighbor.
+     *
+     * The log scaling factors of the input array are added to the ones of the output array.
+     *
+     * @param packedP   The packed transition matrices, as output by packTransitionProbabilities().
+     * @param iLik      The input conditional likelihoods.
+     * @param oLik      The output conditional likelihoods.
+     * @param nbSites   The number of sites.
+     * @param nbClasses The number of rate classes.
+     * @param nbStates  The number of states.
+     */
+    static void multiplyConditionalLikelihoods(
+        const LikelihoodArray& packedP,
+        const LikelihoodArray& iLik,
+        LikelihoodArray& oLik,
+        size_t nbSites,
+        size_t nbClasses,
+        size_t nbStates);
+
+    /**
+     * @brief Multiply all conditional likelihoods in an array by the propagated likelihoods of several neighbors.
+     *
+     * This is equivalent to calling multiplyConditionalLikelihoods() for each neighbor in turn,
+     * but all neighbors are processed for a block of sites before moving to the next block.
+     * Blocks are distributed over threads.
+     *
+     * @param packedP   The packed transition matrices for each neighbor.
+     * @param iLik      The input conditional likelihoods for each neighbor.
+     * @param oLik      The output conditional likelihoods.
+     * @param nbSites   The number of sites.
+     * @param nbClasses The number of rate classes.
+     * @param nbStates  The number of states.
+     * @param nbThreads The number of threads to use.
+     */
+    static void multiplyConditionalLikelihoods(
+        const std::vector<const LikelihoodArray*>& packedP,
+        const std::vector<const LikelihoodArray*>& iLik,
+        LikelihoodArray& oLik,
+        size_t nbSites,
+        size_t nbClasses,
+        size_t nbStates,
+        size_t nbThreads);
+
+    /**
+     * @brief Multiply all conditional likelihoods in an array by the propagated likelihoods of a neighbor stored as nested vectors.
+     *
+     * This is used by the classes storing conditional likelihoods as VVVdouble, where the input rows of a site
+     * are not contiguous and are found through pattern links.
+     * For each block of sites, input rows are first gathered in a buffer small enough to stay in cache,
+     * then all sites of the block are processed with one kernel call per rate class.
+     * Blocks are distributed over threads. Scaling factors are left unchanged.
+     *
+     * @param packedP   The packed transition matrices, as output by packTransitionProbabilities().
+     * @param iLik      The input conditional likelihoods (site x class x state).
+     * @param positions The position in iLik of each site of oLik.
+     * @param oLik      The output conditional likelihoods.
+     * @param nbThreads The number of threads to use.
+     */
+    static void multiplyConditionalLikelihoods(
+        const LikelihoodArray& packedP,
+        const VVVdouble& iLik,
+        const std::vector<size_t>& positions,
+        LikelihoodArray& oLik,
+        size_t nbThreads);
+
+    /**
+     * @brief Rescale an array of conditional likelihoods, see LikelihoodArray::rescale().
+     *
+     * @param lik       The array to rescale.
+     * @param nbThreads The number of threads to use.
+     */
+    static void rescaleConditionalLikelihoods(LikelihoodArray& lik, size_t nbThreads);
+
+    /**
+     * @return The number of sites processed at once by a thread.
+     *
+     * The block size is chosen so that the conditional likelihoods of a block fit in the L1 cache.
+     *
+     * @param nbClasses The number of rate classes.
+     * @param nbStates  The number of states.
+     */
+    static size_t getSiteBlockSize(size_t nbClasses, size_t nbStates);
+
+  private:
+    static void multiplyConditionalLikelihoods_(
+        const LikelihoodArray& packedP,
+        const LikelihoodArray& iLik,
+        LikelihoodArray& oLik,
+        size_t firstSite,
+        size_t lastSite,
+        size_t nbClasses,
+        size_t nbStates);
+
+};
+
+} //end of namespace bpp.
+
+#endif //_LIKELIHOODKERNELS_H_
+
@@ -38,6 +38,7 @@
  */
 
 #include "NNIHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/App/ApplicationTools.h>
@@ -47,6 +48,11 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <algorithm>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
 
 using namespace std;
 
@@ -94,26 +100,29 @@ void BranchLikelihood::computeLogLikelihood()
 {
   lnL_ = 0;
 
-  vector<double> la(array1_->size());
-  for (size_t i = 0; i < array1_->size(); i++)
+  size_t nbSites = array1_->getNumberOfSites();
+  vector<double> la(nbSites);
+  for (size_t i = 0; i < nbSites; i++)
   {
     double Li = 0;
     for (size_t c = 0; c < nbClasses_; c++)
     {
       double rc = rDist_->getProbability(c);
+      const double* array1_i_c = (*array1_)(i, c);
+      const double* array2_i_c = (*array2_)(i, c);
       for (size_t x = 0; x < nbStates_; x++)
       {
         for (size_t y = 0; y < nbStates_; y++)
         {
-          Li += rc * (*array1_)[i][c][x] * pxy_[c][x][y] * (*array2_)[i][c][y];
+          Li += rc * array1_i_c[x] * pxy_[c][x][y] * array2_i_c[y];
         }
       }
     }
-    la[i] = weights_[i] * log(Li);
+    la[i] = weights_[i] * (log(Li) + array1_->getLogScalingFactor(i) + array2_->getLogScalingFactor(i));
   }
 
   sort(la.begin(), la.end());
-  for (size_t i = array1_->size(); i > 0; i--)
+  for (size_t i = nbSites; i > 0; i--)
   {
     lnL_ -= la[i - 1];
   }
@@ -205,6 +214,106 @@ NNIHomogeneousTreeLikelihood::~NNIHomogeneousTreeLikelihood()
 
 /******************************************************************************/
 double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const throw (NodeException)
+{
+  double brLen;
+  double diff = testNNI_(nodeId, model_, rateDistribution_, brLikFunction_, brentOptimizer_, nbThreads_, brLen);
+  brLenNNIValues_[nodeId] = brLen;
+  return diff;
+}
+
+/******************************************************************************/
+vector<double> NNIHomogeneousTreeLikelihood::testNNIs(const vector<int>& nodeIds) const throw (NodeException)
+{
+  size_t nbNNIs = nodeIds.size();
+  size_t nbThreads = min(nbThreads_, nbNNIs);
+  vector<double> diffs(nbNNIs);
+  if (nbThreads <= 1)
+  {
+    for (size_t i = 0; i < nbNNIs; i++)
+    {
+      diffs[i] = testNNI(nodeIds[i]);
+    }
+    return diffs;
+  }
+
+  // Check all nodes first, as exceptions cannot leave a parallel region:
+  for (size_t i = 0; i < nbNNIs; i++)
+  {
+    const Node* son = tree_->getNode(nodeIds[i]);
+    if (!son->hasFather()) throw NodePException("NNIHomogeneousTreeLikelihood::testNNIs(). Node 'son' must not be the root node.", son);
+    if (!son->getFather()->hasFather()) throw NodePException("NNIHomogeneousTreeLikelihood::testNNIs(). Node 'parent' must not be the root node.", son->getFather());
+  }
+
+  // Each thread gets its own copy of all objects which are modified during a test.
+  // The substitution model is copied as it caches the transition matrices it computes.
+  vector<SubstitutionModel*> models(nbThreads);
+  vector<DiscreteDistribution*> rateDists(nbThreads);
+  vector<BranchLikelihood*> brLikFunctions(nbThreads);
+  vector<BrentOneDimension*> brentOptimizers(nbThreads);
+  for (size_t t = 0; t < nbThreads; t++)
+  {
+    models[t] = dynamic_cast<SubstitutionModel*>(model_->clone());
+    rateDists[t] = dynamic_cast<DiscreteDistribution*>(rateDistribution_->clone());
+    brLikFunctions[t] = dynamic_cast<BranchLikelihood*>(brLikFunction_->clone());
+    brentOptimizers[t] = dynamic_cast<BrentOneDimension*>(brentOptimizer_->clone());
+  }
+
+  vector<double> brLens(nbNNIs);
+  string error;
+  int errorNodeId = 0;
+  long nbNNIsL = static_cast<long>(nbNNIs);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads))
+#endif
+  for (long li = 0; li < nbNNIsL; li++)
+  {
+    size_t i = static_cast<size_t>(li);
+    size_t t = 0;
+#ifdef _OPENMP
+    t = static_cast<size_t>(omp_get_thread_num());
+#endif
+    try
+    {
+      diffs[i] = testNNI_(nodeIds[i], models[t], rateDists[t], brLikFunctions[t], brentOptimizers[t], 1, brLens[i]);
+    }
+    catch (std::exception& ex)
+    {
+#ifdef _OPENMP
+#  pragma omp critical
+#endif
+      {
+        error = ex.what();
+        errorNodeId = nodeIds[i];
+      }
+    }
+  }
+
+  for (size_t t = 0; t < nbThreads; t++)
+  {
+    delete models[t];
+    delete rateDists[t];
+    delete brLikFunctions[t];
+    delete brentOptimizers[t];
+  }
+  if (error.size() > 0)
+    throw NodeException("NNIHomogeneousTreeLikelihood::testNNIs(). " + error, errorNodeId);
+
+  for (size_t i = 0; i < nbNNIs; i++)
+  {
+    brLenNNIValues_[nodeIds[i]] = brLens[i];
+  }
+  return diffs;
+}
+
+/******************************************************************************/
+double NNIHomogeneousTreeLikelihood::testNNI_(
+  int nodeId,
+  const SubstitutionModel* model,
+  const DiscreteDistribution* rateDistribution,
+  BranchLikelihood* brLikFunction,
+  BrentOneDimension* brentOptimizer,
+  size_t nbThreads,
+  double& brLen) const throw (NodeException)
 {
   const Node* son    = tree_->getNode(nodeId);
   if (!son->hasFather()) throw NodePException("DRHomogeneousTreeLikelihood::testNNI(). Node 'son' must not be the root node.", son);
@@ -220,48 +329,48 @@ double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const throw (NodeExcept
 
   // Retrieving arrays of interest:
   const DRASDRTreeLikelihoodNodeData* parentData = &getLikelihoodData()->getNodeData(parent->getId());
-  const VVVdouble* sonArray   = &parentData->getLikelihoodArrayForNeighbor(son->getId());
+  const LikelihoodArray* sonArray   = &parentData->getLikelihoodBufferForNeighbor(son->getId());
   vector<const Node*> parentNeighbors = TreeTemplateTools::getRemainingNeighbors(parent, grandFather, son);
   size_t nbParentNeighbors = parentNeighbors.size();
-  vector<const VVVdouble*> parentArrays(nbParentNeighbors);
+  vector<const LikelihoodArray*> parentArrays(nbParentNeighbors);
   vector<const VVVdouble*> parentTProbs(nbParentNeighbors);
   for (size_t k = 0; k < nbParentNeighbors; k++)
   {
     const Node* n = parentNeighbors[k]; // This neighbor
-    parentArrays[k] = &parentData->getLikelihoodArrayForNeighbor(n->getId());
+    parentArrays[k] = &parentData->getLikelihoodBufferForNeighbor(n->getId());
     // if(n != grandFather) parentTProbs[k] = & pxy_[n->getId()];
     // else                 parentTProbs[k] = & pxy_[parent->getId()];
-    parentTProbs[k] = &pxy_[n->getId()];
+    parentTProbs[k] = getTransitionProbabilitiesForNode_(n->getId());
   }
 
   const DRASDRTreeLikelihoodNodeData* grandFatherData = &getLikelihoodData()->getNodeData(grandFather->getId());
-  const VVVdouble* uncleArray      = &grandFatherData->getLikelihoodArrayForNeighbor(uncle->getId());
+  const LikelihoodArray* uncleArray      = &grandFatherData->getLikelihoodBufferForNeighbor(uncle->getId());
   vector<const Node*> grandFatherNeighbors = TreeTemplateTools::getRemainingNeighbors(grandFather, parent, uncle);
   size_t nbGrandFatherNeighbors = grandFatherNeighbors.size();
-  vector<const VVVdouble*> grandFatherArrays;
+  vector<const LikelihoodArray*> grandFatherArrays;
   vector<const VVVdouble*> grandFatherTProbs;
   for (size_t k = 0; k < nbGrandFatherNeighbors; k++)
   {
     const Node* n = grandFatherNeighbors[k]; // This neighbor
     if (grandFather->getFather() == NULL || n != grandFather->getFather())
     {
-      grandFatherArrays.push_back(&grandFatherData->getLikelihoodArrayForNeighbor(n->getId()));
-      grandFatherTProbs.push_back(&pxy_[n->getId()]);
+      grandFatherArrays.push_back(&grandFatherData->getLikelihoodBufferForNeighbor(n->getId()));
+      grandFatherTProbs.push_back(getTransitionProbabilitiesForNode_(n->getId()));
     }
   }
 
   // Compute array 1: grand father array
-  VVVdouble array1 = *sonArray;
+  LikelihoodArray array1 = *sonArray;
   resetLikelihoodArray(array1);
   grandFatherArrays.push_back(sonArray);
-  grandFatherTProbs.push_back(&pxy_[son->getId()]);
+  grandFatherTProbs.push_back(getTransitionProbabilitiesForNode_(son->getId()));
   if (grandFather->hasFather())
   {
-    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, &grandFatherData->getLikelihoodArrayForNeighbor(grandFather->getFather()->getId()), &pxy_[grandFather->getId()], array1, nbGrandFatherNeighbors, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, &grandFatherData->getLikelihoodBufferForNeighbor(grandFather->getFather()->getId()), getTransitionProbabilitiesForNode_(grandFather->getId()), array1, nbGrandFatherNeighbors, nbDistinctSites_, nbClasses_, nbStates_, false, nbThreads);
   }
   else
   {
-    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, array1, nbGrandFatherNeighbors + 1, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, array1, nbGrandFatherNeighbors + 1, nbDistinctSites_, nbClasses_, nbStates_, false, nbThreads);
 
     // This is the root node, we have to account for the ancestral frequencies:
     for (size_t i = 0; i < nbDistinctSites_; i++)
@@ -270,44 +379,50 @@ double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const throw (NodeExcept
       {
         for (size_t x = 0; x < nbStates_; x++)
         {
-          array1[i][j][x] *= rootFreqs_[x];
+          array1(i, j, x) *= rootFreqs_[x];
         }
       }
     }
   }
 
   // Compute array 2: parent array
-  VVVdouble array2 = *uncleArray;
+  LikelihoodArray array2 = *uncleArray;
   resetLikelihoodArray(array2);
   parentArrays.push_back(uncleArray);
-  parentTProbs.push_back(&pxy_[uncle->getId()]);
-  computeLikelihoodFromArrays(parentArrays, parentTProbs, array2, nbParentNeighbors + 1, nbDistinctSites_, nbClasses_, nbStates_, false);
+  parentTProbs.push_back(getTransitionProbabilitiesForNode_(uncle->getId()));
+  computeLikelihoodFromArrays(parentArrays, parentTProbs, array2, nbParentNeighbors + 1, nbDistinctSites_, nbClasses_, nbStates_, false, nbThreads);
+
+  if (scaling_)
+  {
+    LikelihoodKernels::rescaleConditionalLikelihoods(array1, nbThreads);
+    LikelihoodKernels::rescaleConditionalLikelihoods(array2, nbThreads);
+  }
 
   // Initialize BranchLikelihood:
-  brLikFunction_->initModel(model_, rateDistribution_);
-  brLikFunction_->initLikelihoods(&array1, &array2);
+  brLikFunction->initModel(model, rateDistribution);
+  brLikFunction->initLikelihoods(&array1, &array2);
   ParameterList parameters;
   size_t pos = 0;
   while (pos < nodes_.size() && nodes_[pos]->getId() != parent->getId()) pos++;
   if (pos == nodes_.size()) throw Exception("NNIHomogeneousTreeLikelihood::testNNI. Unvalid node id.");
-  Parameter brLen = getParameter("BrLen" + TextTools::toString(pos));
-  brLen.setName("BrLen");
-  parameters.addParameter(brLen);
-  brLikFunction_->setParameters(parameters);
+  Parameter brLenParam = getParameter("BrLen" + TextTools::toString(pos));
+  brLenParam.setName("BrLen");
+  parameters.addParameter(brLenParam);
+  brLikFunction->setParameters(parameters);
 
   // Re-estimate branch length:
-  brentOptimizer_->setFunction(brLikFunction_);
-  brentOptimizer_->getStopCondition()->setTolerance(0.1);
-  brentOptimizer_->setInitialInterval(brLen.getValue(), brLen.getValue() + 0.01);
-  brentOptimizer_->init(parameters);
-  brentOptimizer_->optimize();
-  // brLenNNIValues_[nodeId] = brLikFunction_->getParameterValue("BrLen");
-  brLenNNIValues_[nodeId] = brentOptimizer_->getParameters().getParameter("BrLen").getValue();
-  brLikFunction_->resetLikelihoods(); // Array1 and Array2 will be destroyed after this function call.
-                                      // We should not keep pointers towards them...
+  brentOptimizer->setFunction(brLikFunction);
+  brentOptimizer->getStopCondition()->setTolerance(0.1);
+  brentOptimizer->setInitialInterval(brLenParam.getValue(), brLenParam.getValue() + 0.01);
+  brentOptimizer->init(parameters);
+  brentOptimizer->optimize();
+  // brLen = brLikFunction->getParameterValue("BrLen");
+  brLen = brentOptimizer->getParameters().getParameter("BrLen").getValue();
+  brLikFunction->resetLikelihoods(); // Array1 and Array2 will be destroyed after this function call.
+                                     // We should not keep pointers towards them...
 
   // Return the resulting likelihood:
-  return brLikFunction_->getValue() - getValue();
+  return brLikFunction->getValue() - getValue();
 }
 
 /*******************************************************************************/
@@ -329,6 +444,7 @@ void NNIHomogeneousTreeLikelihood::doNNI(int nodeId) throw (NodeException)
   grandFather->removeSon(uncle);
   parent->addSon(uncle);
   grandFather->addSon(son);
+  flagAllNodesForUpdate();
   size_t pos = 0;
   while (pos < nodes_.size() && nodes_[pos]->getId() != parent->getId()) pos++;
   if (pos == nodes_.size()) throw Exception("NNIHomogeneousTreeLikelihood::doNNI. Unvalid node id.");
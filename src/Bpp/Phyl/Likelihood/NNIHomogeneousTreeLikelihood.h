@@ -64,7 +64,7 @@ class BranchLikelihood :
   public AbstractParametrizable
 {
 protected:
-  const VVVdouble* array1_, * array2_;
+  const LikelihoodArray* array1_, * array2_;
   const SubstitutionModel* model_;
   const DiscreteDistribution* rDist_;
   size_t nbStates_, nbClasses_;
@@ -127,7 +127,7 @@ public:
    * @warning No checking on alphabet size or number of rate classes is performed,
    * use with care!
    */
-  void initLikelihoods(const VVVdouble* array1, const VVVdouble* array2)
+  void initLikelihoods(const LikelihoodArray* array1, const LikelihoodArray* array2)
   {
     array1_ = array1;
     array2_ = array2;
@@ -262,6 +262,16 @@ public:
 
   double testNNI(int nodeId) const throw (NodeException);
 
+  /**
+   * @brief Test several NNIs.
+   *
+   * If more than one thread is allowed (see setNumberOfThreads), the NNIs are distributed over the threads,
+   * each of them computing the likelihood of a movement with its own copy of the model, of the BranchLikelihood function and of the optimizer.
+   * The conditional likelihood arrays of the current tree are only read.
+   * Otherwise, testNNI is called for each node.
+   */
+  std::vector<double> testNNIs(const std::vector<int>& nodeIds) const throw (NodeException);
+
   void doNNI(int nodeId) throw (NodeException);
 
   void topologyChangeTested(const TopologyChangeEvent& event)
@@ -277,6 +287,33 @@ public:
     brLenNNIValues_.clear();
   }
   /** @} */
+
+protected:
+  /**
+   * @brief Compute the score variation of a NNI with the given objects.
+   *
+   * @param nodeId         The id of the node defining the NNI movement.
+   * @param model          The substitution model to use for the tested branch.
+   * @param rateDistribution The rate distribution to use for the tested branch.
+   * @param brLikFunction  The function used to compute the likelihood of the tested branch.
+   * @param brentOptimizer The optimizer used to re-estimate the length of the tested branch.
+   * @param nbThreads      The number of threads used for computing conditional likelihoods.
+   * @param brLen          [out] The estimated length of the tested branch.
+   * @return The score variation of the NNI.
+   */
+  double testNNI_(
+    int nodeId,
+    const SubstitutionModel* model,
+    const DiscreteDistribution* rateDistribution,
+    BranchLikelihood* brLikFunction,
+    BrentOneDimension* brentOptimizer,
+    size_t nbThreads,
+    double& brLen) const throw (NodeException);
+
+  const VVVdouble* getTransitionProbabilitiesForNode_(int nodeId) const
+  {
+    return &pxy_.find(nodeId)->second;
+  }
 };
 } // end of namespace bpp.
 
@@ -37,6 +37,7 @@
  */
 
 #include "RHomogeneousMixedTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 
 
 // From the STL:
@@ -59,19 +60,10 @@ RHomogeneousMixedTreeLikelihood::RHomogeneousMixedTreeLikelihood(
   bool verbose,
   bool usePatterns) throw (Exception) :
   RHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose, usePatterns),
-  treeLikelihoodsContainer_(),
-  probas_()
+  probas_(),
+  componentsFreqs_()
 {
-  MixedSubstitutionModel* mixedmodel;
-  if ((mixedmodel = dynamic_cast<MixedSubstitutionModel*>(model_)) == 0)
-    throw Exception("Bad model: RHomogeneousMixedTreeLikelihood needs a MixedSubstitutionModel.");
-  size_t s = mixedmodel->getNumberOfModels();
-  for (size_t i = 0; i < s; i++)
-  {
-    treeLikelihoodsContainer_.push_back(
-      new RHomogeneousTreeLikelihood(tree, mixedmodel->getNModel(i), rDist, checkRooted, false, usePatterns));
-    probas_.push_back(mixedmodel->getNProbability(i));
-  }
+  init_(usePatterns);
 }
 
 RHomogeneousMixedTreeLikelihood::RHomogeneousMixedTreeLikelihood(
@@ -83,134 +75,73 @@ RHomogeneousMixedTreeLikelihood::RHomogeneousMixedTreeLikelihood(
   bool verbose,
   bool usePatterns) throw (Exception) :
   RHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose, usePatterns),
-  treeLikelihoodsContainer_(),
-  probas_()
+  probas_(),
+  componentsFreqs_()
 {
-  MixedSubstitutionModel* mixedmodel;
+  init_(usePatterns);
+  setData(data);
+}
 
+void RHomogeneousMixedTreeLikelihood::init_(bool usePatterns) throw (Exception)
+{
+  MixedSubstitutionModel* mixedmodel;
   if ((mixedmodel = dynamic_cast<MixedSubstitutionModel*>(model_)) == 0)
     throw Exception("Bad model: RHomogeneousMixedTreeLikelihood needs a MixedSubstitutionModel.");
-
   size_t s = mixedmodel->getNumberOfModels();
   for (size_t i = 0; i < s; i++)
   {
-    treeLikelihoodsContainer_.push_back(
-      new RHomogeneousTreeLikelihood(tree, mixedmodel->getNModel(i), rDist, checkRooted, false, usePatterns));
     probas_.push_back(mixedmodel->getNProbability(i));
+    componentsFreqs_.push_back(mixedmodel->getNModel(i)->getFrequencies());
   }
-  setData(data);
+
+  // One class in the likelihood arrays for each component and each rate class:
+  delete likelihoodData_;
+  likelihoodData_ = new DRASRTreeLikelihoodData(tree_, s * nbClasses_, usePatterns);
 }
 
 RHomogeneousMixedTreeLikelihood& RHomogeneousMixedTreeLikelihood::operator=(const RHomogeneousMixedTreeLikelihood& lik)
 {
   RHomogeneousTreeLikelihood::operator=(lik);
-
-  treeLikelihoodsContainer_.clear();
-  probas_.clear();
-
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_.push_back(lik.treeLikelihoodsContainer_[i]->clone());
-    probas_.push_back(lik.probas_[i]);
-  }
-
+  probas_          = lik.probas_;
+  componentsFreqs_ = lik.componentsFreqs_;
   return *this;
 }
 
 
 RHomogeneousMixedTreeLikelihood::RHomogeneousMixedTreeLikelihood(const RHomogeneousMixedTreeLikelihood& lik) :
   RHomogeneousTreeLikelihood(lik),
-  treeLikelihoodsContainer_(lik.treeLikelihoodsContainer_.size()),
-  probas_(lik.probas_.size())
-{
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i] = lik.treeLikelihoodsContainer_[i]->clone();
-    probas_.push_back(lik.probas_[i]);
-  }
-}
-
-RHomogeneousMixedTreeLikelihood::~RHomogeneousMixedTreeLikelihood()
-{
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    delete treeLikelihoodsContainer_[i];
-  }
-}
-
-
-void RHomogeneousMixedTreeLikelihood::initialize() throw (Exception)
-{
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->initialize();
-  }
-  
-  RHomogeneousTreeLikelihood::initialize();
-}
-
-void RHomogeneousMixedTreeLikelihood::setData(const SiteContainer& sites) throw (Exception)
-{
-  RHomogeneousTreeLikelihood::setData(sites);
-
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->setData(sites);
-  }
-}
+  probas_(lik.probas_),
+  componentsFreqs_(lik.componentsFreqs_)
+{}
 
-
-void RHomogeneousMixedTreeLikelihood::fireParameterChanged(const ParameterList& params)
-{
-  // checks in the model will change
-  bool modelC=model_->getParameters().testParametersValues(params);
-
-  applyParameters();
-  MixedSubstitutionModel* mixedmodel = dynamic_cast<MixedSubstitutionModel*>(model_);
-  size_t s = mixedmodel->getNumberOfModels();
-
-  const SubstitutionModel* pm;
-  for (size_t i = 0; i < s; i++)
-  {
-    ParameterList pl;
-    pm = mixedmodel->getNModel(i);
-    pl.addParameters(pm->getParameters());
-    pl.includeParameters(getParameters());
-
-    if (modelC){
-      treeLikelihoodsContainer_[i]->setParameters(pl);
-    }
-    else
-      treeLikelihoodsContainer_[i]->matchParametersValues(pl);
-  }
-  
-  probas_ = mixedmodel->getProbabilities();
-  minusLogLik_ = -getLogLikelihood();
-}
-
-void RHomogeneousMixedTreeLikelihood::computeTreeLikelihood()
-{
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->computeTreeLikelihood();
-  }
-}
+RHomogeneousMixedTreeLikelihood::~RHomogeneousMixedTreeLikelihood() {}
 
 /******************************************************************************
  *                                   Likelihoods                              *
  ******************************************************************************/
-double RHomogeneousMixedTreeLikelihood::getLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
+double RHomogeneousMixedTreeLikelihood::averageOverComponents_(const VVVdouble& array, size_t site, size_t rateClass) const
 {
+  const VVdouble* array_i = &array[likelihoodData_->getRootArrayPosition(site)];
   double res = 0;
-
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  for (size_t m = 0; m < probas_.size(); m++)
   {
-    res += treeLikelihoodsContainer_[i]->getLikelihoodForASiteForARateClass(site, rateClass) * probas_[i];
+    const Vdouble* array_i_c = &(*array_i)[m * nbClasses_ + rateClass];
+    const Vdouble* freqs_m = &componentsFreqs_[m];
+    double l = 0;
+    for (size_t x = 0; x < nbStates_; x++)
+    {
+      l += (*array_i_c)[x] * (*freqs_m)[x];
+    }
+    res += l * probas_[m];
   }
-
   return res;
 }
 
+double RHomogeneousMixedTreeLikelihood::getLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
+{
+  return averageOverComponents_(likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId()), site, rateClass);
+}
+
 double RHomogeneousMixedTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
 {
   double x = getLikelihoodForASiteForARateClass(site, rateClass);
@@ -221,11 +152,11 @@ double RHomogeneousMixedTreeLikelihood::getLogLikelihoodForASiteForARateClass(si
 
 double RHomogeneousMixedTreeLikelihood::getLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
+  const VVdouble* la = &likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)];
   double res = 0;
-
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  for (size_t m = 0; m < probas_.size(); m++)
   {
-    res += treeLikelihoodsContainer_[i]->getLikelihoodForASiteForARateClassForAState(site, rateClass, state) * probas_[i];
+    res += (*la)[m * nbClasses_ + rateClass][static_cast<size_t>(state)] * probas_[m];
   }
 
   return res;
@@ -245,22 +176,7 @@ double RHomogeneousMixedTreeLikelihood::getLogLikelihoodForASiteForARateClassFor
 ******************************************************************************/
 double RHomogeneousMixedTreeLikelihood::getDLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
 {
-  double res = 0;
-
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    res += treeLikelihoodsContainer_[i]->getDLikelihoodForASiteForARateClass(site, rateClass) * probas_[i];
-  }
-
-  return res;
-}
-
-void RHomogeneousMixedTreeLikelihood::computeTreeDLikelihood(const string& variable)
-{
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->computeTreeDLikelihood(variable);
-  }
+  return averageOverComponents_(likelihoodData_->getDLikelihoodArray(tree_->getRootNode()->getId()), site, rateClass);
 }
 
 /******************************************************************************
@@ -268,72 +184,84 @@ void RHomogeneousMixedTreeLikelihood::computeTreeDLikelihood(const string& varia
 ******************************************************************************/
 double RHomogeneousMixedTreeLikelihood::getD2LikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
 {
-  double res = 0;
-
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    res += treeLikelihoodsContainer_[i]->getD2LikelihoodForASiteForARateClass(site, rateClass) * probas_[i];
-  }
-
-  return res;
-}
-
-
-void RHomogeneousMixedTreeLikelihood::computeTreeD2Likelihood(const string& variable)
-{
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->computeTreeD2Likelihood(variable);
-  }
-}
-
-void RHomogeneousMixedTreeLikelihood::computeSubtreeLikelihood(const Node* node)
-{
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->computeSubtreeLikelihood(node);
-  }
-}
-
-void RHomogeneousMixedTreeLikelihood::computeDownSubtreeDLikelihood(const Node* node)
-{
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->computeDownSubtreeDLikelihood(node);
-  }
-}
-
-void RHomogeneousMixedTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* node)
-{
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->computeDownSubtreeD2Likelihood(node);
-  }
+  return averageOverComponents_(likelihoodData_->getD2LikelihoodArray(tree_->getRootNode()->getId()), site, rateClass);
 }
 
+/******************************************************************************/
 
 void RHomogeneousMixedTreeLikelihood::computeAllTransitionProbabilities()
 {
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  // Component probabilities and frequencies only change with model parameters:
+  MixedSubstitutionModel* mixedmodel = dynamic_cast<MixedSubstitutionModel*>(model_);
+  for (size_t m = 0; m < probas_.size(); m++)
   {
-    treeLikelihoodsContainer_[i]->computeAllTransitionProbabilities();
+    probas_[m] = mixedmodel->getNProbability(m);
+    componentsFreqs_[m] = mixedmodel->getNModel(m)->getFrequencies();
   }
+  RHomogeneousTreeLikelihood::computeAllTransitionProbabilities();
 }
 
 
 void RHomogeneousMixedTreeLikelihood::computeTransitionProbabilitiesForNode(const Node* node)
 {
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  MixedSubstitutionModel* mixedmodel = dynamic_cast<MixedSubstitutionModel*>(model_);
+  double l = node->getDistanceToFather();
+  vector<double> times(nbClasses_);
+  for (size_t c = 0; c < nbClasses_; c++)
   {
-    treeLikelihoodsContainer_[i]->computeTransitionProbabilitiesForNode(node);
+    times[c] = l * rateDistribution_->getCategory(c);
   }
-}
 
-
-void RHomogeneousMixedTreeLikelihood::displayLikelihood(const Node* node)
-{
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  size_t nbModels = probas_.size();
+  VVVdouble* pxy__node   = &pxy_[node->getId()];
+  VVVdouble* dpxy__node  = computeFirstOrderDerivatives_  ? &dpxy_[node->getId()]  : 0;
+  VVVdouble* d2pxy__node = computeSecondOrderDerivatives_ ? &d2pxy_[node->getId()] : 0;
+  pxy__node->resize(nbModels * nbClasses_);
+  if (dpxy__node) dpxy__node->resize(nbModels * nbClasses_);
+  if (d2pxy__node) d2pxy__node->resize(nbModels * nbClasses_);
+
+  // Each component has its own model object, so that components can be computed concurrently:
+  long nbModelsL = static_cast<long>(nbModels);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads_)) if(nbThreads_ > 1)
+#endif
+  for (long lm = 0; lm < nbModelsL; lm++)
   {
-    treeLikelihoodsContainer_[i]->displayLikelihood(node);
+    size_t m = static_cast<size_t>(lm);
+    VVVdouble pxy_m, dpxy_m, d2pxy_m;
+    mixedmodel->getNModel(m)->getTransitionProbabilities(times, pxy_m, dpxy__node ? &dpxy_m : 0, d2pxy__node ? &d2pxy_m : 0);
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      size_t k = m * nbClasses_ + c;
+      (*pxy__node)[k].swap(pxy_m[c]);
+
+      // Derivatives are computed with respect to l * rc:
+      double rc = rateDistribution_->getCategory(c);
+      if (dpxy__node)
+      {
+        (*dpxy__node)[k].swap(dpxy_m[c]);
+        for (size_t x = 0; x < nbStates_; x++)
+        {
+          Vdouble* dpxy__node_k_x = &(*dpxy__node)[k][x];
+          for (size_t y = 0; y < nbStates_; y++)
+          {
+            (*dpxy__node_k_x)[y] *= rc;
+          }
+        }
+      }
+      if (d2pxy__node)
+      {
+        (*d2pxy__node)[k].swap(d2pxy_m[c]);
+        for (size_t x = 0; x < nbStates_; x++)
+        {
+          Vdouble* d2pxy__node_k_x = &(*d2pxy__node)[k][x];
+          for (size_t y = 0; y < nbStates_; y++)
+          {
+            (*d2pxy__node_k_x)[y] *= rc * rc;
+          }
+        }
+      }
+    }
   }
+  LikelihoodKernels::packTransitionProbabilities(*pxy__node, packedPxy_[node->getId()]);
 }
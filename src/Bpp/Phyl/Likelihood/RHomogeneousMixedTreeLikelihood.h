@@ -55,14 +55,26 @@ namespace bpp
  *
  * In all the calculs, the average of the likelihoods, probabilities
  * are computed.
+ *
+ * All mixture components share the same tree and the same likelihood arrays:
+ * components are an extra dimension of the conditional likelihood arrays,
+ * like rate classes, so that the tree is traversed only once for all components.
+ * Class k of the arrays stands for component k / n and rate class k % n, where n is the number of rate classes,
+ * so that getLikelihoodData() returns arrays with (number of components * number of rate classes) classes.
+ * Sites are split between threads during the traversal (see setNumberOfThreads()),
+ * and the transition probabilities of the components are computed in parallel.
  **/
 
 class RHomogeneousMixedTreeLikelihood :
   public RHomogeneousTreeLikelihood
 {
 private:
-  std::vector<RHomogeneousTreeLikelihood*> treeLikelihoodsContainer_;
   std::vector<double> probas_;
+
+  /**
+   * @brief The equilibrium frequencies of each component, used at the root.
+   */
+  VVdouble componentsFreqs_;
   
 public:
   /**
@@ -124,22 +136,26 @@ public:
 
   RHomogeneousMixedTreeLikelihood* clone() const { return new RHomogeneousMixedTreeLikelihood(*this); }
 
+private:
+  void init_(bool usePatterns) throw (Exception);
+
 public:
   /**
-   * @name The TreeLikelihood interface.
+   * @brief Scaling is not supported for mixture models.
    *
-   * Other methods are implemented in the RHomogeneousTreeLikelihood class.
-   *
-   * @{
+   * @throw Exception if yn is true.
    */
-  void setData(const SiteContainer& sites) throw (Exception);
-
-  /** @} */
-
+  void enableScaling(bool yn)
+  {
+    if (yn) throw Exception("RHomogeneousMixedTreeLikelihood::enableScaling. Scaling is not supported for mixture models.");
+  }
 
+public:
   /**
    * @name The DiscreteRatesAcrossSites interface implementation:
    *
+   * Likelihoods are averaged over the mixture components.
+   *
    * @{
    */
   double getLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const;
@@ -150,62 +166,41 @@ public:
 
 public:
   // Specific methods:
-  void initialize() throw (Exception);
-
-  void fireParameterChanged(const ParameterList& params);
 
-  void computeTreeLikelihood();
+  /**
+   * @return The number of components of the mixed model.
+   */
+  size_t getNumberOfComponents() const { return probas_.size(); }
 
   virtual double getDLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const;
 
-  virtual void computeTreeDLikelihood(const std::string& variable);
-
   virtual double getD2LikelihoodForASiteForARateClass(size_t site, size_t rateClass) const;
 
-  virtual void computeTreeD2Likelihood(const std::string& variable);
-
 protected:
-  /**
-   * @brief Compute the likelihood for a subtree defined by the Tree::Node <i>node</i>.
-   *
-   * @param node The root of the subtree.
-   */
-  virtual void computeSubtreeLikelihood(const Node* node); // Recursive method.
-
-  virtual void computeDownSubtreeDLikelihood(const Node*);
-
-  virtual void computeDownSubtreeD2Likelihood(const Node*);
-
   /**
    * @brief This method is used by fireParameterChanged method.
    *
+   * Also updates the probabilities and equilibrium frequencies of the components.
    */
   void computeAllTransitionProbabilities();
   /**
    * @brief This method is used by fireParameterChanged method.
    *
+   * Fill the arrays of all components and rate classes for the branch of a node.
    */
   void computeTransitionProbabilitiesForNode(const Node* node);
 
+private:
   /**
-   * @brief This method is mainly for debugging purpose.
+   * @brief Average the root arrays of all components for a site and a rate class.
    *
-   * @param node The node at which likelihood values must be displayed.
+   * @param array     The root array to use (likelihoods or their derivatives).
+   * @param site      The site index.
+   * @param rateClass The rate class index.
+   * @return The average over components of the array weighted by the component frequencies.
    */
-  virtual void displayLikelihood(const Node* node);
-
-  virtual void setMinimumBranchLength(double brlen) throw (Exception) {
-    RHomogeneousMixedTreeLikelihood::setMinimumBranchLength(brlen);
-    for (size_t i = 0; i < treeLikelihoodsContainer_.size(); ++i)
-      treeLikelihoodsContainer_[i]->setMinimumBranchLength(brlen);
-  }
-  virtual void setMaximumBranchLength(double brlen) throw (Exception) {
-    RHomogeneousMixedTreeLikelihood::setMaximumBranchLength(brlen);
-    for (size_t i = 0; i < treeLikelihoodsContainer_.size(); ++i)
-      treeLikelihoodsContainer_[i]->setMaximumBranchLength(brlen);
-  }
+  double averageOverComponents_(const VVVdouble& array, size_t site, size_t rateClass) const;
 };
 } // end of namespace bpp.
 
 #endif  // _RHOMOGENEOUSMIXEDTREELIKELIHOOD_H_
-
@@ -38,6 +38,7 @@
  */
 
 #include "RHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -62,7 +63,9 @@ RHomogeneousTreeLikelihood::RHomogeneousTreeLikelihood(
 throw (Exception) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
-  minusLogLik_(-1.)
+  minusLogLik_(-1.),
+  packedPxy_(),
+  product_()
 {
   init_(usePatterns);
 }
@@ -80,7 +83,9 @@ RHomogeneousTreeLikelihood::RHomogeneousTreeLikelihood(
 throw (Exception) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
-  minusLogLik_(-1.)
+  minusLogLik_(-1.),
+  packedPxy_(),
+  product_()
 {
   init_(usePatterns);
   setData(data);
@@ -102,7 +107,9 @@ RHomogeneousTreeLikelihood::RHomogeneousTreeLikelihood(
   const RHomogeneousTreeLikelihood& lik) :
   AbstractHomogeneousTreeLikelihood(lik),
   likelihoodData_(0),
-  minusLogLik_(lik.minusLogLik_)
+  minusLogLik_(lik.minusLogLik_),
+  packedPxy_(lik.packedPxy_),
+  product_()
 {
   likelihoodData_ = dynamic_cast<DRASRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
@@ -118,6 +125,7 @@ RHomogeneousTreeLikelihood& RHomogeneousTreeLikelihood::operator=(
   likelihoodData_ = dynamic_cast<DRASRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
   minusLogLik_ = lik.minusLogLik_;
+  packedPxy_ = lik.packedPxy_;
   return *this;
 }
 
@@ -145,6 +153,7 @@ void RHomogeneousTreeLikelihood::setData(const SiteContainer& sites) throw (Exce
   if (verbose_) ApplicationTools::displayResult("Number of distinct sites",
                                                 TextTools::toString(nbDistinctSites_));
   initialized_ = false;
+  flagAllNodesForUpdate();
 }
 
 /******************************************************************************/
@@ -194,6 +203,15 @@ double RHomogeneousTreeLikelihood::getLikelihoodForASite(size_t site) const
 double RHomogeneousTreeLikelihood::getLogLikelihoodForASite(size_t site) const
 {
   double l = 0;
+  if (scaling_)
+  {
+    for (size_t i = 0; i < nbClasses_; i++)
+    {
+      double li = getScaledLikelihoodForASiteForARateClass_(site, i) * rateDistribution_->getProbability(i);
+      if (li > 0) l+= li; //Corrects for numerical instabilities leading to slightly negative likelihoods
+    }
+    return log(l) + getLogScalingFactorForASite(site);
+  }
   for (size_t i = 0; i < nbClasses_; i++)
   {
     double li = getLikelihoodForASiteForARateClass(site, i) * rateDistribution_->getProbability(i);
@@ -204,13 +222,12 @@ double RHomogeneousTreeLikelihood::getLogLikelihoodForASite(size_t site) const
 
 /******************************************************************************/
 
-double RHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
+double RHomogeneousTreeLikelihood::getScaledLikelihoodForASiteForARateClass_(size_t site, size_t rateClass) const
 {
   double l = 0;
   Vdouble* la = &likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass];
   for (size_t i = 0; i < nbStates_; i++)
   {
-    //cout << (*la)[i] << "\t" << rootFreqs_[i] << endl;
     double li = (*la)[i] * rootFreqs_[i];
     if (li > 0) l+= li; //Corrects for numerical instabilities leading to slightly negative likelihoods
   }
@@ -219,6 +236,22 @@ double RHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClass(size_t sit
 
 /******************************************************************************/
 
+double RHomogeneousTreeLikelihood::getLogScalingFactorForASite(size_t site) const
+{
+  return likelihoodData_->getLogScalingFactors(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)];
+}
+
+/******************************************************************************/
+
+double RHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
+{
+  double l = getScaledLikelihoodForASiteForARateClass_(site, rateClass);
+  if (scaling_) l *= exp(getLogScalingFactorForASite(site));
+  return l;
+}
+
+/******************************************************************************/
+
 double RHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
 {
   double l = 0;
@@ -228,6 +261,7 @@ double RHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t
     l += (*la)[i] * rootFreqs_[i];
   }
   //if(l <= 0.) cerr << "WARNING!!! Negative likelihood." << endl;
+  if (scaling_) return log(l) + getLogScalingFactorForASite(site);
   return log(l);
 }
 
@@ -235,14 +269,18 @@ double RHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t
 
 double RHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  double l = likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  if (scaling_) l *= exp(getLogScalingFactorForASite(site));
+  return l;
 }
 
 /******************************************************************************/
 
 double RHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return log(likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)]);
+  double ll = log(likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)]);
+  if (scaling_) ll += getLogScalingFactorForASite(site);
+  return ll;
 }
 
 /******************************************************************************/
@@ -274,7 +312,9 @@ void RHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& param
       if (s.substr(0, 5) == "BrLen")
       {
         //Branch length parameter:
-        computeTransitionProbabilitiesForNode(nodes_[TextTools::to<size_t>(s.substr(5))]);
+        const Node* node = nodes_[TextTools::to<size_t>(s.substr(5))];
+        computeTransitionProbabilitiesForNode(node);
+        flagBranchForUpdate(node);
       }
     }
     rootFreqs_ = model_->getFrequencies();
@@ -287,6 +327,14 @@ void RHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& param
 
 /******************************************************************************/
 
+void RHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(const Node* node)
+{
+  AbstractHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(node);
+  LikelihoodKernels::packTransitionProbabilities(pxy_[node->getId()], packedPxy_[node->getId()]);
+}
+
+/******************************************************************************/
+
 double RHomogeneousTreeLikelihood::getValue() const
 throw (Exception)
 {
@@ -308,6 +356,7 @@ double RHomogeneousTreeLikelihood::getDLikelihoodForASiteForARateClass(
   {
     dl += (*dla)[i] * rootFreqs_[i];
   }
+  if (scaling_) dl *= exp(getLogScalingFactorForASite(site));
   return dl;
 }
 
@@ -328,6 +377,24 @@ double RHomogeneousTreeLikelihood::getDLikelihoodForASite(size_t site) const
 
 double RHomogeneousTreeLikelihood::getDLogLikelihoodForASite(size_t site) const
 {
+  if (scaling_)
+  {
+    // Likelihoods and derivatives share the same scaling factor, which cancels out:
+    size_t pos = likelihoodData_->getRootArrayPosition(site);
+    VVdouble* la = &likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[pos];
+    VVdouble* dla = &likelihoodData_->getDLikelihoodArray(tree_->getRootNode()->getId())[pos];
+    double l = 0, dl = 0;
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      double p = rateDistribution_->getProbability(c);
+      for (size_t x = 0; x < nbStates_; x++)
+      {
+        l  += (*la)[c][x]  * rootFreqs_[x] * p;
+        dl += (*dla)[c][x] * rootFreqs_[x] * p;
+      }
+    }
+    return dl / l;
+  }
   // d(f(g(x)))/dx = dg(x)/dx . df(g(x))/dg :
   return getDLikelihoodForASite(site) / getLikelihoodForASite(site);
 }
@@ -378,10 +445,11 @@ void RHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variable)
   // Compute dLikelihoods array for the father node.
   // Fist initialize to 1:
   size_t nbSites  = _dLikelihoods_father->size();
+  size_t nbClasses = likelihoodData_->getNumberOfClasses();
   for (size_t i = 0; i < nbSites; i++)
   {
     VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t c = 0; c < nbClasses; c++)
     {
       Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
       for (size_t s = 0; s < nbStates_; s++)
@@ -406,7 +474,7 @@ void RHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variable)
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t c = 0; c < nbClasses; c++)
         {
           Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
           Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
@@ -431,7 +499,7 @@ void RHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variable)
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t c = 0; c < nbClasses; c++)
         {
           Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
           Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
@@ -451,6 +519,9 @@ void RHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variable)
     }
   }
 
+  if (scaling_)
+    applyLocalScalingFactors_(father->getId(), *_dLikelihoods_father);
+
   // Now we go down the tree toward the root node:
   computeDownSubtreeDLikelihood(father);
 }
@@ -468,10 +539,11 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* node)
   // Fist initialize to 1:
   VVVdouble* _dLikelihoods_father = &likelihoodData_->getDLikelihoodArray(father->getId());
   size_t nbSites  = _dLikelihoods_father->size();
+  size_t nbClasses = likelihoodData_->getNumberOfClasses();
   for (size_t i = 0; i < nbSites; i++)
   {
     VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t c = 0; c < nbClasses; c++)
     {
       Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
       for (size_t s = 0; s < nbStates_; s++)
@@ -496,7 +568,7 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* node)
       {
         VVdouble* _dLikelihoods_son_i = &(*_dLikelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t c = 0; c < nbClasses; c++)
         {
           Vdouble* _dLikelihoods_son_i_c = &(*_dLikelihoods_son_i)[c];
           Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
@@ -521,7 +593,7 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* node)
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t c = 0; c < nbClasses; c++)
         {
           Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
           Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
@@ -541,6 +613,9 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* node)
     }
   }
 
+  if (scaling_)
+    applyLocalScalingFactors_(father->getId(), *_dLikelihoods_father);
+
   //Next step: move toward grand father...
   computeDownSubtreeDLikelihood(father);
 }
@@ -559,6 +634,7 @@ double RHomogeneousTreeLikelihood::getD2LikelihoodForASiteForARateClass(
   {
     d2l += (*d2la)[i] * rootFreqs_[i];
   }
+  if (scaling_) d2l *= exp(getLogScalingFactorForASite(site));
   return d2l;
 }
 
@@ -579,6 +655,26 @@ double RHomogeneousTreeLikelihood::getD2LikelihoodForASite(size_t site) const
 
 double RHomogeneousTreeLikelihood::getD2LogLikelihoodForASite(size_t site) const
 {
+  if (scaling_)
+  {
+    // Likelihoods and derivatives share the same scaling factor, which cancels out:
+    size_t pos = likelihoodData_->getRootArrayPosition(site);
+    VVdouble* la = &likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[pos];
+    VVdouble* dla = &likelihoodData_->getDLikelihoodArray(tree_->getRootNode()->getId())[pos];
+    VVdouble* d2la = &likelihoodData_->getD2LikelihoodArray(tree_->getRootNode()->getId())[pos];
+    double l = 0, dl = 0, d2l = 0;
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      double p = rateDistribution_->getProbability(c);
+      for (size_t x = 0; x < nbStates_; x++)
+      {
+        l   += (*la)[c][x]   * rootFreqs_[x] * p;
+        dl  += (*dla)[c][x]  * rootFreqs_[x] * p;
+        d2l += (*d2la)[c][x] * rootFreqs_[x] * p;
+      }
+    }
+    return d2l / l - pow(dl / l, 2);
+  }
   return getD2LikelihoodForASite(site) / getLikelihoodForASite(site)
          - pow( getDLikelihoodForASite(site) / getLikelihoodForASite(site), 2);
 }
@@ -629,10 +725,11 @@ void RHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variable)
   // Fist initialize to 1:
   VVVdouble* _d2Likelihoods_father = &likelihoodData_->getD2LikelihoodArray(father->getId());
   size_t nbSites  = _d2Likelihoods_father->size();
+  size_t nbClasses = likelihoodData_->getNumberOfClasses();
   for (size_t i = 0; i < nbSites; i++)
   {
     VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t c = 0; c < nbClasses; c++)
     {
       Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
       for (size_t s = 0; s < nbStates_; s++)
@@ -657,7 +754,7 @@ void RHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variable)
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t c = 0; c < nbClasses; c++)
         {
           Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
           Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
@@ -682,7 +779,7 @@ void RHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variable)
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t c = 0; c < nbClasses; c++)
         {
           Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
           Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
@@ -702,6 +799,9 @@ void RHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variable)
     }
   }
 
+  if (scaling_)
+    applyLocalScalingFactors_(father->getId(), *_d2Likelihoods_father);
+
   // Now we go down the tree toward the root node:
   computeDownSubtreeD2Likelihood(father);
 }
@@ -719,10 +819,11 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* node
   // Fist initialize to 1:
   VVVdouble* _d2Likelihoods_father = &likelihoodData_->getD2LikelihoodArray(father->getId());
   size_t nbSites  = _d2Likelihoods_father->size();
+  size_t nbClasses = likelihoodData_->getNumberOfClasses();
   for (size_t i = 0; i < nbSites; i++)
   {
     VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t c = 0; c < nbClasses; c++)
     {
       Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
       for (size_t s = 0; s < nbStates_; s++)
@@ -747,7 +848,7 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* node
       {
         VVdouble* _d2Likelihoods_son_i = &(*_d2Likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t c = 0; c < nbClasses; c++)
         {
           Vdouble* _d2Likelihoods_son_i_c = &(*_d2Likelihoods_son_i)[c];
           Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
@@ -772,7 +873,7 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* node
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t c = 0; c < nbClasses; c++)
         {
           Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
           Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
@@ -792,15 +893,42 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* node
     }
   }
 
+  if (scaling_)
+    applyLocalScalingFactors_(father->getId(), *_d2Likelihoods_father);
+
   //Next step: move toward grand father...
   computeDownSubtreeD2Likelihood(father);
 }
 
 /******************************************************************************/
 
+void RHomogeneousTreeLikelihood::applyLocalScalingFactors_(int nodeId, VVVdouble& array) const
+{
+  // Put the array on the same scale as the likelihoods of the node:
+  const Vdouble* _localScales_node = &likelihoodData_->getLocalLogScalingFactors(nodeId);
+  size_t nbSites = array.size();
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    if ((*_localScales_node)[i] == 0.) continue;
+    double f = exp(-(*_localScales_node)[i]);
+    VVdouble* array_i = &array[i];
+    for (size_t c = 0; c < array_i->size(); c++)
+    {
+      Vdouble* array_i_c = &(*array_i)[c];
+      for (size_t s = 0; s < array_i_c->size(); s++)
+      {
+        (*array_i_c)[s] *= f;
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
 void RHomogeneousTreeLikelihood::computeTreeLikelihood()
 {
   computeSubtreeLikelihood(tree_->getRootNode());
+  resetUpdateFlags();
 }
 
 /******************************************************************************/
@@ -810,62 +938,53 @@ void RHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
   if (node->isLeaf()) return;
 
   size_t nbSites = likelihoodData_->getLikelihoodArray(node->getId()).size();
+  size_t nbClasses = likelihoodData_->getNumberOfClasses();
   size_t nbNodes = node->getNumberOfSons();
 
-  // Must reset the likelihood array first (i.e. set all of them to 1):
   VVVdouble* _likelihoods_node = &likelihoodData_->getLikelihoodArray(node->getId());
+  Vdouble* _scales_node = &likelihoodData_->getLogScalingFactors(node->getId());
+  Vdouble* _localScales_node = &likelihoodData_->getLocalLogScalingFactors(node->getId());
   for (size_t i = 0; i < nbSites; i++)
   {
-    //For each site in the sequence,
-    VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      //For each rate classe,
-      Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        //For each initial state,
-        (*_likelihoods_node_i_c)[x] = 1.;
-      }
-    }
+    (*_scales_node)[i] = 0.;
+  }
+
+  //Only the subtrees containing modified branches need to be recomputed.
+  //This is done first, as all nodes share the same scratch array for products:
+  for (size_t l = 0; l < nbNodes; l++)
+  {
+    const Node* son = node->getSon(l);
+    if (isUpdateNeededBelow(son))
+      computeSubtreeLikelihood(son); //Recursive method:
   }
 
+  // Products are computed in a contiguous array, so that each son is processed
+  // with a single kernel call over all sites and rate classes:
+  product_.resize(nbSites, nbClasses, nbStates_);
+  product_.fill(1.);
   for (size_t l = 0; l < nbNodes; l++)
   {
     //For each son node,
 
     const Node* son = node->getSon(l);
 
-    computeSubtreeLikelihood(son); //Recursive method:
-
-    VVVdouble* pxy__son = &pxy_[son->getId()];
     vector<size_t> * _patternLinks_node_son = &likelihoodData_->getArrayPositions(node->getId(), son->getId());
     VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
+    Vdouble* _scales_son = &likelihoodData_->getLogScalingFactors(son->getId());
 
+    LikelihoodKernels::multiplyConditionalLikelihoods(packedPxy_[son->getId()], *_likelihoods_son, *_patternLinks_node_son, product_, nbThreads_);
     for (size_t i = 0; i < nbSites; i++)
     {
-      //For each site in the sequence,
-      VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_node_son)[i]];
-      VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        //For each rate classe,
-        Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-        Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-        VVdouble* pxy__son_c = &(*pxy__son)[c];
-        for (size_t x = 0; x < nbStates_; x++)
-        {
-          //For each initial state,
-          Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates_; y++)
-            likelihood += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
-          
-          (*_likelihoods_node_i_c)[x] *= likelihood;
-        }
-      }
+      (*_scales_node)[i] += (*_scales_son)[(*_patternLinks_node_son)[i]];
     }
   }
+  product_.copyTo(*_likelihoods_node);
+
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    (*_localScales_node)[i] = scaling_ ? rescaleLikelihoods((*_likelihoods_node)[i]) : 0.;
+    (*_scales_node)[i] += (*_localScales_node)[i];
+  }
 }
 
 /******************************************************************************/
@@ -43,6 +43,7 @@
 #include "AbstractHomogeneousTreeLikelihood.h"
 #include "../Model/SubstitutionModel.h"
 #include "DRASRTreeLikelihoodData.h"
+#include "LikelihoodArray.h"
 
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/Prob/DiscreteDistribution.h>
@@ -78,6 +79,9 @@ namespace bpp
    *   Patterns are hence usefull when you have a high number of computation to perform, while optimizing numerical
    *   parameters for instance).
    * - Patterns are more likely to occur whith small alphabet (nucleotides).
+   *
+   * When scaling is enabled (see enableScaling()), conditional likelihoods are rescaled at each node
+   * and the log scaling factors are stored in the DRASRTreeLikelihoodData object.
    */
   class RHomogeneousTreeLikelihood :
     public AbstractHomogeneousTreeLikelihood
@@ -89,6 +93,19 @@ namespace bpp
   protected:
     double minusLogLik_;
 
+    /**
+     * @brief Transition probabilities for each node, packed for LikelihoodKernels.
+     *
+     * These are updated together with pxy_ by computeTransitionProbabilitiesForNode(),
+     * so that they are not repacked at each likelihood computation.
+     */
+    mutable std::map<int, LikelihoodArray> packedPxy_;
+
+    /**
+     * @brief Scratch array for the products computed by computeSubtreeLikelihood().
+     */
+    mutable LikelihoodArray product_;
+
   public:
     /**
      * @brief Build a new RHomogeneousTreeLikelihood object without data.
@@ -153,6 +170,11 @@ namespace bpp
      * @brief Method called by constructors.
      */
     void init_(bool usePatterns) throw (Exception);
+
+    /**
+     * @return The likelihood of a site for a rate class, without its scaling factor.
+     */
+    double getScaledLikelihoodForASiteForARateClass_(size_t site, size_t rateClass) const;
 	
   public:
 
@@ -224,6 +246,14 @@ namespace bpp
 
     void computeTreeLikelihood();
 
+    /**
+     * @return The log of the factor the conditional likelihoods of the root node are scaled by for a given site
+     * (0 if scaling is disabled).
+     *
+     * @param site The site index.
+     */
+    double getLogScalingFactorForASite(size_t site) const;
+
     virtual double getDLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const;
 
     virtual double getDLikelihoodForASite(size_t site) const;
@@ -250,14 +280,32 @@ namespace bpp
     /**
      * @brief Compute the likelihood for a subtree defined by the Tree::Node <i>node</i>.
      *
+     * Son subtrees that do not contain any branch flagged for update are not recomputed.
+     *
      * @param node The root of the subtree.
      */
     virtual void computeSubtreeLikelihood(const Node* node); //Recursive method.			
     virtual void computeDownSubtreeDLikelihood(const Node*);
 		
     virtual void computeDownSubtreeD2Likelihood(const Node*);
+
+    /**
+     * @brief Divide the values of an array by the scaling factors applied locally at a node.
+     *
+     * Derivative arrays are computed from the unscaled products of the son arrays,
+     * this puts them on the same scale as the likelihood array of the node.
+     *
+     * @param nodeId The node the array belongs to.
+     * @param array  The array to rescale, with one entry per site of the node arrays.
+     */
+    void applyLocalScalingFactors_(int nodeId, VVVdouble& array) const;
 	
     void fireParameterChanged(const ParameterList& params);
+
+    /**
+     * @brief Fill the pxy_, dpxy_ and d2pxy_ arrays for one node, and update the corresponding packed array.
+     */
+    virtual void computeTransitionProbabilitiesForNode(const Node* node);
 	
     /**
      * @brief This method is mainly for debugging purpose.
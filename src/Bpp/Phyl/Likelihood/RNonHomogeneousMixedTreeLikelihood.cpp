@@ -38,6 +38,7 @@
  */
 
 #include "RNonHomogeneousMixedTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 #include "../Model/MixedSubstitutionModel.h"
 #include "../TreeTools.h"
@@ -374,47 +375,7 @@ RNonHomogeneousMixedTreeLikelihood::~RNonHomogeneousMixedTreeLikelihood()
     rootFreqs_ = modelSet_->getRootFrequencies();
   }
   else {
-    if (params.getCommonParametersWith(rateDistribution_->getIndependentParameters()).size() > 0)
-      {
-        computeAllTransitionProbabilities();
-      }
-    else
-      {
-        vector<int> ids;
-        vector<string> tmp = params.getCommonParametersWith(modelSet_->getNodeParameters()).getParameterNames();
-        for (size_t i = 0; i < tmp.size(); i++)
-          {
-            vector<int> tmpv = modelSet_->getNodesWithParameter(tmp[i]);
-            ids = VectorTools::vectorUnion(ids, tmpv);
-          }
-        tmp = params.getCommonParametersWith(brLenParameters_).getParameterNames();
-        vector<const Node*> nodes;
-        for (size_t i = 0; i < ids.size(); i++)
-          {
-            nodes.push_back(idToNode_[ids[i]]);
-          }
-        vector<const Node*> tmpv;
-        bool test = false;
-        for (size_t i = 0; i < tmp.size(); i++)
-          {
-            if (tmp[i] == "BrLenRoot" || tmp[i] == "RootPosition")
-              {
-                if (!test)
-                  {
-                    tmpv.push_back(tree_->getRootNode()->getSon(0));
-                    tmpv.push_back(tree_->getRootNode()->getSon(1));
-                    test = true; // Add only once.
-                  }
-              }
-            else
-              tmpv.push_back(nodes_[TextTools::to < size_t > (tmp[i].substr(5))]);
-          }
-        nodes = VectorTools::vectorUnion(nodes, tmpv);
-        
-        for (size_t i = 0; i < nodes.size(); i++){
-          computeTransitionProbabilitiesForNode(nodes[i]);
-        }
-      }
+    computeTransitionProbabilitiesForParameters(params);
 
     map<int, vector<RNonHomogeneousMixedTreeLikelihood*> >::iterator it;
     for (it = mvTreeLikelihoods_.begin(); it != mvTreeLikelihoods_.end(); it++)
@@ -716,6 +677,14 @@ void RNonHomogeneousMixedTreeLikelihood::computeDownSubtreeD2Likelihood(const No
 }
 
 
+/*******************************************************************************/
+
+void RNonHomogeneousMixedTreeLikelihood::computeTransitionProbabilitiesForModel(size_t modelIndex, const vector<const Node*>& nodes)
+{
+  for (size_t i = 0; i < nodes.size(); i++)
+    computeTransitionProbabilitiesForNode(nodes[i]);
+}
+
 /*******************************************************************************/
 
 void RNonHomogeneousMixedTreeLikelihood::computeTransitionProbabilitiesForNode(const Node* node)
@@ -766,6 +735,8 @@ void RNonHomogeneousMixedTreeLikelihood::computeTransitionProbabilitiesForNode(c
       }
     }
   }
+  LikelihoodKernels::packTransitionProbabilities(*pxy__node, packedPxy_[node->getId()]);
+  LikelihoodKernels::packTransitionProbabilities(*pxy__node, packedReversePxy_[node->getId()], true);
   
   if (computeFirstOrderDerivatives_) {
     // Computes all dpxy/dt once for all:
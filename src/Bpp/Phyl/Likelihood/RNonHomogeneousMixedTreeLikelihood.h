@@ -287,6 +287,11 @@ protected:
 
   void computeTransitionProbabilitiesForNode(const Node* node);
 
+  /**
+   * @brief Mixed models are averaged over their hypernode components, one node at a time.
+   */
+  void computeTransitionProbabilitiesForModel(size_t modelIndex, const std::vector<const Node*>& nodes);
+
 };
 } // end of namespace bpp.
 
@@ -39,6 +39,7 @@
  */
 
 #include "RNonHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -63,7 +64,8 @@ RNonHomogeneousTreeLikelihood::RNonHomogeneousTreeLikelihood(
 throw (Exception) :
   AbstractNonHomogeneousTreeLikelihood(tree, modelSet, rDist, verbose, reparametrizeRoot),
   likelihoodData_(0),
-  minusLogLik_(-1.)
+  minusLogLik_(-1.),
+  product_()
 {
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("RNonHomogeneousTreeLikelihood(constructor). Model set is not fully specified.");
@@ -83,7 +85,8 @@ RNonHomogeneousTreeLikelihood::RNonHomogeneousTreeLikelihood(
 throw (Exception) :
   AbstractNonHomogeneousTreeLikelihood(tree, modelSet, rDist, verbose, reparametrizeRoot),
   likelihoodData_(0),
-  minusLogLik_(-1.)
+  minusLogLik_(-1.),
+  product_()
 {
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("RNonHomogeneousTreeLikelihood(constructor). Model set is not fully specified.");
@@ -107,7 +110,8 @@ RNonHomogeneousTreeLikelihood::RNonHomogeneousTreeLikelihood(
   const RNonHomogeneousTreeLikelihood& lik) :
   AbstractNonHomogeneousTreeLikelihood(lik),
   likelihoodData_(0),
-  minusLogLik_(lik.minusLogLik_)
+  minusLogLik_(lik.minusLogLik_),
+  product_()
 {
   likelihoodData_ = dynamic_cast<DRASRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
@@ -263,49 +267,7 @@ void RNonHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& pa
 {
   applyParameters();
 
-  if (params.getCommonParametersWith(rateDistribution_->getIndependentParameters()).size() > 0)
-  {
-    computeAllTransitionProbabilities();
-  }
-  else
-  {
-    vector<int> ids;
-    vector<string> tmp = params.getCommonParametersWith(modelSet_->getNodeParameters()).getParameterNames();
-    for (size_t i = 0; i < tmp.size(); i++)
-    {
-      vector<int> tmpv = modelSet_->getNodesWithParameter(tmp[i]);
-      ids = VectorTools::vectorUnion(ids, tmpv);
-    }
-    tmp = params.getCommonParametersWith(brLenParameters_).getParameterNames();
-    vector<const Node*> nodes;
-    for (size_t i = 0; i < ids.size(); i++)
-    {
-      nodes.push_back(idToNode_[ids[i]]);
-    }
-    vector<const Node*> tmpv;
-    bool test = false;
-    for (size_t i = 0; i < tmp.size(); i++)
-    {
-      if (tmp[i] == "BrLenRoot" || tmp[i] == "RootPosition")
-      {
-        if (!test)
-        {
-          tmpv.push_back(tree_->getRootNode()->getSon(0));
-          tmpv.push_back(tree_->getRootNode()->getSon(1));
-          test = true; //Add only once.
-        }
-      }
-      else
-        tmpv.push_back(nodes_[TextTools::to < size_t > (tmp[i].substr(5))]);
-    }
-    nodes = VectorTools::vectorUnion(nodes, tmpv);
-
-    for (size_t i = 0; i < nodes.size(); i++)
-    {
-      computeTransitionProbabilitiesForNode(nodes[i]);
-    }
-    rootFreqs_ = modelSet_->getRootFrequencies();
-  }
+  computeTransitionProbabilitiesForParameters(params);
   computeTreeLikelihood();
 
   minusLogLik_ = -getLogLikelihood();
@@ -1296,61 +1258,28 @@ void RNonHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
   size_t nbSites  = likelihoodData_->getLikelihoodArray(node->getId()).size();
   size_t nbNodes  = node->getNumberOfSons();
 
-  // Must reset the likelihood array first (i.e. set all of them to 1):
-  VVVdouble* _likelihoods_node = &likelihoodData_->getLikelihoodArray(node->getId());
-  for (size_t i = 0; i < nbSites; i++)
+  //Sons are computed first, as all nodes share the same scratch array for products:
+  for (size_t l = 0; l < nbNodes; l++)
   {
-    //For each site in the sequence,
-    VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      //For each rate classe,
-      Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        //For each initial state,
-        (*_likelihoods_node_i_c)[x] = 1.;
-      }
-    }
+    computeSubtreeLikelihood(node->getSon(l)); //Recursive method:
   }
 
+  // Products are computed in a contiguous array, so that each son is processed
+  // with a single kernel call over all sites and rate classes:
+  product_.resize(nbSites, nbClasses_, nbStates_);
+  product_.fill(1.);
   for (size_t l = 0; l < nbNodes; l++)
   {
     //For each son node,
 
     const Node* son = node->getSon(l);
 
-    computeSubtreeLikelihood(son); //Recursive method:
-
-    VVVdouble* pxy__son = &pxy_[son->getId()];
     vector<size_t> * _patternLinks_node_son = &likelihoodData_->getArrayPositions(node->getId(), son->getId());
     VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
-    for (size_t i = 0; i < nbSites; i++)
-    {
-      //For each site in the sequence,
-      VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_node_son)[i]];
-      VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        //For each rate classe,
-        Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-        Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-        VVdouble* pxy__son_c = &(*pxy__son)[c];
-        for (size_t x = 0; x < nbStates_; x++)
-        {
-          //For each initial state,
-          Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates_; y++)
-          {
-            likelihood += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
-          }
-          (*_likelihoods_node_i_c)[x] *= likelihood;
-        }
-      }
-    }
+    LikelihoodKernels::multiplyConditionalLikelihoods(packedPxy_[son->getId()], *_likelihoods_son, *_patternLinks_node_son, product_, 1);
   }
+  product_.copyTo(likelihoodData_->getLikelihoodArray(node->getId()));
 }
 
 
@@ -91,6 +91,11 @@ namespace bpp
     mutable DRASRTreeLikelihoodData* likelihoodData_;
     double minusLogLik_;
 
+    /**
+     * @brief Scratch array for the products computed by computeSubtreeLikelihood().
+     */
+    mutable LikelihoodArray product_;
+
   public:
     /**
      * @brief Build a new NonHomogeneousTreeLikelihood object without data.
@@ -0,0 +1,123 @@
+//
+// File: StreamingSiteLikelihoods.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "StreamingSiteLikelihoods.h"
+
+//From bpp-seq:
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+
+// From the STL:
+#include <algorithm>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+SiteContainer* SiteContainerChunks::nextChunk() throw (Exception)
+{
+  size_t nbSites = sites_->getNumberOfSites();
+  if (position_ >= nbSites)
+    return 0;
+  size_t last = min(nbSites, position_ + chunkSize_);
+  vector<const Site*> chunk(last - position_);
+  for (size_t i = position_; i < last; i++)
+  {
+    chunk[i - position_] = &sites_->getSite(i);
+  }
+  position_ = last;
+  SiteContainer* sites = new VectorSiteContainer(chunk, sites_->getAlphabet());
+  sites->setSequencesNames(sites_->getSequencesNames(), false);
+  return sites;
+}
+
+/******************************************************************************/
+
+vector<double> StreamingSiteLikelihoods::computeLogLikelihoodForEachSite(const SiteContainer& sites) throw (Exception)
+{
+  // Arrays are reallocated for the new chunk, parameters are left unchanged:
+  likelihood_.setData(sites);
+  likelihood_.initialize();
+  return likelihood_.getLogLikelihoodForEachSite();
+}
+
+/******************************************************************************/
+
+void StreamingSiteLikelihoods::writeLogLikelihoodForEachSite(
+  SiteContainerChunkReader& reader,
+  const string& name,
+  TreepuzzlePairedSiteLikelihoodsWriter& writer) throw (Exception)
+{
+  reader.rewind();
+  writer.beginModel(name);
+  SiteContainer* chunk;
+  while ((chunk = reader.nextChunk()) != 0)
+  {
+    auto_ptr<SiteContainer> chunkPtr(chunk);
+    writer.writeSites(computeLogLikelihoodForEachSite(*chunk));
+  }
+  writer.endModel();
+}
+
+/******************************************************************************/
+
+void StreamingSiteLikelihoods::writeLogLikelihoodForEachSite(
+  const vector<const Tree*>& trees,
+  const vector<string>& names,
+  SubstitutionModel* model,
+  DiscreteDistribution* rDist,
+  SiteContainerChunkReader& reader,
+  ostream& os,
+  const string& delim,
+  size_t nbThreads) throw (Exception)
+{
+  if (names.size() != trees.size())
+    throw Exception("StreamingSiteLikelihoods::writeLogLikelihoodForEachSite. There should be as many names as trees.");
+  TreepuzzlePairedSiteLikelihoodsWriter writer(os, trees.size(), reader.getNumberOfSites(), delim);
+  for (size_t i = 0; i < trees.size(); i++)
+  {
+    StreamingSiteLikelihoods evaluator(*trees[i], model, rDist);
+    evaluator.getTreeLikelihood().setNumberOfThreads(nbThreads);
+    evaluator.writeLogLikelihoodForEachSite(reader, names[i], writer);
+  }
+}
+
+/******************************************************************************/
+
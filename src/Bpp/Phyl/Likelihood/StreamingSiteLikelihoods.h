@@ -0,0 +1,221 @@
+//
+// File: StreamingSiteLikelihoods.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _STREAMINGSITELIKELIHOODS_H_
+#define _STREAMINGSITELIKELIHOODS_H_
+
+#include "DRHomogeneousTreeLikelihood.h"
+#include "../Io/IoPairedSiteLikelihoods.h"
+
+//From bpp-seq:
+#include <Bpp/Seq/Container/SiteContainer.h>
+
+// From the STL:
+#include <vector>
+#include <string>
+#include <iostream>
+
+namespace bpp
+{
+
+/**
+ * @brief Interface for objects providing the sites of an alignment chunk by chunk.
+ *
+ * Implementations may read the chunks from a file, so that the full alignment never has to be stored in memory
+ * (see FastaSiteChunks and PhylipSiteChunks).
+ */
+class SiteContainerChunkReader
+{
+  public:
+    SiteContainerChunkReader() {}
+    virtual ~SiteContainerChunkReader() {}
+
+  public:
+    /**
+     * @return The total number of sites in the alignment.
+     */
+    virtual size_t getNumberOfSites() const = 0;
+
+    /**
+     * @brief Go back to the first chunk.
+     */
+    virtual void rewind() throw (Exception) = 0;
+
+    /**
+     * @return A new container with the next chunk of sites, or 0 if all sites have been read.
+     * The container is owned by the caller.
+     */
+    virtual SiteContainer* nextChunk() throw (Exception) = 0;
+};
+
+
+/**
+ * @brief Split an existing site container into chunks of consecutive sites.
+ */
+class SiteContainerChunks :
+  public virtual SiteContainerChunkReader
+{
+  private:
+    const SiteContainer* sites_;
+    size_t chunkSize_;
+    size_t position_;
+
+  public:
+    /**
+     * @param sites     The container to split (will not be copied, and must not be deleted before this object).
+     * @param chunkSize The maximum number of sites in each chunk.
+     */
+    SiteContainerChunks(const SiteContainer& sites, size_t chunkSize) :
+      sites_(&sites), chunkSize_(chunkSize), position_(0)
+    {
+      if (chunkSize_ == 0)
+        throw Exception("SiteContainerChunks. Chunk size must be positive.");
+    }
+
+    SiteContainerChunks(const SiteContainerChunks& chunks) :
+      sites_(chunks.sites_), chunkSize_(chunks.chunkSize_), position_(chunks.position_)
+    {}
+
+    SiteContainerChunks& operator=(const SiteContainerChunks& chunks)
+    {
+      sites_     = chunks.sites_;
+      chunkSize_ = chunks.chunkSize_;
+      position_  = chunks.position_;
+      return *this;
+    }
+
+    virtual ~SiteContainerChunks() {}
+
+  public:
+    size_t getNumberOfSites() const { return sites_->getNumberOfSites(); }
+
+    void rewind() throw (Exception) { position_ = 0; }
+
+    SiteContainer* nextChunk() throw (Exception);
+};
+
+
+/**
+ * @brief Compute site log-likelihoods of an alignment chunk by chunk.
+ *
+ * A DRHomogeneousTreeLikelihood object is built once for a given tree, model and rate distribution,
+ * and used to evaluate successive chunks of sites.
+ * The conditional likelihood arrays are only allocated for the current chunk,
+ * so that the memory required is bounded by the chunk size and not by the total number of sites.
+ *
+ * Model and rate distribution parameters are taken "as is", and are not estimated.
+ */
+class StreamingSiteLikelihoods
+{
+  private:
+    DRHomogeneousTreeLikelihood likelihood_;
+
+  public:
+    /**
+     * @param tree  The tree to use.
+     * @param model The substitution model to use.
+     * @param rDist The rate across sites distribution to use.
+     */
+    StreamingSiteLikelihoods(
+      const Tree& tree,
+      SubstitutionModel* model,
+      DiscreteDistribution* rDist) throw (Exception) :
+      likelihood_(tree, model, rDist, true, false)
+    {}
+
+    virtual ~StreamingSiteLikelihoods() {}
+
+  public:
+    /**
+     * @return The underlying likelihood object, for instance to set the number of threads or enable scaling.
+     */
+    DRHomogeneousTreeLikelihood& getTreeLikelihood() { return likelihood_; }
+
+    /**
+     * @brief Compute the log-likelihood of each site in a chunk.
+     *
+     * @param sites The chunk of sites to evaluate.
+     * @return The site log-likelihoods, in the order of the input sites.
+     */
+    std::vector<double> computeLogLikelihoodForEachSite(const SiteContainer& sites) throw (Exception);
+
+    /**
+     * @brief Compute the log-likelihood of all sites provided by a chunk reader, and write them.
+     *
+     * The reader is rewound first. The model line is begun and ended by this method.
+     *
+     * @param reader The object providing the sites.
+     * @param name   The name of the model in the output.
+     * @param writer The writer to use.
+     */
+    void writeLogLikelihoodForEachSite(
+      SiteContainerChunkReader& reader,
+      const std::string& name,
+      TreepuzzlePairedSiteLikelihoodsWriter& writer) throw (Exception);
+
+    /**
+     * @brief Compute and write site log-likelihoods for several trees.
+     *
+     * Trees are evaluated one after the other, reading all chunks for each tree,
+     * and written in the Tree-Puzzle/RAxML paired-site likelihoods format.
+     *
+     * @param trees     The trees to evaluate.
+     * @param names     The name of each tree in the output.
+     * @param model     The substitution model to use.
+     * @param rDist     The rate across sites distribution to use.
+     * @param reader    The object providing the sites.
+     * @param os        The output stream.
+     * @param delim     The delimiter between model names and likelihoods.
+     * @param nbThreads The number of threads to use for each likelihood computation.
+     */
+    static void writeLogLikelihoodForEachSite(
+      const std::vector<const Tree*>& trees,
+      const std::vector<std::string>& names,
+      SubstitutionModel* model,
+      DiscreteDistribution* rDist,
+      SiteContainerChunkReader& reader,
+      std::ostream& os,
+      const std::string& delim = "\t",
+      size_t nbThreads = 1) throw (Exception);
+};
+
+} //end of namespace bpp.
+
+#endif //_STREAMINGSITELIKELIHOODS_H_
+
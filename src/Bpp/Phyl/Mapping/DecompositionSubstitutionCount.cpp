@@ -47,17 +47,46 @@ using namespace std;
 
 /******************************************************************************/
 
+namespace
+{
+  // Product of row-major matrices with leading dimensions, as BLAS dgemm: c (m x n) = a (m x k) %*% b (k x n).
+  // The i-k-j loop order lets the compiler vectorize the inner loop, and zeros in a are skipped.
+  void matrixProduct(size_t m, size_t n, size_t k, const double* a, size_t lda, const double* b, size_t ldb, double* c, size_t ldc)
+  {
+    for (size_t i = 0; i < m; ++i)
+    {
+      double* c_i = c + i * ldc;
+      for (size_t j = 0; j < n; ++j)
+        c_i[j] = 0.;
+      const double* a_i = a + i * lda;
+      for (size_t l = 0; l < k; ++l)
+      {
+        double a_il = a_i[l];
+        if (a_il == 0.)
+          continue;
+        const double* b_l = b + l * ldb;
+        for (size_t j = 0; j < n; ++j)
+          c_i[j] += a_il * b_l[j];
+      }
+    }
+  }
+
+  // Maximum number of types processed together, bounds the size of temporary arrays:
+  const size_t TYPE_BLOCK_SIZE = 16;
+}
+
+/******************************************************************************/
+
 DecompositionSubstitutionCount::DecompositionSubstitutionCount(const ReversibleSubstitutionModel* model, SubstitutionRegister* reg, const AlphabetIndex2* weights) :
   AbstractSubstitutionCount(reg),
   AbstractWeightedSubstitutionCount(weights, true),
   model_(model),
   nbStates_(model->getNumberOfStates()),
-  jMat_(nbStates_, nbStates_),
-  v_(nbStates_, nbStates_),
-  vInv_(nbStates_, nbStates_),
-  lambda_(nbStates_, nbStates_),
+  v_(nbStates_ * nbStates_),
+  vInv_(nbStates_ * nbStates_),
+  lambda_(nbStates_),
   bMatrices_(reg->getNumberOfSubstitutionTypes()),
-  insideProducts_(reg->getNumberOfSubstitutionTypes()),
+  insideProducts_(),
   counts_(reg->getNumberOfSubstitutionTypes()),
   currentLength_(-1.)
 {
@@ -92,18 +121,36 @@ void DecompositionSubstitutionCount::fillBMatrices_()
 
 void DecompositionSubstitutionCount::computeEigen_()
 {
-  v_      = model_->getColumnRightEigenVectors();
-  vInv_   = model_->getRowLeftEigenVectors();
+  const Matrix<double>& v    = model_->getColumnRightEigenVectors();
+  const Matrix<double>& vInv = model_->getRowLeftEigenVectors();
+  for (size_t i = 0; i < nbStates_; ++i) {
+    for (size_t j = 0; j < nbStates_; ++j) {
+      v_[i * nbStates_ + j]    = v(i, j);
+      vInv_[i * nbStates_ + j] = vInv(i, j);
+    }
+  }
   lambda_ = model_->getEigenValues();
 }
 
 void DecompositionSubstitutionCount::computeProducts_()
 {
-  for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); ++i) {
-    //vInv_ %*% bMatrices_[i] %*% v_;
-    RowMatrix<double> tmp(nbStates_, nbStates_);
-    MatrixTools::mult(vInv_, bMatrices_[i], tmp);
-    MatrixTools::mult(tmp, v_, insideProducts_[i]);
+  //vInv_ %*% bMatrices_[i] %*% v_, for all types at once:
+  size_t nbTypes = register_->getNumberOfSubstitutionTypes();
+  size_t width = nbTypes * nbStates_;
+  vector<double> bStack(nbStates_ * width), tmp(nbStates_ * width);
+  for (size_t i = 0; i < nbTypes; ++i) {
+    for (size_t j = 0; j < nbStates_; ++j) {
+      for (size_t k = 0; k < nbStates_; ++k) {
+        bStack[j * width + i * nbStates_ + k] = bMatrices_[i](j, k);
+      }
+    }
+  }
+  insideProducts_.resize(nbStates_ * width);
+  if (width == 0)
+    return;
+  matrixProduct(nbStates_, width, nbStates_, &vInv_[0], nbStates_, &bStack[0], width, &tmp[0], width);
+  for (size_t i = 0; i < nbTypes; ++i) {
+    matrixProduct(nbStates_, nbStates_, nbStates_, &tmp[i * nbStates_], width, &v_[0], nbStates_, &insideProducts_[i * nbStates_], width);
   }
 }
 
@@ -111,15 +158,13 @@ void DecompositionSubstitutionCount::resetBMatrices_()
 {
   size_t nbTypes = register_->getNumberOfSubstitutionTypes();
   bMatrices_.resize(nbTypes);
-  insideProducts_.resize(nbTypes);
   counts_.resize(nbTypes);
 }
 
 void DecompositionSubstitutionCount::resetStates_()
 {
-  jMat_.resize(nbStates_, nbStates_);
-  v_.resize(nbStates_, nbStates_);
-  vInv_.resize(nbStates_, nbStates_);
+  v_.resize(nbStates_ * nbStates_);
+  vInv_.resize(nbStates_ * nbStates_);
   lambda_.resize(nbStates_);
 }
 
@@ -128,21 +173,20 @@ void DecompositionSubstitutionCount::initBMatrices_()
   //Re-initialize all B matrices according to substitution register.
   for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); ++i) {
     bMatrices_[i].resize(nbStates_, nbStates_);
-    insideProducts_[i].resize(nbStates_, nbStates_);
     counts_[i].resize(nbStates_, nbStates_);
   }
 }
 
-void DecompositionSubstitutionCount::jFunction_(const std::vector<double>& lambda, double t, RowMatrix<double>& result) const
+void DecompositionSubstitutionCount::jFunction_(const std::vector<double>& lambda, double t, double* result) const
 {
 	vector<double> expLam = VectorTools::exp(lambda * t);
-	for (unsigned int i = 0; i < nbStates_; ++i) {
-	  for (unsigned int j = 0; j < nbStates_; ++j) {
+	for (size_t i = 0; i < nbStates_; ++i) {
+	  for (size_t j = 0; j < nbStates_; ++j) {
       double dd = lambda[i] - lambda[j];
       if (dd == 0) {
-  		  result(i, j) = t * expLam[i];
+  		  result[i * nbStates_ + j] = t * expLam[i];
       } else {
-  		  result(i, j) = (expLam[i] - expLam[j]) / dd;
+  		  result[i * nbStates_ + j] = (expLam[i] - expLam[j]) / dd;
       }
     }
 	}
@@ -150,28 +194,96 @@ void DecompositionSubstitutionCount::jFunction_(const std::vector<double>& lambd
 
 /******************************************************************************/
 
-void DecompositionSubstitutionCount::computeCounts_(double length) const
+void DecompositionSubstitutionCount::computeCounts_(double length, double* counts) const
 {
-  jFunction_(lambda_, length, jMat_);
-  for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); ++i) {
-    RowMatrix<double> tmp1(nbStates_, nbStates_), tmp2(nbStates_, nbStates_);
-    MatrixTools::hadamardMult(jMat_, insideProducts_[i], tmp1);
-    MatrixTools::mult(v_, tmp1, tmp2);
-    MatrixTools::mult(tmp2, vInv_, counts_[i]);
-	}
+  size_t nbTypes = register_->getNumberOfSubstitutionTypes();
+  size_t n2 = nbStates_ * nbStates_;
+  size_t width = nbTypes * nbStates_;
+  vector<double> jMat(n2);
+  jFunction_(lambda_, length, &jMat[0]);
+
+  // v_ %*% (jMat * insideProducts_[i]) %*% vInv_, by blocks of types sharing the first product:
+  size_t blockWidth = min(nbTypes, TYPE_BLOCK_SIZE) * nbStates_;
+  vector<double> tmp1(nbStates_ * blockWidth), tmp2(nbStates_ * blockWidth);
+  for (size_t i0 = 0; i0 < nbTypes; i0 += TYPE_BLOCK_SIZE) {
+    size_t nbBlockTypes = min(nbTypes - i0, TYPE_BLOCK_SIZE);
+    size_t w = nbBlockTypes * nbStates_;
+    for (size_t j = 0; j < nbStates_; ++j) {
+      const double* jMat_j = &jMat[j * nbStates_];
+      const double* inside_j = &insideProducts_[j * width + i0 * nbStates_];
+      double* tmp1_j = &tmp1[j * w];
+      for (size_t i = 0; i < nbBlockTypes; ++i) {
+        for (size_t k = 0; k < nbStates_; ++k) {
+          tmp1_j[i * nbStates_ + k] = jMat_j[k] * inside_j[i * nbStates_ + k];
+        }
+      }
+    }
+    matrixProduct(nbStates_, w, nbStates_, &v_[0], nbStates_, &tmp1[0], w, &tmp2[0], w);
+    for (size_t i = 0; i < nbBlockTypes; ++i) {
+      matrixProduct(nbStates_, nbStates_, nbStates_, &tmp2[i * nbStates_], w, &vInv_[0], nbStates_, counts + (i0 + i) * n2, nbStates_);
+    }
+  }
+
   // Now we must divide by pijt and account for putative weights:
   vector<int> supportedStates = model_->getAlphabetStates();
-  RowMatrix<double> P = model_->getPij_t(length);
-  for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); i++) {
+  const Matrix<double>& P = model_->getPij_t(length);
+  for (size_t i = 0; i < nbTypes; i++) {
+    double* counts_i = counts + i * n2;
     for (size_t j = 0; j < nbStates_; j++) {
       for (size_t k = 0; k < nbStates_; k++) {
-        counts_[i](j, k) /= P(j, k);
-        if (isnan(counts_[i](j, k)) || counts_[i](j, k) < 0.) {
-          counts_[i](j, k) = 0.;
+        double* c = &counts_i[j * nbStates_ + k];
+        *c /= P(j, k);
+        if (isnan(*c) || *c < 0.)
+          *c = 0.;
         //Weights:
         if (weights_)
-          counts_[i](j, k) *= weights_->getIndex(supportedStates[j], supportedStates[k]);
-        }
+          *c *= weights_->getIndex(supportedStates[j], supportedStates[k]);
+      }
+    }
+  }
+}
+
+void DecompositionSubstitutionCount::computeCounts_(double length) const
+{
+  size_t nbTypes = register_->getNumberOfSubstitutionTypes();
+  size_t n2 = nbStates_ * nbStates_;
+  vector<double> counts(nbTypes * n2);
+  if (counts.empty())
+    return;
+  computeCounts_(length, &counts[0]);
+  for (size_t i = 0; i < nbTypes; i++) {
+    for (size_t j = 0; j < nbStates_; j++) {
+      for (size_t k = 0; k < nbStates_; k++) {
+        counts_[i](j, k) = counts[i * n2 + j * nbStates_ + k];
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+void DecompositionSubstitutionCount::getAllNumbersOfSubstitutionsForEachType(const std::vector<double>& lengths, VVVVdouble& counts) const
+{
+  size_t nbTypes = register_->getNumberOfSubstitutionTypes();
+  size_t n2 = nbStates_ * nbStates_;
+  vector<double> countsForLength(nbTypes * n2);
+  counts.resize(lengths.size());
+  for (size_t l = 0; l < lengths.size(); ++l)
+  {
+    if (lengths[l] < 0)
+      throw Exception("DecompositionSubstitutionCount::getAllNumbersOfSubstitutionsForEachType. Negative branch length: " + TextTools::toString(lengths[l]) + ".");
+    if (nbTypes > 0)
+      computeCounts_(lengths[l], &countsForLength[0]);
+    VVVdouble* counts_l = &counts[l];
+    counts_l->resize(nbTypes);
+    for (size_t i = 0; i < nbTypes; ++i)
+    {
+      VVdouble* counts_l_i = &(*counts_l)[i];
+      counts_l_i->resize(nbStates_);
+      for (size_t j = 0; j < nbStates_; ++j)
+      {
+        const double* src = &countsForLength[i * n2 + j * nbStates_];
+        (*counts_l_i)[j].assign(src, src + nbStates_);
       }
     }
   }
@@ -261,8 +373,8 @@ void DecompositionSubstitutionCount::setSubstitutionModel(const SubstitutionMode
   computeEigen_();
   computeProducts_();
 
-  //Recompute counts:
-  computeCounts_(currentLength_);
+  //Counts will be recomputed when needed:
+  currentLength_ = -1.;
 }
 
 /******************************************************************************/
@@ -278,9 +390,8 @@ void DecompositionSubstitutionCount::substitutionRegisterHasChanged() throw (Exc
   fillBMatrices_();
   computeProducts_();
 
-  //Recompute counts:
-  if (currentLength_ > 0)
-   computeCounts_(currentLength_);
+  //Counts will be recomputed when needed:
+  currentLength_ = -1.;
 }
 
 /******************************************************************************/
@@ -293,9 +404,8 @@ void DecompositionSubstitutionCount::weightsHaveChanged() throw (Exception)
   //jdutheil on 25/07/14: not necessary if weights are only accounted for in the end.
   //fillBMatrices_();
   
-  //Recompute counts:
-  if (currentLength_ > 0)
-    computeCounts_(currentLength_);
+  //Counts will be recomputed when needed:
+  currentLength_ = -1.;
 }
 
 /******************************************************************************/
@@ -53,6 +53,12 @@ namespace bpp
  * The codes is adapted from the original R code by Paula Tataru and Asger Hobolth.
  * Only reversible models are supported for now.
  *
+ * The B matrices of all substitution types are projected on the eigen basis of the model
+ * once, when the model or the register changes. Counts for a given branch length are then
+ * obtained for all types with two matrix products, the first one being shared by all types.
+ * Use getAllNumbersOfSubstitutionsForEachType() to compute the counts for several branch lengths
+ * (for instance all rate classes of all branches) in one call.
+ *
  * @author Julien Dutheil
  */
 class DecompositionSubstitutionCount:
@@ -62,9 +68,11 @@ class DecompositionSubstitutionCount:
 	private:
 		const ReversibleSubstitutionModel* model_;
     size_t nbStates_;
-		mutable RowMatrix<double> jMat_, v_, vInv_;
-    mutable std::vector<double> lambda_;
-    std::vector< RowMatrix<double> > bMatrices_, insideProducts_;
+    // Eigen decomposition of the generator, v_ and vInv_ are stored by rows:
+    std::vector<double> v_, vInv_, lambda_;
+    std::vector< RowMatrix<double> > bMatrices_;
+    // vInv_ %*% bMatrices_[t] %*% v_ for all types t, as a nbStates_ x (nbTypes * nbStates_) matrix:
+    std::vector<double> insideProducts_;
     mutable std::vector< RowMatrix<double> > counts_;
     mutable double currentLength_;
 	
@@ -76,7 +84,6 @@ class DecompositionSubstitutionCount:
       AbstractWeightedSubstitutionCount(dsc),
       model_(dsc.model_),
       nbStates_(dsc.nbStates_),
-      jMat_(dsc.jMat_),
       v_(dsc.v_),
       vInv_(dsc.vInv_),
       lambda_(dsc.lambda_),
@@ -92,7 +99,6 @@ class DecompositionSubstitutionCount:
       AbstractWeightedSubstitutionCount::operator=(dsc);
       model_          = dsc.model_;
       nbStates_       = dsc.nbStates_;
-      jMat_           = dsc.jMat_;
       v_              = dsc.v_;
       vInv_           = dsc.vInv_;
       lambda_         = dsc.lambda_;
@@ -113,6 +119,8 @@ class DecompositionSubstitutionCount:
     Matrix<double>* getAllNumbersOfSubstitutions(double length, size_t type = 1) const;
     
     std::vector<double> getNumberOfSubstitutionsForEachType(size_t initialState, size_t finalState, double length) const;
+
+    void getAllNumbersOfSubstitutionsForEachType(const std::vector<double>& lengths, VVVVdouble& counts) const;
    
     /**
      * @brief Set the substitution model.
@@ -123,7 +131,15 @@ class DecompositionSubstitutionCount:
 
   protected:
     void computeCounts_(double length) const;
-    void jFunction_(const std::vector<double>& lambda, double t, RowMatrix<double>& result) const;
+
+    /**
+     * @brief Compute the counts of all types for a given length.
+     *
+     * @param length The branch length.
+     * @param counts [out] An array of nbTypes * nbStates * nbStates values, counts of type t + 1 starting at t * nbStates * nbStates, by rows.
+     */
+    void computeCounts_(double length, double* counts) const;
+    void jFunction_(const std::vector<double>& lambda, double t, double* result) const;
     void substitutionRegisterHasChanged() throw (Exception);
     void weightsHaveChanged() throw (Exception);
 
@@ -47,6 +47,7 @@
 
 //From the STL:
 #include <vector>
+#include <memory>
 
 namespace bpp
 {
@@ -150,6 +151,39 @@ namespace bpp
      */
     virtual std::vector<double> getNumberOfSubstitutionsForEachType(size_t initialState, size_t finalState, double length) const = 0;
 
+    /**
+     * @brief Get the numbers of susbstitutions of all types, for several branch lengths at once.
+     *
+     * This is typically used to get the counts for all rate classes of a branch, or for all branches
+     * of a tree, in one call. Implementations may share computations between lengths and types.
+     * The default implementation calls getAllNumbersOfSubstitutions() for each length and each type.
+     *
+     * @param lengths The lengths of the branches.
+     * @param counts  [out] counts[k][t][i][j] is the number of substitutions of type t + 1 from state i to state j, on a branch of length lengths[k].
+     */
+    virtual void getAllNumbersOfSubstitutionsForEachType(const std::vector<double>& lengths, VVVVdouble& counts) const
+    {
+      size_t nbTypes = getNumberOfSubstitutionTypes();
+      counts.resize(lengths.size());
+      for (size_t k = 0; k < lengths.size(); ++k)
+      {
+        counts[k].resize(nbTypes);
+        for (size_t t = 0; t < nbTypes; ++t)
+        {
+          std::auto_ptr< Matrix<double> > m(getAllNumbersOfSubstitutions(lengths[k], t + 1));
+          VVdouble* counts_k_t = &counts[k][t];
+          counts_k_t->resize(m->getNumberOfRows());
+          for (size_t i = 0; i < m->getNumberOfRows(); ++i)
+          {
+            Vdouble* counts_k_t_i = &(*counts_k_t)[i];
+            counts_k_t_i->resize(m->getNumberOfColumns());
+            for (size_t j = 0; j < m->getNumberOfColumns(); ++j)
+              (*counts_k_t_i)[j] = (*m)(i, j);
+          }
+        }
+      }
+    }
+
     /**
      * @brief Set the substitution model associated with this count, if relevent.
      *
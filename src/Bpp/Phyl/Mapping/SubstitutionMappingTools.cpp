@@ -55,194 +55,181 @@ using namespace bpp;
 
 // From the STL:
 #include <iomanip>
+#include <algorithm>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
 
 using namespace std;
 
 /******************************************************************************/
 
-ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectors(
-  const DRTreeLikelihood& drtl,
-  const vector<int>& nodeIds,
-  SubstitutionCount& substitutionCount,
-  bool verbose) throw (Exception)
+namespace
 {
-  // Preamble:
-  if (!drtl.isInitialized())
-    throw Exception("SubstitutionMappingTools::computeSubstitutionVectors(). Likelihood object is not initialized.");
-
-  // A few variables we'll need:
-
-  const TreeTemplate<Node> tree(drtl.getTree());
-  const SiteContainer*    sequences = drtl.getData();
-  const DiscreteDistribution* rDist = drtl.getRateDistribution();
+  /**
+   * Number of distinct sites processed in a row by a single thread.
+   */
+  const size_t SITE_BLOCK_SIZE = 64;
 
-  size_t nbSites         = sequences->getNumberOfSites();
-  size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
-  size_t nbStates        = sequences->getAlphabet()->getSize();
-  size_t nbClasses       = rDist->getNumberOfCategories();
-  size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
-  vector<const Node*> nodes    = tree.getNodes();
-  const vector<size_t>* rootPatternLinks
-    = &drtl.getLikelihoodData()->getRootArrayPositions();
-  nodes.pop_back(); // Remove root node.
-  size_t nbNodes         = nodes.size();
+  size_t getEffectiveNumberOfThreads(size_t nbThreads)
+  {
+#ifdef _OPENMP
+    if (nbThreads == 0)
+      nbThreads = static_cast<size_t>(omp_get_num_procs());
+#else
+    nbThreads = 1;
+#endif
+    return nbThreads;
+  }
 
-  // We create a new ProbabilisticSubstitutionMapping object:
-  ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
+  /**
+   * Get the indices of all distinct sites sharing a given branch model.
+   */
+  void getSitePartition(const TreeLikelihood::ConstBranchModelDescription& bmd, vector<size_t>& sites)
+  {
+    sites.clear();
+    auto_ptr<TreeLikelihood::SiteIterator> sit(bmd.getNewSiteIterator());
+    while (sit->hasNext())
+    {
+      sites.push_back(sit->next());
+    }
+  }
 
-  // Store likelihood for each rate for each site:
-  VVVdouble lik;
-  drtl.computeLikelihoodAtNode(tree.getRootId(), lik);
-  Vdouble Lr(nbDistinctSites, 0);
-  Vdouble rcProbs = rDist->getProbabilities();
-  Vdouble rcRates = rDist->getCategories();
-  for (size_t i = 0; i < nbDistinctSites; i++)
+  /**
+   * Multiply the constant part of the father likelihood by the likelihood of
+   * a neighbour subtree, for all distinct sites in a partition.
+   *
+   * If 'fromFather' is true, the neighbour is the father of the father node,
+   * and transition probabilities are read backward.
+   */
+  void multiplyByNeighbourLikelihoods(
+    const vector<size_t>& sites,
+    const VVVdouble& pxy,
+    const LikelihoodArray& likelihoodsFather_son,
+    bool fromFather,
+    VVVdouble& likelihoodsFatherConstantPart,
+    size_t nbThreads)
   {
-    VVdouble* lik_i = &lik[i];
-    for (size_t c = 0; c < nbClasses; c++)
+    size_t nbClasses = pxy.size();
+    size_t nbStates  = nbClasses > 0 ? pxy[0].size() : 0;
+    long nbBlocks = static_cast<long>((sites.size() + SITE_BLOCK_SIZE - 1) / SITE_BLOCK_SIZE);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads))
+#endif
+    for (long b = 0; b < nbBlocks; b++)
     {
-      Vdouble* lik_i_c = &(*lik_i)[c];
-      double rc = rDist->getProbability(c);
-      for (size_t s = 0; s < nbStates; s++)
+      size_t begin = static_cast<size_t>(b) * SITE_BLOCK_SIZE;
+      size_t end   = min(begin + SITE_BLOCK_SIZE, sites.size());
+      for (size_t k = begin; k < end; k++)
       {
-        Lr[i] += (*lik_i_c)[s] * rc;
+        size_t i = sites[k];
+        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
+        for (size_t c = 0; c < nbClasses; c++)
+        {
+          const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
+          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
+          const VVdouble* pxy_c = &pxy[c];
+          for (size_t x = 0; x < nbStates; x++)
+          {
+            double likelihood = 0.;
+            if (fromFather)
+            {
+              for (size_t y = 0; y < nbStates; y++)
+              {
+                likelihood += (*pxy_c)[y][x] * likelihoodsFather_son_i_c[y];
+              }
+            }
+            else
+            {
+              const Vdouble* pxy_c_x = &(*pxy_c)[x];
+              for (size_t y = 0; y < nbStates; y++)
+              {
+                likelihood += (*pxy_c_x)[y] * likelihoodsFather_son_i_c[y];
+              }
+            }
+            (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
+          }
+        }
       }
     }
   }
 
-  // Compute the number of substitutions for each class and each branch in the tree:
-  if (verbose)
-    ApplicationTools::displayTask("Compute joint node-pairs likelihood", true);
-
-  for (size_t l = 0; l < nbNodes; ++l)
+  /**
+   * Compute, for each distinct site, rate class and state at the father of a
+   * node, the likelihood of the tree without the branch leading to the node.
+   * The probability of each rate class is included.
+   *
+   * @param drtl                          The likelihood object.
+   * @param currentNode                   The node at the bottom of the branch.
+   * @param likelihoodsFatherConstantPart [out] The likelihoods (site x class x state).
+   * @param nbThreads                     The number of threads to use.
+   */
+  void computeFatherConstantPart(
+    const DRTreeLikelihood& drtl,
+    const Node* currentNode,
+    VVVdouble& likelihoodsFatherConstantPart,
+    size_t nbThreads)
   {
-    // For each node,
-    const Node* currentNode = nodes[l];
-    if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, currentNode->getId()))
-      continue;
+    const DiscreteDistribution* rDist = drtl.getRateDistribution();
+    const DRASDRTreeLikelihoodData* data = drtl.getLikelihoodData();
 
-    const Node* father = currentNode->getFather();
+    size_t nbDistinctSites = data->getNumberOfDistinctSites();
+    size_t nbStates        = drtl.getData()->getAlphabet()->getSize();
+    size_t nbClasses       = rDist->getNumberOfCategories();
 
-    double d = currentNode->getDistanceToFather();
-
-    if (verbose)
-      ApplicationTools::displayGauge(l, nbNodes - 1);
-    VVdouble substitutionsForCurrentNode(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; ++i)
-    {
-      substitutionsForCurrentNode[i].resize(nbTypes);
-    }
+    const Node* father = currentNode->getFather();
 
     // Now we've got to compute likelihoods in a smart manner... ;)
-    VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
+    likelihoodsFatherConstantPart.resize(nbDistinctSites);
     for (size_t i = 0; i < nbDistinctSites; i++)
     {
       VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
       likelihoodsFatherConstantPart_i->resize(nbClasses);
       for (size_t c = 0; c < nbClasses; c++)
       {
-        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-        likelihoodsFatherConstantPart_i_c->resize(nbStates);
-        double rc = rDist->getProbability(c);
-        for (size_t s = 0; s < nbStates; s++)
-        {
-          // (* likelihoodsFatherConstantPart_i_c)[s] = rc * model->freq(s);
-          // freq is already accounted in the array
-          (*likelihoodsFatherConstantPart_i_c)[s] = rc;
-        }
+        // (* likelihoodsFatherConstantPart_i_c)[s] = rc * model->freq(s);
+        // freq is already accounted in the array
+        (*likelihoodsFatherConstantPart_i)[c].assign(nbStates, rDist->getProbability(c));
       }
     }
 
     // First, what will remain constant:
+    vector<size_t> sites;
     size_t nbSons =  father->getNumberOfSons();
     for (size_t n = 0; n < nbSons; n++)
     {
       const Node* currentSon = father->getSon(n);
       if (currentSon->getId() != currentNode->getId())
       {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+        const LikelihoodArray* likelihoodsFather_son = &data->getLikelihoodBuffer(father->getId(), currentSon->getId());
 
         // Now iterate over all site partitions:
         auto_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
-        VVVdouble pxy;
-        bool first;
         while (mit->hasNext())
         {
-          TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-          auto_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-          first = true;
-          while (sit->hasNext())
-          {
-            size_t i = sit->next();
-            // We retrieve the transition probabilities for this site partition:
-            if (first)
-            {
-              pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
-              first = false;
-            }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-            VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-            for (size_t c = 0; c < nbClasses; c++)
-            {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-              Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-              VVdouble* pxy_c = &pxy[c];
-              for (size_t x = 0; x < nbStates; x++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[x];
-                double likelihood = 0.;
-                for (size_t y = 0; y < nbStates; y++)
-                {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
-                }
-                (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-              }
-            }
-          }
+          getSitePartition(*mit->next(), sites);
+          if (sites.empty())
+            continue;
+          // Transition probabilities are the same for all sites in a partition:
+          VVVdouble pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), sites[0]);
+          multiplyByNeighbourLikelihoods(sites, pxy, *likelihoodsFather_son, false, likelihoodsFatherConstantPart, nbThreads);
         }
       }
     }
     if (father->hasFather())
     {
       const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+      const LikelihoodArray* likelihoodsFather_son = &data->getLikelihoodBuffer(father->getId(), currentSon->getId());
       // Now iterate over all site partitions:
       auto_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
-      VVVdouble pxy;
-      bool first;
       while (mit->hasNext())
       {
-        TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-        auto_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-        first = true;
-        while (sit->hasNext())
-        {
-          size_t i = sit->next();
-          // We retrieve the transition probabilities for this site partition:
-          if (first)
-          {
-            pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
-            first = false;
-          }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-          VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-          for (size_t c = 0; c < nbClasses; c++)
-          {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-            Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-            VVdouble* pxy_c = &pxy[c];
-            for (size_t x = 0; x < nbStates; x++)
-            {
-              double likelihood = 0.;
-              for (size_t y = 0; y < nbStates; y++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
-              }
-              (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-            }
-          }
-        }
+        getSitePartition(*mit->next(), sites);
+        if (sites.empty())
+          continue;
+        VVVdouble pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), sites[0]);
+        multiplyByNeighbourLikelihoods(sites, pxy, *likelihoodsFather_son, true, likelihoodsFatherConstantPart, nbThreads);
       }
     }
     else
@@ -250,7 +237,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
       // Account for root frequencies:
       for (size_t i = 0; i < nbDistinctSites; i++)
       {
-        vector<double> freqs = drtl.getRootFrequencies(i);
+        const vector<double>& freqs = drtl.getRootFrequencies(i);
         VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
         for (size_t c = 0; c < nbClasses; c++)
         {
@@ -262,86 +249,132 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
         }
       }
     }
+  }
+
+  /**
+   * Compute the posterior number of substitutions of each type on the branch
+   * leading to a node, for each distinct site.
+   *
+   * Distinct sites are independent, so they are processed by blocks on
+   * several threads. The substitution count is only used outside the parallel
+   * sections, as it is not thread-safe.
+   *
+   * Counts are normalized by the likelihood of each site, computed from the
+   * same conditional likelihood arrays, so that the scaling factors of these
+   * arrays cancel out.
+   *
+   * @param drtl              The likelihood object.
+   * @param modelSet          If not null, the model set to take the model of
+   *                          the branch from. Otherwise, models are taken from
+   *                          the likelihood object.
+   * @param currentNode       The node at the bottom of the branch.
+   * @param substitutionCount The SubstitutionCount to use.
+   * @param substitutions     [out] The counts, one vector of size the number of
+   *                          types for each distinct site.
+   * @param nbThreads         The number of threads to use.
+   */
+  void computeSubstitutionsForBranch(
+    const DRTreeLikelihood& drtl,
+    const SubstitutionModelSet* modelSet,
+    const Node* currentNode,
+    SubstitutionCount& substitutionCount,
+    VVdouble& substitutions,
+    size_t nbThreads)
+  {
+    const DiscreteDistribution* rDist = drtl.getRateDistribution();
+    const DRASDRTreeLikelihoodData* data = drtl.getLikelihoodData();
 
+    size_t nbDistinctSites = data->getNumberOfDistinctSites();
+    size_t nbStates        = drtl.getData()->getAlphabet()->getSize();
+    size_t nbClasses       = rDist->getNumberOfCategories();
+    size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
+    Vdouble rcRates = rDist->getCategories();
+
+    const Node* father = currentNode->getFather();
+    double d = currentNode->getDistanceToFather();
+
+    VVVdouble likelihoodsFatherConstantPart;
+    computeFatherConstantPart(drtl, currentNode, likelihoodsFatherConstantPart, nbThreads);
+    vector<size_t> sites;
 
     // Then, we deal with the node of interest.
     // We first average upon 'y' to save computations, and then upon 'x'.
     // ('y' is the state at 'node' and 'x' the state at 'father'.)
+    substitutions.resize(nbDistinctSites);
+    for (size_t i = 0; i < nbDistinctSites; ++i)
+    {
+      substitutions[i].assign(nbTypes, 0);
+    }
+    Vdouble siteLikelihoods(nbDistinctSites, 0.);
 
     // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &(drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId()));
+    const LikelihoodArray* likelihoodsFather_node = &data->getLikelihoodBuffer(father->getId(), currentNode->getId());
     auto_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
-    VVVdouble pxy;
-    bool first;
     while (mit->hasNext())
     {
       TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-      substitutionCount.setSubstitutionModel(bmd->getModel());
-      // compute all nxy first:
-      VVVVdouble nxy(nbClasses);
+      if (modelSet)
+        substitutionCount.setSubstitutionModel(modelSet->getModelForNode(currentNode->getId()));
+      else
+        substitutionCount.setSubstitutionModel(bmd->getModel());
+
+      // compute all nxy first, for all rate classes at once:
+      Vdouble lengths(nbClasses);
       for (size_t c = 0; c < nbClasses; ++c)
       {
-        VVVdouble* nxy_c = &nxy[c];
-        double rc = rcRates[c];
-        nxy_c->resize(nbTypes);
-        for (size_t t = 0; t < nbTypes; ++t)
-        {
-          VVdouble* nxy_c_t = &(*nxy_c)[t];
-          Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rc, t + 1);
-          nxy_c_t->resize(nbStates);
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            Vdouble* nxy_c_t_x = &(*nxy_c_t)[x];
-            nxy_c_t_x->resize(nbStates);
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              (*nxy_c_t_x)[y] = (*nijt)(x, y);
-            }
-          }
-          delete nijt;
-        }
+        lengths[c] = d * rcRates[c];
       }
+      VVVVdouble nxy;
+      substitutionCount.getAllNumbersOfSubstitutionsForEachType(lengths, nxy);
 
       // Now loop over sites:
-      auto_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-      first = true;
-      while (sit->hasNext())
+      getSitePartition(*bmd, sites);
+      if (sites.empty())
+        continue;
+      // We retrieve the transition probabilities for this site partition:
+      VVVdouble pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), sites[0]);
+      long nbBlocks = static_cast<long>((sites.size() + SITE_BLOCK_SIZE - 1) / SITE_BLOCK_SIZE);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads))
+#endif
+      for (long b = 0; b < nbBlocks; ++b)
       {
-        size_t i = sit->next();
-        // We retrieve the transition probabilities and substitution counts for this site partition:
-        if (first)
-        {
-          pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
-          first = false;
-        }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; ++c)
+        size_t begin = static_cast<size_t>(b) * SITE_BLOCK_SIZE;
+        size_t end   = min(begin + SITE_BLOCK_SIZE, sites.size());
+        for (size_t k = begin; k < end; ++k)
         {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          const VVdouble* pxy_c = &pxy[c];
-          VVVdouble* nxy_c = &nxy[c];
-          for (size_t x = 0; x < nbStates; ++x)
+          size_t i = sites[k];
+          Vdouble* substitutions_i = &substitutions[i];
+          double* siteLikelihoods_i = &siteLikelihoods[i];
+          VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
+          for (size_t c = 0; c < nbClasses; ++c)
           {
-            double* likelihoodsFatherConstantPart_i_c_x = &(*likelihoodsFatherConstantPart_i_c)[x];
-            const Vdouble* pxy_c_x = &(*pxy_c)[x];
-            for (size_t y = 0; y < nbStates; ++y)
+            const double* likelihoodsFather_node_i_c = (*likelihoodsFather_node)(i, c);
+            Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
+            const VVdouble* pxy_c = &pxy[c];
+            const VVVdouble* nxy_c = &nxy[c];
+            for (size_t x = 0; x < nbStates; ++x)
             {
-              double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
-                                      * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
-
-              for (size_t t = 0; t < nbTypes; ++t)
+              double likelihoodsFatherConstantPart_i_c_x = (*likelihoodsFatherConstantPart_i_c)[x];
+              const Vdouble* pxy_c_x = &(*pxy_c)[x];
+              for (size_t y = 0; y < nbStates; ++y)
               {
-                // Now the vector computation:
-                substitutionsForCurrentNode[i][t] += likelihood_cxy * (*nxy_c)[t][x][y];
-                //                                   <------------>   <--------------->
-                // Posterior probability                   |                 |
-                // for site i and rate class c *           |                 |
-                // likelihood for this site----------------+                 |
-                //                                                           |
-                // Substitution function for site i and rate class c----------+
+                double likelihood_cxy = likelihoodsFatherConstantPart_i_c_x
+                                        * (*pxy_c_x)[y]
+                                        * likelihoodsFather_node_i_c[y];
+                (*siteLikelihoods_i) += likelihood_cxy;
+
+                for (size_t t = 0; t < nbTypes; ++t)
+                {
+                  // Now the vector computation:
+                  (*substitutions_i)[t] += likelihood_cxy * (*nxy_c)[t][x][y];
+                  //                       <------------>   <--------------->
+                  // Posterior probability       |                 |
+                  // for site i and rate class c *                 |
+                  // likelihood for this site----+                 |
+                  //                                               |
+                  // Substitution function for site i and rate class c
+                }
               }
             }
           }
@@ -349,335 +382,271 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
       }
     }
 
-    // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbSites; ++i)
+    // Normalize by the likelihood of each site:
+    for (size_t i = 0; i < nbDistinctSites; ++i)
     {
       for (size_t t = 0; t < nbTypes; ++t)
       {
-        (*substitutions)(l, i, t) = substitutionsForCurrentNode[(*rootPatternLinks)[i]][t] / Lr[(*rootPatternLinks)[i]];
+        substitutions[i][t] /= siteLikelihoods[i];
       }
     }
   }
-  if (verbose)
+
+  /**
+   * Get the nodes at the bottom of the branches with the given ids.
+   */
+  vector<const Node*> getBranchNodes(const TreeTemplate<Node>& tree, const vector<int>& ids) throw (Exception)
   {
-    if (ApplicationTools::message)
-      *ApplicationTools::message << " ";
-    ApplicationTools::displayTaskDone();
+    vector<const Node*> nodes(ids.size());
+    for (size_t k = 0; k < ids.size(); ++k)
+    {
+      nodes[k] = tree.getNode(ids[k]);
+      if (!nodes[k]->hasFather())
+        throw Exception("SubstitutionMappingTools. No branch above node " + TextTools::toString(ids[k]) + ".");
+    }
+    return nodes;
   }
 
-  return substitutions;
-}
-
-/******************************************************************************/
-
-ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectors(
-  const DRTreeLikelihood& drtl,
-  const SubstitutionModelSet& modelSet,
-  const vector<int>& nodeIds,
-  SubstitutionCount& substitutionCount,
-  bool verbose) throw (Exception)
-{
-  // Preamble:
-  if (!drtl.isInitialized())
-    throw Exception("SubstitutionMappingTools::computeSubstitutionVectors(). Likelihood object is not initialized.");
-
-  // A few variables we'll need:
+  ProbabilisticSubstitutionMapping* mapSubstitutions(
+    const DRTreeLikelihood& drtl,
+    const SubstitutionModelSet* modelSet,
+    const vector<int>& nodeIds,
+    SubstitutionCount& substitutionCount,
+    bool verbose,
+    size_t nbThreads) throw (Exception)
+  {
+    // Preamble:
+    if (!drtl.isInitialized())
+      throw Exception("SubstitutionMappingTools::computeSubstitutionVectors(). Likelihood object is not initialized.");
+    nbThreads = getEffectiveNumberOfThreads(nbThreads);
+
+    // A few variables we'll need:
+
+    const TreeTemplate<Node> tree(drtl.getTree());
+    size_t nbSites         = drtl.getData()->getNumberOfSites();
+    size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
+    vector<const Node*> nodes    = tree.getNodes();
+    const vector<size_t>* rootPatternLinks
+      = &drtl.getLikelihoodData()->getRootArrayPositions();
+    nodes.pop_back(); // Remove root node.
+    size_t nbNodes         = nodes.size();
+
+    // We create a new ProbabilisticSubstitutionMapping object:
+    ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
+
+    // Compute the number of substitutions for each class and each branch in the tree:
+    if (verbose)
+      ApplicationTools::displayTask("Compute joint node-pairs likelihood", true);
 
-  const TreeTemplate<Node> tree(drtl.getTree());
-  const SiteContainer*    sequences = drtl.getData();
-  const DiscreteDistribution* rDist = drtl.getRateDistribution();
+    VVdouble substitutionsForCurrentNode;
+    for (size_t l = 0; l < nbNodes; ++l)
+    {
+      // For each node,
+      const Node* currentNode = nodes[l];
+      if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, currentNode->getId()))
+        continue;
 
-  size_t nbSites         = sequences->getNumberOfSites();
-  size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
-  size_t nbStates        = sequences->getAlphabet()->getSize();
-  size_t nbClasses       = rDist->getNumberOfCategories();
-  size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
-  vector<const Node*> nodes    = tree.getNodes();
-  const vector<size_t>* rootPatternLinks
-    = &drtl.getLikelihoodData()->getRootArrayPositions();
-  nodes.pop_back(); // Remove root node.
-  size_t nbNodes         = nodes.size();
+      if (verbose)
+        ApplicationTools::displayGauge(l, nbNodes - 1);
 
-  // We create a new ProbabilisticSubstitutionMapping object:
-  ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
+      computeSubstitutionsForBranch(drtl, modelSet, currentNode, substitutionCount, substitutionsForCurrentNode, nbThreads);
 
-  // Store likelihood for each rate for each site:
-  VVVdouble lik;
-  drtl.computeLikelihoodAtNode(tree.getRootId(), lik);
-  Vdouble Lr(nbDistinctSites, 0);
-  Vdouble rcProbs = rDist->getProbabilities();
-  Vdouble rcRates = rDist->getCategories();
-  for (size_t i = 0; i < nbDistinctSites; i++)
-  {
-    VVdouble* lik_i = &lik[i];
-    for (size_t c = 0; c < nbClasses; c++)
-    {
-      Vdouble* lik_i_c = &(*lik_i)[c];
-      double rc = rDist->getProbability(c);
-      for (size_t s = 0; s < nbStates; s++)
+      // Now we just have to copy the substitutions into the result vector:
+      for (size_t i = 0; i < nbSites; ++i)
       {
-        Lr[i] += (*lik_i_c)[s] * rc;
+        for (size_t t = 0; t < nbTypes; ++t)
+        {
+          (*substitutions)(l, i, t) = substitutionsForCurrentNode[(*rootPatternLinks)[i]][t];
+        }
       }
     }
-  }
+    if (verbose)
+    {
+      if (ApplicationTools::message)
+        *ApplicationTools::message << " ";
+      ApplicationTools::displayTaskDone();
+    }
 
-  // Compute the number of substitutions for each class and each branch in the tree:
-  if (verbose)
-    ApplicationTools::displayTask("Compute joint node-pairs likelihood", true);
+    return substitutions;
+  }
 
-  for (size_t l = 0; l < nbNodes; ++l)
+  vector< vector<double> > sumSubstitutionsPerBranch(
+    const DRTreeLikelihood& drtl,
+    const SubstitutionModelSet* modelSet,
+    const vector<int>& ids,
+    SubstitutionCount& substitutionCount,
+    double threshold,
+    bool verbose,
+    size_t nbThreads) throw (Exception)
   {
-    // For each node,
-    const Node* currentNode = nodes[l];
-    if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, currentNode->getId()))
-      continue;
-
-    const Node* father = currentNode->getFather();
-
-    double d = currentNode->getDistanceToFather();
-
-    if (verbose)
-      ApplicationTools::displayGauge(l, nbNodes - 1);
-    VVdouble substitutionsForCurrentNode(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; ++i)
+    if (!drtl.isInitialized())
+      throw Exception("SubstitutionMappingTools::computeCountsPerBranch(). Likelihood object is not initialized.");
+    nbThreads = getEffectiveNumberOfThreads(nbThreads);
+
+    const TreeTemplate<Node> tree(drtl.getTree());
+    size_t nbSites = drtl.getData()->getNumberOfSites();
+    size_t nbTypes = substitutionCount.getNumberOfSubstitutionTypes();
+    const vector<size_t>& rootPatternLinks = drtl.getLikelihoodData()->getRootArrayPositions();
+    vector<const Node*> nodes = getBranchNodes(tree, ids);
+
+    size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
+    vector<size_t> weights(nbDistinctSites, 0);
+    for (size_t i = 0; i < nbSites; ++i)
     {
-      substitutionsForCurrentNode[i].resize(nbTypes);
+      weights[rootPatternLinks[i]]++;
     }
 
-    // Now we've got to compute likelihoods in a smart manner... ;)
-    VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; i++)
+    vector< vector<double> > counts(nodes.size());
+    VVdouble substitutionsForCurrentNode;
+    for (size_t k = 0; k < nodes.size(); ++k)
     {
-      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-      likelihoodsFatherConstantPart_i->resize(nbClasses);
-      for (size_t c = 0; c < nbClasses; c++)
+      computeSubstitutionsForBranch(drtl, modelSet, nodes[k], substitutionCount, substitutionsForCurrentNode, nbThreads);
+
+      vector<double> countsf(nbTypes, 0);
+      size_t nbIgnored = 0;
+      bool error = false;
+      for (size_t i = 0; !error && i < nbDistinctSites; ++i)
       {
-        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-        likelihoodsFatherConstantPart_i_c->resize(nbStates);
-        double rc = rDist->getProbability(c);
-        for (size_t s = 0; s < nbStates; s++)
+        if (weights[i] == 0)
+          continue;
+        const Vdouble* tmp = &substitutionsForCurrentNode[i];
+        double s = 0;
+        for (size_t t = 0; !error && t < nbTypes; ++t)
         {
-          // (* likelihoodsFatherConstantPart_i_c)[s] = rc * model->freq(s);
-          // freq is already accounted in the array
-          (*likelihoodsFatherConstantPart_i_c)[s] = rc;
+          error = isnan((*tmp)[t]);
+          s += (*tmp)[t];
         }
-      }
-    }
-
-    // First, what will remain constant:
-    size_t nbSons =  father->getNumberOfSons();
-    for (size_t n = 0; n < nbSons; n++)
-    {
-      const Node* currentSon = father->getSon(n);
-      if (currentSon->getId() != currentNode->getId())
-      {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-
-        // Now iterate over all site partitions:
-        auto_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
-        VVVdouble pxy;
-        bool first;
-        while (mit->hasNext())
+        if (error)
+          break;
+        if (threshold >= 0 && s > threshold)
         {
-          TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-          auto_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-          first = true;
-          while (sit->hasNext())
-          {
-            size_t i = sit->next();
-            // We retrieve the transition probabilities for this site partition:
-            if (first)
-            {
-              pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
-              first = false;
-            }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-            VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-            for (size_t c = 0; c < nbClasses; c++)
-            {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-              Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-              VVdouble* pxy_c = &pxy[c];
-              for (size_t x = 0; x < nbStates; x++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[x];
-                double likelihood = 0.;
-                for (size_t y = 0; y < nbStates; y++)
-                {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
-                }
-                (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-              }
-            }
-          }
+          nbIgnored += weights[i];
         }
-      }
-    }
-    if (father->hasFather())
-    {
-      const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-      // Now iterate over all site partitions:
-      auto_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
-      VVVdouble pxy;
-      bool first;
-      while (mit->hasNext())
-      {
-        TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-        auto_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-        first = true;
-        while (sit->hasNext())
+        else
         {
-          size_t i = sit->next();
-          // We retrieve the transition probabilities for this site partition:
-          if (first)
+          double w = static_cast<double>(weights[i]);
+          for (size_t t = 0; t < nbTypes; ++t)
           {
-            pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
-            first = false;
-          }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-          VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-          for (size_t c = 0; c < nbClasses; c++)
-          {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-            Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-            VVdouble* pxy_c = &pxy[c];
-            for (size_t x = 0; x < nbStates; x++)
-            {
-              double likelihood = 0.;
-              for (size_t y = 0; y < nbStates; y++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
-              }
-              (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-            }
+            countsf[t] += w * (*tmp)[t];
           }
         }
       }
-    }
-    else
-    {
-      // Account for root frequencies:
-      for (size_t i = 0; i < nbDistinctSites; i++)
+
+      if (error)
       {
-        vector<double> freqs = drtl.getRootFrequencies(i);
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; c++)
-        {
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          for (size_t x = 0; x < nbStates; x++)
-          {
-            (*likelihoodsFatherConstantPart_i_c)[x] *= freqs[x];
-          }
-        }
+        // We do nothing. This happens for small branches.
+        if (verbose)
+          ApplicationTools::displayWarning("On branch " + TextTools::toString(nodes[k]->getId()) + ", counts could not be computed.");
+        countsf.assign(nbTypes, 0);
       }
+      else if (nbIgnored > 0)
+      {
+        if (verbose)
+          ApplicationTools::displayWarning("On branch " + TextTools::toString(nodes[k]->getId()) + ", " + TextTools::toString(nbIgnored) + " sites (" + TextTools::toString(ceil(static_cast<double>(nbIgnored * 100) / static_cast<double>(nbSites))) + "%) have been ignored because they are presumably saturated.");
+      }
+      counts[k] = countsf;
     }
 
+    return counts;
+  }
+}
 
-    // Then, we deal with the node of interest.
-    // We first average upon 'y' to save computations, and then upon 'x'.
-    // ('y' is the state at 'node' and 'x' the state at 'father'.)
+/******************************************************************************/
 
-    // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &(drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId()));
-    auto_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
-    VVVdouble pxy;
-    bool first;
-    while (mit->hasNext())
-    {
-      TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-      substitutionCount.setSubstitutionModel(modelSet.getModelForNode(currentNode->getId()));
+ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectors(
+  const DRTreeLikelihood& drtl,
+  const vector<int>& nodeIds,
+  SubstitutionCount& substitutionCount,
+  bool verbose,
+  size_t nbThreads) throw (Exception)
+{
+  return mapSubstitutions(drtl, 0, nodeIds, substitutionCount, verbose, nbThreads);
+}
 
-      // compute all nxy first:
-      VVVVdouble nxy(nbClasses);
-      for (size_t c = 0; c < nbClasses; ++c)
-      {
-        VVVdouble* nxy_c = &nxy[c];
-        double rc = rcRates[c];
-        nxy_c->resize(nbTypes);
-        for (size_t t = 0; t < nbTypes; ++t)
-        {
-          VVdouble* nxy_c_t = &(*nxy_c)[t];
-          Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rc, t + 1);
-          nxy_c_t->resize(nbStates);
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            Vdouble* nxy_c_t_x = &(*nxy_c_t)[x];
-            nxy_c_t_x->resize(nbStates);
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              (*nxy_c_t_x)[y] = (*nijt)(x, y);
-            }
-          }
-          delete nijt;
-        }
-      }
+/******************************************************************************/
 
-      // Now loop over sites:
-      auto_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-      first = true;
-      while (sit->hasNext())
-      {
-        size_t i = sit->next();
-        // We retrieve the transition probabilities and substitution counts for this site partition:
-        if (first)
-        {
-          pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
-          first = false;
-        }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; ++c)
-        {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          const VVdouble* pxy_c = &pxy[c];
-          VVVdouble* nxy_c = &nxy[c];
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            double* likelihoodsFatherConstantPart_i_c_x = &(*likelihoodsFatherConstantPart_i_c)[x];
-            const Vdouble* pxy_c_x = &(*pxy_c)[x];
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
-                                      * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
+ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectors(
+  const DRTreeLikelihood& drtl,
+  const SubstitutionModelSet& modelSet,
+  const vector<int>& nodeIds,
+  SubstitutionCount& substitutionCount,
+  bool verbose,
+  size_t nbThreads) throw (Exception)
+{
+  return mapSubstitutions(drtl, &modelSet, nodeIds, substitutionCount, verbose, nbThreads);
+}
+
+/******************************************************************************/
+
+vector< vector<double> > SubstitutionMappingTools::computeCountsPerBranch(
+  const DRTreeLikelihood& drtl,
+  const vector<int>& ids,
+  SubstitutionCount& substitutionCount,
+  double threshold,
+  bool verbose,
+  size_t nbThreads) throw (Exception)
+{
+  return sumSubstitutionsPerBranch(drtl, 0, ids, substitutionCount, threshold, verbose, nbThreads);
+}
+
+/******************************************************************************/
+
+vector< vector<double> > SubstitutionMappingTools::computeCountsPerBranch(
+  const DRTreeLikelihood& drtl,
+  const SubstitutionModelSet& modelSet,
+  const vector<int>& ids,
+  SubstitutionCount& substitutionCount,
+  double threshold,
+  bool verbose,
+  size_t nbThreads) throw (Exception)
+{
+  return sumSubstitutionsPerBranch(drtl, &modelSet, ids, substitutionCount, threshold, verbose, nbThreads);
+}
 
-              for (size_t t = 0; t < nbTypes; ++t)
-              {
-                // Now the vector computation:
-                substitutionsForCurrentNode[i][t] += likelihood_cxy * (*nxy_c)[t][x][y];
-                //                                   <------------>   <--------------->
-                // Posterior probability                   |                 |
-                // for site i and rate class c *           |                 |
-                // likelihood for this site----------------+                 |
-                //                                                           |
-                // Substitution function for site i and rate class c----------+
-              }
-            }
-          }
-        }
-      }
-    }
+/******************************************************************************/
 
-    // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbSites; ++i)
+vector< vector<double> > SubstitutionMappingTools::computeCountsPerSite(
+  const DRTreeLikelihood& drtl,
+  const vector<int>& nodeIds,
+  SubstitutionCount& substitutionCount,
+  size_t nbThreads) throw (Exception)
+{
+  if (!drtl.isInitialized())
+    throw Exception("SubstitutionMappingTools::computeCountsPerSite(). Likelihood object is not initialized.");
+  nbThreads = getEffectiveNumberOfThreads(nbThreads);
+
+  const TreeTemplate<Node> tree(drtl.getTree());
+  size_t nbSites = drtl.getData()->getNumberOfSites();
+  size_t nbTypes = substitutionCount.getNumberOfSubstitutionTypes();
+  const vector<size_t>& rootPatternLinks = drtl.getLikelihoodData()->getRootArrayPositions();
+  vector<const Node*> nodes = tree.getNodes();
+  nodes.pop_back(); // Remove root node.
+
+  size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
+
+  // Sum over branches for each distinct site:
+  VVdouble patternCounts(nbDistinctSites, Vdouble(nbTypes, 0));
+  VVdouble substitutionsForCurrentNode;
+  for (size_t k = 0; k < nodes.size(); ++k)
+  {
+    if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, nodes[k]->getId()))
+      continue;
+    computeSubstitutionsForBranch(drtl, 0, nodes[k], substitutionCount, substitutionsForCurrentNode, nbThreads);
+    for (size_t i = 0; i < nbDistinctSites; ++i)
     {
       for (size_t t = 0; t < nbTypes; ++t)
       {
-        (*substitutions)(l, i, t) = substitutionsForCurrentNode[(*rootPatternLinks)[i]][t] / Lr[(*rootPatternLinks)[i]];
+        patternCounts[i][t] += substitutionsForCurrentNode[i][t];
       }
     }
   }
-  if (verbose)
+
+  vector< vector<double> > counts(nbSites);
+  for (size_t i = 0; i < nbSites; ++i)
   {
-    if (ApplicationTools::message)
-      *ApplicationTools::message << " ";
-    ApplicationTools::displayTaskDone();
+    counts[i] = patternCounts[rootPatternLinks[i]];
   }
-
-  return substitutions;
+  return counts;
 }
 
 /**************************************************************************************************/
@@ -685,11 +654,13 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
 ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectorsNoAveraging(
   const DRTreeLikelihood& drtl,
   SubstitutionCount& substitutionCount,
-  bool verbose) throw (Exception)
+  bool verbose,
+  size_t nbThreads) throw (Exception)
 {
   // Preamble:
   if (!drtl.isInitialized())
     throw Exception("SubstitutionMappingTools::computeSubstitutionVectorsNoAveraging(). Likelihood object is not initialized.");
+  nbThreads = getEffectiveNumberOfThreads(nbThreads);
 
   // A few variables we'll need:
   const TreeTemplate<Node> tree(drtl.getTree());
@@ -711,6 +682,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
 
   Vdouble rcRates = rDist->getCategories();
+  vector<size_t> sites;
 
   // Compute the number of substitutions for each class and each branch in the tree:
   if (verbose)
@@ -733,229 +705,87 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
       substitutionsForCurrentNode[i].resize(nbTypes);
     }
 
-    // Now we've got to compute likelihoods in a smart manner... ;)
-    VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; ++i)
-    {
-      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-      likelihoodsFatherConstantPart_i->resize(nbClasses);
-      for (size_t c = 0; c < nbClasses; ++c)
-      {
-        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-        likelihoodsFatherConstantPart_i_c->resize(nbStates);
-        double rc = rDist->getProbability(c);
-        for (size_t s = 0; s < nbStates; ++s)
-        {
-          // (* likelihoodsFatherConstantPart_i_c)[s] = rc * model->freq(s);
-          // freq is already accounted in the array
-          (*likelihoodsFatherConstantPart_i_c)[s] = rc;
-        }
-      }
-    }
-
-    // First, what will remain constant:
-    size_t nbSons =  father->getNumberOfSons();
-    for (size_t n = 0; n < nbSons; ++n)
-    {
-      const Node* currentSon = father->getSon(n);
-      if (currentSon->getId() != currentNode->getId())
-      {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-
-        // Now iterate over all site partitions:
-        auto_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
-        VVVdouble pxy;
-        bool first;
-        while (mit->hasNext())
-        {
-          TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-          auto_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-          first = true;
-          while (sit->hasNext())
-          {
-            size_t i = sit->next();
-            // We retrieve the transition probabilities for this site partition:
-            if (first)
-            {
-              pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
-              first = false;
-            }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-            VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-            for (size_t c = 0; c < nbClasses; ++c)
-            {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-              Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-              VVdouble* pxy_c = &pxy[c];
-              for (size_t x = 0; x < nbStates; ++x)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[x];
-                double likelihood = 0.;
-                for (size_t y = 0; y < nbStates; ++y)
-                {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
-                }
-                (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-              }
-            }
-          }
-        }
-      }
-    }
-    if (father->hasFather())
-    {
-      const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-      // Now iterate over all site partitions:
-      auto_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
-      VVVdouble pxy;
-      bool first;
-      while (mit->hasNext())
-      {
-        TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-        auto_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-        first = true;
-        while (sit->hasNext())
-        {
-          size_t i = sit->next();
-          // We retrieve the transition probabilities for this site partition:
-          if (first)
-          {
-            pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
-            first = false;
-          }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-          VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-          for (size_t c = 0; c < nbClasses; ++c)
-          {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-            Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-            VVdouble* pxy_c = &pxy[c];
-            for (size_t x = 0; x < nbStates; ++x)
-            {
-              double likelihood = 0.;
-              for (size_t y = 0; y < nbStates; ++y)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
-              }
-              (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-            }
-          }
-        }
-      }
-    }
-    else
-    {
-      // Account for root frequencies:
-      for (size_t i = 0; i < nbDistinctSites; ++i)
-      {
-        vector<double> freqs = drtl.getRootFrequencies(i);
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; ++c)
-        {
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            (*likelihoodsFatherConstantPart_i_c)[x] *= freqs[x];
-          }
-        }
-      }
-    }
+    VVVdouble likelihoodsFatherConstantPart;
+    computeFatherConstantPart(drtl, currentNode, likelihoodsFatherConstantPart, nbThreads);
 
     // Then, we deal with the node of interest.
-    // We first average uppon 'y' to save computations, and then uppon 'x'.
     // ('y' is the state at 'node' and 'x' the state at 'father'.)
 
     // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId());
+    const LikelihoodArray* likelihoodsFather_node = &drtl.getLikelihoodData()->getLikelihoodBuffer(father->getId(), currentNode->getId());
     auto_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
-    VVVdouble pxy;
-    bool first;
     while (mit->hasNext())
     {
       TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
       substitutionCount.setSubstitutionModel(bmd->getModel());
-      // compute all nxy first:
-      VVVVdouble nxy(nbClasses);
+      // compute all nxy first, for all rate classes at once:
+      Vdouble lengths(nbClasses);
       for (size_t c = 0; c < nbClasses; ++c)
       {
-        double rc = rcRates[c];
-        VVVdouble* nxy_c = &nxy[c];
-        nxy_c->resize(nbTypes);
-        for (size_t t = 0; t < nbTypes; ++t)
-        {
-          VVdouble* nxy_c_t = &(*nxy_c)[t];
-          nxy_c_t->resize(nbStates);
-          Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rc, t + 1);
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            Vdouble* nxy_c_t_x = &(*nxy_c_t)[x];
-            nxy_c_t_x->resize(nbStates);
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              (*nxy_c_t_x)[y] = (*nijt)(x, y);
-            }
-          }
-          delete nijt;
-        }
+        lengths[c] = d * rcRates[c];
       }
+      VVVVdouble nxy;
+      substitutionCount.getAllNumbersOfSubstitutionsForEachType(lengths, nxy);
 
       // Now loop over sites:
-      auto_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-      first = true;
-      while (sit->hasNext())
+      getSitePartition(*bmd, sites);
+      if (sites.empty())
+        continue;
+      // We retrieve the transition probabilities for this site partition:
+      VVVdouble pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), sites[0]);
+      long nbBlocks = static_cast<long>((sites.size() + SITE_BLOCK_SIZE - 1) / SITE_BLOCK_SIZE);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads))
+#endif
+      for (long b = 0; b < nbBlocks; ++b)
       {
-        size_t i = sit->next();
-        // We retrieve the transition probabilities and substitution counts for this site partition:
-        if (first)
-        {
-          pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
-          first = false;
-        }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
         RowMatrix<double> pairProbabilities(nbStates, nbStates);
-        MatrixTools::fill(pairProbabilities, 0.);
-        VVVdouble subsCounts(nbStates);
-        for (size_t j = 0; j < nbStates; ++j)
-        {
-          subsCounts[j].resize(nbStates);
-          for (size_t k = 0; k < nbStates; ++k)
-          {
-            subsCounts[j][k].resize(nbTypes);
-          }
-        }
-        for (size_t c = 0; c < nbClasses; ++c)
+        VVVdouble subsCounts(nbStates, VVdouble(nbStates, Vdouble(nbTypes)));
+        size_t begin = static_cast<size_t>(b) * SITE_BLOCK_SIZE;
+        size_t end   = min(begin + SITE_BLOCK_SIZE, sites.size());
+        for (size_t k = begin; k < end; ++k)
         {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          const VVdouble* pxy_c = &pxy[c];
-          VVVdouble* nxy_c = &nxy[c];
+          size_t i = sites[k];
+          VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
+          MatrixTools::fill(pairProbabilities, 0.);
           for (size_t x = 0; x < nbStates; ++x)
           {
-            double* likelihoodsFatherConstantPart_i_c_x = &(*likelihoodsFatherConstantPart_i_c)[x];
-            const Vdouble* pxy_c_x = &(*pxy_c)[x];
             for (size_t y = 0; y < nbStates; ++y)
             {
-              double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
-                                      * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
-              pairProbabilities(x, y) += likelihood_cxy; // Sum over all rate classes.
-              for (size_t t = 0; t < nbTypes; ++t)
+              subsCounts[x][y].assign(nbTypes, 0.);
+            }
+          }
+          for (size_t c = 0; c < nbClasses; ++c)
+          {
+            const double* likelihoodsFather_node_i_c = (*likelihoodsFather_node)(i, c);
+            Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
+            const VVdouble* pxy_c = &pxy[c];
+            const VVVdouble* nxy_c = &nxy[c];
+            for (size_t x = 0; x < nbStates; ++x)
+            {
+              double likelihoodsFatherConstantPart_i_c_x = (*likelihoodsFatherConstantPart_i_c)[x];
+              const Vdouble* pxy_c_x = &(*pxy_c)[x];
+              for (size_t y = 0; y < nbStates; ++y)
               {
-                subsCounts[x][y][t] += likelihood_cxy * (*nxy_c)[t][x][y];
+                double likelihood_cxy = likelihoodsFatherConstantPart_i_c_x
+                                        * (*pxy_c_x)[y]
+                                        * likelihoodsFather_node_i_c[y];
+                pairProbabilities(x, y) += likelihood_cxy; // Sum over all rate classes.
+                for (size_t t = 0; t < nbTypes; ++t)
+                {
+                  subsCounts[x][y][t] += likelihood_cxy * (*nxy_c)[t][x][y];
+                }
               }
             }
           }
-        }
-        // Now the vector computation:
-        // Here we do not average over all possible pair of ancestral states,
-        // We only consider the one with max likelihood:
-        vector<size_t> xy = MatrixTools::whichMax(pairProbabilities);
-        for (size_t t = 0; t < nbTypes; ++t)
-        {
-          substitutionsForCurrentNode[i][t] += subsCounts[xy[0]][xy[1]][t] / pairProbabilities(xy[0], xy[1]);
+          // Now the vector computation:
+          // Here we do not average over all possible pair of ancestral states,
+          // We only consider the one with max likelihood:
+          vector<size_t> xy = MatrixTools::whichMax(pairProbabilities);
+          for (size_t t = 0; t < nbTypes; ++t)
+          {
+            substitutionsForCurrentNode[i][t] += subsCounts[xy[0]][xy[1]][t] / pairProbabilities(xy[0], xy[1]);
+          }
         }
       }
     }
@@ -982,11 +812,13 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
 ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectorsNoAveragingMarginal(
   const DRTreeLikelihood& drtl,
   SubstitutionCount& substitutionCount,
-  bool verbose) throw (Exception)
+  bool verbose,
+  size_t nbThreads) throw (Exception)
 {
   // Preamble:
   if (!drtl.isInitialized())
     throw Exception("SubstitutionMappingTools::computeSubstitutionVectorsNoAveragingMarginal(). Likelihood object is not initialized.");
+  nbThreads = getEffectiveNumberOfThreads(nbThreads);
 
   // A few variables we'll need:
 
@@ -1011,6 +843,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   // Compute the whole likelihood of the tree according to the specified model:
 
   Vdouble rcRates = rDist->getCategories();
+  vector<size_t> sites;
 
   // Compute the number of substitutions for each class and each branch in the tree:
   if (verbose)
@@ -1055,38 +888,35 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
       TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
       substitutionCount.setSubstitutionModel(bmd->getModel());
       // compute all nxy first:
-      VVVdouble nxyt(nbTypes);
-      for (size_t t = 0; t < nbTypes; ++t)
+      VVVVdouble nxy;
+      substitutionCount.getAllNumbersOfSubstitutionsForEachType(Vdouble(1, d), nxy);
+      const VVVdouble& nxyt = nxy[0];
+      // Now loop over sites:
+      getSitePartition(*bmd, sites);
+      long nbBlocks = static_cast<long>((sites.size() + SITE_BLOCK_SIZE - 1) / SITE_BLOCK_SIZE);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads))
+#endif
+      for (long b = 0; b < nbBlocks; ++b)
       {
-        nxyt[t].resize(nbStates);
-        Matrix<double>* nxy = substitutionCount.getAllNumbersOfSubstitutions(d, t + 1);
-        for (size_t x = 0; x < nbStates; ++x)
+        size_t begin = static_cast<size_t>(b) * SITE_BLOCK_SIZE;
+        size_t end   = min(begin + SITE_BLOCK_SIZE, sites.size());
+        for (size_t k = begin; k < end; ++k)
         {
-          nxyt[t][x].resize(nbStates);
-          for (size_t y = 0; y < nbStates; ++y)
-          {
-            nxyt[t][x][y] = (*nxy)(x, y);
-          }
+          size_t i = sites[k];
+          size_t fatherState = fatherStates[i];
+          size_t nodeState   = nodeStates[i];
+          if (fatherState >= nbStates || nodeState >= nbStates)
+            for (size_t t = 0; t < nbTypes; ++t)
+            {
+              substitutionsForCurrentNode[i][t] = 0;
+            }                                                    // To be conservative! Only in case there are generic characters.
+          else
+            for (size_t t = 0; t < nbTypes; ++t)
+            {
+              substitutionsForCurrentNode[i][t] = nxyt[t][fatherState][nodeState];
+            }
         }
-        delete nxy;
-      }
-      // Now loop over sites:
-      auto_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-      while (sit->hasNext())
-      {
-        size_t i = sit->next();
-        size_t fatherState = fatherStates[i];
-        size_t nodeState   = nodeStates[i];
-        if (fatherState >= nbStates || nodeState >= nbStates)
-          for (size_t t = 0; t < nbTypes; ++t)
-          {
-            substitutionsForCurrentNode[i][t] = 0;
-          }                                                    // To be conservative! Only in case there are generic characters.
-        else
-          for (size_t t = 0; t < nbTypes; ++t)
-          {
-            substitutionsForCurrentNode[i][t] = nxyt[t][fatherState][nodeState];
-          }
       }
     }
 
@@ -1113,11 +943,13 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
 ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectorsMarginal(
   const DRTreeLikelihood& drtl,
   SubstitutionCount& substitutionCount,
-  bool verbose) throw (Exception)
+  bool verbose,
+  size_t nbThreads) throw (Exception)
 {
   // Preamble:
   if (!drtl.isInitialized())
     throw Exception("SubstitutionMappingTools::computeSubstitutionVectorsMarginal(). Likelihood object is not initialized.");
+  nbThreads = getEffectiveNumberOfThreads(nbThreads);
 
   // A few variables we'll need:
 
@@ -1143,6 +975,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
 
   Vdouble rcProbs = rDist->getProbabilities();
   Vdouble rcRates = rDist->getCategories();
+  vector<size_t> sites;
 
   // II) Compute the number of substitutions for each class and each branch in the tree:
   if (verbose)
@@ -1176,58 +1009,52 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     {
       TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
       substitutionCount.setSubstitutionModel(bmd->getModel());
-      // compute all nxy first:
-      VVVVdouble nxy(nbClasses);
+      // compute all nxy first, for all rate classes at once:
+      Vdouble lengths(nbClasses);
       for (size_t c = 0; c < nbClasses; ++c)
       {
-        VVVdouble* nxy_c = &nxy[c];
-        double rc = rcRates[c];
-        nxy_c->resize(nbTypes);
-        for (size_t t = 0; t < nbTypes; ++t)
-        {
-          VVdouble* nxy_c_t = &(*nxy_c)[t];
-          Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rc, t + 1);
-          nxy_c_t->resize(nbStates);
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            Vdouble* nxy_c_t_x = &(*nxy_c_t)[x];
-            nxy_c_t_x->resize(nbStates);
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              (*nxy_c_t_x)[y] = (*nijt)(x, y);
-            }
-          }
-          delete nijt;
-        }
+        lengths[c] = d * rcRates[c];
       }
+      VVVVdouble nxy;
+      substitutionCount.getAllNumbersOfSubstitutionsForEachType(lengths, nxy);
 
       // Now loop over sites:
-      auto_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-      while (sit->hasNext())
+      getSitePartition(*bmd, sites);
+      long nbBlocks = static_cast<long>((sites.size() + SITE_BLOCK_SIZE - 1) / SITE_BLOCK_SIZE);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads))
+#endif
+      for (long b = 0; b < nbBlocks; ++b)
       {
-        size_t i = sit->next();
-        VVdouble* probsNode_i   = &probsNode[i];
-        VVdouble* probsFather_i = &probsFather[i];
-        for (size_t c = 0; c < nbClasses; ++c)
+        size_t begin = static_cast<size_t>(b) * SITE_BLOCK_SIZE;
+        size_t end   = min(begin + SITE_BLOCK_SIZE, sites.size());
+        for (size_t k = begin; k < end; ++k)
         {
-          Vdouble* probsNode_i_c   = &(*probsNode_i)[c];
-          Vdouble* probsFather_i_c = &(*probsFather_i)[c];
-          VVVdouble* nxy_c = &nxy[c];
-          for (size_t x = 0; x < nbStates; ++x)
+          size_t i = sites[k];
+          VVdouble* probsNode_i   = &probsNode[i];
+          VVdouble* probsFather_i = &probsFather[i];
+          Vdouble* substitutions_i = &substitutionsForCurrentNode[i];
+          for (size_t c = 0; c < nbClasses; ++c)
           {
-            for (size_t y = 0; y < nbStates; ++y)
+            Vdouble* probsNode_i_c   = &(*probsNode_i)[c];
+            Vdouble* probsFather_i_c = &(*probsFather_i)[c];
+            const VVVdouble* nxy_c = &nxy[c];
+            for (size_t x = 0; x < nbStates; ++x)
             {
-              double prob_cxy = (*probsFather_i_c)[x] * (*probsNode_i_c)[y];
-              // Now the vector computation:
-              for (size_t t = 0; t < nbTypes; ++t)
+              for (size_t y = 0; y < nbStates; ++y)
               {
-                substitutionsForCurrentNode[i][t] += prob_cxy * (*nxy_c)[t][x][y];
-                //                                   <------>   <--------------->
-                // Posterior probability                 |                |
-                // for site i and rate class c *         |                |
-                // likelihood for this site--------------+                |
-                //                                                        |
-                // Substitution function for site i and rate class c-------+
+                double prob_cxy = (*probsFather_i_c)[x] * (*probsNode_i_c)[y];
+                // Now the vector computation:
+                for (size_t t = 0; t < nbTypes; ++t)
+                {
+                  (*substitutions_i)[t] += prob_cxy * (*nxy_c)[t][x][y];
+                  //                       <------>   <--------------->
+                  // Posterior probability     |                |
+                  // for site i and rate class c *              |
+                  // likelihood for this site--+                |
+                  //                                            |
+                  // Substitution function for site i and rate class c
+                }
               }
             }
           }
@@ -1422,78 +1249,14 @@ vector< vector<double> > SubstitutionMappingTools::getCountsPerBranch(
   SubstitutionModel* model,
   const SubstitutionRegister& reg,
   double threshold,
-  bool verbose)
+  bool verbose,
+  size_t nbThreads)
 {
   SubstitutionRegister* reg2 = reg.clone();
 
   auto_ptr<SubstitutionCount> count(new UniformizationSubstitutionCount(model, reg2));
 
-  auto_ptr<ProbabilisticSubstitutionMapping> mapping(SubstitutionMappingTools::computeSubstitutionVectors(drtl, ids, *count, false));
-
-  vector< vector<double> > counts(ids.size());
-  size_t nbSites = mapping->getNumberOfSites();
-  size_t nbTypes = mapping->getNumberOfSubstitutionTypes();
-
-  for (size_t k = 0; k < ids.size(); ++k)
-  {
-    vector<double> countsf(nbTypes, 0);
-    vector<double> tmp(nbTypes, 0);
-    size_t nbIgnored = 0;
-    bool error = false;
-    for (size_t i = 0; !error && i < nbSites; ++i)
-    {
-      double s = 0;
-      for (size_t t = 0; t < nbTypes; ++t)
-      {
-        tmp[t] = (*mapping)(mapping->getNodeIndex(ids[k]), i, t);
-        error = isnan(tmp[t]);
-        if (error)
-          goto ERROR;
-        s += tmp[t];
-      }
-      if (threshold >= 0)
-      {
-        if (s <= threshold)
-          countsf += tmp;
-        else
-        {
-          nbIgnored++;
-        }
-      }
-      else
-      {
-        countsf += tmp;
-      }
-    }
-
-ERROR:
-    if (error)
-    {
-      // We do nothing. This happens for small branches.
-      if (verbose)
-        ApplicationTools::displayWarning("On branch " + TextTools::toString(ids[k]) + ", counts could not be computed.");
-      for (size_t t = 0; t < nbTypes; ++t)
-      {
-        countsf[t] = 0;
-      }
-    }
-    else
-    {
-      if (nbIgnored > 0)
-      {
-        if (verbose)
-          ApplicationTools::displayWarning("On branch " + TextTools::toString(ids[k]) + ", " + TextTools::toString(nbIgnored) + " sites (" + TextTools::toString(ceil(static_cast<double>(nbIgnored * 100) / static_cast<double>(nbSites))) + "%) have been ignored because they are presumably saturated.");
-      }
-    }
-
-    counts[k].resize(countsf.size());
-    for (size_t j = 0; j < countsf.size(); ++j)
-    {
-      counts[k][j] = countsf[j];
-    }
-  }
-
-  return counts;
+  return computeCountsPerBranch(drtl, ids, *count, threshold, verbose, nbThreads);
 }
 
 /**************************************************************************************************/
@@ -1504,78 +1267,14 @@ vector< vector<double> > SubstitutionMappingTools::getCountsPerBranch(
   const SubstitutionModelSet& modelSet,
   const SubstitutionRegister& reg,
   double threshold,
-  bool verbose)
+  bool verbose,
+  size_t nbThreads)
 {
   SubstitutionRegister* reg2 = reg.clone();
 
   auto_ptr<SubstitutionCount> count(new UniformizationSubstitutionCount(modelSet.getModel(0), reg2));
 
-  auto_ptr<ProbabilisticSubstitutionMapping> mapping(SubstitutionMappingTools::computeSubstitutionVectors(drtl, modelSet, ids, *count, false));
-
-  vector< vector<double> > counts(ids.size());
-  size_t nbSites = mapping->getNumberOfSites();
-  size_t nbTypes = mapping->getNumberOfSubstitutionTypes();
-
-  for (size_t k = 0; k < ids.size(); ++k)
-  {
-    vector<double> countsf(nbTypes, 0);
-    vector<double> tmp(nbTypes, 0);
-    size_t nbIgnored = 0;
-    bool error = false;
-    for (size_t i = 0; !error && i < nbSites; ++i)
-    {
-      double s = 0;
-      for (size_t t = 0; t < nbTypes; ++t)
-      {
-        tmp[t] = (*mapping)(mapping->getNodeIndex(ids[k]), i, t);
-        error = isnan(tmp[t]);
-        if (error)
-          goto ERROR;
-        s += tmp[t];
-      }
-      if (threshold >= 0)
-      {
-        if (s <= threshold)
-          countsf += tmp;
-        else
-        {
-          nbIgnored++;
-        }
-      }
-      else
-      {
-        countsf += tmp;
-      }
-    }
-
-ERROR:
-    if (error)
-    {
-      // We do nothing. This happens for small branches.
-      if (verbose)
-        ApplicationTools::displayWarning("On branch " + TextTools::toString(ids[k]) + ", counts could not be computed.");
-      for (size_t t = 0; t < nbTypes; ++t)
-      {
-        countsf[t] = 0;
-      }
-    }
-    else
-    {
-      if (nbIgnored > 0)
-      {
-        if (verbose)
-          ApplicationTools::displayWarning("On branch " + TextTools::toString(ids[k]) + ", " + TextTools::toString(nbIgnored) + " sites (" + TextTools::toString(ceil(static_cast<double>(nbIgnored * 100) / static_cast<double>(nbSites))) + "%) have been ignored because they are presumably saturated.");
-      }
-    }
-
-    counts[k].resize(countsf.size());
-    for (size_t j = 0; j < countsf.size(); ++j)
-    {
-      counts[k][j] = countsf[j];
-    }
-  }
-
-  return counts;
+  return computeCountsPerBranch(drtl, modelSet, ids, *count, threshold, verbose, nbThreads);
 }
 
 /**************************************************************************************************/
@@ -73,16 +73,18 @@ public:
    * @param drtl              A DRTreeLikelihood object.
    * @param substitutionCount The SubstitutionCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use, 0 for as many as available processors.
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectors(
     const DRTreeLikelihood& drtl,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception)
+    bool verbose = true,
+    size_t nbThreads = 1) throw (Exception)
   {
     std::vector<int> nodeIds;
-    return computeSubstitutionVectors(drtl, nodeIds, substitutionCount, verbose);
+    return computeSubstitutionVectors(drtl, nodeIds, substitutionCount, verbose, nbThreads);
   }
 
   /**
@@ -95,6 +97,9 @@ public:
    *                          on all nodes.
    * @param substitutionCount The SubstitutionCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use, 0 for as many as available processors.
+   *                          Distinct sites are distributed over threads by blocks,
+   *                          results do not depend on the number of threads.
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
@@ -102,14 +107,74 @@ public:
     const DRTreeLikelihood& drtl,
     const std::vector<int>& nodeIds,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    size_t nbThreads = 1) throw (Exception);
 
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectors(
     const DRTreeLikelihood& drtl,
     const SubstitutionModelSet& modelSet,
     const std::vector<int>& nodeIds,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    size_t nbThreads = 1) throw (Exception);
+
+  /**
+   * @brief Compute the total substitution counts on each branch.
+   *
+   * The result is the same as summing the vectors of computeSubstitutionVectors()
+   * over sites, but the substitution vectors of each site are never stored:
+   * memory only grows with the number of distinct sites, one branch at a time.
+   *
+   * @param drtl              A DRTreeLikelihood object.
+   * @param ids               The ids of the nodes of the branches to count substitutions on.
+   * @param substitutionCount The SubstitutionCount to use.
+   * @param threshold         Sites with a total count above this value are considered
+   *                          saturated and are ignored (default: -1 means no threshold).
+   * @param verbose           Display warnings.
+   * @param nbThreads         The number of threads to use, 0 for as many as available processors.
+   * @return One vector per branch, with the counts for each substitution type.
+   * Counts on a branch are set to 0 if they could not be computed.
+   * @throw Exception If the likelihood object is not initialized or a node has no father.
+   */
+  static std::vector< std::vector<double> > computeCountsPerBranch(
+    const DRTreeLikelihood& drtl,
+    const std::vector<int>& ids,
+    SubstitutionCount& substitutionCount,
+    double threshold = -1,
+    bool verbose = true,
+    size_t nbThreads = 1) throw (Exception);
+
+  static std::vector< std::vector<double> > computeCountsPerBranch(
+    const DRTreeLikelihood& drtl,
+    const SubstitutionModelSet& modelSet,
+    const std::vector<int>& ids,
+    SubstitutionCount& substitutionCount,
+    double threshold = -1,
+    bool verbose = true,
+    size_t nbThreads = 1) throw (Exception);
+
+  /**
+   * @brief Compute the total substitution counts of each type for each site,
+   * summed over branches.
+   *
+   * This is the same as computeTotalSubstitutionVectorForSitePerType() applied
+   * to the result of computeSubstitutionVectors(), without storing the counts
+   * for each branch.
+   *
+   * @param drtl              A DRTreeLikelihood object.
+   * @param nodeIds           The ids of the nodes the substitutions
+   *                          are counted on. If empty, count substitutions
+   *                          on all nodes.
+   * @param substitutionCount The SubstitutionCount to use.
+   * @param nbThreads         The number of threads to use, 0 for as many as available processors.
+   * @return One vector per site, with the counts for each substitution type.
+   * @throw Exception If the likelihood object is not initialized.
+   */
+  static std::vector< std::vector<double> > computeCountsPerSite(
+    const DRTreeLikelihood& drtl,
+    const std::vector<int>& nodeIds,
+    SubstitutionCount& substitutionCount,
+    size_t nbThreads = 1) throw (Exception);
 
   /**
    * @brief Compute the substitutions vectors for a particular dataset using the
@@ -125,16 +190,20 @@ public:
    * This function is mainly for testing purpose (see Dutheil et al. 2005).
    * For practical use, consider using the 'getSubstitutionVectors' method instead.
    *
+   * Distinct sites are processed by blocks on several threads, as in computeSubstitutionVectors().
+   *
    * @param drtl              A DRTreeLikelihood object.
    * @param substitutionCount The substitutionsCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use, 0 for as many as available processors.
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectorsNoAveraging(
     const DRTreeLikelihood& drtl,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    size_t nbThreads = 1) throw (Exception);
 
 
   /**
@@ -149,16 +218,21 @@ public:
    *
    * Use with another substitution count objet is in most cases irrelevent.
    *
+   * Substitution counts are looked up by blocks of distinct sites on several threads.
+   * The marginal reconstruction of ancestral states itself is not parallelized.
+   *
    * @param drtl              A DRTreeLikelihood object.
    * @param substitutionCount The substitutionsCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use, 0 for as many as available processors.
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectorsNoAveragingMarginal(
     const DRTreeLikelihood& drtl,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    size_t nbThreads = 1) throw (Exception);
 
 
   /**
@@ -170,16 +244,21 @@ public:
    * This function is mainly for testing purpose (see Dutheil et al. 2005).
    * For practical use, consider using the 'getSubstitutionVectors' method instead.
    *
+   * Substitution counts are computed by blocks of distinct sites on several threads.
+   * The posterior probabilities of the states at each node are not computed in parallel.
+   *
    * @param drtl              A DRTreeLikelihood object.
    * @param substitutionCount The substitutionsCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads to use, 0 for as many as available processors.
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectorsMarginal(
     const DRTreeLikelihood& drtl,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    size_t nbThreads = 1) throw (Exception);
 
 
   /**
@@ -290,7 +369,9 @@ public:
    * @param threshold         value above which counts are considered saturated
    *                                        (default: -1 means no threshold).
    * @param verbose           Display progress messages.
+   * @param nbThreads         The number of threads to use, 0 for as many as available processors.
    * @return A vector of substitutions vectors (one per branch per type).
+   * @see computeCountsPerBranch
    */
   static std::vector< std::vector<double> > getCountsPerBranch(
     DRTreeLikelihood& drtl,
@@ -298,7 +379,8 @@ public:
     SubstitutionModel* model,
     const SubstitutionRegister& reg,
     double threshold = -1,
-    bool verbose = true);
+    bool verbose = true,
+    size_t nbThreads = 1);
 
   static std::vector< std::vector<double> > getCountsPerBranch(
     DRTreeLikelihood& drtl,
@@ -306,7 +388,8 @@ public:
     const SubstitutionModelSet& modelSet,
     const SubstitutionRegister& reg,
     double threshold = -1,
-    bool verbose = true);
+    bool verbose = true,
+    size_t nbThreads = 1);
 
 
   /**
@@ -65,6 +65,7 @@ AbstractSubstitutionModel::AbstractSubstitutionModel(const Alphabet* alpha, Stat
   pijt_(size_, size_),
   dpijt_(size_, size_),
   d2pijt_(size_, size_),
+  pijtCache_(),
   eigenDecompose_(true),
   eigenValues_(size_),
   iEigenValues_(size_),
@@ -85,6 +86,8 @@ AbstractSubstitutionModel::AbstractSubstitutionModel(const Alphabet* alpha, Stat
 
 void AbstractSubstitutionModel::updateMatrices()
 {
+  pijtCache_.clear();
+
   // if the object is not an AbstractReversibleSubstitutionModel,
   // computes the exchangeability_ Matrix (otherwise the generator_
   // has been computed from the exchangeability_)
@@ -133,6 +136,14 @@ void AbstractSubstitutionModel::updateMatrices()
 
 const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
 {
+  double key = rate_ * t;
+  const RowMatrix<double>* cached = pijtCache_.find(key, 0);
+  if (cached)
+  {
+    pijt_ = *cached;
+    return pijt_;
+  }
+
   if (t == 0)
   {
     MatrixTools::getId(size_, pijt_);
@@ -199,11 +210,20 @@ const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
     }
   }
 //  MatrixTools::print(pijt_);
+  pijtCache_.insert(key, 0, pijt_);
   return pijt_;
 }
 
 const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
 {
+  double key = rate_ * t;
+  const RowMatrix<double>* cached = pijtCache_.find(key, 1);
+  if (cached)
+  {
+    dpijt_ = *cached;
+    return dpijt_;
+  }
+
   if (isNonSingular_)
   {
     if (isDiagonalizable_)
@@ -268,11 +288,20 @@ const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
     MatrixTools::mult(vPowGen_[1], dpijt_, tmpMat_);
     MatrixTools::copy(tmpMat_, dpijt_);
   }
+  pijtCache_.insert(key, 1, dpijt_);
   return dpijt_;
 }
 
 const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
 {
+  double key = rate_ * t;
+  const RowMatrix<double>* cached = pijtCache_.find(key, 2);
+  if (cached)
+  {
+    d2pijt_ = *cached;
+    return d2pijt_;
+  }
+
   if (isNonSingular_)
   {
     if (isDiagonalizable_)
@@ -341,6 +370,7 @@ const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
     MatrixTools::mult(vPowGen_[2], d2pijt_, tmpMat_);
     MatrixTools::copy(tmpMat_, d2pijt_);
   }
+  pijtCache_.insert(key, 2, d2pijt_);
   return d2pijt_;
 }
 
@@ -428,7 +458,10 @@ void AbstractSubstitutionModel::setRate(double rate)
   if (hasParameter("rate"))
     setParameterValue("rate", rate);
   else
+  {
     rate_ = rate;
+    pijtCache_.clear();
+  }
 }
 
 void AbstractSubstitutionModel::addRateParameter()
@@ -41,6 +41,7 @@
 #define _ABSTRACTSUBSTITUTIONMODEL_H_
 
 #include "SubstitutionModel.h"
+#include "TransitionMatrixCache.h"
 
 #include <Bpp/Numeric/AbstractParameterAliasable.h>
 #include <Bpp/Numeric/VectorTools.h>
@@ -71,6 +72,14 @@ namespace bpp
  * The Pij_t, dPij_dt and d2Pij_dt2 are particularly inefficient since the matrix formula
  * is used to compute all probabilities, and then the result for the initial and final state
  * of interest is retrieved.
+ * To limit this cost, the last matrices computed are kept in a small cache indexed by rate * t,
+ * which is cleared each time the generator is updated (see setTransitionMatrixCacheSize()).
+ *
+ * @warning Instances are not thread-safe, even through const methods: getPij_t(), getdPij_dt()
+ * and getd2Pij_dt2() write the returned matrix and the cache without any lock.
+ * Code running in several threads must give each thread its own model object,
+ * either a clone (as in NNIHomogeneousTreeLikelihood::testNNIs()) or a distinct component
+ * of a mixture (as in RHomogeneousMixedTreeLikelihood).
  *
  * @note This class is dedicated to "simple" substitution models, for which the number of states is equivalent to the number of characters in the alphabet.
  * Consider using the MarkovModulatedSubstitutionModel for more complexe cases.
@@ -127,6 +136,15 @@ protected:
   mutable RowMatrix<double> dpijt_;
   mutable RowMatrix<double> d2pijt_;
 
+  /**
+   * @brief The last matrices returned by getPij_t, getdPij_dt and getd2Pij_dt2.
+   *
+   * Derived classes that compute eigen values and vectors without calling
+   * AbstractSubstitutionModel::updateMatrices() must clear it.
+   * It is not protected against concurrent accesses (see the class description).
+   */
+  mutable TransitionMatrixCache pijtCache_;
+
   /**
    * @brief Tell if the eigen decomposition should be performed.
    */
@@ -189,6 +207,7 @@ public:
     pijt_(model.pijt_),
     dpijt_(model.dpijt_),
     d2pijt_(model.d2pijt_),
+    pijtCache_(model.pijtCache_),
     eigenDecompose_(model.eigenDecompose_),
     eigenValues_(model.eigenValues_),
     iEigenValues_(model.iEigenValues_),
@@ -213,6 +232,7 @@ public:
     pijt_              = model.pijt_;
     dpijt_             = model.dpijt_;
     d2pijt_            = model.d2pijt_;
+    pijtCache_         = model.pijtCache_;
     eigenDecompose_    = model.eigenDecompose_;
     eigenValues_       = model.eigenValues_;
     iEigenValues_      = model.iEigenValues_;
@@ -286,6 +306,15 @@ public:
 
   bool enableEigenDecomposition() { return eigenDecompose_; }
 
+  /**
+   * @brief Set the number of matrices kept in cache by getPij_t, getdPij_dt and getd2Pij_dt2.
+   *
+   * @param size The number of matrices to keep. 0 disables the cache.
+   */
+  void setTransitionMatrixCacheSize(size_t size) { pijtCache_.setCapacity(size); }
+
+  size_t getTransitionMatrixCacheSize() const { return pijtCache_.getCapacity(); }
+
   /**
    * @brief Tells the model that a parameter value has changed.
    *
@@ -294,6 +323,7 @@ public:
   virtual void fireParameterChanged(const ParameterList& parameters)
   {
     AbstractParameterAliasable::fireParameterChanged(parameters);
+    pijtCache_.clear();
     
     if (parameters.hasParameter(getNamespace()+"rate"))
     {
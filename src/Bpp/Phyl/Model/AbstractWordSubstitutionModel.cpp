@@ -267,6 +267,8 @@ void AbstractWordSubstitutionModel::setNamespace(const std::string& prefix)
 
 void AbstractWordSubstitutionModel::updateMatrices()
 {
+  pijtCache_.clear();
+
   // First we update position specific models. This need to be done
   // here and not in fireParameterChanged, as some parameter aliases
   // might have been defined and need to be resolved first.
@@ -234,6 +234,7 @@ void YpR::updateMatrices(double CgT, double cGA,
 
   // calcul spectral
 
+  pijtCache_.clear();
   EigenValue<double> ev(generator_);
   eigenValues_ = ev.getRealEigenValues();
   iEigenValues_ = ev.getImagEigenValues();
@@ -92,6 +92,9 @@ void gBGC::fireParameterChanged(const ParameterList& parameters)
 
 void gBGC::updateMatrices()
 {
+  // The eigen decomposition is not delegated to AbstractSubstitutionModel::updateMatrices():
+  pijtCache_.clear();
+
   gamma_=getParameterValue("gamma");
   unsigned int i,j;
   // Generator:
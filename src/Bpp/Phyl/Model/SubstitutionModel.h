@@ -345,6 +345,46 @@ public:
    */
   virtual const Matrix<double>& getd2Pij_dt2(double t) const = 0;
 
+  /**
+   * @brief Get the transition probabilities, and optionally their derivatives, for several times at once.
+   *
+   * This is typically used to get the matrices for all rate classes of a branch in one call,
+   * and avoids copying each returned matrix in a temporary object.
+   * The default implementation calls getPij_t(), getdPij_dt() and getd2Pij_dt2() for each time.
+   *
+   * @param times  The times for which probabilities are computed.
+   * @param pijt   [out] pijt[k][i][j] is the probability of change from state i to state j during times[k].
+   * @param dpijt  [out] If not null, the first order derivatives, in the same format.
+   * @param d2pijt [out] If not null, the second order derivatives, in the same format.
+   */
+  virtual void getTransitionProbabilities(const std::vector<double>& times, VVVdouble& pijt, VVVdouble* dpijt = 0, VVVdouble* d2pijt = 0) const
+  {
+    size_t nbTimes = times.size();
+    size_t n = getNumberOfStates();
+    pijt.resize(nbTimes);
+    if (dpijt) dpijt->resize(nbTimes);
+    if (d2pijt) d2pijt->resize(nbTimes);
+    for (size_t k = 0; k < nbTimes; k++)
+    {
+      for (unsigned int order = 0; order < 3; order++)
+      {
+        VVdouble* p_k = (order == 0 ? &pijt[k] : (order == 1 ? (dpijt ? &(*dpijt)[k] : 0) : (d2pijt ? &(*d2pijt)[k] : 0)));
+        if (!p_k) continue;
+        const Matrix<double>& m = (order == 0 ? getPij_t(times[k]) : (order == 1 ? getdPij_dt(times[k]) : getd2Pij_dt2(times[k])));
+        p_k->resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+          Vdouble* p_k_i = &(*p_k)[i];
+          p_k_i->resize(n);
+          for (size_t j = 0; j < n; j++)
+          {
+            (*p_k_i)[j] = m(i, j);
+          }
+        }
+      }
+    }
+  }
+
   /**
    * @brief Set if eigenValues and Vectors must be computed
    */
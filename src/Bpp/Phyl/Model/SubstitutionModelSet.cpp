@@ -115,26 +115,41 @@ void SubstitutionModelSet::setRootFrequencies(FrequenciesSet* rootFreqs)
 std::vector<int> SubstitutionModelSet::getNodesWithParameter(const std::string& name) const
   throw (ParameterNotFoundException)
 {
-  if (!(hasParameter(name)))
-    throw ParameterNotFoundException("SubstitutionModelSet::getNodesWithParameter.", name);
-    
-  vector<string> nalias=getAlias(name);
-  size_t p=name.rfind("_");
-  vector<int> inode = getNodesWithModel(TextTools::to<size_t>(name.substr(p+1,string::npos)) - 1);
-  
-  for (size_t i = 0; i < nalias.size(); i++)
+  vector<size_t> models = getModelsWithParameter(name);
+  vector<int> inode;
+  for (size_t i = 0; i < models.size(); i++)
     {
-      p=nalias[i].rfind("_");
-      size_t pos=TextTools::to<size_t>(nalias[i].substr(p+1,string::npos));
-      if (pos>0){
-        vector<int> ni = getNodesWithModel(pos-1);
-        inode.insert(inode.end(),ni.begin(),ni.end());
-      }
+      const vector<int>& ni = getNodesWithModel(models[i]);
+      inode.insert(inode.end(), ni.begin(), ni.end());
     }
   
   return inode;
 }
 
+std::vector<size_t> SubstitutionModelSet::getModelsWithParameter(const std::string& name) const
+  throw (ParameterNotFoundException)
+{
+  if (!(hasParameter(name)))
+    throw ParameterNotFoundException("SubstitutionModelSet::getModelsWithParameter.", name);
+
+  vector<string> names = getAlias(name);
+  names.insert(names.begin(), name);
+  vector<size_t> models;
+  for (size_t i = 0; i < names.size(); i++)
+    {
+      if (!stationarity_ && rootFrequencies_->getParameters().hasParameter(names[i]))
+        continue;
+      size_t p = names[i].rfind("_");
+      if (p == string::npos)
+        continue;
+      size_t pos = TextTools::to<size_t>(names[i].substr(p + 1, string::npos));
+      if (pos > 0 && pos <= modelSet_.size() && !VectorTools::contains(models, pos - 1))
+        models.push_back(pos - 1);
+    }
+  sort(models.begin(), models.end());
+  return models;
+}
+
 void SubstitutionModelSet::addModel(SubstitutionModel* model, const std::vector<int>& nodesId)//, const vector<string>& newParams) throw (Exception)
 {
   if (model->getAlphabet()->getAlphabetType() != alphabet_->getAlphabetType())
@@ -238,9 +253,20 @@ void SubstitutionModelSet::fireParameterChanged(const ParameterList& parameters)
   // Update root frequencies:
   updateRootFrequencies();
 
-  // Then we update all models in the set:
+  // Then we update the models depending on the modified parameters:
+  vector<bool> changed(modelSet_.size(), false);
+  for (size_t i = 0; i < parameters.size(); i++)
+    {
+      if (!hasParameter(parameters[i].getName()))
+        continue;
+      vector<size_t> models = getModelsWithParameter(parameters[i].getName());
+      for (size_t j = 0; j < models.size(); j++)
+        changed[models[j]] = true;
+    }
   for (size_t i = 0; i < modelParameters_.size(); i++)
     {
+      if (!changed[i])
+        continue;
       for (size_t np = 0 ; np< modelParameters_[i].size() ; np++)
         {
           modelParameters_[i][np].setValue(getParameterValue(modelParameters_[i][np].getName()+"_"+TextTools::toString(i+1)));
@@ -227,6 +227,7 @@ public:
   /**
    * To be called when a parameter has changed.
    * Depending on parameters, this will actualize the _initialFrequencies vector or the corresponding models in the set.
+   * Only the models depending on the modified parameters are updated (see getModelsWithParameter()).
    * @param parameters The modified parameters.
    */
   virtual void fireParameterChanged(const ParameterList& parameters);
@@ -318,6 +319,19 @@ public:
 
   std::vector<int> getNodesWithParameter(const std::string& name) const throw (ParameterNotFoundException);
 
+  /**
+   * @brief Get the models which depend on a given parameter.
+   *
+   * This is the model referred to by the index suffix of the parameter name,
+   * together with the models of all parameters aliased to it.
+   * Root frequencies parameters do not belong to any model.
+   *
+   * @param name The name of the parameter to look for.
+   * @return The sorted indices of the models depending on the specified parameter.
+   * @throw ParameterNotFoundException If no parameter with the specified name is found.
+   */
+  std::vector<size_t> getModelsWithParameter(const std::string& name) const throw (ParameterNotFoundException);
+
   /**
    * @brief Add a new model to the set, and set relationships with nodes and params.
    *
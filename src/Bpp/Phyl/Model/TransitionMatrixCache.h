@@ -0,0 +1,171 @@
+//
+// File: TransitionMatrixCache.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+
+#ifndef _TRANSITIONMATRIXCACHE_H_
+#define _TRANSITIONMATRIXCACHE_H_
+
+#include <Bpp/Numeric/Matrix/Matrix.h>
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief A small least-recently-used cache of transition matrices.
+ *
+ * Matrices are identified by a key, typically the product rate * t, and by their
+ * derivation order (0 for @f$P(t)@f$, 1 for @f$dP(t)/dt@f$ and 2 for @f$d^2P(t)/dt^2@f$).
+ * When the cache is full, the entry that was not used for the longest time is replaced.
+ *
+ * The cache must be cleared whenever the generator it refers to changes.
+ * A cache with a capacity of 0 never stores anything.
+ */
+class TransitionMatrixCache
+{
+  private:
+    struct Entry
+    {
+      double key;
+      unsigned int order;
+      unsigned long lastUse;
+      bool used;
+      RowMatrix<double> matrix;
+
+      Entry() : key(0), order(0), lastUse(0), used(false), matrix() {}
+    };
+
+    std::vector<Entry> entries_;
+    unsigned long clock_;
+
+  public:
+    TransitionMatrixCache(size_t capacity = 16) :
+      entries_(capacity), clock_(0)
+    {}
+
+  public:
+    /**
+     * @return The matrix stored for a given key and order, or 0 if it is not in the cache.
+     *
+     * @param key   The key of the matrix.
+     * @param order The derivation order of the matrix.
+     */
+    const RowMatrix<double>* find(double key, unsigned int order)
+    {
+      for (size_t i = 0; i < entries_.size(); i++)
+      {
+        Entry* e = &entries_[i];
+        if (e->used && e->key == key && e->order == order)
+        {
+          e->lastUse = ++clock_;
+          return &e->matrix;
+        }
+      }
+      return 0;
+    }
+
+    /**
+     * @brief Store a copy of a matrix in the cache.
+     *
+     * @param key    The key of the matrix.
+     * @param order  The derivation order of the matrix.
+     * @param matrix The matrix to store.
+     */
+    void insert(double key, unsigned int order, const Matrix<double>& matrix)
+    {
+      if (entries_.size() == 0) return;
+      // Use the first free slot, or the least recently used one:
+      Entry* slot = &entries_[0];
+      for (size_t i = 0; i < entries_.size(); i++)
+      {
+        if (!entries_[i].used)
+        {
+          slot = &entries_[i];
+          break;
+        }
+        if (entries_[i].lastUse < slot->lastUse)
+          slot = &entries_[i];
+      }
+      slot->key     = key;
+      slot->order   = order;
+      slot->lastUse = ++clock_;
+      slot->used    = true;
+      size_t n = matrix.getNumberOfRows();
+      size_t m = matrix.getNumberOfColumns();
+      slot->matrix.resize(n, m);
+      for (size_t i = 0; i < n; i++)
+      {
+        for (size_t j = 0; j < m; j++)
+        {
+          slot->matrix(i, j) = matrix(i, j);
+        }
+      }
+    }
+
+    /**
+     * @brief Remove all matrices from the cache.
+     */
+    void clear()
+    {
+      for (size_t i = 0; i < entries_.size(); i++)
+      {
+        entries_[i].used = false;
+      }
+    }
+
+    size_t getCapacity() const { return entries_.size(); }
+
+    /**
+     * @brief Change the number of matrices that can be stored. The cache is cleared.
+     *
+     * @param capacity The new capacity.
+     */
+    void setCapacity(size_t capacity)
+    {
+      entries_.resize(capacity);
+      clear();
+    }
+};
+
+} //end of namespace bpp.
+
+#endif //_TRANSITIONMATRIXCACHE_H_
+
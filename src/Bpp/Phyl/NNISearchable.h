@@ -45,6 +45,9 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "TreeTemplate.h"
 #include "TopologySearch.h"
 
+// From the STL:
+#include <vector>
+
 namespace bpp
 {
 
@@ -121,6 +124,24 @@ class NNISearchable:
 		 */
 		virtual double testNNI(int nodeId) const throw (NodeException) = 0;
 
+		/**
+		 * @brief Send the scores of several NNI movements, without performing them.
+		 *
+		 * This is equivalent to calling testNNI() for each node, which is what the default implementation does.
+		 * Implementations may evaluate the movements concurrently.
+		 *
+		 * @param nodeIds The ids of the nodes defining the NNI movements.
+		 * @return The score variations of the NNIs, in the same order as the node ids.
+		 * @throw NodeException If one of the nodes does not define a valid NNI.
+		 */
+		virtual std::vector<double> testNNIs(const std::vector<int>& nodeIds) const throw (NodeException)
+		{
+			std::vector<double> diffs(nodeIds.size());
+			for (size_t i = 0; i < nodeIds.size(); i++)
+				diffs[i] = testNNI(nodeIds[i]);
+			return diffs;
+		}
+
 		/**
 		 * @brief Perform a NNI movement.
 		 *
@@ -171,10 +171,17 @@ void NNITopologySearch::searchBetter() throw (Exception)
     vector<double> improvement;
     if (verbose_ >= 2 && ApplicationTools::message)
       ApplicationTools::message->endLine();
+    // All moves are evaluated at once, which allows the searchable object to do it concurrently:
+    vector<int> nodesSubId(nodesSub.size());
+    for (size_t i = 0; i < nodesSub.size(); i++)
+    {
+      nodesSubId[i] = nodesSub[i]->getId();
+    }
+    vector<double> diffs = searchableTree_->testNNIs(nodesSubId);
     for (size_t i = 0; i < nodesSub.size(); i++)
     {
       Node* node = nodesSub[i];
-      double diff = searchableTree_->testNNI(node->getId());
+      double diff = diffs[i];
       if (verbose_ >= 3)
       {
         ApplicationTools::displayResult("   Testing node " + TextTools::toString(node->getId())
@@ -236,10 +243,17 @@ void NNITopologySearch::searchPhyML() throw (Exception)
     vector<double> improvement;
     if (verbose_ >= 2 && ApplicationTools::message)
       ApplicationTools::message->endLine();
+    // All moves are evaluated at once, which allows the searchable object to do it concurrently:
+    vector<int> nodesSubId(nodesSub.size());
+    for (size_t i = 0; i < nodesSub.size(); i++)
+    {
+      nodesSubId[i] = nodesSub[i]->getId();
+    }
+    vector<double> diffs = searchableTree_->testNNIs(nodesSubId);
     for (size_t i = 0; i < nodesSub.size(); i++)
     {
       Node* node = nodesSub[i];
-      double diff = searchableTree_->testNNI(node->getId());
+      double diff = diffs[i];
       if (verbose_ >= 3)
       {
         ApplicationTools::displayResult("   Testing node " + TextTools::toString(node->getId())
@@ -57,6 +57,11 @@ namespace bpp
  *   Then re-loop over all nodes.
  * - PhyML algorithm (not fully tested, use with care): as the previous one, but perform all NNI improving the score at the same time.
  *   Leads to faster convergence.
+ *
+ * The Better and PhyML algorithms test all NNIs with a single call to NNISearchable::testNNIs,
+ * so that they can be evaluated in parallel by the searchable object
+ * (see for instance NNIHomogeneousTreeLikelihood::setNumberOfThreads).
+ * Combined with the PhyML algorithm, this gives a fully parallel evaluation followed by a batch of non-conflicting moves.
  */
 class NNITopologySearch :
   public virtual TopologySearch
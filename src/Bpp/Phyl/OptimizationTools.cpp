@@ -638,6 +638,49 @@ DRTreeParsimonyScore* OptimizationTools::optimizeTreeNNI(
 
 /******************************************************************************/
 
+DRTreeParsimonyScore* OptimizationTools::optimizeTreeSPR(
+  DRTreeParsimonyScore* tp,
+  unsigned int verbose)
+{
+  bool improved = true;
+  while (improved)
+  {
+    improved = false;
+    vector<int> ids = tp->getTree().getNodesId();
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+      // Topology may have changed since the last move:
+      const Node* node = dynamic_cast<const TreeTemplate<Node>&>(tp->getTree()).getNode(ids[i]);
+      if (!node->hasFather() || node->getFather()->degree() != 3) continue;
+      map<int, double> diffs = tp->testSPRs(ids[i]);
+      int best = 0;
+      double bestDiff = 0;
+      for (map<int, double>::iterator it = diffs.begin(); it != diffs.end(); it++)
+      {
+        if (it->second < bestDiff)
+        {
+          best = it->first;
+          bestDiff = it->second;
+        }
+      }
+      if (bestDiff < 0)
+      {
+        if (verbose >= 2)
+          ApplicationTools::displayResult("   Moving node " + TextTools::toString(ids[i])
+                                          + " to " + TextTools::toString(best),
+                                          TextTools::toString(bestDiff));
+        tp->doSPR(ids[i], best);
+        improved = true;
+        if (verbose >= 1)
+          ApplicationTools::displayResult("   Current value", TextTools::toString(tp->getScore()));
+      }
+    }
+  }
+  return tp;
+}
+
+/******************************************************************************/
+
 std::string OptimizationTools::DISTANCEMETHOD_INIT       = "init";
 std::string OptimizationTools::DISTANCEMETHOD_PAIRWISE   = "pairwise";
 std::string OptimizationTools::DISTANCEMETHOD_ITERATIONS = "iterations";
@@ -701,6 +701,21 @@ public:
     DRTreeParsimonyScore* tp,
     unsigned int verbose = 1);
 
+  /**
+   * @brief Optimize tree topology from a DRTreeParsimonyScore using Subtree Pruning and Regrafting.
+   *
+   * Each subtree is pruned in turn, and all its regraft positions are scored at once
+   * with DRTreeParsimonyScore::testSPRs. The best improving move, if any, is performed.
+   * The search stops when no subtree can be moved to a better position.
+   *
+   * @param tp               A pointer toward the DRTreeParsimonyScore object to optimize.
+   * @param verbose          The verbose level.
+   * @return A pointer toward the final parsimony score object, the same as passed in argument.
+   */
+  static DRTreeParsimonyScore* optimizeTreeSPR(
+    DRTreeParsimonyScore* tp,
+    unsigned int verbose = 1);
+
   /**
    * @brief Estimate a distance matrix using maximum likelihood.
    *
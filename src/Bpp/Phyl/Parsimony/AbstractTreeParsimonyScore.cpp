@@ -93,7 +93,6 @@ void AbstractTreeParsimonyScore::init_(const SiteContainer& data, bool verbose)
   data_ = PatternTools::getSequenceSubset(data, *tree_->getRootNode());
   if (data_->getNumberOfSequences() == 1) throw Exception("Error, only 1 sequence!");
   if (data_->getNumberOfSequences() == 0) throw Exception("Error, no sequence!");
-  if (data_->getAlphabet()->getSize() > 20) throw Exception("Error, only alphabet with size <= 20 are supported. See the source file of AbstractTreeParsimonyScore.");
 }
 
 std::vector<unsigned int> AbstractTreeParsimonyScore::getScoreForEachSite() const
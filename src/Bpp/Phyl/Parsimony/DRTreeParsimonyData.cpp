@@ -44,21 +44,31 @@
 // From SeqLib:
 #include <Bpp/Seq/Container/AlignedSequenceContainer.h>
 
+// From the STL:
+#include <algorithm>
+
 using namespace bpp;
 using namespace std;
 
 /******************************************************************************/
 
+const size_t DRTreeParsimonyData::SITES_PER_WORD;
+
+/******************************************************************************/
+
 DRTreeParsimonyData::DRTreeParsimonyData(const DRTreeParsimonyData& data) :
   AbstractTreeParsimonyData(data),
   nodeData_(data.nodeData_),
   leafData_(data.leafData_),
   rootBitsets_(data.rootBitsets_),
-  rootScores_(data.rootScores_),
+  rootScore_(data.rootScore_),
+  rootSiteScores_(data.rootSiteScores_),
+  blockWeights_(data.blockWeights_),
   shrunkData_(0),
   nbSites_(data.nbSites_),
   nbStates_(data.nbStates_),
-  nbDistinctSites_(data.nbDistinctSites_)
+  nbDistinctSites_(data.nbDistinctSites_),
+  nbBlocks_(data.nbBlocks_)
 {
   if (data.shrunkData_)
     shrunkData_ = dynamic_cast<SiteContainer*>(data.shrunkData_->clone());
@@ -74,7 +84,9 @@ DRTreeParsimonyData& DRTreeParsimonyData::operator=(const DRTreeParsimonyData& d
   nodeData_        = data.nodeData_;
   leafData_        = data.leafData_;
   rootBitsets_     = data.rootBitsets_;
-  rootScores_      = data.rootScores_;
+  rootScore_       = data.rootScore_;
+  rootSiteScores_  = data.rootSiteScores_;
+  blockWeights_    = data.blockWeights_;
   if (shrunkData_) delete shrunkData_;
   if (data.shrunkData_)
     shrunkData_ = dynamic_cast<SiteContainer*>(data.shrunkData_->clone());
@@ -83,6 +95,7 @@ DRTreeParsimonyData& DRTreeParsimonyData::operator=(const DRTreeParsimonyData& d
   nbSites_         = data.nbSites_;
   nbStates_        = data.nbStates_;
   nbDistinctSites_ = data.nbDistinctSites_;
+  nbBlocks_        = data.nbBlocks_;
   return *this;
 }
 
@@ -96,6 +109,21 @@ void DRTreeParsimonyData::init(const SiteContainer& sites, const StateMap& state
   rootWeights_      = pattern.getWeights();
   rootPatternLinks_ = pattern.getIndices();
   nbDistinctSites_  = shrunkData_->getNumberOfSites();
+  nbBlocks_         = (nbDistinctSites_ + SITES_PER_WORD - 1) / SITES_PER_WORD;
+
+  // Blocks where all sites have the same weight can be scored with a single popcount:
+  blockWeights_.resize(nbBlocks_);
+  for (size_t b = 0; b < nbBlocks_; b++)
+  {
+    size_t begin = b * SITES_PER_WORD;
+    size_t end = min(begin + SITES_PER_WORD, nbDistinctSites_);
+    blockWeights_[b] = rootWeights_[begin];
+    for (size_t i = begin + 1; i < end && blockWeights_[b] > 0; i++)
+    {
+      if (rootWeights_[i] != blockWeights_[b])
+        blockWeights_[b] = 0;
+    }
+  }
 
   // Init data:
   // Clone data for more efficiency on sequences access:
@@ -104,8 +132,9 @@ void DRTreeParsimonyData::init(const SiteContainer& sites, const StateMap& state
   delete sequences;
 
   // Now initialize root arrays:
-  rootBitsets_.resize(nbDistinctSites_);
-  rootScores_.resize(nbDistinctSites_);
+  rootBitsets_.resize(nbStates_ * nbBlocks_);
+  rootScore_ = 0;
+  rootSiteScores_.resize(nbDistinctSites_);
 }
 
 /******************************************************************************/
@@ -123,28 +152,37 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
     {
       throw SequenceNotFoundException("DRTreeParsimonyData:init(node, sites). Leaf name in tree not found in site container: ", (node->getName()));
     }
-    DRTreeParsimonyLeafData* leafData    = &leafData_[node->getId()];
-    vector<Bitset>* leafData_bitsets     = &leafData->getBitsetsArray();
+    DRTreeParsimonyLeafData* leafData       = &leafData_[node->getId()];
+    vector<ParsimonyWord>* leafData_bitsets = &leafData->getBitsetsArray();
     leafData->setNode(node);
 
-    leafData_bitsets->resize(nbDistinctSites_);
+    leafData_bitsets->assign(nbStates_ * nbBlocks_, 0);
 
-    for (unsigned int i = 0; i < nbDistinctSites_; i++)
+    for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      Bitset* leafData_bitsets_i = &(*leafData_bitsets)[i];
-      for (unsigned int s = 0; s < nbStates_; s++)
+      size_t block = i / SITES_PER_WORD;
+      ParsimonyWord bit = static_cast<ParsimonyWord>(1) << (i % SITES_PER_WORD);
+      // Leaves bits are set to 1 if the char correspond to the site in the sequence,
+      // otherwise value set to 0:
+      int state = seq->getValue(i);
+      vector<int> states = alphabet->getAlias(state);
+      for (size_t s = 0; s < nbStates_; s++)
       {
-        // Leaves bitset are set to 1 if the char correspond to the site in the sequence,
-        // otherwise value set to 0:
-        int state = seq->getValue(i);
-        vector<int> states = alphabet->getAlias(state);
         for (size_t j = 0; j < states.size(); j++)
         {
           if (stateMap.getAlphabetStateAsInt(s) == states[j])
-            (*leafData_bitsets_i)[s].flip();
+            (*leafData_bitsets)[s * nbBlocks_ + block] |= bit;
         }
       }
     }
+    // Padding sites allow all states:
+    for (size_t i = nbDistinctSites_; i < nbBlocks_ * SITES_PER_WORD; i++)
+    {
+      size_t block = i / SITES_PER_WORD;
+      ParsimonyWord bit = static_cast<ParsimonyWord>(1) << (i % SITES_PER_WORD);
+      for (size_t s = 0; s < nbStates_; s++)
+        (*leafData_bitsets)[s * nbBlocks_ + block] |= bit;
+    }
   }
   else
   {
@@ -157,11 +195,10 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
     for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
     {
       const Node* neighbor = (*node)[n];
-      vector<Bitset>* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
-      vector<unsigned int>* neighborData_scores  = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
+      vector<ParsimonyWord>* neighborData_bitsets = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
 
-      neighborData_bitsets->resize(nbDistinctSites_);
-      neighborData_scores->resize(nbDistinctSites_);
+      neighborData_bitsets->resize(nbStates_ * nbBlocks_);
+      nodeData->getScoreForNeighbor(neighbor->getId()) = 0;
     }
   }
 
@@ -198,11 +235,10 @@ void DRTreeParsimonyData::reInit(const Node* node) throw (Exception)
     for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
     {
       const Node* neighbor = (*node)[n];
-      vector<Bitset>* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
-      vector<unsigned int>* neighborData_scores  = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
+      vector<ParsimonyWord>* neighborData_bitsets = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
 
-      neighborData_bitsets->resize(nbDistinctSites_);
-      neighborData_scores->resize(nbDistinctSites_);
+      neighborData_bitsets->resize(nbStates_ * nbBlocks_);
+      nodeData->getScoreForNeighbor(neighbor->getId()) = 0;
     }
   }
 
@@ -48,11 +48,23 @@
 #include <Bpp/Seq/Container/SiteContainer.h>
 
 // From the STL:
-#include <bitset>
+#include <vector>
+#include <map>
 
 namespace bpp
 {
-typedef std::bitset<21> Bitset; // 20AA + gaps, codon not lalowed so far :s
+/**
+ * @brief Machine word used to store bit-sliced state sets.
+ *
+ * Sets of states are not stored site by site, but state by state:
+ * for a given state, the bits of one word tell whether this state is
+ * possible at each of DRTreeParsimonyData::SITES_PER_WORD consecutive sites.
+ * The intersection and union steps of the Fitch algorithm, as well as the
+ * counting of the score, are then performed for all these sites at once.
+ * There is no limit on the number of states, so that codon alphabets
+ * can be used.
+ */
+typedef unsigned long ParsimonyWord;
 
 /**
  * @brief Parsimony data structure for a node.
@@ -60,8 +72,8 @@ typedef std::bitset<21> Bitset; // 20AA + gaps, codon not lalowed so far :s
  * This class is for use with the DRTreeParsimonyData class.
  *
  * Store for each neighbor node
- * - a vector of bitsets,
- * - a vector of score for the corresponding subtree.
+ * - an array of bit-sliced state sets,
+ * - the weighted score of the corresponding subtree.
  *
  * @see DRTreeParsimonyData
  */
@@ -69,8 +81,8 @@ class DRTreeParsimonyNodeData :
   public TreeParsimonyNodeData
 {
 private:
-  mutable std::map<int, std::vector<Bitset> > nodeBitsets_;
-  mutable std::map<int, std::vector<unsigned int> > nodeScores_;
+  mutable std::map<int, std::vector<ParsimonyWord> > nodeBitsets_;
+  mutable std::map<int, unsigned int> nodeScores_;
   const Node* node_;
 
 public:
@@ -101,19 +113,19 @@ public:
 
   void setNode(const Node* node) { node_ = node; }
 
-  std::vector<Bitset>& getBitsetsArrayForNeighbor(int neighborId)
+  std::vector<ParsimonyWord>& getBitsetsArrayForNeighbor(int neighborId)
   {
     return nodeBitsets_[neighborId];
   }
-  const std::vector<Bitset>& getBitsetsArrayForNeighbor(int neighborId) const
+  const std::vector<ParsimonyWord>& getBitsetsArrayForNeighbor(int neighborId) const
   {
     return nodeBitsets_[neighborId];
   }
-  std::vector<unsigned int>& getScoresArrayForNeighbor(int neighborId)
+  unsigned int& getScoreForNeighbor(int neighborId)
   {
     return nodeScores_[neighborId];
   }
-  const std::vector<unsigned int>& getScoresArrayForNeighbor(int neighborId) const
+  unsigned int getScoreForNeighbor(int neighborId) const
   {
     return nodeScores_[neighborId];
   }
@@ -135,7 +147,7 @@ public:
  *
  * This class is for use with the DRTreeParsimonyData class.
  *
- * Store the vector of bitsets associated to a leaf.
+ * Store the array of bit-sliced state sets associated to a leaf.
  *
  * @see DRTreeParsimonyData
  */
@@ -143,7 +155,7 @@ class DRTreeParsimonyLeafData :
   public TreeParsimonyNodeData
 {
 private:
-  mutable std::vector<Bitset> leafBitsets_;
+  mutable std::vector<ParsimonyWord> leafBitsets_;
   const Node* leaf_;
 
 public:
@@ -171,11 +183,11 @@ public:
   const Node* getNode() const { return leaf_; }
   void setNode(const Node* node) { leaf_ = node; }
 
-  std::vector<Bitset>& getBitsetsArray()
+  std::vector<ParsimonyWord>& getBitsetsArray()
   {
     return leafBitsets_;
   }
-  const std::vector<Bitset>& getBitsetsArray() const
+  const std::vector<ParsimonyWord>& getBitsetsArray() const
   {
     return leafBitsets_;
   }
@@ -184,13 +196,19 @@ public:
 /**
  * @brief Parsimony data structure for double-recursive (DR) algorithm.
  *
- * States are coded using bitsets for faster computing (@see AbstractTreeParsimonyData).
+ * States are coded using bit-sliced arrays for faster computing (@see ParsimonyWord).
  * For each inner node in the tree, we store a DRTreeParsimonyNodeData object in nodeData_.
  * For each leaf node in the tree, we store a DRTreeParsimonyLeafData object in leafData_.
  *
  * The dataset is first compressed, removing all identical sites.
  * The resulting dataset is stored in shrunkData_.
  * The corresponding positions are stored in rootPatternLinks_, inherited from AbstractTreeParsimonyData.
+ *
+ * Distinct sites are then packed by blocks of SITES_PER_WORD sites.
+ * An array of state sets has size nbStates_ * nbBlocks_, and the word for
+ * state @f$s@f$ and block @f$b@f$ is found at position @f$s \times nbBlocks\_ + b@f$.
+ * The unused sites of the last block have all their states set, so that
+ * they never contribute to the score.
  */
 class DRTreeParsimonyData :
   public AbstractTreeParsimonyData
@@ -198,12 +216,18 @@ class DRTreeParsimonyData :
 private:
   mutable std::map<int, DRTreeParsimonyNodeData> nodeData_;
   mutable std::map<int, DRTreeParsimonyLeafData> leafData_;
-  mutable std::vector<Bitset> rootBitsets_;
-  mutable std::vector<unsigned int> rootScores_;
+  mutable std::vector<ParsimonyWord> rootBitsets_;
+  unsigned int rootScore_;
+  mutable std::vector<unsigned int> rootSiteScores_;
+  std::vector<unsigned int> blockWeights_;
   SiteContainer* shrunkData_;
   size_t nbSites_;
   size_t nbStates_;
   size_t nbDistinctSites_;
+  size_t nbBlocks_;
+
+public:
+  static const size_t SITES_PER_WORD = 8 * sizeof(ParsimonyWord);
 
 public:
   DRTreeParsimonyData(const TreeTemplate<Node>* tree) :
@@ -211,11 +235,14 @@ public:
     nodeData_(),
     leafData_(),
     rootBitsets_(),
-    rootScores_(),
+    rootScore_(0),
+    rootSiteScores_(),
+    blockWeights_(),
     shrunkData_(0),
     nbSites_(0),
     nbStates_(0),
-    nbDistinctSites_(0)
+    nbDistinctSites_(0),
+    nbBlocks_(0)
   {}
 
   DRTreeParsimonyData(const DRTreeParsimonyData& data);
@@ -269,22 +296,22 @@ public:
     return leafData_[nodeId];
   }
 
-  std::vector<Bitset>& getBitsetsArray(int nodeId, int neighborId)
+  std::vector<ParsimonyWord>& getBitsetsArray(int nodeId, int neighborId)
   {
     return nodeData_[nodeId].getBitsetsArrayForNeighbor(neighborId);
   }
-  const std::vector<Bitset>& getBitsetsArray(int nodeId, int neighborId) const
+  const std::vector<ParsimonyWord>& getBitsetsArray(int nodeId, int neighborId) const
   {
     return nodeData_[nodeId].getBitsetsArrayForNeighbor(neighborId);
   }
 
-  std::vector<unsigned int>& getScoresArray(int nodeId, int neighborId)
+  unsigned int& getScore(int nodeId, int neighborId)
   {
-    return nodeData_[nodeId].getScoresArrayForNeighbor(neighborId);
+    return nodeData_[nodeId].getScoreForNeighbor(neighborId);
   }
-  const std::vector<unsigned int>& getScoresArray(int nodeId, int neighborId) const
+  unsigned int getScore(int nodeId, int neighborId) const
   {
-    return nodeData_[nodeId].getScoresArrayForNeighbor(neighborId);
+    return nodeData_[nodeId].getScoreForNeighbor(neighborId);
   }
 
   size_t getArrayPosition(int parentId, int sonId, size_t currentPosition) const
@@ -292,17 +319,28 @@ public:
     return currentPosition;
   }
 
-  std::vector<Bitset>& getRootBitsets() { return rootBitsets_; }
-  const std::vector<Bitset>& getRootBitsets() const { return rootBitsets_; }
-  const Bitset& getRootBitset(size_t i) const { return rootBitsets_[i]; }
+  std::vector<ParsimonyWord>& getRootBitsets() { return rootBitsets_; }
+  const std::vector<ParsimonyWord>& getRootBitsets() const { return rootBitsets_; }
 
-  std::vector<unsigned int>& getRootScores() { return rootScores_; }
-  const std::vector<unsigned int>& getRootScores() const { return rootScores_; }
-  unsigned int getRootScore(size_t i) const { return rootScores_[i]; }
+  unsigned int& getRootScore() { return rootScore_; }
+  unsigned int getRootScore() const { return rootScore_; }
+
+  /**
+   * @return The array of scores for each distinct site. These are not updated
+   * by the score computation itself, and must be filled on demand.
+   */
+  std::vector<unsigned int>& getRootSiteScores() const { return rootSiteScores_; }
+
+  /**
+   * @return The weight shared by all sites in a block, or 0 if they do not all have the same weight.
+   * @param block The block index.
+   */
+  unsigned int getBlockWeight(size_t block) const { return blockWeights_[block]; }
 
   size_t getNumberOfDistinctSites() const { return nbDistinctSites_; }
   size_t getNumberOfSites() const { return nbSites_; }
   size_t getNumberOfStates() const { return nbStates_; }
+  size_t getNumberOfBlocks() const { return nbBlocks_; }
 
   void init(const SiteContainer& sites, const StateMap& stateMap) throw (Exception);
   void reInit() throw (Exception);
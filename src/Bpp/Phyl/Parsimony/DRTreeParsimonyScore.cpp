@@ -44,6 +44,9 @@
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/VectorTools.h>
 
+// From the STL:
+#include <algorithm>
+
 using namespace bpp;
 using namespace std;
 
@@ -57,7 +60,8 @@ DRTreeParsimonyScore::DRTreeParsimonyScore(
 throw (Exception) :
   AbstractTreeParsimonyScore(tree, data, verbose, includeGaps),
   parsimonyData_(new DRTreeParsimonyData(getTreeP_())),
-  nbDistinctSites_()
+  nbDistinctSites_(),
+  siteScoresUpToDate_(false)
 {
   init_(data, verbose);
 }
@@ -70,7 +74,8 @@ DRTreeParsimonyScore::DRTreeParsimonyScore(
 throw (Exception) :
   AbstractTreeParsimonyScore(tree, data, statesMap, verbose),
   parsimonyData_(new DRTreeParsimonyData(getTreeP_())),
-  nbDistinctSites_()
+  nbDistinctSites_(),
+  siteScoresUpToDate_(false)
 {
   init_(data, verbose);
 }
@@ -94,7 +99,8 @@ void DRTreeParsimonyScore::init_(const SiteContainer& data, bool verbose)
 DRTreeParsimonyScore::DRTreeParsimonyScore(const DRTreeParsimonyScore& tp) :
   AbstractTreeParsimonyScore(tp),
   parsimonyData_(dynamic_cast<DRTreeParsimonyData*>(tp.parsimonyData_->clone())),
-  nbDistinctSites_(tp.nbDistinctSites_)
+  nbDistinctSites_(tp.nbDistinctSites_),
+  siteScoresUpToDate_(tp.siteScoresUpToDate_)
 {
   parsimonyData_->setTree(getTreeP_());
 }
@@ -107,6 +113,7 @@ DRTreeParsimonyScore& DRTreeParsimonyScore::operator=(const DRTreeParsimonyScore
   parsimonyData_ = dynamic_cast<DRTreeParsimonyData*>(tp.parsimonyData_->clone());
   parsimonyData_->setTree(getTreeP_());
   nbDistinctSites_ = tp.nbDistinctSites_;
+  siteScoresUpToDate_ = tp.siteScoresUpToDate_;
   return *this;
 }
 
@@ -125,7 +132,8 @@ void DRTreeParsimonyScore::computeScores()
   computeScoresForNode(
     parsimonyData_->getNodeData(getTree().getRootId()),
     parsimonyData_->getRootBitsets(),
-    parsimonyData_->getRootScores());
+    parsimonyData_->getRootScore());
+  siteScoresUpToDate_ = false;
 }
 
 void DRTreeParsimonyScore::computeScoresPostorder(const Node* node)
@@ -136,48 +144,44 @@ void DRTreeParsimonyScore::computeScoresPostorder(const Node* node)
   {
     const Node* son = node->getSon(k);
     computeScoresPostorder(son);
-    vector<Bitset>* bitsets      = &pData->getBitsetsArrayForNeighbor(son->getId());
-    vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(son->getId());
+    vector<ParsimonyWord>* bitsets = &pData->getBitsetsArrayForNeighbor(son->getId());
+    unsigned int* score            = &pData->getScoreForNeighbor(son->getId());
     if (son->isLeaf())
     {
       // son has no NodeData associated, must use LeafData instead
-      vector<Bitset>* sonBitsets = &parsimonyData_->getLeafData(son->getId()).getBitsetsArray();
-      for (unsigned int i = 0; i < sonBitsets->size(); i++)
-      {
-        (*bitsets)[i] = (*sonBitsets)[i];
-        (*scores)[i]  = 0;
-      }
+      *bitsets = parsimonyData_->getLeafData(son->getId()).getBitsetsArray();
+      *score   = 0;
     }
     else
     {
       computeScoresPostorderForNode(
         parsimonyData_->getNodeData(son->getId()),
         *bitsets,
-        *scores);
+        *score);
     }
   }
 }
 
-void DRTreeParsimonyScore::computeScoresPostorderForNode(const DRTreeParsimonyNodeData& pData, vector<Bitset>& rBitsets, vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresPostorderForNode(const DRTreeParsimonyNodeData& pData, vector<ParsimonyWord>& rBitsets, unsigned int& rScore) const
 {
   // First initialize the vectors from input:
   const Node* node = pData.getNode();
   const Node* source = node->getFather();
   vector<const Node*> neighbors = node->getNeighbors();
   size_t nbNeighbors = node->degree();
-  vector< const vector<Bitset>*> iBitsets;
-  vector< const vector<unsigned int>*> iScores;
+  vector< const vector<ParsimonyWord>*> iBitsets;
+  vector<unsigned int> iScores;
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
     const Node* n = neighbors[k];
     if (n != source)
     {
       iBitsets.push_back(&pData.getBitsetsArrayForNeighbor(n->getId()));
-      iScores.push_back(&pData.getScoresArrayForNeighbor(n->getId()));
+      iScores.push_back(pData.getScoreForNeighbor(n->getId()));
     }
   }
   // Then call the general method on these arrays:
-  computeScoresFromArrays(iBitsets, iScores, rBitsets, rScores);
+  computeScoresFromArrays(iBitsets, iScores, rBitsets, rScore);
 }
 
 void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
@@ -187,17 +191,13 @@ void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    vector<Bitset>* bitsets      = &pData->getBitsetsArrayForNeighbor(father->getId());
-    vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(father->getId());
+    vector<ParsimonyWord>* bitsets = &pData->getBitsetsArrayForNeighbor(father->getId());
+    unsigned int* score            = &pData->getScoreForNeighbor(father->getId());
     if (father->isLeaf())
     { // Means that the tree is rooted by a leaf... dunno if we must allow that! Let it be for now.
       // son has no NodeData associated, must use LeafData instead
-      vector<Bitset>* sonBitsets = &parsimonyData_->getLeafData(father->getId()).getBitsetsArray();
-      for (unsigned int i = 0; i < sonBitsets->size(); i++)
-      {
-        (*bitsets)[i] = (*sonBitsets)[i];
-        (*scores)[i]  = 0;
-      }
+      *bitsets = parsimonyData_->getLeafData(father->getId()).getBitsetsArray();
+      *score   = 0;
     }
     else
     {
@@ -205,7 +205,7 @@ void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
         parsimonyData_->getNodeData(father->getId()),
         node,
         *bitsets,
-        *scores);
+        *score);
     }
   }
   // Recurse call:
@@ -215,96 +215,190 @@ void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
   }
 }
 
-void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNodeData& pData, const Node* source, std::vector<Bitset>& rBitsets, std::vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNodeData& pData, const Node* source, std::vector<ParsimonyWord>& rBitsets, unsigned int& rScore) const
 {
   // First initialize the vectors from input:
   const Node* node = pData.getNode();
   vector<const Node*> neighbors = node->getNeighbors();
   size_t nbNeighbors = node->degree();
-  vector< const vector<Bitset>*> iBitsets;
-  vector< const vector<unsigned int>*> iScores;
+  vector< const vector<ParsimonyWord>*> iBitsets;
+  vector<unsigned int> iScores;
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
     const Node* n = neighbors[k];
     if (n != source)
     {
       iBitsets.push_back(&pData.getBitsetsArrayForNeighbor(n->getId()));
-      iScores.push_back(&pData.getScoresArrayForNeighbor(n->getId()));
+      iScores.push_back(pData.getScoreForNeighbor(n->getId()));
     }
   }
   // Then call the general method on these arrays:
-  computeScoresFromArrays(iBitsets, iScores, rBitsets, rScores);
+  computeScoresFromArrays(iBitsets, iScores, rBitsets, rScore);
 }
 
-void DRTreeParsimonyScore::computeScoresForNode(const DRTreeParsimonyNodeData& pData, std::vector<Bitset>& rBitsets, std::vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresForNode(const DRTreeParsimonyNodeData& pData, std::vector<ParsimonyWord>& rBitsets, unsigned int& rScore) const
 {
   const Node* node = pData.getNode();
   size_t nbNeighbors = node->degree();
   vector<const Node*> neighbors = node->getNeighbors();
   // First initialize the vectors fro input:
-  vector< const vector<Bitset>*> iBitsets(nbNeighbors);
-  vector< const vector<unsigned int>*> iScores(nbNeighbors);
+  vector< const vector<ParsimonyWord>*> iBitsets(nbNeighbors);
+  vector<unsigned int> iScores(nbNeighbors);
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
     const Node* n = neighbors[k];
     iBitsets[k] =  &pData.getBitsetsArrayForNeighbor(n->getId());
-    iScores [k] =  &pData.getScoresArrayForNeighbor(n->getId());
+    iScores [k] =  pData.getScoreForNeighbor(n->getId());
   }
   // Then call the general method on these arrays:
-  computeScoresFromArrays(iBitsets, iScores, rBitsets, rScores);
+  computeScoresFromArrays(iBitsets, iScores, rBitsets, rScore);
 }
 
 /******************************************************************************/
 unsigned int DRTreeParsimonyScore::getScore() const
 {
-  unsigned int score = 0;
-  for (unsigned int i = 0; i < nbDistinctSites_; i++)
-  {
-    score += parsimonyData_->getRootScore(i) * parsimonyData_->getWeight(i);
-  }
-  return score;
+  return parsimonyData_->getRootScore();
 }
 
 /******************************************************************************/
 unsigned int DRTreeParsimonyScore::getScoreForSite(size_t site) const
 {
-  return parsimonyData_->getRootScore(parsimonyData_->getRootArrayPosition(site));
+  vector<unsigned int>& siteScores = parsimonyData_->getRootSiteScores();
+  if (!siteScoresUpToDate_)
+  {
+    siteScores.assign(nbDistinctSites_, 0);
+    vector<ParsimonyWord> bitsets;
+    unsigned int score;
+    computeSiteScoresPostorder_(getTreeP_()->getRootNode(), bitsets, score, siteScores);
+    siteScoresUpToDate_ = true;
+  }
+  return siteScores[parsimonyData_->getRootArrayPosition(site)];
+}
+
+void DRTreeParsimonyScore::computeSiteScoresPostorder_(const Node* node, vector<ParsimonyWord>& rBitsets, unsigned int& rScore, vector<unsigned int>& siteScores) const
+{
+  if (node->isLeaf())
+  {
+    rBitsets = parsimonyData_->getLeafData(node->getId()).getBitsetsArray();
+    rScore   = 0;
+    return;
+  }
+  size_t nbSons = node->getNumberOfSons();
+  vector< vector<ParsimonyWord> > sonBitsets(nbSons);
+  vector<unsigned int> sonScores(nbSons);
+  vector< const vector<ParsimonyWord>*> iBitsets(nbSons);
+  for (size_t k = 0; k < nbSons; k++)
+  {
+    computeSiteScoresPostorder_(node->getSon(k), sonBitsets[k], sonScores[k], siteScores);
+    iBitsets[k] = &sonBitsets[k];
+  }
+  computeScoresFromArrays(iBitsets, sonScores, rBitsets, rScore, &siteScores);
 }
 
 /******************************************************************************/
+
+namespace
+{
+
+inline unsigned int countBits(ParsimonyWord word)
+{
+#ifdef __GNUC__
+  return static_cast<unsigned int>(__builtin_popcountl(word));
+#else
+  unsigned int count = 0;
+  for ( ; word; word &= word - 1)
+    count++;
+  return count;
+#endif
+}
+
+inline size_t getLowestBit(ParsimonyWord word)
+{
+#ifdef __GNUC__
+  return static_cast<size_t>(__builtin_ctzl(word));
+#else
+  size_t i = 0;
+  for ( ; !(word & 1); word >>= 1)
+    i++;
+  return i;
+#endif
+}
+
+} //end of anonymous namespace.
+
 void DRTreeParsimonyScore::computeScoresFromArrays(
-  const vector< const vector<Bitset>*>& iBitsets,
-  const vector< const vector<unsigned int>*>& iScores,
-  vector<Bitset>& oBitsets,
-  vector<unsigned int>& oScores)
+  const vector< const vector<ParsimonyWord>*>& iBitsets,
+  const vector<unsigned int>& iScores,
+  vector<ParsimonyWord>& oBitsets,
+  unsigned int& oScore,
+  vector<unsigned int>* siteScores) const
 {
-  size_t nbPos  = oBitsets.size();
   size_t nbNodes = iBitsets.size();
   if (iScores.size() != nbNodes)
     throw Exception("DRTreeParsimonyScore::computeScores(); Error, input arrays must have the same length.");
   if (nbNodes < 1)
     throw Exception("DRTreeParsimonyScore::computeScores(); Error, input arrays must have a size >= 1.");
-  const vector<Bitset>* bitsets0 = iBitsets[0];
-  const vector<unsigned int>* scores0 = iScores[0];
-  for (size_t i = 0; i < nbPos; i++)
-  {
-    oBitsets[i] = (*bitsets0)[i];
-    oScores[i]  = (*scores0)[i];
-  }
+  size_t nbStates = parsimonyData_->getNumberOfStates();
+  size_t nbBlocks = parsimonyData_->getNumberOfBlocks();
+  oBitsets = *iBitsets[0];
+  oScore   = iScores[0];
+  if (nbBlocks == 0) return;
+
+  // Blocks are processed by chunks, so that the loops over blocks can be vectorized
+  // while the temporary array of empty intersections stays in cache:
+  const size_t chunkSize = 32;
+  ParsimonyWord empty[chunkSize];
   for (size_t k = 1; k < nbNodes; k++)
   {
-    const vector<Bitset>* bitsetsk = iBitsets[k];
-    const vector<unsigned int>* scoresk = iScores[k];
-    for (unsigned int i = 0; i < nbPos; i++)
+    oScore += iScores[k];
+    const ParsimonyWord* iBitsets_k = &(*iBitsets[k])[0];
+    ParsimonyWord* oBitsets_k = &oBitsets[0];
+    for (size_t b0 = 0; b0 < nbBlocks; b0 += chunkSize)
     {
-      Bitset bs = oBitsets[i] & (*bitsetsk)[i];
-      oScores[i] += (*scoresk)[i];
-      if (bs == 0)
+      size_t n = min(chunkSize, nbBlocks - b0);
+      // Sites where the intersection of the two sets is empty:
+      for (size_t j = 0; j < n; j++)
+        empty[j] = 0;
+      for (size_t s = 0; s < nbStates; s++)
+      {
+        const ParsimonyWord* x = iBitsets_k + s * nbBlocks + b0;
+        const ParsimonyWord* o = oBitsets_k + s * nbBlocks + b0;
+        for (size_t j = 0; j < n; j++)
+          empty[j] |= o[j] & x[j];
+      }
+      for (size_t j = 0; j < n; j++)
+        empty[j] = ~empty[j];
+      // Intersection where not empty, union otherwise:
+      for (size_t s = 0; s < nbStates; s++)
       {
-        bs = oBitsets[i] | (*bitsetsk)[i];
-        oScores[i] += 1;
+        const ParsimonyWord* x = iBitsets_k + s * nbBlocks + b0;
+        ParsimonyWord* o = oBitsets_k + s * nbBlocks + b0;
+        for (size_t j = 0; j < n; j++)
+          o[j] = (o[j] & x[j]) | (empty[j] & (o[j] | x[j]));
+      }
+      // Score, one per empty intersection:
+      for (size_t j = 0; j < n; j++)
+      {
+        ParsimonyWord word = empty[j];
+        if (!word) continue;
+        size_t block = b0 + j;
+        unsigned int weight = parsimonyData_->getBlockWeight(block);
+        if (weight > 0 && !siteScores)
+        {
+          oScore += weight * countBits(word);
+        }
+        else
+        {
+          size_t offset = block * DRTreeParsimonyData::SITES_PER_WORD;
+          for ( ; word; word &= word - 1)
+          {
+            size_t i = offset + getLowestBit(word);
+            oScore += parsimonyData_->getWeight(i);
+            if (siteScores)
+              (*siteScores)[i]++;
+          }
+        }
       }
-      oBitsets[i] = bs;
     }
   }
 }
@@ -325,60 +419,51 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const throw (NodeException)
 
   // Retrieving arrays of interest:
   const DRTreeParsimonyNodeData* parentData = &parsimonyData_->getNodeData(parent->getId());
-  const vector<Bitset>* sonBitsets = &parentData->getBitsetsArrayForNeighbor(son->getId());
-  const vector<unsigned int>* sonScores  = &parentData->getScoresArrayForNeighbor(son->getId());
+  const vector<ParsimonyWord>* sonBitsets = &parentData->getBitsetsArrayForNeighbor(son->getId());
+  unsigned int sonScore = parentData->getScoreForNeighbor(son->getId());
   vector<const Node*> parentNeighbors = TreeTemplateTools::getRemainingNeighbors(parent, grandFather, son);
   size_t nbParentNeighbors = parentNeighbors.size();
-  vector< const vector<Bitset>*> parentBitsets(nbParentNeighbors);
-  vector< const vector<unsigned int>*> parentScores(nbParentNeighbors);
+  vector< const vector<ParsimonyWord>*> parentBitsets(nbParentNeighbors);
+  vector<unsigned int> parentScores(nbParentNeighbors);
   for (unsigned int k = 0; k < nbParentNeighbors; k++)
   {
     const Node* n = parentNeighbors[k]; // This neighbor
     parentBitsets[k] = &parentData->getBitsetsArrayForNeighbor(n->getId());
-    parentScores[k] = &parentData->getScoresArrayForNeighbor(n->getId());
+    parentScores[k] = parentData->getScoreForNeighbor(n->getId());
   }
 
   const DRTreeParsimonyNodeData* grandFatherData = &parsimonyData_->getNodeData(grandFather->getId());
-  const vector<Bitset>* uncleBitsets = &grandFatherData->getBitsetsArrayForNeighbor(uncle->getId());
-  const vector<unsigned int>* uncleScores  = &grandFatherData->getScoresArrayForNeighbor(uncle->getId());
+  const vector<ParsimonyWord>* uncleBitsets = &grandFatherData->getBitsetsArrayForNeighbor(uncle->getId());
+  unsigned int uncleScore = grandFatherData->getScoreForNeighbor(uncle->getId());
   vector<const Node*> grandFatherNeighbors = TreeTemplateTools::getRemainingNeighbors(grandFather, parent, uncle);
   size_t nbGrandFatherNeighbors = grandFatherNeighbors.size();
-  vector< const vector<Bitset>*> grandFatherBitsets(nbGrandFatherNeighbors);
-  vector< const vector<unsigned int>*> grandFatherScores(nbGrandFatherNeighbors);
+  vector< const vector<ParsimonyWord>*> grandFatherBitsets(nbGrandFatherNeighbors);
+  vector<unsigned int> grandFatherScores(nbGrandFatherNeighbors);
   for (unsigned int k = 0; k < nbGrandFatherNeighbors; k++)
   {
     const Node* n = grandFatherNeighbors[k]; // This neighbor
     grandFatherBitsets[k] = &grandFatherData->getBitsetsArrayForNeighbor(n->getId());
-    grandFatherScores[k] = &grandFatherData->getScoresArrayForNeighbor(n->getId());
+    grandFatherScores[k] = grandFatherData->getScoreForNeighbor(n->getId());
   }
 
   // Compute arrays and scores for grand-father node:
   grandFatherBitsets.push_back(sonBitsets);
-  grandFatherScores.push_back(sonScores);
-  // Init arrays:
-  vector<Bitset> gfBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
-  vector<unsigned int> gfScores(sonScores->size());
-  // Fill arrays:
-  computeScoresFromArrays(grandFatherBitsets, grandFatherScores, gfBitsets, gfScores);
+  grandFatherScores.push_back(sonScore);
+  vector<ParsimonyWord> gfBitsets;
+  unsigned int gfScore;
+  computeScoresFromArrays(grandFatherBitsets, grandFatherScores, gfBitsets, gfScore);
 
   // Now computes arrays and scores for parent node:
   parentBitsets.push_back(uncleBitsets);
-  parentScores.push_back(uncleScores);
+  parentScores.push_back(uncleScore);
   parentBitsets.push_back(&gfBitsets);
-  parentScores.push_back(&gfScores);
-  // Init arrays:
-  vector<Bitset> pBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
-  vector<unsigned int> pScores(sonScores->size());
-  // Fill arrays:
-  computeScoresFromArrays(parentBitsets, parentScores, pBitsets, pScores);
+  parentScores.push_back(gfScore);
+  vector<ParsimonyWord> pBitsets;
+  unsigned int pScore;
+  computeScoresFromArrays(parentBitsets, parentScores, pBitsets, pScore);
 
   // Final computation:
-  unsigned int score = 0;
-  for (unsigned int i = 0; i < nbDistinctSites_; i++)
-  {
-    score += pScores[i] * parsimonyData_->getWeight(i);
-  }
-  return (double)score - (double)getScore();
+  return (double)pScore - (double)getScore();
 }
 
 /******************************************************************************/
@@ -403,3 +488,150 @@ void DRTreeParsimonyScore::doNNI(int nodeId) throw (NodeException)
 
 /******************************************************************************/
 
+void DRTreeParsimonyScore::orientPrunedTree_(const Node* node, const Node* from, size_t depth, PrunedTree_& pruned, vector<const Node*>& nodes) const
+{
+  pruned.depth[node->getId()] = depth;
+  nodes.push_back(node);
+  vector<const Node*> neighbors = node->getNeighbors();
+  for (size_t k = 0; k < neighbors.size(); k++)
+  {
+    if (neighbors[k] != from)
+      orientPrunedTree_(neighbors[k], node, depth + 1, pruned, nodes);
+  }
+}
+
+void DRTreeParsimonyScore::getPrunedArrays_(
+  const Node* node,
+  const Node* from,
+  PrunedTree_& pruned,
+  const vector<ParsimonyWord>*& rBitsets,
+  unsigned int& rScore) const
+{
+  if (node->isLeaf())
+  {
+    rBitsets = &parsimonyData_->getLeafData(node->getId()).getBitsetsArray();
+    rScore   = 0;
+    return;
+  }
+  bool newBranch = (node == pruned.neighbor1 && from == pruned.neighbor2)
+                || (node == pruned.neighbor2 && from == pruned.neighbor1);
+  if (newBranch)
+  {
+    // The branch created by the pruning: the arrays were computed from the pruning point.
+    rBitsets = &parsimonyData_->getNodeData(pruned.parent->getId()).getBitsetsArrayForNeighbor(node->getId());
+    rScore   = parsimonyData_->getNodeData(pruned.parent->getId()).getScoreForNeighbor(node->getId());
+    return;
+  }
+  if (pruned.depth[node->getId()] > pruned.depth[from->getId()])
+  {
+    // This side of the branch does not contain the pruned subtree, arrays are still valid:
+    rBitsets = &parsimonyData_->getNodeData(from->getId()).getBitsetsArrayForNeighbor(node->getId());
+    rScore   = parsimonyData_->getNodeData(from->getId()).getScoreForNeighbor(node->getId());
+    return;
+  }
+  pair<int, int> key(node->getId(), from->getId());
+  map<pair<int, int>, vector<ParsimonyWord> >::iterator it = pruned.bitsets.find(key);
+  if (it == pruned.bitsets.end())
+  {
+    // Arrays must be recomputed, without the pruned subtree:
+    vector<const Node*> neighbors = node->getNeighbors();
+    vector< const vector<ParsimonyWord>*> iBitsets;
+    vector<unsigned int> iScores;
+    for (size_t k = 0; k < neighbors.size(); k++)
+    {
+      const Node* n = neighbors[k];
+      if (n == pruned.parent)
+        n = (node == pruned.neighbor1 ? pruned.neighbor2 : pruned.neighbor1);
+      if (n == from) continue;
+      const vector<ParsimonyWord>* bitsets;
+      unsigned int score;
+      getPrunedArrays_(n, node, pruned, bitsets, score);
+      iBitsets.push_back(bitsets);
+      iScores.push_back(score);
+    }
+    it = pruned.bitsets.insert(make_pair(key, vector<ParsimonyWord>())).first;
+    computeScoresFromArrays(iBitsets, iScores, it->second, pruned.scores[key]);
+  }
+  rBitsets = &it->second;
+  rScore   = pruned.scores[key];
+}
+
+map<int, double> DRTreeParsimonyScore::testSPRs(int nodeId) const throw (NodeException)
+{
+  const Node* subtree = getTreeP_()->getNode(nodeId);
+  if (!subtree->hasFather()) throw NodePException("DRTreeParsimonyScore::testSPRs(). Node 'subtree' must not be the root node.", subtree);
+  const Node* parent = subtree->getFather();
+  vector<const Node*> neighbors = TreeTemplateTools::getRemainingNeighbors(parent, subtree, subtree);
+  if (neighbors.size() != 2) throw NodePException("DRTreeParsimonyScore::testSPRs(). Node 'parent' must have exactly three neighbors.", parent);
+
+  // The pruned subtree, as seen from its father:
+  const DRTreeParsimonyNodeData& parentData = parsimonyData_->getNodeData(parent->getId());
+  const vector<ParsimonyWord>* subtreeBitsets = &parentData.getBitsetsArrayForNeighbor(nodeId);
+  unsigned int subtreeScore = parentData.getScoreForNeighbor(nodeId);
+
+  // Distances to the pruning point tell which arrays include the pruned subtree:
+  PrunedTree_ pruned(parent, neighbors[0], neighbors[1]);
+  pruned.depth[parent->getId()] = 0;
+  vector<const Node*> nodes;
+  orientPrunedTree_(neighbors[0], parent, 1, pruned, nodes);
+  orientPrunedTree_(neighbors[1], parent, 1, pruned, nodes);
+
+  map<int, double> diffs;
+  double score = static_cast<double>(getScore());
+  vector< const vector<ParsimonyWord>*> iBitsets(3);
+  vector<unsigned int> iScores(3);
+  iBitsets[2] = subtreeBitsets;
+  iScores[2]  = subtreeScore;
+  vector<ParsimonyWord> oBitsets;
+  for (size_t i = 0; i < nodes.size(); i++)
+  {
+    const Node* node = nodes[i];
+    // The branch leading to a son of 'parent' is the current position, or does not exist anymore:
+    if (!node->hasFather() || node->getFather() == parent) continue;
+    getPrunedArrays_(node, node->getFather(), pruned, iBitsets[0], iScores[0]);
+    getPrunedArrays_(node->getFather(), node, pruned, iBitsets[1], iScores[1]);
+    unsigned int newScore;
+    computeScoresFromArrays(iBitsets, iScores, oBitsets, newScore);
+    diffs[node->getId()] = static_cast<double>(newScore) - score;
+  }
+  return diffs;
+}
+
+/******************************************************************************/
+void DRTreeParsimonyScore::doSPR(int nodeId, int regraftId) throw (NodeException)
+{
+  TreeTemplate<Node>* tree = getTreeP_();
+  Node* subtree = tree->getNode(nodeId);
+  if (!subtree->hasFather()) throw NodePException("DRTreeParsimonyScore::doSPR(). Node 'subtree' must not be the root node.", subtree);
+  Node* parent = subtree->getFather();
+  if (parent->degree() != 3) throw NodePException("DRTreeParsimonyScore::doSPR(). Node 'parent' must have exactly three neighbors.", parent);
+  Node* regraft = tree->getNode(regraftId);
+  if (!regraft->hasFather() || regraft == parent || regraft->getFather() == parent)
+    throw NodePException("DRTreeParsimonyScore::doSPR(). Invalid regraft position.", regraft);
+  vector<int> subtreeIds = TreeTemplateTools::getNodesId(*subtree);
+  if (find(subtreeIds.begin(), subtreeIds.end(), regraftId) != subtreeIds.end())
+    throw NodePException("DRTreeParsimonyScore::doSPR(). Regraft position is within the pruned subtree.", regraft);
+  Node* regraftFather = regraft->getFather();
+
+  // The node to move must have a father:
+  if (!parent->hasFather())
+    tree->rootAt(regraftFather);
+
+  // Prune:
+  Node* grandFather = parent->getFather();
+  Node* sibling = parent->getSon(parent->getSon(0) == subtree ? 1 : 0);
+  grandFather->removeSon(parent);
+  parent->removeSon(sibling);
+  grandFather->addSon(sibling);
+
+  // Regraft:
+  regraftFather->removeSon(regraft);
+  regraftFather->addSon(parent);
+  parent->addSon(regraft);
+
+  parsimonyData_->reInit();
+  computeScores();
+}
+
+/******************************************************************************/
+
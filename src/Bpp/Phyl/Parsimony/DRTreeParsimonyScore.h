@@ -45,6 +45,10 @@
 #include "../NNISearchable.h"
 #include "../TreeTools.h"
 
+// From the STL:
+#include <map>
+#include <utility>
+
 namespace bpp
 {
 /**
@@ -59,6 +63,27 @@ class DRTreeParsimonyScore :
 private:
   DRTreeParsimonyData* parsimonyData_;
   size_t nbDistinctSites_;
+  mutable bool siteScoresUpToDate_;
+
+  /**
+   * @brief Directional arrays of the tree obtained after pruning a subtree, used by testSPRs.
+   *
+   * Arrays are indexed by (node id, neighbor id), as in DRTreeParsimonyNodeData.
+   * Only the arrays that include the pruned subtree are recomputed, the other ones
+   * are taken from the parsimony data.
+   */
+  struct PrunedTree_
+  {
+    const Node* parent;
+    const Node* neighbor1;
+    const Node* neighbor2;
+    std::map<int, size_t> depth;
+    std::map<std::pair<int, int>, std::vector<ParsimonyWord> > bitsets;
+    std::map<std::pair<int, int>, unsigned int> scores;
+
+    PrunedTree_(const Node* p, const Node* n1, const Node* n2) :
+      parent(p), neighbor1(n1), neighbor2(n2), depth(), bitsets(), scores() {}
+  };
 
 public:
   DRTreeParsimonyScore(
@@ -95,7 +120,7 @@ protected:
   /**
    * @brief Compute all scores.
    *
-   * Call the computeScoresPreorder and computeScoresPostorder methods, and then initialize rootBitsets_ and rootScores_.
+   * Call the computeScoresPreorder and computeScoresPostorder methods, and then initialize rootBitsets_ and rootScore_.
    */
   virtual void computeScores();
   /**
@@ -112,60 +137,123 @@ public:
   unsigned int getScoreForSite(size_t site) const;
 
   /**
-   * @brief Compute bitsets and scores for each site for a node, in postorder.
+   * @brief Compute bitsets and score for a node, in postorder.
    *
    * @param pData    The node data to use.
    * @param rBitsets The bitset array where to store the resulting bitsets.
-   * @param rScores  The score array where to write the resulting scores.
+   * @param rScore   The resulting score.
    */
-  static void computeScoresPostorderForNode(
+  void computeScoresPostorderForNode(
     const DRTreeParsimonyNodeData& pData,
-    std::vector<Bitset>& rBitsets,
-    std::vector<unsigned int>& rScores);
+    std::vector<ParsimonyWord>& rBitsets,
+    unsigned int& rScore) const;
 
   /**
-   * @brief Compute bitsets and scores for each site for a node, in preorder.
+   * @brief Compute bitsets and score for a node, in preorder.
    *
    * @param pData    The node data to use.
    * @param source   The node where we are coming from.
    * @param rBitsets The bitset array where to store the resulting bitsets.
-   * @param rScores  The score array where to write the resulting scores.
+   * @param rScore   The resulting score.
    */
-  static void computeScoresPreorderForNode(
+  void computeScoresPreorderForNode(
     const DRTreeParsimonyNodeData& pData,
     const Node* source,
-    std::vector<Bitset>& rBitsets,
-    std::vector<unsigned int>& rScores);
+    std::vector<ParsimonyWord>& rBitsets,
+    unsigned int& rScore) const;
 
   /**
-   * @brief Compute bitsets and scores for each site for a node, in all directions.
+   * @brief Compute bitsets and score for a node, in all directions.
    *
    * @param pData    The node data to use.
    * @param rBitsets The bitset array where to store the resulting bitsets.
-   * @param rScores  The score array where to write the resulting scores.
+   * @param rScore   The resulting score.
    */
-  static void computeScoresForNode(
-    const DRTreeParsimonyNodeData& pData, std::vector<Bitset>& rBitsets,
-    std::vector<unsigned int>& rScores);
+  void computeScoresForNode(
+    const DRTreeParsimonyNodeData& pData,
+    std::vector<ParsimonyWord>& rBitsets,
+    unsigned int& rScore) const;
 
   /**
-   * @brief Compute bitsets and scores from an array of arrays.
+   * @brief Compute bitsets and score from an array of arrays.
    *
    * This method is the more general score computation.
-   * Depending on what is passed as input, it may computes scroes fo a subtree
+   * Depending on what is passed as input, it may computes scores for a subtree
    * or the whole tree.
+   * All arrays are bit-sliced, as described in DRTreeParsimonyData, so that
+   * all sites of a block are processed at once.
+   *
+   * @param iBitsets   The vector of bitset arrays to use.
+   * @param iScores    The vector of subtree scores to use.
+   * @param oBitsets   The bitset array where to store the resulting bitsets.
+   * @param oScore     The resulting weighted score.
+   * @param siteScores If not null, the unweighted score increment of each distinct site is added to this array.
+   */
+  void computeScoresFromArrays(
+    const std::vector<const std::vector<ParsimonyWord>*>& iBitsets,
+    const std::vector<unsigned int>& iScores,
+    std::vector<ParsimonyWord>& oBitsets,
+    unsigned int& oScore,
+    std::vector<unsigned int>* siteScores = 0) const;
+
+private:
+  /**
+   * @brief Compute the score of each distinct site, in postorder, for use by getScoreForSite.
+   */
+  void computeSiteScoresPostorder_(
+    const Node* node,
+    std::vector<ParsimonyWord>& rBitsets,
+    unsigned int& rScore,
+    std::vector<unsigned int>& siteScores) const;
+
+  void orientPrunedTree_(const Node* node, const Node* from, size_t depth, PrunedTree_& pruned, std::vector<const Node*>& nodes) const;
+
+  void getPrunedArrays_(
+    const Node* node,
+    const Node* from,
+    PrunedTree_& pruned,
+    const std::vector<ParsimonyWord>*& rBitsets,
+    unsigned int& rScore) const;
+
+public:
+  /**
+   * @name Subtree pruning and regrafting (SPR).
+   *
+   * Topology changes are described by two nodes: the root of the subtree to prune,
+   * and a node of the remaining tree, the subtree being regrafted on the branch
+   * between this node and its father.
+   * Bifurcating trees are assumed.
+   *
+   * @{
+   */
+
+  /**
+   * @brief Score all possible regraft positions of a subtree.
+   *
+   * The directional arrays of the tree without the subtree are computed once,
+   * reusing all arrays that do not include the pruned subtree.
+   * Each regraft position then only costs the combination of three arrays.
+   *
+   * @param nodeId The id of the root of the subtree to prune. It must not be the root of the tree.
+   * @return For each regraft position, given by a node id, the difference between the
+   * score of the new tree and the current one. The current position is not included.
+   * @throw NodeException If the subtree cannot be pruned.
+   */
+  std::map<int, double> testSPRs(int nodeId) const throw (NodeException);
+
+  /**
+   * @brief Prune a subtree and regraft it at a new position.
    *
-   * @param iBitsets The vector of bitset arrays to use.
-   * @param iScores  The vector of score arrays to use.
-   * @param oBitsets The bitset array where to store the resulting bitsets.
-   * @param oScores  The score array where to write the resulting scores.
+   * The tree may be rerooted in the process, and all scores are recomputed.
+   *
+   * @param nodeId    The id of the root of the subtree to prune.
+   * @param regraftId The id of the node below the regraft position, as returned by testSPRs.
+   * @throw NodeException If the move is not valid.
    */
-  static void computeScoresFromArrays(
-    const std::vector<const std::vector<Bitset>*>& iBitsets,
-    const std::vector<const std::vector<unsigned int>*>& iScores,
-    std::vector<Bitset>& oBitsets,
-    std::vector<unsigned int>& oScores);
+  void doSPR(int nodeId, int regraftId) throw (NodeException);
+  /** @} */
 
+public:
   /**
    * @name Thee NNISearchable interface.
    *
@@ -49,6 +49,8 @@ using namespace bpp;
 size_t AbstractMutationProcess::mutate(size_t state) const
 {
   double alea = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.0);
+  if (samplers_.size() == size_)
+    return samplers_[state].draw(alea);
   for (size_t j = 0; j < size_; j++)
   {
     if (alea < repartition_[state][j]) return j;
@@ -63,21 +65,24 @@ size_t AbstractMutationProcess::mutate(size_t state, unsigned int n) const
   size_t s = state;
   for (unsigned int k = 0; k < n; k++)
   {
-    double alea = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.0);
-    for (size_t j = 1; j < size_ + 1; j++)
-    {
-      if (alea < repartition_[s][j])
-      {
-        s = j;
-        break;
-      }
-    }
+    s = mutate(s);
   }
   return s;
 }
 
 /******************************************************************************/
 
+void AbstractMutationProcess::initSamplers()
+{
+  samplers_.resize(size_);
+  for (size_t i = 0; i < size_; i++)
+  {
+    samplers_[i] = StateSampler(repartition_[i]);
+  }
+}
+
+/******************************************************************************/
+
 double AbstractMutationProcess::getTimeBeforeNextMutationEvent(size_t state) const
 {
   return RandomTools::randExponential(-1. / model_->Qij(state, state));
@@ -148,6 +153,7 @@ SimpleMutationProcess::SimpleMutationProcess(const SubstitutionModel* model) :
   }
   // Note that I use cumulative probabilities in repartition_ (hence the name).
   // These cumulative probabilities are useful for the 'mutate(...)' function.
+  initSamplers();
 }
 
 SimpleMutationProcess::~SimpleMutationProcess() {}
@@ -156,12 +162,13 @@ SimpleMutationProcess::~SimpleMutationProcess() {}
 
 size_t SimpleMutationProcess::evolve(size_t initialState, double time) const
 {
-  // Compute all cumulative pijt:
+  // Compute all cumulative pijt, with a single matrix exponential:
+  const Matrix<double>& P = model_->getPij_t(time);
   Vdouble pijt(size_);
-  pijt[0] = model_->Pij_t(initialState, 0, time);
+  pijt[0] = P(initialState, 0);
   for (size_t i = 1; i < size_; i++)
   {
-    pijt[i] = pijt[i - 1] + model_->Pij_t(initialState, i, time);
+    pijt[i] = pijt[i - 1] + P(initialState, i);
   }
   double rand = RandomTools::giveRandomNumberBetweenZeroAndEntry(1);
   for (size_t i = 0; i < size_; i++)
@@ -191,6 +198,7 @@ SelfMutationProcess::SelfMutationProcess(size_t alphabetSize) :
   }
   // Note that I use cumulative probabilities in repartition_ (hence the name).
   // These cumulative probabilities are useful for the 'mutate(...)' function.
+  initSamplers();
 }
 
 SelfMutationProcess::~SelfMutationProcess() {}
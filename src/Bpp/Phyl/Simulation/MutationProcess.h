@@ -42,6 +42,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "../Model/SubstitutionModel.h"
 #include "../Mapping/SubstitutionRegister.h"
+#include "StateSampler.h"
 
 #include <Bpp/Numeric/VectorTools.h>
 
@@ -273,6 +274,8 @@ class MutationProcess
  * corresponding character using the bijection of the repartition function.
  *
  * All derived classes must initialize the repartition_ and size_ fields.
+ * They should then call initSamplers(), so that states are drawn in constant time.
+ * Otherwise, the repartition function is scanned linearly at each mutation.
  */
 class AbstractMutationProcess :
   public virtual MutationProcess
@@ -296,14 +299,19 @@ class AbstractMutationProcess :
      * we'll be in state <= j at time t+1.
      */
     VVdouble repartition_;
+
+    /**
+     * @brief Samplers built from the repartition function, one per state.
+     */
+    std::vector<StateSampler> samplers_;
   
   public:
     AbstractMutationProcess(const SubstitutionModel* model) :
-      model_(model), size_(), repartition_()
+      model_(model), size_(), repartition_(), samplers_()
     {}
 
     AbstractMutationProcess(const AbstractMutationProcess& amp) :
-      model_(amp.model_), size_(amp.size_), repartition_(amp.repartition_)
+      model_(amp.model_), size_(amp.size_), repartition_(amp.repartition_), samplers_(amp.samplers_)
     {}
 
     AbstractMutationProcess& operator=(const AbstractMutationProcess& amp)
@@ -311,6 +319,7 @@ class AbstractMutationProcess :
       model_       = amp.model_;
       size_        = amp.size_;
       repartition_ = amp.repartition_;
+      samplers_    = amp.samplers_;
       return *this;
     }
 
@@ -323,6 +332,14 @@ class AbstractMutationProcess :
     size_t evolve(size_t initialState, double time) const;
     MutationPath detailedEvolve(size_t initialState, double time) const;
     const SubstitutionModel* getSubstitutionModel() const { return model_; }
+
+  protected:
+    /**
+     * @brief Build the samplers from the repartition function.
+     *
+     * Must be called again each time repartition_ is modified.
+     */
+    void initSamplers();
 };
 
 /**
@@ -49,9 +49,42 @@
 // From SeqLib:
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 
+// From the STL:
+#include <algorithm>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
 using namespace bpp;
 using namespace std;
 
+namespace
+{
+  /**
+   * Build one sampler per row of a transition probability matrix.
+   */
+  void buildSamplers(const Matrix<double>& P, vector<StateSampler>& samplers)
+  {
+    size_t nbStates = P.getNumberOfRows();
+    samplers.resize(nbStates);
+    Vdouble cumpxy(nbStates);
+    for (size_t x = 0; x < nbStates; x++)
+    {
+      cumpxy[0] = P(x, 0);
+      for (size_t y = 1; y < nbStates; y++)
+      {
+        cumpxy[y] = cumpxy[y - 1] + P(x, y);
+      }
+      samplers[x] = StateSampler(cumpxy);
+    }
+  }
+}
+
+/******************************************************************************/
+
+const size_t NonHomogeneousSequenceSimulator::SIMULATION_BLOCK_SIZE = 1024;
+
 /******************************************************************************/
 
 NonHomogeneousSequenceSimulator::NonHomogeneousSequenceSimulator(
@@ -70,7 +103,8 @@ NonHomogeneousSequenceSimulator::NonHomogeneousSequenceSimulator(
   nbNodes_(),
   nbClasses_(rate_->getNumberOfCategories()),
   nbStates_(modelSet_->getNumberOfStates()),
-  continuousRates_(false)
+  continuousRates_(false),
+  nbThreads_(1)
 {
   if (!modelSet->isFullySetUpFor(*tree))
     throw Exception("NonHomogeneousSequenceSimulator(constructor). Model set is not fully specified.");
@@ -95,7 +129,8 @@ NonHomogeneousSequenceSimulator::NonHomogeneousSequenceSimulator(
   nbNodes_(),
   nbClasses_(rate_->getNumberOfCategories()),
   nbStates_(model->getNumberOfStates()),
-  continuousRates_(false)
+  continuousRates_(false),
+  nbThreads_(1)
 {
   FixedFrequenciesSet* fSet = new FixedFrequenciesSet(model->getStateMap().clone(), model->getFrequencies());
   fSet->setNamespace("anc.");
@@ -112,7 +147,7 @@ void NonHomogeneousSequenceSimulator::init()
   {
     seqNames_[i] = leaves_[i]->getName();
   }
-  // Initialize cumulative pxy:
+  // Initialize samplers from cumulative pxy:
   vector<SNode*> nodes = tree_.getNodes();
   nodes.pop_back(); // remove root
   nbNodes_ = nodes.size();
@@ -122,23 +157,12 @@ void NonHomogeneousSequenceSimulator::init()
     SNode* node = nodes[i];
     node->getInfos().model = modelSet_->getModelForNode(node->getId());
     double d = node->getDistanceToFather();
-    VVVdouble* cumpxy_node_ = &node->getInfos().cumpxy;
-    cumpxy_node_->resize(nbClasses_);
+    vector< vector<StateSampler> >* samplers_node_ = &node->getInfos().samplers;
+    samplers_node_->resize(nbClasses_);
     for (size_t c = 0; c < nbClasses_; c++)
     {
-      VVdouble* cumpxy_node_c_ = &(*cumpxy_node_)[c];
-      cumpxy_node_c_->resize(nbStates_);
       RowMatrix<double> P = node->getInfos().model->getPij_t(d * rate_->getCategory(c));
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        Vdouble* cumpxy_node_c_x_ = &(*cumpxy_node_c_)[x];
-        cumpxy_node_c_x_->resize(nbStates_);
-        (*cumpxy_node_c_x_)[0] = P(x, 0);
-        for (size_t y = 1; y < nbStates_; y++)
-        {
-          (*cumpxy_node_c_x_)[y] = (*cumpxy_node_c_x_)[y - 1] + P(x, y);
-        }
-      }
+      buildSamplers(P, (*samplers_node_)[c]);
     }
   }
 }
@@ -297,6 +321,125 @@ SiteContainer* NonHomogeneousSequenceSimulator::simulate(size_t numberOfSites) c
 
 /******************************************************************************/
 
+SiteContainer* NonHomogeneousSequenceSimulator::simulate(size_t numberOfSites, uint64_t seed) const throw (Exception)
+{
+  vector< vector<int> > states(leaves_.size(), vector<int>(numberOfSites));
+  simulate(0, numberOfSites, seed, states);
+
+  // Now create a SiteContainer object:
+  AlignedSequenceContainer* sites = new AlignedSequenceContainer(alphabet_);
+  for (size_t i = 0; i < leaves_.size(); i++)
+  {
+    sites->addSequence(BasicSequence(leaves_[i]->getName(), states[i], alphabet_), false);
+  }
+  return sites;
+}
+
+/******************************************************************************/
+
+void NonHomogeneousSequenceSimulator::simulate(size_t firstSite, size_t numberOfSites, uint64_t seed, vector< vector<int> >& states) const throw (Exception)
+{
+  if (continuousRates_)
+    throw Exception("NonHomogeneousSequenceSimulator::simulate. Continuous rates are not supported with a seed.");
+  if (firstSite % SIMULATION_BLOCK_SIZE != 0)
+    throw Exception("NonHomogeneousSequenceSimulator::simulate. The first site must be a multiple of the block size.");
+  size_t nbLeaves = leaves_.size();
+  if (states.size() != nbLeaves)
+    throw Exception("NonHomogeneousSequenceSimulator::simulate. The matrix must have one row per leaf.");
+  for (size_t i = 0; i < nbLeaves; i++)
+  {
+    if (states[i].size() < numberOfSites)
+      throw Exception("NonHomogeneousSequenceSimulator::simulate. Matrix rows are too short for the number of sites.");
+  }
+
+  // Nodes in breadth-first order, so that fathers come before their sons.
+  // The tree is only read, so that blocks can be simulated concurrently.
+  vector<const SNode*> nodes(1, tree_.getRootNode());
+  vector<size_t> fathers(1, 0);
+  map<int, size_t> positions;
+  for (size_t k = 0; k < nodes.size(); k++)
+  {
+    positions[nodes[k]->getId()] = k;
+    for (size_t i = 0; i < nodes[k]->getNumberOfSons(); i++)
+    {
+      nodes.push_back(nodes[k]->getSon(i));
+      fathers.push_back(k);
+    }
+  }
+  vector<size_t> leafPositions(nbLeaves);
+  for (size_t i = 0; i < nbLeaves; i++)
+  {
+    leafPositions[i] = positions[leaves_[i]->getId()];
+  }
+
+  vector<double> cumfreqs = modelSet_->getRootFrequencies();
+  for (size_t i = 1; i < cumfreqs.size(); i++)
+  {
+    cumfreqs[i] += cumfreqs[i - 1];
+  }
+  StateSampler rootSampler(cumfreqs);
+
+  uint64_t firstBlock = static_cast<uint64_t>(firstSite / SIMULATION_BLOCK_SIZE);
+  long nbBlocks = static_cast<long>((numberOfSites + SIMULATION_BLOCK_SIZE - 1) / SIMULATION_BLOCK_SIZE);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads_))
+#endif
+  for (long b = 0; b < nbBlocks; b++)
+  {
+    RandomStream stream(seed, firstBlock + static_cast<uint64_t>(b));
+    size_t begin   = static_cast<size_t>(b) * SIMULATION_BLOCK_SIZE;
+    size_t nbSites = min(SIMULATION_BLOCK_SIZE, numberOfSites - begin);
+
+    // Draw ancestral states and rate classes:
+    vector< vector<size_t> > nodeStates(nodes.size(), vector<size_t>(nbSites));
+    vector<size_t> rateClasses(nbSites);
+    for (size_t j = 0; j < nbSites; j++)
+    {
+      nodeStates[0][j] = rootSampler.draw(stream.drawNumber());
+      rateClasses[j]   = stream.drawIndex(nbClasses_);
+    }
+
+    // Make these states evolve:
+    for (size_t k = 1; k < nodes.size(); k++)
+    {
+      const vector< vector<StateSampler> >* samplers_node_ = &nodes[k]->getInfos().samplers;
+      const vector<size_t>* fatherStates = &nodeStates[fathers[k]];
+      vector<size_t>* sonStates = &nodeStates[k];
+      for (size_t j = 0; j < nbSites; j++)
+      {
+        (*sonStates)[j] = (*samplers_node_)[rateClasses[j]][(*fatherStates)[j]].draw(stream.drawNumber());
+      }
+    }
+
+    // Store the states of the leaves:
+    for (size_t i = 0; i < nbLeaves; i++)
+    {
+      const SubstitutionModel* model = nodes[leafPositions[i]]->getInfos().model;
+      const vector<size_t>* leafStates = &nodeStates[leafPositions[i]];
+      int* row = &states[i][begin];
+      for (size_t j = 0; j < nbSites; j++)
+      {
+        row[j] = model->getAlphabetStateAsInt((*leafStates)[j]);
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+void NonHomogeneousSequenceSimulator::setNumberOfThreads(size_t nbThreads)
+{
+#ifdef _OPENMP
+  if (nbThreads == 0)
+    nbThreads = static_cast<size_t>(omp_get_num_procs());
+  nbThreads_ = nbThreads;
+#else
+  nbThreads_ = 1;
+#endif
+}
+
+/******************************************************************************/
+
 RASiteSimulationResult* NonHomogeneousSequenceSimulator::dSimulateSite() const
 {
   // Draw an initial state randomly according to equilibrum frequencies:
@@ -377,30 +520,28 @@ RASiteSimulationResult* NonHomogeneousSequenceSimulator::dSimulateSite(double ra
 
 size_t NonHomogeneousSequenceSimulator::evolve(const SNode* node, size_t initialStateIndex, size_t rateClass) const
 {
-  const Vdouble* cumpxy_node_c_x_ = &node->getInfos().cumpxy[rateClass][initialStateIndex];
   double rand = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-  for (size_t y = 0; y < nbStates_; y++)
-  {
-    if (rand < (*cumpxy_node_c_x_)[y]) return y;
-  }
-  throw Exception("HomogeneousSequenceSimulator::evolve. The impossible happened! rand = " + TextTools::toString(rand) + ".");
+  return node->getInfos().samplers[rateClass][initialStateIndex].draw(rand);
 }
 
 /******************************************************************************/
 
 size_t NonHomogeneousSequenceSimulator::evolve(const SNode* node, size_t initialStateIndex, double rate) const
 {
-  double cumpxy = 0;
   double rand = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-  double l = rate * node->getDistanceToFather();
-  const SubstitutionModel* model = node->getInfos().model;
+  const Matrix<double>& P = node->getInfos().model->getPij_t(rate * node->getDistanceToFather());
+  // Rates usually differ from site to site, so that only the row of the initial state is used.
+  // States are drawn as with a StateSampler built from this row:
+  double cumpxy = 0;
+  size_t last = 0;
   for (size_t y = 0; y < nbStates_; y++)
   {
-    cumpxy += model->Pij_t(initialStateIndex, y, l);
+    double pxy = P(initialStateIndex, y);
+    if (pxy > 0) last = y;
+    cumpxy += pxy;
     if (rand < cumpxy) return y;
   }
-  MatrixTools::print(model->getPij_t(l));
-  throw Exception("HomogeneousSequenceSimulator::evolve. The impossible happened! rand = " + TextTools::toString(rand) + ".");
+  return last;
 }
 
 /******************************************************************************/
@@ -411,19 +552,11 @@ void NonHomogeneousSequenceSimulator::multipleEvolve(
     const vector<size_t>& rateClasses,
     std::vector<size_t>& finalStateIndices) const
 {
-  const VVVdouble* cumpxy_node_ = &node->getInfos().cumpxy;
+  const vector< vector<StateSampler> >* samplers_node_ = &node->getInfos().samplers;
   for (size_t i = 0; i < initialStateIndices.size(); i++)
   {
-    const Vdouble* cumpxy_node_c_x_ = &(*cumpxy_node_)[rateClasses[i]][initialStateIndices[i]];
     double rand = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-    for (size_t y = 0; y < nbStates_; y++)
-    {
-      if (rand < (*cumpxy_node_c_x_)[y])
-      {
-        finalStateIndices[i] = y;
-        break;
-      }
-    }
+    finalStateIndices[i] = (*samplers_node_)[rateClasses[i]][initialStateIndices[i]].draw(rand);
   }
 }
 
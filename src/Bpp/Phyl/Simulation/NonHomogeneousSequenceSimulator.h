@@ -43,6 +43,8 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "DetailedSiteSimulator.h"
 #include "SequenceSimulator.h"
+#include "RandomStream.h"
+#include "StateSampler.h"
 #include "../TreeTemplate.h"
 #include "../NodeTemplate.h"
 #include "../Model/SubstitutionModel.h"
@@ -69,18 +71,21 @@ class SimData
   public:
     size_t state;
     std::vector<size_t> states;
-    VVVdouble cumpxy;
+    /**
+     * @brief Samplers of the state at the node, for each rate class and each state at the father node.
+     */
+    std::vector< std::vector<StateSampler> > samplers;
     const SubstitutionModel* model;
 
   public:
-    SimData(): state(), states(), cumpxy(), model(0) {}
-    SimData(const SimData& sd): state(sd.state), states(sd.states), cumpxy(), model(sd.model) {}
+    SimData(): state(), states(), samplers(), model(0) {}
+    SimData(const SimData& sd): state(sd.state), states(sd.states), samplers(sd.samplers), model(sd.model) {}
     SimData& operator=(const SimData& sd)
     {
-      state  = sd.state;
-      states = sd.states;
-      cumpxy = sd.cumpxy;
-      model  = sd.model;
+      state    = sd.state;
+      states   = sd.states;
+      samplers = sd.samplers;
+      model    = sd.model;
       return *this;
     }
 };
@@ -96,6 +101,14 @@ class NonHomogeneousSequenceSimulator:
   public DetailedSiteSimulator,
   public virtual SequenceSimulator
 {
+  public:
+    /**
+     * @brief Number of sites drawn from the same random stream in seeded simulations.
+     *
+     * Changing this value changes the simulated data for a given seed.
+     */
+    static const size_t SIMULATION_BLOCK_SIZE;
+
   private:
     const SubstitutionModelSet* modelSet_;
     const Alphabet            * alphabet_;
@@ -118,6 +131,8 @@ class NonHomogeneousSequenceSimulator:
     size_t nbStates_;
 
     bool continuousRates_;
+
+    size_t nbThreads_;
   
     /**
      * @name Stores intermediate results.
@@ -156,7 +171,8 @@ class NonHomogeneousSequenceSimulator:
       nbNodes_        (nhss.nbNodes_),
       nbClasses_      (nhss.nbClasses_),
       nbStates_       (nhss.nbStates_),
-      continuousRates_(nhss.continuousRates_)
+      continuousRates_(nhss.continuousRates_),
+      nbThreads_      (nhss.nbThreads_)
     {}
 
     NonHomogeneousSequenceSimulator& operator=(const NonHomogeneousSequenceSimulator& nhss)
@@ -174,6 +190,7 @@ class NonHomogeneousSequenceSimulator:
       nbClasses_       = nhss.nbClasses_;
       nbStates_        = nhss.nbStates_;
       continuousRates_ = nhss.continuousRates_;
+      nbThreads_       = nhss.nbThreads_;
       return *this;
     }
 
@@ -231,6 +248,56 @@ class NonHomogeneousSequenceSimulator:
      */
     SiteContainer* simulate(size_t numberOfSites) const;
     /** @} */
+
+    /**
+     * @brief Simulate sequences in a reproducible way.
+     *
+     * Sites are split into blocks of SIMULATION_BLOCK_SIZE sites, and each block draws its random
+     * numbers from its own RandomStream, built from the seed and the index of the block.
+     * The global random generator is not used. Blocks are simulated in parallel
+     * (see setNumberOfThreads()), and the result only depends on the seed,
+     * not on the number of threads.
+     *
+     * Only discrete rate classes are supported.
+     *
+     * @param numberOfSites The number of sites to simulate.
+     * @param seed          The seed of the random streams.
+     * @return A container with the simulated sequences.
+     * @throw Exception If continuous rates are enabled.
+     */
+    SiteContainer* simulate(size_t numberOfSites, uint64_t seed) const throw (Exception);
+
+    /**
+     * @brief Simulate a range of sites of a seeded simulation into a matrix of states.
+     *
+     * Leaf states are written directly into the matrix, without creating any Site or Sequence object.
+     * Simulating an alignment range by range gives the same states as simulate(size_t, uint64_t)
+     * with the same seed, so that large alignments can be simulated in chunks of bounded size.
+     *
+     * @param firstSite     The position of the first site to simulate in the full alignment.
+     * It must be a multiple of SIMULATION_BLOCK_SIZE.
+     * @param numberOfSites The number of sites to simulate.
+     * @param seed          The seed of the random streams.
+     * @param states        [out] The matrix of states, with one row per leaf, in the order of getSequencesNames().
+     * It must be allocated by the caller, with rows of at least numberOfSites states.
+     * Site i of the range is stored in column i.
+     * @throw Exception If continuous rates are enabled, or if the range or the matrix dimensions are invalid.
+     */
+    void simulate(size_t firstSite, size_t numberOfSites, uint64_t seed, std::vector< std::vector<int> >& states) const throw (Exception);
+
+    /**
+     * @brief Set the number of threads used by seeded simulations.
+     *
+     * If the library was built without OpenMP support, simulations are always single-threaded.
+     *
+     * @param nbThreads The number of threads to use. 0 means one thread per available processor.
+     */
+    void setNumberOfThreads(size_t nbThreads);
+
+    /**
+     * @return The number of threads used for seeded simulations.
+     */
+    size_t getNumberOfThreads() const { return nbThreads_; }
     
     /**
      * @name SiteSimulator and SequenceSimulator interface
@@ -284,7 +351,8 @@ class NonHomogeneousSequenceSimulator:
     /**
      * @brief Evolve from an initial state along a branch, knowing the evolutionary rate class.
      *
-     * This method is fast since all pijt have been computed in the constructor of the class.
+     * This method is fast since all pijt have been computed in the constructor of the class,
+     * and states are drawn in constant time.
      * This method is used for the implementation of the SiteSimulator interface.
      */
     size_t evolve(const SNode* node, size_t initialStateIndex, size_t rateClass) const;
@@ -293,6 +361,7 @@ class NonHomogeneousSequenceSimulator:
      * @brief Evolve from an initial state along a branch, knowing the evolutionary rate.
      *
      * This method is slower than the previous one since exponential terms must be computed.
+     * They are cached for the last branch lengths used.
      * This method is used for the implementation of the SiteSimulator interface.
      */
     size_t evolve(const SNode* node, size_t initialStateIndex, double rate) const;
@@ -0,0 +1,119 @@
+//
+// File: RandomStream.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _RANDOMSTREAM_H_
+#define _RANDOMSTREAM_H_
+
+// From the STL:
+#include <cstddef>
+#include <stdint.h>
+
+namespace bpp
+{
+
+/**
+ * @brief A counter-based stream of random numbers.
+ *
+ * The n-th number of a stream is a hash of the seed, the stream index and n,
+ * so that it does not depend on any other generator: streams can be used
+ * independently, for instance one per block of sites simulated on different
+ * threads, and results are fully determined by the seed.
+ * The hash is the SplitMix64 finalizer, which is fast and passes standard
+ * statistical test batteries.
+ *
+ * This class is not meant for cryptographic use.
+ */
+class RandomStream
+{
+  private:
+    uint64_t key_;
+    uint64_t counter_;
+
+  public:
+    /**
+     * @param seed   The seed.
+     * @param stream The index of the stream.
+     */
+    RandomStream(uint64_t seed, uint64_t stream) :
+      key_(mix(mix(seed) ^ (stream * 0xd1b54a32d192ed03ULL + 1))),
+      counter_(0)
+    {}
+
+  public:
+    /**
+     * @return A random number uniformly distributed in [0, 1).
+     */
+    double drawNumber()
+    {
+      return static_cast<double>(drawWord() >> 11) * (1. / 9007199254740992.);
+    }
+
+    /**
+     * @param n An upper bound, must be strictly positive.
+     * @return A random integer uniformly distributed in [0, n).
+     */
+    size_t drawIndex(size_t n)
+    {
+      size_t i = static_cast<size_t>(drawNumber() * static_cast<double>(n));
+      return i < n ? i : n - 1;
+    }
+
+    /**
+     * @return 64 random bits.
+     */
+    uint64_t drawWord()
+    {
+      return mix(key_ + (++counter_) * 0x9e3779b97f4a7c15ULL);
+    }
+
+    /**
+     * @return The number of words drawn so far.
+     */
+    uint64_t getPosition() const { return counter_; }
+
+  public:
+    /**
+     * @brief The SplitMix64 finalizer, a bijective mixing function on 64-bit words.
+     */
+    static uint64_t mix(uint64_t z);
+};
+
+} //end of namespace bpp.
+
+#endif //_RANDOMSTREAM_H_
@@ -0,0 +1,154 @@
+//
+// File: SimulatedSiteChunks.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "SimulatedSiteChunks.h"
+
+// From bpp-seq:
+#include <Bpp/Seq/Container/AlignedSequenceContainer.h>
+
+// From the STL:
+#include <algorithm>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+SimulatedSiteChunks::SimulatedSiteChunks(
+  const NonHomogeneousSequenceSimulator& simulator,
+  size_t numberOfSites,
+  uint64_t seed,
+  size_t chunkSize) throw (Exception) :
+  simulator_(&simulator),
+  numberOfSites_(numberOfSites),
+  seed_(seed),
+  chunkSize_(chunkSize),
+  position_(0),
+  states_()
+{
+  if (chunkSize_ == 0)
+    throw Exception("SimulatedSiteChunks. Chunk size must be positive.");
+  size_t blockSize = NonHomogeneousSequenceSimulator::SIMULATION_BLOCK_SIZE;
+  chunkSize_ = ((chunkSize_ + blockSize - 1) / blockSize) * blockSize;
+  // The matrix is allocated once, and reused for all chunks:
+  states_.resize(simulator.getSequencesNames().size(), vector<int>(min(chunkSize_, numberOfSites_)));
+}
+
+/******************************************************************************/
+
+size_t SimulatedSiteChunks::nextStates() throw (Exception)
+{
+  if (position_ >= numberOfSites_)
+    return 0;
+  size_t nbSites = min(chunkSize_, numberOfSites_ - position_);
+  simulator_->simulate(position_, nbSites, seed_, states_);
+  position_ += nbSites;
+  return nbSites;
+}
+
+/******************************************************************************/
+
+SiteContainer* SimulatedSiteChunks::nextChunk() throw (Exception)
+{
+  size_t nbSites = nextStates();
+  if (nbSites == 0)
+    return 0;
+  vector<string> names = simulator_->getSequencesNames();
+  AlignedSequenceContainer* sites = new AlignedSequenceContainer(simulator_->getAlphabet());
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    vector<int> content(states_[i].begin(), states_[i].begin() + static_cast<ptrdiff_t>(nbSites));
+    sites->addSequence(BasicSequence(names[i], content, simulator_->getAlphabet()), false);
+  }
+  return sites;
+}
+
+/******************************************************************************/
+
+void SimulatedSiteChunks::writePhylip(ostream& os) throw (Exception)
+{
+  const Alphabet* alphabet = simulator_->getAlphabet();
+  vector<string> names = simulator_->getSequencesNames();
+
+  // Symbols are looked up once for all resolved states:
+  vector<string> symbols(alphabet->getSize());
+  for (size_t x = 0; x < symbols.size(); x++)
+  {
+    symbols[x] = alphabet->intToChar(static_cast<int>(x));
+  }
+
+  size_t width = 10;
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    width = max(width, names[i].size() + 2);
+  }
+
+  os << names.size() << " " << numberOfSites_ << endl;
+  rewind();
+  bool first = true;
+  size_t nbSites;
+  string line;
+  while ((nbSites = nextStates()) != 0)
+  {
+    if (!first)
+      os << endl;
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      line.clear();
+      if (first)
+      {
+        line = names[i];
+        line.resize(width, ' ');
+      }
+      const vector<int>& row = states_[i];
+      for (size_t j = 0; j < nbSites; j++)
+      {
+        if (row[j] >= 0 && static_cast<size_t>(row[j]) < symbols.size())
+          line += symbols[static_cast<size_t>(row[j])];
+        else
+          line += alphabet->intToChar(row[j]);
+      }
+      os << line << endl;
+    }
+    first = false;
+  }
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,168 @@
+//
+// File: SimulatedSiteChunks.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _SIMULATEDSITECHUNKS_H_
+#define _SIMULATEDSITECHUNKS_H_
+
+#include "NonHomogeneousSequenceSimulator.h"
+#include "../Likelihood/StreamingSiteLikelihoods.h"
+
+// From the STL:
+#include <vector>
+#include <string>
+#include <iostream>
+
+namespace bpp
+{
+
+/**
+ * @brief Provide a seeded simulated alignment chunk by chunk.
+ *
+ * Each chunk is simulated on demand with NonHomogeneousSequenceSimulator::simulate(size_t, size_t, uint64_t, std::vector< std::vector<int> >&),
+ * into a matrix of states which is reused from one chunk to the next.
+ * The concatenation of all chunks is identical to the alignment returned by
+ * NonHomogeneousSequenceSimulator::simulate(size_t, uint64_t) with the same seed,
+ * but the memory required is bounded by the chunk size.
+ *
+ * Chunks can be passed to the likelihood code, for instance with StreamingSiteLikelihoods,
+ * or written to a stream in the PHYLIP interleaved format.
+ * Note that there is no likelihood input taking a matrix of states: chunks passed to the likelihood code
+ * are converted to sequences by nextChunk().
+ */
+class SimulatedSiteChunks :
+  public virtual SiteContainerChunkReader
+{
+  private:
+    const NonHomogeneousSequenceSimulator* simulator_;
+    size_t numberOfSites_;
+    uint64_t seed_;
+    size_t chunkSize_;
+    size_t position_;
+    std::vector< std::vector<int> > states_;
+
+  public:
+    /**
+     * @param simulator     The simulator to use (will not be copied, and must not be deleted before this object).
+     * @param numberOfSites The total number of sites in the alignment.
+     * @param seed          The seed of the simulation.
+     * @param chunkSize     The maximum number of sites in each chunk.
+     * It is rounded up to a multiple of NonHomogeneousSequenceSimulator::SIMULATION_BLOCK_SIZE.
+     */
+    SimulatedSiteChunks(
+      const NonHomogeneousSequenceSimulator& simulator,
+      size_t numberOfSites,
+      uint64_t seed,
+      size_t chunkSize) throw (Exception);
+
+    SimulatedSiteChunks(const SimulatedSiteChunks& chunks) :
+      simulator_(chunks.simulator_),
+      numberOfSites_(chunks.numberOfSites_),
+      seed_(chunks.seed_),
+      chunkSize_(chunks.chunkSize_),
+      position_(chunks.position_),
+      states_(chunks.states_)
+    {}
+
+    SimulatedSiteChunks& operator=(const SimulatedSiteChunks& chunks)
+    {
+      simulator_     = chunks.simulator_;
+      numberOfSites_ = chunks.numberOfSites_;
+      seed_          = chunks.seed_;
+      chunkSize_     = chunks.chunkSize_;
+      position_      = chunks.position_;
+      states_        = chunks.states_;
+      return *this;
+    }
+
+    virtual ~SimulatedSiteChunks() {}
+
+  public:
+    size_t getNumberOfSites() const { return numberOfSites_; }
+
+    void rewind() throw (Exception) { position_ = 0; }
+
+    /**
+     * @brief Simulate the next chunk and return it as a container.
+     *
+     * The likelihood classes only take their data as a SiteContainer,
+     * so each row of the state matrix is copied into a new Sequence object.
+     * Use nextStates() to access the simulated states without this copy.
+     *
+     * @return A new container with the next chunk, or 0 if all sites have been simulated.
+     */
+    SiteContainer* nextChunk() throw (Exception);
+
+    /**
+     * @return The size of the chunks, after rounding.
+     */
+    size_t getChunkSize() const { return chunkSize_; }
+
+    /**
+     * @brief Simulate the next chunk into the internal matrix of states.
+     *
+     * No Site or Sequence object is created.
+     *
+     * @return The number of sites in the chunk, or 0 if all sites have been simulated.
+     * The states are then available with getStates().
+     */
+    size_t nextStates() throw (Exception);
+
+    /**
+     * @return The matrix of states of the last chunk, with one row per sequence, in the order of the simulator sequence names.
+     * Rows may be longer than the chunk, only the first sites are valid.
+     */
+    const std::vector< std::vector<int> >& getStates() const { return states_; }
+
+    /**
+     * @brief Simulate all chunks and write them in the PHYLIP interleaved format.
+     *
+     * The simulation is rewound first. Each chunk is written as soon as it is simulated,
+     * so that the full alignment is never stored in memory.
+     * Sequence names are padded to a common width, with at least two spaces,
+     * so that the output can be read with the extended PHYLIP format.
+     *
+     * @param os The output stream.
+     */
+    void writePhylip(std::ostream& os) throw (Exception);
+};
+
+} //end of namespace bpp.
+
+#endif //_SIMULATEDSITECHUNKS_H_
+
@@ -0,0 +1,77 @@
+//
+// File: StateSampler.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "StateSampler.h"
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+StateSampler::StateSampler(const vector<double>& cumprobs) :
+  cumprobs_(cumprobs),
+  guide_(cumprobs.size()),
+  last_(0)
+{
+  size_t n = cumprobs_.size();
+  // Make the repartition function non-decreasing, and find the last state that can be drawn:
+  double previous = 0;
+  for (size_t y = 0; y < n; y++)
+  {
+    if (cumprobs_[y] > previous)
+    {
+      previous = cumprobs_[y];
+      last_ = y;
+    }
+    else
+    {
+      cumprobs_[y] = previous;
+    }
+  }
+  // Fill the guide table:
+  size_t y = 0;
+  for (size_t k = 0; k < n; k++)
+  {
+    double threshold = static_cast<double>(k) / static_cast<double>(n);
+    while (y < last_ && cumprobs_[y] <= threshold) y++;
+    guide_[k] = y;
+  }
+}
+
+/******************************************************************************/
@@ -0,0 +1,112 @@
+//
+// File: StateSampler.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _STATESAMPLER_H_
+#define _STATESAMPLER_H_
+
+// From the STL:
+#include <vector>
+#include <cstddef>
+
+namespace bpp
+{
+
+/**
+ * @brief Draw states from a discrete distribution in expected constant time.
+ *
+ * The sampler stores the cumulative probabilities of the states together with a
+ * guide table (Chen and Asau, 1974): entry k of the table is the first state whose
+ * cumulative probability is greater than k / n, n being the number of states.
+ * A draw starts at the entry of the table corresponding to the random number and
+ * scans forward, which takes less than two steps on average, whatever the number of states.
+ *
+ * For a given random number, the state drawn is the same as with a linear scan of
+ * the cumulative probabilities, that is, the first state with a cumulative probability
+ * greater than the random number.
+ * If no such state exists because of rounding errors, the last state with a non-null
+ * probability is returned.
+ */
+class StateSampler
+{
+  private:
+    std::vector<double> cumprobs_;
+    std::vector<size_t> guide_;
+    size_t last_;
+
+  public:
+    StateSampler() : cumprobs_(), guide_(), last_(0) {}
+
+    /**
+     * @brief Build a sampler from cumulative probabilities.
+     *
+     * Values smaller than the previous ones, such as the -1 used by mutation
+     * processes for forbidden states, denote states with a null probability.
+     *
+     * @param cumprobs The cumulative probabilities of the states. The last one should be 1.
+     */
+    explicit StateSampler(const std::vector<double>& cumprobs);
+
+  public:
+    /**
+     * @param r A random number in [0, 1).
+     * @return The corresponding state.
+     */
+    size_t draw(double r) const
+    {
+      size_t k = static_cast<size_t>(r * static_cast<double>(guide_.size()));
+      size_t y = guide_[k < guide_.size() ? k : guide_.size() - 1];
+      while (y > 0 && r < cumprobs_[y - 1]) y--;
+      while (y < last_ && r >= cumprobs_[y]) y++;
+      return y;
+    }
+
+    /**
+     * @return The cumulative probabilities of the states.
+     */
+    const std::vector<double>& getCumulativeProbabilities() const { return cumprobs_; }
+
+    /**
+     * @return The number of states.
+     */
+    size_t getNumberOfStates() const { return cumprobs_.size(); }
+};
+
+} //end of namespace bpp.
+
+#endif //_STATESAMPLER_H_
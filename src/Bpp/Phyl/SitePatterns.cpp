@@ -44,12 +44,20 @@
 #include <Bpp/Seq/SiteTools.h>
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 
+// From the STL:
+#include <algorithm>
+#include <utility>
+
 using namespace bpp;
 using namespace std;
 
 /******************************************************************************/
 
-SitePatterns::SitePatterns(const SiteContainer* sequences, bool own) :
+const size_t SitePatterns::BLOCK_SIZE = 4096;
+
+/******************************************************************************/
+
+SitePatterns::SitePatterns(const SiteContainer* sequences, bool own, size_t nbThreads) :
   names_(sequences->getSequencesNames()),
   sites_(),
   weights_(),
@@ -59,49 +67,121 @@ SitePatterns::SitePatterns(const SiteContainer* sequences, bool own) :
   own_(own)
 {
   size_t nbSites = sequences->getNumberOfSites();
-  vector<SortableSite> ss(nbSites);
+  if (nbSites == 0)
+    return;
+
+  // Find unique sites, indices_ first stores the position of each pattern in the table.
+  // Sites are processed by blocks, so that only the unique sites and one block are kept in memory:
+  indices_.resize(nbSites);
+  PatternTable table;
+#ifdef _OPENMP
+  nbThreads = max(static_cast<size_t>(1), nbThreads);
+#else
+  nbThreads = 1;
+#endif
+  size_t blockSize = min(nbSites, nbThreads * BLOCK_SIZE);
+  vector<const Site*> sites(blockSize);
+  vector<size_t> hashes(blockSize);
+  for (size_t begin = 0; begin < nbSites; begin += blockSize)
+  {
+    size_t nbBlockSites = min(blockSize, nbSites - begin);
+    // Sites are retrieved first, as getSite may not be safe to call concurrently:
+    for (size_t i = 0; i < nbBlockSites; i++)
+    {
+      sites[i] = &sequences->getSite(begin + i);
+    }
+    long nbBlockSitesL = static_cast<long>(nbBlockSites);
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(static) num_threads(static_cast<int>(nbThreads)) if(nbThreads > 1)
+#endif
+    for (long li = 0; li < nbBlockSitesL; li++)
+    {
+      size_t i = static_cast<size_t>(li);
+      hashes[i] = hashSite_(*sites[i]);
+    }
+    // Sites are then merged in order:
+    for (size_t i = 0; i < nbBlockSites; i++)
+    {
+      indices_[begin + i] = table.insert(sites[i], hashes[i]);
+    }
+  }
+
+  // Sort patterns according to site contents:
+  size_t nbPatterns = table.getNumberOfPatterns();
+  vector< pair<string, size_t> > sortedPatterns(nbPatterns);
+  for (size_t p = 0; p < nbPatterns; p++)
+  {
+    sortedPatterns[p].first = table.getPattern(p)->toString();
+    sortedPatterns[p].second = p;
+  }
+  sort(sortedPatterns.begin(), sortedPatterns.end());
+
+  // Now build patterns:
+  vector<size_t> ranks(nbPatterns);
+  sites_.resize(nbPatterns);
+  for (size_t r = 0; r < nbPatterns; r++)
+  {
+    ranks[sortedPatterns[r].second] = r;
+    sites_[r] = table.getPattern(sortedPatterns[r].second);
+  }
+  weights_.resize(nbPatterns, 0);
   for (size_t i = 0; i < nbSites; i++)
   {
-    const Site* currentSite = &sequences->getSite(i);
-    SortableSite* ssi = &ss[i];
-    ssi->siteS = currentSite->toString();
-    ssi->siteP = currentSite;
-    ssi->originalPosition = i;
+    indices_[i] = ranks[indices_[i]];
+    weights_[indices_[i]]++;
   }
+}
+
+/******************************************************************************/
 
-  if (nbSites > 0)
+size_t SitePatterns::hashSite_(const Site& site)
+{
+  const vector<int>& content = site.getContent();
+  size_t hash = content.size();
+  for (size_t i = 0; i < content.size(); i++)
   {
-    // Quick sort according to site contents:
-    sort(ss.begin(), ss.end());
+    hash ^= static_cast<size_t>(content[i]) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  }
+  return hash;
+}
+
+/******************************************************************************/
 
-    // Now build patterns:
+size_t SitePatterns::PatternTable::insert(const Site* site, size_t hash)
+{
+  size_t mask = slots_.size() - 1;
+  size_t slot = hash & mask;
+  while (slots_[slot] != 0)
+  {
+    size_t p = slots_[slot] - 1;
+    if (hashes_[p] == hash && patterns_[p]->getContent() == site->getContent())
+      return p;
+    slot = (slot + 1) & mask;
+  }
+  // New pattern:
+  patterns_.push_back(site);
+  hashes_.push_back(hash);
+  slots_[slot] = patterns_.size();
+  // Keep the load factor below 1/2:
+  if (2 * patterns_.size() > slots_.size())
+    resize_(2 * slots_.size());
+  return patterns_.size() - 1;
+}
 
-    SortableSite* ss0 = &ss[0];
-    const Site* previousSite = ss0->siteP;
-    indices_.resize(nbSites);
-    indices_[ss0->originalPosition] = 0;
-    sites_.push_back(previousSite);
-    weights_.push_back(1);
+/******************************************************************************/
 
-    unsigned int currentPos = 0;
-    for (unsigned int i = 1; i < nbSites; i++)
+void SitePatterns::PatternTable::resize_(size_t nbSlots)
+{
+  slots_.assign(nbSlots, 0);
+  size_t mask = nbSlots - 1;
+  for (size_t p = 0; p < patterns_.size(); p++)
+  {
+    size_t slot = hashes_[p] & mask;
+    while (slots_[slot] != 0)
     {
-      SortableSite* ssi = &ss[i];
-      const Site* currentSite = ssi->siteP;
-      bool siteExists = SiteTools::areSitesIdentical(*currentSite, *previousSite);
-      if (siteExists)
-      {
-        weights_[currentPos]++;
-      }
-      else
-      {
-        sites_.push_back(currentSite);
-        weights_.push_back(1);
-        currentPos++;
-      }
-      indices_[ssi->originalPosition] = currentPos;
-      previousSite = currentSite;
+      slot = (slot + 1) & mask;
     }
+    slots_[slot] = p + 1;
   }
 }
 
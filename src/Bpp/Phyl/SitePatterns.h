@@ -71,39 +71,37 @@ class SitePatterns :
 {
   private:
     /**
-     * @brief Class used for site pattern sorting.
+     * @brief Hash table used to find unique sites.
+     *
+     * Sites are compared according to their integer states, and stored in the order they were first seen.
+     * The table uses open addressing with linear probing, and grows with the number of unique sites.
      */
-    class SortableSite
+    class PatternTable
     {
-	    public:
-        std::string siteS; 
-		    const Site* siteP;
-		    size_t originalPosition;
-	    
+      private:
+        std::vector<size_t> slots_; // Index of the pattern + 1, or 0 for an empty slot.
+        std::vector<const Site*> patterns_;
+        std::vector<size_t> hashes_;
+
       public:
-		    SortableSite() : siteS(), siteP(0), originalPosition(0) {}
-        SortableSite(const SortableSite& ss) : siteS(ss.siteS), siteP(ss.siteP), originalPosition(ss.originalPosition) {}
-        SortableSite& operator=(const SortableSite& ss)
-        {
-          siteS = ss.siteS;
-          siteP = ss.siteP;
-          originalPosition = ss.originalPosition;
-          return *this;
-        }
-
-        bool operator<(const SortableSite& ss) const { return siteS < ss.siteS; }
-
-		    virtual ~SortableSite() {}
-    };
+        PatternTable() : slots_(16, 0), patterns_(), hashes_() {}
 
-    ///**
-    // * @brief Class used for site pattern sorting.
-    // */
-    //struct SSComparator :
-    //  std::binary_function<SortableSite, SortableSite, bool>
-    //{
-	  //  bool operator()(const SortableSite& ss1, const SortableSite& ss2) const { return ss1.siteS < ss2.siteS; }
-    //};
+      public:
+        /**
+         * @brief Look for a site in the table, and add it if it is not found.
+         *
+         * @param site The site to look for.
+         * @param hash The hash value of the site, as computed by SitePatterns::hashSite_.
+         * @return The index of the pattern identical to the site.
+         */
+        size_t insert(const Site* site, size_t hash);
+
+        size_t getNumberOfPatterns() const { return patterns_.size(); }
+        const Site* getPattern(size_t i) const { return patterns_[i]; }
+
+      private:
+        void resize_(size_t nbSlots);
+    };
 
   private: 
     std::vector<std::string> names_;
@@ -114,17 +112,31 @@ class SitePatterns :
     const Alphabet* alpha_;
     bool own_;
 
+  public:
+    /**
+     * @brief Number of sites per thread read at once from the container.
+     */
+    static const size_t BLOCK_SIZE;
+
   public:
    /**
      * @brief Build a new SitePattern object.
      *
      * Look for patterns (unique sites) within a site container.
      *
+     * Identical sites are found with a hash table working on the integer states of each site.
+     * The unique sites are then sorted according to their string representation,
+     * so that the order of the patterns does not depend on the order of the input sites.
+     *
      * @param sequences The container to look in.
      * @param own       Tel is the class own the sequence container.
      * If yes, the sequences wll be deleted together with this instance.
+     * @param nbThreads The number of threads to use.
+     * Sites are read by blocks of BLOCK_SIZE sites per thread. The hash values of the sites in a block
+     * are computed concurrently, then the sites are merged in the table in order.
+     * Apart from the indices of the sites, memory only grows with the number of unique sites.
      */
-    SitePatterns(const SiteContainer* sequences, bool own = false);
+    SitePatterns(const SiteContainer* sequences, bool own = false, size_t nbThreads = 1);
 
     virtual ~SitePatterns()
     {
@@ -178,6 +190,9 @@ class SitePatterns :
      * @return A new container with each unique site.
      */
 		SiteContainer* getSites() const;
+
+  private:
+    static size_t hashSite_(const Site& site);
     
 };
 
@@ -0,0 +1,129 @@
+//
+// File: Split.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Split.h"
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+bool Split::isIdenticalTo(const Split& split) const
+{
+  if (nbElements_ != split.nbElements_)
+    return false;
+  Split s1(*this), s2(split);
+  s1.canonicalize();
+  s2.canonicalize();
+  return s1.words_ == s2.words_;
+}
+
+/******************************************************************************/
+
+size_t Split::count(const uint64_t* words, size_t nbWords)
+{
+  size_t c = 0;
+  for (size_t i = 0; i < nbWords; ++i)
+  {
+#ifdef __GNUC__
+    c += static_cast<size_t>(__builtin_popcountll(words[i]));
+#else
+    for (uint64_t w = words[i]; w; w &= w - 1)
+      c++;
+#endif
+  }
+  return c;
+}
+
+/******************************************************************************/
+
+void Split::flip(uint64_t* words, size_t nbElements)
+{
+  size_t nbWords = getNumberOfWords(nbElements);
+  for (size_t i = 0; i < nbWords; ++i)
+    words[i] = ~words[i];
+  if (nbElements & 63)
+    words[nbWords - 1] &= (static_cast<uint64_t>(1) << (nbElements & 63)) - 1;
+}
+
+/******************************************************************************/
+
+size_t Split::hash(const uint64_t* words, size_t nbWords)
+{
+  // 64-bit multiplicative mixing (MurmurHash3 finalizer) of each word:
+  uint64_t h = static_cast<uint64_t>(nbWords);
+  for (size_t i = 0; i < nbWords; ++i)
+  {
+    uint64_t k = words[i];
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    h = (h ^ k) * 0x9e3779b97f4a7c15ULL;
+  }
+  h ^= h >> 32;
+  return static_cast<size_t>(h);
+}
+
+/******************************************************************************/
+
+bool Split::areCompatible(const uint64_t* words1, const uint64_t* words2, size_t nbElements)
+{
+  // A and B are compatible if one of A & B, A & ~B, ~A & B or ~A & ~B is empty:
+  bool ab = true, anb = true, nab = true, nanb = true;
+  size_t nbWords = getNumberOfWords(nbElements);
+  for (size_t i = 0; i < nbWords; ++i)
+  {
+    uint64_t mask = ~static_cast<uint64_t>(0);
+    if (i + 1 == nbWords && (nbElements & 63))
+      mask = (static_cast<uint64_t>(1) << (nbElements & 63)) - 1;
+    uint64_t a = words1[i], b = words2[i];
+    if (a & b) ab = false;
+    if (a & ~b & mask) anb = false;
+    if (~a & b & mask) nab = false;
+    if (~a & ~b & mask) nanb = false;
+    if (!(ab || anb || nab || nanb))
+      return false;
+  }
+  return true;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,213 @@
+//
+// File: Split.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _SPLIT_H_
+#define _SPLIT_H_
+
+// From the STL:
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace bpp
+{
+
+/**
+ * @brief A bipartition of a set of elements, stored as an array of 64-bit words.
+ *
+ * Bit i is set if element i belongs to the first part, unset if it belongs to the second.
+ * Unlike BipartitionList, which stores arrays of int, this class is meant to be hashed and
+ * compared in a handful of word operations: two splits with the same set of elements are
+ * identical if and only if their canonical forms (see canonicalize()) are equal word by word.
+ * In the canonical form, the part containing element 0 is the one with unset bits.
+ *
+ * The static methods work directly on raw arrays of words, so that large collections of
+ * splits can be stored contiguously (see SplitCounter).
+ *
+ * @see SplitCounter, BipartitionList
+ */
+class Split
+{
+  private:
+    std::vector<uint64_t> words_;
+    size_t nbElements_;
+
+  public:
+    /**
+     * @brief Build an empty split (all elements in the second part).
+     *
+     * @param nbElements The total number of elements.
+     */
+    Split(size_t nbElements = 0) :
+      words_(getNumberOfWords(nbElements), 0),
+      nbElements_(nbElements)
+    {}
+
+    /**
+     * @brief Build a split from an array of words.
+     *
+     * @param words An array of getNumberOfWords(nbElements) words.
+     * @param nbElements The total number of elements.
+     */
+    Split(const uint64_t* words, size_t nbElements) :
+      words_(words, words + getNumberOfWords(nbElements)),
+      nbElements_(nbElements)
+    {}
+
+    virtual ~Split() {}
+
+  public:
+    size_t getNumberOfElements() const { return nbElements_; }
+
+    size_t getNumberOfWords() const { return words_.size(); }
+
+    const uint64_t* getWords() const { return words_.empty() ? 0 : &words_[0]; }
+
+    void set(size_t i) { words_[i >> 6] |= static_cast<uint64_t>(1) << (i & 63); }
+
+    void reset(size_t i) { words_[i >> 6] &= ~(static_cast<uint64_t>(1) << (i & 63)); }
+
+    bool test(size_t i) const { return (words_[i >> 6] >> (i & 63)) & 1; }
+
+    /**
+     * @brief Swap the two parts.
+     */
+    void flip() { flip(&words_[0], nbElements_); }
+
+    /**
+     * @brief Put the split in canonical form, that is, with element 0 in the second part.
+     */
+    void canonicalize() { if (!words_.empty()) canonicalize(&words_[0], nbElements_); }
+
+    /**
+     * @return The number of elements in the first part.
+     */
+    size_t count() const { return count(getWords(), words_.size()); }
+
+    /**
+     * @return The size of the smallest part (e.g. 1 for external branches).
+     */
+    size_t getPartitionSize() const
+    {
+      size_t c = count();
+      return c < nbElements_ - c ? c : nbElements_ - c;
+    }
+
+    /**
+     * @return True if the split corresponds to an external branch, or has an empty part.
+     */
+    bool isTrivial() const { return getPartitionSize() <= 1; }
+
+    /**
+     * @return A hash value of the split, independent of its orientation.
+     */
+    size_t getHash() const
+    {
+      Split tmp(*this);
+      tmp.canonicalize();
+      return hash(tmp.getWords(), tmp.words_.size());
+    }
+
+    /**
+     * @brief Tells whether two splits can belong to the same tree.
+     *
+     * See BipartitionList::areCompatible for a definition.
+     */
+    bool isCompatibleWith(const Split& split) const
+    {
+      return nbElements_ == split.nbElements_ && areCompatible(getWords(), split.getWords(), nbElements_);
+    }
+
+    /**
+     * @brief Tells whether two splits define the same bipartition, whatever their orientation.
+     */
+    bool isIdenticalTo(const Split& split) const;
+
+    /**
+     * @brief Word-wise comparisons, orientation matters.
+     *
+     * @{
+     */
+    bool operator==(const Split& split) const { return nbElements_ == split.nbElements_ && words_ == split.words_; }
+    bool operator!=(const Split& split) const { return !(*this == split); }
+    bool operator<(const Split& split) const { return nbElements_ < split.nbElements_ || (nbElements_ == split.nbElements_ && words_ < split.words_); }
+    /** @} */
+
+  public:
+    /**
+     * @name Operations on raw arrays of words.
+     *
+     * @{
+     */
+
+    /**
+     * @return The number of words needed to store a split of nbElements elements.
+     */
+    static size_t getNumberOfWords(size_t nbElements) { return (nbElements + 63) / 64; }
+
+    /**
+     * @return The number of set bits in the array.
+     */
+    static size_t count(const uint64_t* words, size_t nbWords);
+
+    /**
+     * @brief Complement the array, leaving the bits after the last element unset.
+     */
+    static void flip(uint64_t* words, size_t nbElements);
+
+    /**
+     * @brief Complement the array if the bit of element 0 is set.
+     */
+    static void canonicalize(uint64_t* words, size_t nbElements)
+    {
+      if (words[0] & 1)
+        flip(words, nbElements);
+    }
+
+    static size_t hash(const uint64_t* words, size_t nbWords);
+
+    static bool areCompatible(const uint64_t* words1, const uint64_t* words2, size_t nbElements);
+
+    /** @} */
+};
+
+} //end of namespace bpp.
+
+#endif //_SPLIT_H_
+
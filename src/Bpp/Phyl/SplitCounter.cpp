@@ -0,0 +1,381 @@
+//
+// File: SplitCounter.cpp
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "SplitCounter.h"
+#include "BipartitionTools.h"
+#include "TreeTemplate.h"
+
+#include <Bpp/Text/TextTools.h>
+
+// From the STL:
+#include <algorithm>
+#include <memory>
+#include <climits> // defines CHAR_BIT
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+SplitCounter::SplitCounter() :
+  elements_(),
+  index_(),
+  nbWords_(0),
+  nbTrees_(0),
+  splits_(),
+  counts_(),
+  hashes_(),
+  lastTree_(),
+  table_(),
+  clades_()
+{}
+
+SplitCounter::SplitCounter(const vector<string>& elements) throw (Exception) :
+  elements_(),
+  index_(),
+  nbWords_(0),
+  nbTrees_(0),
+  splits_(),
+  counts_(),
+  hashes_(),
+  lastTree_(),
+  table_(),
+  clades_()
+{
+  setElements_(elements);
+}
+
+/******************************************************************************/
+
+void SplitCounter::setElements_(const vector<string>& elements) throw (Exception)
+{
+  if (elements.empty())
+    throw Exception("SplitCounter. Empty set of elements.");
+  index_.clear();
+  for (size_t i = 0; i < elements.size(); ++i)
+  {
+    if (!index_.insert(make_pair(elements[i], i)).second)
+      throw Exception("SplitCounter. Duplicated element: " + elements[i]);
+  }
+  elements_ = elements;
+  nbWords_ = Split::getNumberOfWords(elements.size());
+}
+
+/******************************************************************************/
+
+void SplitCounter::getClades_(const Node* root, vector<uint64_t>& clades, vector<const Node*>& nodes) const throw (Exception)
+{
+  nodes.clear();
+  clades.clear();
+  // Iterative post-order traversal. The clades of completed sons are kept on a stack,
+  // as indices in the clades array, until their father is completed:
+  vector< pair<const Node*, size_t> > stack(1, pair<const Node*, size_t>(root, 0));
+  vector<size_t> done;
+  size_t nbLeaves = 0;
+  while (!stack.empty())
+  {
+    const Node* node = stack.back().first;
+    size_t nbSons = stack.back().second;
+    if (nbSons < node->getNumberOfSons())
+    {
+      stack.back().second++;
+      stack.push_back(pair<const Node*, size_t>(node->getSon(nbSons), 0));
+      continue;
+    }
+    stack.pop_back();
+    size_t k = nodes.size();
+    nodes.push_back(node);
+    clades.resize(clades.size() + nbWords_, 0);
+    uint64_t* clade = &clades[k * nbWords_];
+    if (nbSons == 0)
+    {
+      map<string, size_t>::const_iterator it = index_.end();
+      if (node->hasName())
+        it = index_.find(node->getName());
+      if (it == index_.end())
+        throw Exception("SplitCounter. Leaf " + (node->hasName() ? node->getName() : TextTools::toString(node->getId())) + " is not in the set of elements.");
+      clade[it->second >> 6] |= static_cast<uint64_t>(1) << (it->second & 63);
+      nbLeaves++;
+    }
+    else
+    {
+      for (size_t i = done.size() - nbSons; i < done.size(); ++i)
+      {
+        const uint64_t* son = &clades[done[i] * nbWords_];
+        for (size_t j = 0; j < nbWords_; ++j)
+          clade[j] |= son[j];
+      }
+      done.resize(done.size() - nbSons);
+    }
+    done.push_back(k);
+  }
+  if (nbLeaves != elements_.size() || Split::count(&clades[(nodes.size() - 1) * nbWords_], nbWords_) != elements_.size())
+    throw Exception("SplitCounter. The tree does not have the same leaves as the counter.");
+}
+
+/******************************************************************************/
+
+void SplitCounter::addTree(const Tree& tree, vector<size_t>* indices) throw (Exception)
+{
+  if (elements_.empty())
+  {
+    vector<string> names = tree.getLeavesNames();
+    sort(names.begin(), names.end());
+    setElements_(names);
+  }
+  const TreeTemplate<Node>* ttree = dynamic_cast<const TreeTemplate<Node>*>(&tree);
+  auto_ptr< TreeTemplate<Node> > tmp;
+  if (!ttree)
+  {
+    tmp.reset(new TreeTemplate<Node>(tree));
+    ttree = tmp.get();
+  }
+  vector<const Node*> nodes;
+  getClades_(ttree->getRootNode(), clades_, nodes);
+  if (indices)
+    indices->clear();
+  for (size_t i = 0; i + 1 < nodes.size(); ++i)
+    count_(&clades_[i * nbWords_], indices);
+  if (indices)
+    sort(indices->begin(), indices->end());
+  nbTrees_++;
+}
+
+/******************************************************************************/
+
+void SplitCounter::addTree(const CompactTree& tree, vector<size_t>* indices) throw (Exception)
+{
+  if (elements_.empty())
+    throw Exception("SplitCounter::addTree. Leaf names must be set to count compact trees.");
+  size_t nbNodes = tree.getNumberOfNodes();
+  if (nbNodes == 0)
+    throw Exception("SplitCounter::addTree. Empty tree.");
+  clades_.assign(nbNodes * nbWords_, 0);
+  for (size_t i = 0; i < nbNodes; ++i)
+  {
+    uint64_t* clade = &clades_[i * nbWords_];
+    if (tree.isLeaf(i))
+    {
+      size_t leaf = static_cast<size_t>(tree.getLeafIndex(i));
+      if (leaf >= elements_.size())
+        throw IndexOutOfBoundsException("SplitCounter::addTree. Bad leaf index.", leaf, 0, elements_.size());
+      clade[leaf >> 6] |= static_cast<uint64_t>(1) << (leaf & 63);
+    }
+    if (i + 1 < nbNodes)
+    {
+      if (tree.getFather(i) < 0)
+        throw Exception("SplitCounter::addTree. Node " + TextTools::toString(i) + " has no father.");
+      uint64_t* father = &clades_[static_cast<size_t>(tree.getFather(i)) * nbWords_];
+      for (size_t j = 0; j < nbWords_; ++j)
+        father[j] |= clade[j];
+    }
+  }
+  if (tree.getNumberOfLeaves() != elements_.size() || Split::count(&clades_[(nbNodes - 1) * nbWords_], nbWords_) != elements_.size())
+    throw Exception("SplitCounter::addTree. The tree does not have the same leaves as the counter.");
+  if (indices)
+    indices->clear();
+  for (size_t i = 0; i + 1 < nbNodes; ++i)
+    count_(&clades_[i * nbWords_], indices);
+  if (indices)
+    sort(indices->begin(), indices->end());
+  nbTrees_++;
+}
+
+/******************************************************************************/
+
+void SplitCounter::count_(uint64_t* split, vector<size_t>* indices)
+{
+  size_t n = elements_.size();
+  Split::canonicalize(split, n);
+  size_t c = Split::count(split, nbWords_);
+  if (c <= 1 || c + 1 >= n)
+    return; // External branch.
+  size_t h = Split::hash(split, nbWords_);
+  size_t k = find_(split, h);
+  if (k < counts_.size())
+  {
+    // The two branches of a bifurcating root define the same split:
+    if (lastTree_[k] != nbTrees_)
+    {
+      counts_[k]++;
+      lastTree_[k] = nbTrees_;
+      if (indices)
+        indices->push_back(k);
+    }
+    return;
+  }
+  if (2 * (counts_.size() + 1) > table_.size())
+    rehash_();
+  splits_.insert(splits_.end(), split, split + nbWords_);
+  counts_.push_back(1);
+  hashes_.push_back(h);
+  lastTree_.push_back(nbTrees_);
+  size_t mask = table_.size() - 1;
+  size_t pos = h & mask;
+  while (table_[pos])
+    pos = (pos + 1) & mask;
+  table_[pos] = counts_.size();
+  if (indices)
+    indices->push_back(counts_.size() - 1);
+}
+
+/******************************************************************************/
+
+size_t SplitCounter::find_(const uint64_t* words, size_t hash) const
+{
+  if (table_.empty())
+    return counts_.size();
+  size_t mask = table_.size() - 1;
+  for (size_t pos = hash & mask; table_[pos]; pos = (pos + 1) & mask)
+  {
+    size_t k = table_[pos] - 1;
+    if (hashes_[k] == hash && equal(words, words + nbWords_, splits_.begin() + static_cast<ptrdiff_t>(k * nbWords_)))
+      return k;
+  }
+  return counts_.size();
+}
+
+/******************************************************************************/
+
+void SplitCounter::rehash_()
+{
+  table_.assign(table_.empty() ? 64 : 2 * table_.size(), 0);
+  size_t mask = table_.size() - 1;
+  for (size_t k = 0; k < hashes_.size(); ++k)
+  {
+    size_t pos = hashes_[k] & mask;
+    while (table_[pos])
+      pos = (pos + 1) & mask;
+    table_[pos] = k + 1;
+  }
+}
+
+/******************************************************************************/
+
+Split SplitCounter::getSplit(size_t i) const throw (IndexOutOfBoundsException)
+{
+  if (i >= counts_.size())
+    throw IndexOutOfBoundsException("SplitCounter::getSplit.", i, 0, counts_.size());
+  return Split(&splits_[i * nbWords_], elements_.size());
+}
+
+/******************************************************************************/
+
+size_t SplitCounter::getCount(const Split& split) const throw (Exception)
+{
+  size_t n = elements_.size();
+  if (split.getNumberOfElements() != n)
+    throw Exception("SplitCounter::getCount. The split does not have the same number of elements as the counter.");
+  Split tmp(split);
+  tmp.canonicalize();
+  size_t c = tmp.count();
+  if (c == 0)
+    return 0;
+  if (c == 1 || c + 1 == n)
+    return nbTrees_;
+  size_t k = find_(tmp.getWords(), Split::hash(tmp.getWords(), nbWords_));
+  return k < counts_.size() ? counts_[k] : 0;
+}
+
+/******************************************************************************/
+
+void SplitCounter::getSplits(const Tree& tree, vector<Split>& splits, vector<int>* nodeIds) const throw (Exception)
+{
+  if (elements_.empty())
+    throw Exception("SplitCounter::getSplits. No element set.");
+  const TreeTemplate<Node>* ttree = dynamic_cast<const TreeTemplate<Node>*>(&tree);
+  auto_ptr< TreeTemplate<Node> > tmp;
+  if (!ttree)
+  {
+    tmp.reset(new TreeTemplate<Node>(tree));
+    ttree = tmp.get();
+  }
+  vector<uint64_t> clades;
+  vector<const Node*> nodes;
+  getClades_(ttree->getRootNode(), clades, nodes);
+  splits.clear();
+  if (nodeIds)
+    nodeIds->clear();
+  const Node* root = ttree->getRootNode();
+  for (size_t i = 0; i + 1 < nodes.size(); ++i)
+  {
+    if (root->getNumberOfSons() == 2 && nodes[i] == root->getSon(1))
+      continue;
+    splits.push_back(Split(&clades[i * nbWords_], elements_.size()));
+    if (nodeIds)
+      nodeIds->push_back(nodes[i]->getId());
+  }
+}
+
+/******************************************************************************/
+
+BipartitionList* SplitCounter::toBipartitionList(const vector<size_t>& indices) const
+{
+  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
+  size_t nbword = (elements_.size() + lword - 1) / lword;
+  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
+
+  vector<int*> bitBipL;
+  for (size_t i = 0; i < indices.size() + elements_.size(); ++i)
+  {
+    int* bip = new int[nbint];
+    for (size_t j = 0; j < nbint; ++j)
+      bip[j] = 0;
+    if (i < indices.size())
+    {
+      Split split = getSplit(indices[i]);
+      for (size_t j = 0; j < elements_.size(); ++j)
+        if (split.test(j))
+          BipartitionTools::bit1(bip, static_cast<int>(j));
+    }
+    else
+    {
+      // External branch:
+      BipartitionTools::bit1(bip, static_cast<int>(i - indices.size()));
+    }
+    bitBipL.push_back(bip);
+  }
+  BipartitionList* bipL = new BipartitionList(elements_, bitBipL);
+  for (size_t i = 0; i < bitBipL.size(); ++i)
+    delete[] bitBipL[i];
+  return bipL;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,231 @@
+//
+// File: SplitCounter.h
+// Created by: Bio++ Development Team
+// Created on: Sun Oct 18 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _SPLITCOUNTER_H_
+#define _SPLITCOUNTER_H_
+
+#include "Split.h"
+#include "Tree.h"
+#include "CompactTree.h"
+#include "BipartitionList.h"
+
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+
+class Node;
+
+/**
+ * @brief Count the occurrences of splits (bipartitions) in a set of trees.
+ *
+ * Trees are added one at a time and are not kept, so that very large samples (e.g. bootstrap
+ * or posterior samples) can be processed in a single pass, as they are read. Distinct splits
+ * are stored in canonical form (see Split) in a single array, and indexed by an open-addressing
+ * hash table: adding a tree takes a time linear in its number of branches, and the memory used
+ * is proportional to the number of distinct splits.
+ *
+ * Only internal branches are counted: external branches are found in every tree.
+ * All trees must share the same set of leaves, which is checked.
+ * Trees are considered unrooted, and each split is counted at most once per tree.
+ *
+ * Compact trees, as read by NewickBatchReader, can be counted without creating any Node object:
+ * @code
+ * NewickBatchReader reader;
+ * vector<CompactTree> trees;
+ * size_t n = reader.read(input, trees);
+ * SplitCounter counter(reader.getLeavesNames());
+ * for (; n > 0; n = reader.read(input, trees))
+ *   for (size_t i = 0; i < n; ++i)
+ *     counter.addTree(trees[i]);
+ * TreeTemplate<Node>* consensus = TreeTools::thresholdConsensus(counter, 0.5);
+ * @endcode
+ *
+ * @see TreeTools::thresholdConsensus, TreeTools::computeBootstrapValues
+ */
+class SplitCounter
+{
+  private:
+    std::vector<std::string> elements_;
+    std::map<std::string, size_t> index_;
+    size_t nbWords_;
+    size_t nbTrees_;
+    // Distinct splits, in order of first occurrence, nbWords_ words each:
+    std::vector<uint64_t> splits_;
+    std::vector<size_t> counts_;
+    std::vector<size_t> hashes_;
+    std::vector<size_t> lastTree_;
+    // Hash table of split indices + 1, 0 for empty slots:
+    std::vector<size_t> table_;
+    // Working space for the clade of each node:
+    std::vector<uint64_t> clades_;
+
+  public:
+    /**
+     * @brief Build an empty counter, elements are the leaves of the first tree, in alphabetic order.
+     */
+    SplitCounter();
+
+    /**
+     * @brief Build an empty counter for a given set of elements.
+     *
+     * @param elements Leaf names. The index of a leaf in this vector is the one used by CompactTree objects.
+     * @throw Exception If a name is duplicated.
+     */
+    SplitCounter(const std::vector<std::string>& elements) throw (Exception);
+
+    virtual ~SplitCounter() {}
+
+  public:
+    /**
+     * @brief Count the splits of a tree.
+     *
+     * @param tree The tree to count.
+     * @param indices [out] If not null, the sorted indices of the distinct internal splits of the tree.
+     * Two trees have the same topology if and only if they have the same indices, and their
+     * Robinson-Foulds distance is the number of indices found in only one of them.
+     * @throw Exception If the tree does not have the same leaves as the counter.
+     */
+    void addTree(const Tree& tree, std::vector<size_t>* indices = 0) throw (Exception);
+
+    /**
+     * @brief Count the splits of a compact tree, whose leaf indices refer to getElementNames().
+     *
+     * @param tree The tree to count.
+     * @param indices [out] If not null, the sorted indices of the distinct internal splits of the tree.
+     * @throw Exception If the tree does not have the same leaves as the counter.
+     */
+    void addTree(const CompactTree& tree, std::vector<size_t>* indices = 0) throw (Exception);
+
+    void addTrees(const std::vector<Tree*>& trees) throw (Exception)
+    {
+      for (size_t i = 0; i < trees.size(); ++i)
+        addTree(*trees[i]);
+    }
+
+    const std::vector<std::string>& getElementNames() const { return elements_; }
+
+    size_t getNumberOfElements() const { return elements_.size(); }
+
+    size_t getNumberOfTrees() const { return nbTrees_; }
+
+    /**
+     * @return The number of distinct internal splits found.
+     */
+    size_t getNumberOfSplits() const { return counts_.size(); }
+
+    /**
+     * @return The ith distinct split, in canonical form. Splits are indexed in the order they were first found.
+     */
+    Split getSplit(size_t i) const throw (IndexOutOfBoundsException);
+
+    /**
+     * @return The number of trees the ith distinct split was found in.
+     */
+    size_t getCount(size_t i) const throw (IndexOutOfBoundsException)
+    {
+      if (i >= counts_.size())
+        throw IndexOutOfBoundsException("SplitCounter::getCount.", i, 0, counts_.size());
+      return counts_[i];
+    }
+
+    /**
+     * @return The number of trees a split was found in, whatever its orientation.
+     * External branches are found in all trees.
+     * @throw Exception If the split does not have the same number of elements as the counter.
+     */
+    size_t getCount(const Split& split) const throw (Exception);
+
+    /**
+     * @brief Get the splits defined by the branches of a tree, with the elements of the counter.
+     *
+     * As for BipartitionList, the two branches of a bifurcating root define a single split,
+     * which is associated to the first son.
+     *
+     * @param tree The tree to encode.
+     * @param splits [out] The splits of all branches, external ones included.
+     * @param nodeIds [out] If not null, the id of the node below each branch.
+     * @throw Exception If the tree does not have the same leaves as the counter.
+     */
+    void getSplits(const Tree& tree, std::vector<Split>& splits, std::vector<int>* nodeIds = 0) const throw (Exception);
+
+    /**
+     * @brief Convert a subset of the distinct splits into a BipartitionList.
+     *
+     * External branches are added after the selected splits.
+     *
+     * @param indices The indices of the splits to convert.
+     */
+    BipartitionList* toBipartitionList(const std::vector<size_t>& indices) const;
+
+  private:
+    void setElements_(const std::vector<std::string>& elements) throw (Exception);
+
+    /**
+     * @brief Compute the clade of each node of a subtree, in post-order.
+     *
+     * @param root The root of the subtree.
+     * @param clades [out] The clades, as arrays of Split::getNumberOfWords(getNumberOfElements()) words.
+     * @param nodes [out] The nodes, in post-order.
+     * @throw Exception If the leaves of the subtree are not the elements of the counter.
+     */
+    void getClades_(const Node* root, std::vector<uint64_t>& clades, std::vector<const Node*>& nodes) const throw (Exception);
+
+    /**
+     * @brief Count a split, which is put in canonical form in place.
+     *
+     * @param split The split to count.
+     * @param indices If not null, where to append the index of the split, if counted.
+     */
+    void count_(uint64_t* split, std::vector<size_t>* indices);
+
+    size_t find_(const uint64_t* words, size_t hash) const;
+
+    void rehash_();
+};
+
+} //end of namespace bpp.
+
+#endif //_SPLITCOUNTER_H_
+
@@ -41,6 +41,7 @@
 
 #include "TreeTemplateTools.h"
 #include "TreeTemplate.h"
+#include "Io/NewickParser.h"
 
 #include <Bpp/Numeric/Number.h>
 #include <Bpp/BppString.h>
@@ -253,103 +254,19 @@ TreeTemplateTools::Element TreeTemplateTools::getElement(const string& elt) thro
 
 Node* TreeTemplateTools::parenthesisToNode(const string& description, unsigned int& nodeCounter, bool bootstrap, const string& propertyName, bool withId, bool verbose)
 {
-  // cout << "NODE: " << description << endl;
-  Element elt = getElement(description);
-
-  // New node:
-  Node* node = new Node();
-  if (!TextTools::isEmpty(elt.length))
-  {
-    node->setDistanceToFather(TextTools::toDouble(elt.length));
-    // cout << "NODE: LENGTH: " << * elt.length << endl;
-  }
-  if (!TextTools::isEmpty(elt.bootstrap))
-  {
-    if (withId)
-    {
-      node->setId(TextTools::toInt(elt.bootstrap));
-    }
-    else
-    {
-      if (bootstrap)
-      {
-        node->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(TextTools::toDouble(elt.bootstrap)));
-        // cout << "NODE: BOOTSTRAP: " << * elt.bootstrap << endl;
-      }
-      else
-      {
-        node->setBranchProperty(propertyName, BppString(elt.bootstrap));
-      }
-    }
-  }
-
-  NestedStringTokenizer nt(elt.content, "(", ")", ",");
-  vector<string> elements;
-  while (nt.hasMoreToken())
-  {
-    elements.push_back(nt.nextToken());
-  }
-
-  if (elt.isLeaf)
-  {
-    // This is a leaf:
-    string name = TextTools::removeSurroundingWhiteSpaces(elements[0]);
-    if (withId)
-    {
-      StringTokenizer st(name, "_", true, true);
-      ostringstream realName;
-      for (size_t i = 0; i < st.numberOfRemainingTokens() - 1; ++i)
-      {
-        if (i != 0)
-        {
-          realName << "_";
-        }
-        realName << st.getToken(i);
-      }
-      node->setName(realName.str());
-      node->setId(TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1)));
-    }
-    else
-    {
-      node->setName(name);
-    }
-  }
-  else
-  {
-    // This is a node:
-    for (size_t i = 0; i < elements.size(); i++)
-    {
-      // cout << "NODE: SUBNODE: " << i << ", " << elements[i] << endl;
-      Node* son = parenthesisToNode(elements[i], nodeCounter, bootstrap, propertyName, withId, verbose);
-      node->addSon(son);
-    }
-  }
-  nodeCounter++;
-  if (verbose)
-    ApplicationTools::displayUnlimitedGauge(nodeCounter);
-  return node;
+  NewickParser parser(false, bootstrap, propertyName, withId, verbose);
+  return parser.parseNode(description, nodeCounter);
 }
 
 /******************************************************************************/
 
 TreeTemplate<Node>* TreeTemplateTools::parenthesisToTree(const string& description, bool bootstrap, const string& propertyName, bool withId, bool verbose) throw (Exception)
 {
-  string::size_type semi = description.rfind(';');
-  if (semi == string::npos)
+  NewickParser parser(false, bootstrap, propertyName, withId, verbose);
+  const char* pos = description.data();
+  TreeTemplate<Node>* tree = parser.parse(pos, description.data() + description.size());
+  if (!tree)
     throw Exception("TreeTemplateTools::parenthesisToTree(). Bad format: no semi-colon found.");
-  string content = description.substr(0, semi);
-  unsigned int nodeCounter = 0;
-  Node* node = parenthesisToNode(content, nodeCounter, bootstrap, propertyName, withId, verbose);
-  TreeTemplate<Node>* tree = new TreeTemplate<Node>();
-  tree->setRootNode(node);
-  if (!withId)
-  {
-    tree->resetNodesId();
-  }
-  if (verbose) {
-    (*ApplicationTools::message) << " nodes loaded.";
-    ApplicationTools::message->endLine();
-  }
   return tree;
 }
 
@@ -769,17 +769,25 @@ public:
   }
 
   /**
-   * @brief Recursively delete a subtree structure.
+   * @brief Delete a subtree structure.
+   *
+   * The basal node itself is not deleted. Nodes are deleted without recursion,
+   * so that very deep trees can be deleted too.
    *
    * @param node The basal node of the subtree.
    */
   template<class N>
   static void deleteSubtree(N* node)
   {
+    std::vector<N*> nodes;
     for (size_t i = 0; i < node->getNumberOfSons(); ++i)
+      nodes.push_back(node->getSon(i));
+    while (!nodes.empty())
     {
-      N* son = node->getSon(i);
-      deleteSubtree(son);
+      N* son = nodes.back();
+      nodes.pop_back();
+      for (size_t i = 0; i < son->getNumberOfSons(); ++i)
+        nodes.push_back(son->getSon(i));
       delete son;
     }
   }
@@ -955,6 +963,8 @@ public:
    * @brief Parse a string in the parenthesis format and convert it to
    * a subtree.
    *
+   * The description is parsed in a single pass by a NewickParser.
+   *
    * @param description the string to parse;
    * @param nodeCounter [Output] Count all created nodes.
    * @param bootstrap Tell is real bootstrap values are expected. If so, a property with name TreeTools::BOOTSTRAP will be created and stored at the corresponding node.
@@ -970,6 +980,9 @@ public:
    * @brief Parse a string in the parenthesis format and convert it to
    * a tree.
    *
+   * The description is parsed in a single pass by a NewickParser.
+   * To read trees from a stream or from a memory buffer without copying them first, use NewickParser directly.
+   *
    * @param description the string to parse;
    * @param bootstrap Tells if real bootstrap values are expected. If so, a property with name TreeTools::BOOTSTRAP will be created and stored at the corresponding node.
    * The property value will be of type Number<double>. Otherwise, an object of type String will be created and stored with the property name propertyName.
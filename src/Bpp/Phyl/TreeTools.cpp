@@ -62,9 +62,15 @@
 using namespace bpp;
 
 // From the STL:
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <sstream>
 
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
 using namespace std;
 
 /******************************************************************************/
@@ -889,62 +895,44 @@ bool TreeTools::haveSameTopology(const Tree& tr1, const Tree& tr2)
 
 /******************************************************************************/
 
-int TreeTools::robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool checkNames, int* missing_in_tr2, int* missing_in_tr1) throw (Exception)
+namespace
 {
-  BipartitionList* bipL1, * bipL2;
-  size_t i, j;
-  vector<size_t> size1, size2;
-  vector<bool> bipOK2;
-
-
-  if (checkNames && !VectorTools::haveSameElements(tr1.getLeavesNames(), tr2.getLeavesNames()))
-    throw Exception("Distinct leaf sets between trees ");
-
-  /* prepare things */
-  int missing1 = 0;
-  int missing2 = 0;
-
-  bipL1 = new BipartitionList(tr1, true);
-  bipL1->removeTrivialBipartitions();
-  bipL1->sortByPartitionSize();
-  bipL2 = new BipartitionList(tr2, true);
-  bipL2->removeTrivialBipartitions();
-  bipL2->sortByPartitionSize();
-
-
-  for (i = 0; i < bipL1->getNumberOfBipartitions(); i++)
-  {
-    size1.push_back(bipL1->getPartitionSize(i));
-  }
-  for (i = 0; i < bipL2->getNumberOfBipartitions(); i++)
-  {
-    size2.push_back(bipL2->getPartitionSize(i));
-  }
-
-  for (i = 0; i < bipL2->getNumberOfBipartitions(); i++)
+  // Number of common elements in two sorted vectors:
+  size_t numberOfCommonElements(const vector<size_t>& v1, const vector<size_t>& v2)
   {
-    bipOK2.push_back(false);
-  }
-
-  /* main loops */
-
-  for (i = 0; i < bipL1->getNumberOfBipartitions(); i++)
-  {
-    for (j = 0; j < bipL2->getNumberOfBipartitions(); j++)
+    size_t n = 0;
+    vector<size_t>::const_iterator it1 = v1.begin(), it2 = v2.begin();
+    while (it1 != v1.end() && it2 != v2.end())
     {
-      if (bipOK2[j])
-        continue;
-      if (size1[i] == size2[j] && BipartitionTools::areIdentical(*bipL1, i, *bipL2, j))
+      if (*it1 < *it2)
+        ++it1;
+      else if (*it2 < *it1)
+        ++it2;
+      else
       {
-        bipOK2[j] = true;
-        break;
+        ++n;
+        ++it1;
+        ++it2;
       }
     }
-    if (j == bipL2->getNumberOfBipartitions())
-      missing2++;
+    return n;
   }
+}
+
+int TreeTools::robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool checkNames, int* missing_in_tr2, int* missing_in_tr1) throw (Exception)
+{
+  if (checkNames && !VectorTools::haveSameElements(tr1.getLeavesNames(), tr2.getLeavesNames()))
+    throw Exception("Distinct leaf sets between trees ");
+
+  /* hash the bipartitions of both trees */
+  SplitCounter counter;
+  vector<size_t> splits1, splits2;
+  counter.addTree(tr1, &splits1);
+  counter.addTree(tr2, &splits2);
 
-  missing1 = static_cast<int>(bipL2->getNumberOfBipartitions()) - static_cast<int>(bipL1->getNumberOfBipartitions()) + missing2;
+  size_t common = numberOfCommonElements(splits1, splits2);
+  int missing2 = static_cast<int>(splits1.size() - common);
+  int missing1 = static_cast<int>(splits2.size() - common);
 
   if (missing_in_tr1)
     *missing_in_tr1 = missing1;
@@ -955,76 +943,73 @@ int TreeTools::robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool che
 
 /******************************************************************************/
 
-BipartitionList* TreeTools::bipartitionOccurrences(const vector<Tree*>& vecTr, vector<size_t>& bipScore)
+DistanceMatrix* TreeTools::robinsonFouldsDistances(const vector<Tree*>& vecTr, size_t nbThreads) throw (Exception)
 {
-  vector<BipartitionList*> vecBipL;
-  BipartitionList* mergedBipL;
-  vector<size_t> bipSize;
-  size_t nbBip;
+  if (vecTr.size() == 0)
+    throw Exception("TreeTools::robinsonFouldsDistances. Empty vector passed");
 
-  /*  build and merge bipartitions */
-  for (size_t i = 0; i < vecTr.size(); i++)
-  {
-    vecBipL.push_back(new BipartitionList(*vecTr[i]));
-  }
-  mergedBipL = BipartitionTools::mergeBipartitionLists(vecBipL);
+  /* hash the bipartitions of all trees, once */
+  SplitCounter counter;
+  vector< vector<size_t> > splits(vecTr.size());
+  vector<string> names(vecTr.size());
   for (size_t i = 0; i < vecTr.size(); i++)
   {
-    delete vecBipL[i];
+    counter.addTree(*vecTr[i], &splits[i]);
+    names[i] = TextTools::toString(i + 1);
   }
 
-  mergedBipL->removeTrivialBipartitions();
-  nbBip = mergedBipL->getNumberOfBipartitions();
-  bipScore.clear();
-  for (size_t i = 0; i < nbBip; i++)
-  {
-    bipSize.push_back(mergedBipL->getPartitionSize(i));
-    bipScore.push_back(1);
-  }
+#ifdef _OPENMP
+  if (nbThreads == 0)
+    nbThreads = static_cast<size_t>(omp_get_num_procs());
+#else
+  nbThreads = 1;
+#endif
 
-  /* compare bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
+  /* compare all pairs, one row per thread */
+  DistanceMatrix* mat = new DistanceMatrix(names);
+  long n = static_cast<long>(vecTr.size());
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nbThreads))
+#endif
+  for (long li = 0; li < n; li++)
   {
-    if (bipScore[i - 1] == 0)
-      continue;
-    for (size_t j = i - 1; j > 0; j--)
+    size_t i = static_cast<size_t>(li);
+    (*mat)(i, i) = 0;
+    for (size_t j = 0; j < i; j++)
     {
-      if (bipScore[j - 1] && bipSize[i - 1] == bipSize[j - 1] && mergedBipL->areIdentical(i - 1, j - 1))
-      {
-        bipScore[i - 1]++;
-        bipScore[j - 1] = 0;
-      }
+      size_t common = numberOfCommonElements(splits[i], splits[j]);
+      (*mat)(i, j) = (*mat)(j, i) = static_cast<double>(splits[i].size() + splits[j].size() - 2 * common);
     }
   }
+  return mat;
+}
+
+/******************************************************************************/
+
+BipartitionList* TreeTools::bipartitionOccurrences(const vector<Tree*>& vecTr, vector<size_t>& bipScore)
+{
+  SplitCounter counter;
+  counter.addTrees(vecTr);
 
-  /* keep only distinct bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
+  vector<size_t> indices(counter.getNumberOfSplits());
+  bipScore.resize(indices.size());
+  for (size_t i = 0; i < indices.size(); i++)
   {
-    if (bipScore[i - 1] == 0)
-    {
-      bipScore.erase(bipScore.begin() + static_cast<ptrdiff_t>(i - 1));
-      mergedBipL->deleteBipartition(i - 1);
-    }
+    indices[i] = i;
+    bipScore[i] = counter.getCount(i);
   }
 
   /* add terminal branches */
-  mergedBipL->addTrivialBipartitions(false);
-  for (size_t i = 0; i < mergedBipL->getNumberOfElements(); i++)
-  {
-    bipScore.push_back(vecTr.size());
-  }
+  bipScore.resize(indices.size() + counter.getNumberOfElements(), vecTr.size());
 
-  return mergedBipL;
+  return counter.toBipartitionList(indices);
 }
 
 /******************************************************************************/
 
 TreeTemplate<Node>* TreeTools::thresholdConsensus(const vector<Tree*>& vecTr, double threshold, bool checkNames) throw (Exception)
 {
-  vector<size_t> bipScore;
   vector<string> tr0leaves;
-  BipartitionList* bipL;
-  double score;
 
   if (vecTr.size() == 0)
     throw Exception("TreeTools::thresholdConsensus. Empty vector passed");
@@ -1040,33 +1025,64 @@ TreeTemplate<Node>* TreeTools::thresholdConsensus(const vector<Tree*>& vecTr, do
     }
   }
 
-  bipL = bipartitionOccurrences(vecTr, bipScore);
+  SplitCounter counter;
+  counter.addTrees(vecTr);
+  return thresholdConsensus(counter, threshold);
+}
+
+/******************************************************************************/
 
-  for (size_t i = bipL->getNumberOfBipartitions(); i > 0; i--)
+namespace
+{
+  // Sorts split indices by decreasing number of occurrences, then by increasing index:
+  bool moreFrequentSplit(const pair<size_t, size_t>& s1, const pair<size_t, size_t>& s2)
   {
-    if (bipL->getPartitionSize(i - 1) == 1)
-      continue;
-    score = static_cast<int>(bipScore[i - 1]) / static_cast<double>(vecTr.size());
-    if (score <= threshold && score != 1.)
-    {
-      bipL->deleteBipartition(i - 1);
-      continue;
-    }
-    if (score > 0.5)
-      continue;
-    for (size_t j = bipL->getNumberOfBipartitions(); j > i; j--)
+    return s1.first > s2.first || (s1.first == s2.first && s1.second < s2.second);
+  }
+}
+
+TreeTemplate<Node>* TreeTools::thresholdConsensus(const SplitCounter& counter, double threshold) throw (Exception)
+{
+  size_t nbTrees = counter.getNumberOfTrees();
+  if (nbTrees == 0)
+    throw Exception("TreeTools::thresholdConsensus. No tree counted.");
+
+  /* select bipartitions above the threshold */
+  vector< pair<size_t, size_t> > candidates;
+  for (size_t i = 0; i < counter.getNumberOfSplits(); i++)
+  {
+    double score = static_cast<double>(counter.getCount(i)) / static_cast<double>(nbTrees);
+    if (score > threshold || counter.getCount(i) == nbTrees)
+      candidates.push_back(pair<size_t, size_t>(counter.getCount(i), i));
+  }
+  sort(candidates.begin(), candidates.end(), moreFrequentSplit);
+
+  /* greedily add the compatible ones, by decreasing score */
+  size_t nbElements = counter.getNumberOfElements();
+  size_t maxNbSplits = nbElements > 3 ? nbElements - 3 : 0;
+  vector<size_t> indices;
+  vector<Split> splits;
+  for (size_t i = 0; i < candidates.size() && splits.size() < maxNbSplits; i++)
+  {
+    Split split = counter.getSplit(candidates[i].second);
+    bool compatible = true;
+    // Bipartitions found in a majority of trees are always compatible:
+    if (2 * candidates[i].first <= nbTrees)
     {
-      if (!bipL->areCompatible(i - 1, j - 1))
+      for (size_t j = 0; compatible && j < splits.size(); j++)
       {
-        bipL->deleteBipartition(i - 1);
-        break;
+        compatible = split.isCompatibleWith(splits[j]);
       }
     }
+    if (compatible)
+    {
+      indices.push_back(candidates[i].second);
+      splits.push_back(split);
+    }
   }
 
-  TreeTemplate<Node>* tr = bipL->toTree();
-  delete bipL;
-  return tr;
+  auto_ptr<BipartitionList> bipL(counter.toBipartitionList(indices));
+  return bipL->toTree();
 }
 
 /******************************************************************************/
@@ -1123,34 +1139,32 @@ Tree* TreeTools::MRP(const vector<Tree*>& vecTr)
 
 void TreeTools::computeBootstrapValues(Tree& tree, const vector<Tree*>& vecTr, bool verbose, int format)
 {
-  vector<int> index;
-  BipartitionList bpTree(tree, true, &index);
-  vector<size_t> occurences;
-  BipartitionList* bpList = bipartitionOccurrences(vecTr, occurences);
+  vector<string> elements = tree.getLeavesNames();
+  sort(elements.begin(), elements.end());
+  SplitCounter counter(elements);
+  counter.addTrees(vecTr);
+  computeBootstrapValues(tree, counter, verbose, format);
+}
 
-  vector< Number<double> > bootstrapValues(bpTree.getNumberOfBipartitions());
+/******************************************************************************/
 
-  for (size_t i = 0; i < bpTree.getNumberOfBipartitions(); i++)
-  {
-    if (verbose)
-      ApplicationTools::displayGauge(i, bpTree.getNumberOfBipartitions() - 1, '=');
-    for (size_t j = 0; j < bpList->getNumberOfBipartitions(); j++)
-    {
-      if (BipartitionTools::areIdentical(bpTree, i, *bpList, j))
-      {
-        bootstrapValues[i] = format >= 0 ? round(static_cast<double>(occurences[j]) * pow(10., 2 + format) / static_cast<double>(vecTr.size())) / pow(10., format) : static_cast<double>(occurences[j]);
-        break;
-      }
-    }
-  }
+void TreeTools::computeBootstrapValues(Tree& tree, const SplitCounter& counter, bool verbose, int format) throw (Exception)
+{
+  vector<Split> splits;
+  vector<int> index;
+  counter.getSplits(tree, splits, &index);
+  double nbTrees = static_cast<double>(counter.getNumberOfTrees());
 
   for (size_t i = 0; i < index.size(); i++)
   {
-    if (!tree.isLeaf(index[i]))
-      tree.setBranchProperty(index[i], BOOTSTRAP, bootstrapValues[i]);
+    if (verbose)
+      ApplicationTools::displayGauge(i, index.size() - 1, '=');
+    if (tree.isLeaf(index[i]))
+      continue;
+    double occurences = static_cast<double>(counter.getCount(splits[i]));
+    double value = format >= 0 ? round(occurences * pow(10., 2 + format) / nbTrees) / pow(10., format) : occurences;
+    tree.setBranchProperty(index[i], BOOTSTRAP, Number<double>(value));
   }
-
-  delete bpList;
 }
 
 /******************************************************************************/
@@ -44,6 +44,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "Node.h"
 #include "Tree.h"
 #include "BipartitionList.h"
+#include "SplitCounter.h"
 
 #include <Bpp/Exceptions.h>
 #include <Bpp/Numeric/VectorTools.h>
@@ -595,18 +596,38 @@ class TreeTools
      * @param missing_in_tr1 Output as the number of bipartitions occurring in the second tree but not the first
      * @param checkNames Tell whether we should check the trees first.
      * @return Robinson-Foulds distance = *missing_in_tr1 + *missing_in_tr2
-     * @throw Exception If checkNames is set to true and trees do not share the same leaves names.
+     * @throw Exception If trees do not share the same leaves names.
+     *
+     * Bipartitions are hashed (see SplitCounter), so that the distance is computed in a time
+     * linear in the number of leaves.
      */
     static int robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool checkNames = true, int* missing_in_tr2 = NULL, int* missing_in_tr1 = NULL) throw (Exception);
 
+    /**
+     * @brief Calculates the Robinson-Foulds distances between all pairs of trees of a set
+     *
+     * The bipartitions of each tree are hashed only once, and pairs are compared in parallel.
+     * The resulting matrix can be used with any distance method, for instance HierarchicalClustering
+     * to cluster the trees. Rows are in the order of the trees, and named after their rank, starting from 1.
+     *
+     * @param vecTr Vector of input trees (must share a common set of leaves)
+     * @param nbThreads The number of threads to use, 0 for as many as available processors.
+     * This parameter has no effect if OpenMP is not available.
+     * @return A newly allocated matrix of Robinson-Foulds distances.
+     * @throw Exception If the vector is empty, or if trees do not share the same leaves names.
+     */
+    static DistanceMatrix* robinsonFouldsDistances(const std::vector<Tree*>& vecTr, size_t nbThreads = 1) throw (Exception);
+
     /**
      * @brief Counts the total number of occurrences of every bipartition from the input trees
      *
      * Returns the list of distinct bipartitions found at least once in the set of input trees,
      * and writes the number of occurrence of each of these bipartitions in vector bipScore.
+     * Bipartitions are counted with a SplitCounter, internal branches come first, in the order
+     * they are first found, followed by external branches.
      *
      * @author Nicolas Galtier
-     * @param vecTr Vector of input trees (must share a common set of leaves - not checked in this function)
+     * @param vecTr Vector of input trees (must share a common set of leaves)
      * @param bipScore Output as the numbers of occurrences of the returned distinct bipartitions
      * @return A BipartitionList object including only distinct bipartitions
      */
@@ -627,6 +648,19 @@ class TreeTools
      */
     static TreeTemplate<Node>* thresholdConsensus(const std::vector<Tree*>& vecTr, double threshold, bool checkNames = true) throw (Exception);
 
+    /**
+     * @brief General greedy consensus tree method, from precomputed split occurrences
+     *
+     * Same as thresholdConsensus above, for trees that have been counted one at a time,
+     * possibly without being all in memory. Bipartitions with the same score are considered
+     * in the order they were first found.
+     *
+     * @param counter The occurrences of the splits of the input trees.
+     * @param threshold Minimal acceptable score =number of occurrence of a bipartition/number of trees (0.<=threshold<=1.)
+     * @throw Exception If no tree was counted.
+     */
+    static TreeTemplate<Node>* thresholdConsensus(const SplitCounter& counter, double threshold) throw (Exception);
+
     /**
      * @brief Fully-resolved greedy consensus tree method
      *
@@ -686,6 +720,18 @@ class TreeTools
      *                If negative, bootstrap calues are the raw number of tree occurrences.
      */
     static void computeBootstrapValues(Tree& tree, const std::vector<Tree*>& vecTr, bool verbose = true, int format = 0);
+
+    /**
+     * @brief Compute bootstrap values, from precomputed split occurrences.
+     *
+     * @param tree    Input tree. the BOOTSTRAP banch property of the tree will be modified if it already exists.
+     * @param counter The occurrences of the splits of the trees to compare to 'tree'.
+     * @param verbose Tell if a progress bar should be displayed.
+     * @param format  If null or positive, bootstrap values are reported as percentage, with the given number of decimal digits.
+     *                If negative, bootstrap calues are the raw number of tree occurrences.
+     * @throw Exception If 'tree' does not have the same leaves as the counted trees.
+     */
+    static void computeBootstrapValues(Tree& tree, const SplitCounter& counter, bool verbose = true, int format = 0) throw (Exception);
 	
     /**
      * @brief Determine the mid-point position of the root along the branch that already contains the root. Consequently, the topology of the rooted tree remains identical.
@@ -0,0 +1,148 @@
+//
+// File: test_distance.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/Distance/NeighborJoining.h>
+#include <Bpp/Phyl/Distance/BioNJ.h>
+#include <Bpp/Phyl/Distance/FastNeighborJoining.h>
+#include <Bpp/Phyl/Distance/DistanceEstimation.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+bool compare(AgglomerativeDistanceMethod& reference, FastNeighborJoining& fast, const DistanceMatrix& matrix, size_t nbThreads)
+{
+  reference.setDistanceMatrix(matrix);
+  reference.computeTree();
+  fast.setNumberOfThreads(nbThreads);
+  fast.setDistanceMatrix(matrix);
+  fast.computeTree();
+  auto_ptr<Tree> tree1(reference.getTree());
+  auto_ptr<Tree> tree2(fast.getTree());
+  int rf = TreeTools::robinsonFouldsDistance(*tree1, *tree2);
+  double l1 = tree1->getTotalLength();
+  double l2 = tree2->getTotalLength();
+  cout << fast.getName() << "\t" << fast.getNumberOfThreads() << "\t" << rf << "\t" << l1 << "\t" << l2 << endl;
+  return rf == 0 && abs(l1 - l2) < 1e-9;
+}
+
+int main() {
+  vector<string> leaves(50);
+  for (size_t i = 0; i < leaves.size(); ++i)
+    leaves[i] = "leaf" + TextTools::toString(i);
+
+  for (unsigned int j = 0; j < 10; ++j) {
+    //Generate a random tree with random branch lengths:
+    auto_ptr< TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(leaves, false));
+    vector<Node*> nodes = tree->getNodes();
+    for (size_t i = 0; i < nodes.size(); ++i)
+      if (nodes[i]->hasFather())
+        nodes[i]->setDistanceToFather(RandomTools::giveRandomNumberBetweenZeroAndEntry(1.) + 0.01);
+
+    //Additive distances, perturbed so that the tree cannot be recovered exactly:
+    auto_ptr<DistanceMatrix> matrix(TreeTemplateTools::getDistanceMatrix(*tree));
+    for (size_t i = 1; i < matrix->size(); ++i)
+      for (size_t k = 0; k < i; ++k)
+        (*matrix)(i, k) = (*matrix)(k, i) = (*matrix)(i, k) * (0.8 + RandomTools::giveRandomNumberBetweenZeroAndEntry(0.4));
+
+    NeighborJoining nj(false, false, false);
+    BioNJ bionj(false, false, false);
+    FastNeighborJoining fnj(false, false, false, false);
+    FastNeighborJoining fbionj(true, false, false, false);
+    for (size_t t = 1; t <= 4; t += 3) {
+      if (!compare(nj, fnj, *matrix, t)) return 1;
+      if (!compare(bionj, fbionj, *matrix, t)) return 1;
+    }
+  }
+
+  //Pairwise distances must not depend on the number of threads, nor on the sharing of site patterns:
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "AAATGGCTGTGCACGTCAAATGGCTGTGCACGTC", alphabet));
+  sites.addSequence(BasicSequence("B", "GACTGGATCTGCACGTCGACTGGATCTGCACGTC", alphabet));
+  sites.addSequence(BasicSequence("C", "CTCTGGATGTGCACGTGCTCTGGATGTGCACGTG", alphabet));
+  sites.addSequence(BasicSequence("D", "AAATGGCGGTGCGCCTAAAATGGCGGTGCGCCTA", alphabet));
+  sites.addSequence(BasicSequence("E", "AAATGGCTGTGCACGTCGACTGGATCTGCAC-TC", alphabet));
+  DistanceEstimation estimation(new K80(alphabet, 2.), new GammaDiscreteRateDistribution(4, 1.), &sites, 0, false);
+  estimation.computeMatrix();
+  auto_ptr<DistanceMatrix> dist1(estimation.getMatrix());
+  estimation.setNumberOfThreads(4);
+  estimation.computeMatrix();
+  auto_ptr<DistanceMatrix> dist2(estimation.getMatrix());
+  estimation.shareSitePatterns(true);
+  estimation.computeMatrix();
+  auto_ptr<DistanceMatrix> dist3(estimation.getMatrix());
+  for (size_t i = 0; i < sites.getNumberOfSequences(); ++i) {
+    for (size_t k = 0; k < sites.getNumberOfSequences(); ++k) {
+      cout << (*dist1)(i, k) << "\t" << (*dist2)(i, k) << "\t" << (*dist3)(i, k) << endl;
+      if ((*dist1)(i, k) != (*dist2)(i, k)) return 1;
+      if (abs((*dist1)(i, k) - (*dist3)(i, k)) > 1e-6) return 1;
+    }
+  }
+
+  //Robinson-Foulds distances, between pairs or all at once:
+  auto_ptr<Tree> rf1(TreeTemplateTools::parenthesisToTree("((A,B),C,D,(E,F));"));
+  auto_ptr<Tree> rf2(TreeTemplateTools::parenthesisToTree("(((A,B),C),(D,(E,F)));"));
+  auto_ptr<Tree> rf3(TreeTemplateTools::parenthesisToTree("(((A,C),B),(D,(E,F)));"));
+  int missing2, missing1;
+  if (TreeTools::robinsonFouldsDistance(*rf1, *rf2, true, &missing2, &missing1) != 1 || missing2 != 0 || missing1 != 1) return 1;
+  if (TreeTools::robinsonFouldsDistance(*rf2, *rf3) != 2) return 1;
+  vector<Tree*> rfTrees;
+  for (unsigned int j = 0; j < 20; ++j)
+    rfTrees.push_back(TreeTemplateTools::getRandomTree(leaves, j % 2 == 0));
+  auto_ptr<DistanceMatrix> rfMatrix(TreeTools::robinsonFouldsDistances(rfTrees, 4));
+  for (size_t i = 0; i < rfTrees.size(); ++i) {
+    for (size_t k = 0; k < rfTrees.size(); ++k) {
+      if ((*rfMatrix)(i, k) != TreeTools::robinsonFouldsDistance(*rfTrees[i], *rfTrees[k])) return 1;
+    }
+    delete rfTrees[i];
+  }
+  return 0;
+}
+
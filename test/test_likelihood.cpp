@@ -40,13 +40,24 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
 #include <Bpp/Numeric/Matrix/MatrixTools.h>
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Io/Fasta.h>
+#include <Bpp/Seq/Io/Phylip.h>
 #include <Bpp/Phyl/TreeTemplate.h>
 #include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/MixtureOfSubstitutionModels.h>
 #include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
 #include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
 #include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/NNIHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousMixedTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/StreamingSiteLikelihoods.h>
+#include <Bpp/Phyl/Io/SiteFileChunks.h>
 #include <Bpp/Phyl/OptimizationTools.h>
 #include <iostream>
+#include <sstream>
+#include <limits>
+#include <algorithm>
+#include <cstdio>
 
 using namespace bpp;
 using namespace std;
@@ -87,6 +98,111 @@ void fitModelHDR(SubstitutionModel* model, DiscreteDistribution* rdist, const Tr
     throw Exception("Incorrect final value.");
 }
 
+//Balanced tree with leaves named L<first> to L<first + nbLeaves - 1>:
+string balancedSubtree(size_t first, size_t nbLeaves, double brLen) {
+  ostringstream oss;
+  if (nbLeaves == 1) {
+    oss << "L" << first << ":" << brLen;
+  } else {
+    size_t half = nbLeaves / 2;
+    oss << "(" << balancedSubtree(first, half, brLen) << "," << balancedSubtree(first + half, nbLeaves - half, brLen) << "):" << brLen;
+  }
+  return oss.str();
+}
+
+TreeTemplate<Node>* balancedTree(size_t nbLeaves, double brLen) {
+  size_t half = nbLeaves / 2;
+  return TreeTemplateTools::parenthesisToTree("(" + balancedSubtree(0, half, brLen) + "," + balancedSubtree(half, nbLeaves - half, brLen) + ");");
+}
+
+//Scaled likelihoods must match unscaled ones when the latter do not underflow:
+bool testScaling(SubstitutionModel* model, DiscreteDistribution* rdist) {
+  auto_ptr<TreeTemplate<Node> > tree(balancedTree(256, 0.5));
+  HomogeneousSequenceSimulator simulator(model, rdist, tree.get());
+  auto_ptr<SiteContainer> sites(simulator.simulate(50, 1));
+  DRHomogeneousTreeLikelihood tldr(*tree, *sites, model, rdist, true, false);
+  tldr.initialize();
+  DRHomogeneousTreeLikelihood tldrsc(*tree, *sites, model, rdist, true, false);
+  tldrsc.enableScaling(true);
+  tldrsc.initialize();
+  RHomogeneousTreeLikelihood tlsr(*tree, *sites, model, rdist, true, false);
+  tlsr.initialize();
+  RHomogeneousTreeLikelihood tlsrsc(*tree, *sites, model, rdist, true, false);
+  tlsrsc.enableScaling(true);
+  tlsrsc.initialize();
+  cout << "Scaling\t" << tldr.getValue() << "\t" << tldrsc.getValue() << "\t" << tlsr.getValue() << "\t" << tlsrsc.getValue() << endl;
+  if (abs(tldrsc.getValue() - tldr.getValue()) > 1e-8) return false;
+  if (abs(tlsrsc.getValue() - tlsr.getValue()) > 1e-8) return false;
+
+  //Make sure that the test actually rescales some sites:
+  const Vdouble& rootScales = tldrsc.getLikelihoodData()->getRootLikelihoodBuffer().getLogScalingFactors();
+  if (*min_element(rootScales.begin(), rootScales.end()) == 0.) return false;
+
+  vector<string> params = tldr.getBranchLengthsParameters().getParameterNames();
+  for (size_t k = 0; k < params.size(); k += 50) {
+    double d1 = tldr.getFirstOrderDerivative(params[k]);
+    if (abs(tldrsc.getFirstOrderDerivative(params[k]) - d1) > 1e-6 * max(1., abs(d1))) return false;
+    if (abs(tlsrsc.getFirstOrderDerivative(params[k]) - d1) > 1e-6 * max(1., abs(d1))) return false;
+    double d2 = tldr.getSecondOrderDerivative(params[k]);
+    if (abs(tldrsc.getSecondOrderDerivative(params[k]) - d2) > 1e-6 * max(1., abs(d2))) return false;
+    if (abs(tlsrsc.getSecondOrderDerivative(params[k]) - d2) > 1e-6 * max(1., abs(d2))) return false;
+  }
+
+  //Conditional likelihoods at a node must be returned unscaled:
+  VVVdouble lik, likSc;
+  tldr.computeLikelihoodAtNode(tree->getRootId(), lik);
+  tldrsc.computeLikelihoodAtNode(tree->getRootId(), likSc);
+  for (size_t i = 0; i < lik.size(); i++) {
+    for (size_t c = 0; c < lik[i].size(); c++) {
+      for (size_t x = 0; x < lik[i][c].size(); x++) {
+        if (abs(likSc[i][c][x] - lik[i][c][x]) > 1e-10 * lik[i][c][x]) return false;
+      }
+    }
+  }
+
+  //So must the arrays returned by the deprecated VVVdouble accessors:
+  const DRASDRTreeLikelihoodData* data = tldr.getLikelihoodData();
+  const DRASDRTreeLikelihoodData* dataSc = tldrsc.getLikelihoodData();
+  const VVVdouble& rootLik = data->getRootLikelihoodArray();
+  const VVVdouble& rootLikSc = dataSc->getRootLikelihoodArray();
+  int rootId = tldr.getTree().getRootId();
+  int sonId = tldr.getTree().getSonsId(rootId)[0];
+  const VVVdouble& sonLik = data->getLikelihoodArray(rootId, sonId);
+  const VVVdouble& sonLikSc = dataSc->getLikelihoodArray(rootId, sonId);
+  for (size_t i = 0; i < rootLik.size(); i++) {
+    for (size_t c = 0; c < rootLik[i].size(); c++) {
+      for (size_t x = 0; x < rootLik[i][c].size(); x++) {
+        if (abs(rootLikSc[i][c][x] - rootLik[i][c][x]) > 1e-10 * rootLik[i][c][x]) return false;
+        if (abs(sonLikSc[i][c][x] - sonLik[i][c][x]) > 1e-10 * sonLik[i][c][x]) return false;
+      }
+    }
+  }
+
+  //A tree where unscaled likelihoods underflow must still give a finite log-likelihood:
+  tree.reset(balancedTree(1024, 0.5));
+  HomogeneousSequenceSimulator simulatorLarge(model, rdist, tree.get());
+  sites.reset(simulatorLarge.simulate(50, 1));
+  DRHomogeneousTreeLikelihood tldrLarge(*tree, *sites, model, rdist, true, false);
+  tldrLarge.enableScaling(true);
+  tldrLarge.initialize();
+  RHomogeneousTreeLikelihood tlsrLarge(*tree, *sites, model, rdist, true, false);
+  tlsrLarge.enableScaling(true);
+  tlsrLarge.initialize();
+  cout << "Scaling, large tree\t" << tldrLarge.getValue() << "\t" << tlsrLarge.getValue() << endl;
+  if (!(tldrLarge.getValue() < numeric_limits<double>::max())) return false;
+  if (abs(tlsrLarge.getValue() - tldrLarge.getValue()) > 1e-8 * tldrLarge.getValue()) return false;
+  Vdouble logScales;
+  tldrLarge.computeScaledLikelihoodAtNode(tree->getRootId(), lik, logScales);
+  for (size_t i = 0; i < sites->getNumberOfSites(); i++) {
+    size_t pos = tldrLarge.getLikelihoodData()->getRootArrayPosition(i);
+    double l = 0;
+    for (size_t c = 0; c < lik[pos].size(); c++)
+      l += VectorTools::sum(lik[pos][c]) * rdist->getProbability(c);
+    if (abs(log(l) + logScales[pos] - tldrLarge.getLogLikelihoodForASite(i)) > 1e-8) return false;
+  }
+  return true;
+}
+
 int main() {
   auto_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree("((A:0.01, B:0.02):0.03,C:0.01,D:0.1);"));
   vector<string> seqNames= tree->getLeavesNames();
@@ -134,5 +250,123 @@ int main() {
     if (abs(d1sr - d1dr) > 0.000001) return 1;
   }
 
+  if (!testScaling(model.get(), rdist.get())) return 1;
+
+  //Results must not depend on the number of threads:
+  DRHomogeneousTreeLikelihood tldrmt(*tree, sites, model.get(), rdist.get());
+  tldrmt.setNumberOfThreads(4);
+  tldrmt.initialize();
+  cout << "Threads: " << tldrmt.getNumberOfThreads() << endl;
+  if (tldrmt.getValue() != tldr.getValue()) return 1;
+  for (vector<string>::iterator it = params.begin(); it != params.end(); ++it) {
+    if (tldrmt.getFirstOrderDerivative(*it) != tldr.getFirstOrderDerivative(*it)) return 1;
+    if (tldrmt.getSecondOrderDerivative(*it) != tldr.getSecondOrderDerivative(*it)) return 1;
+  }
+
+  //Incremental updates after a branch length change must match a full recomputation:
+  ParameterList pl;
+  pl.addParameter(Parameter(params[1], 0.2));
+  tlsr.matchParametersValues(pl);
+  tldr.matchParametersValues(pl);
+  double lsr = tlsr.getValue();
+  double ldr = tldr.getValue();
+  tlsr.setParameters(tlsr.getParameters());
+  tldr.setParameters(tldr.getParameters());
+  cout << lsr << "\t" << tlsr.getValue() << "\t" << ldr << "\t" << tldr.getValue() << endl;
+  if (abs(lsr - tlsr.getValue()) > 1e-10) return 1;
+  if (abs(ldr - tldr.getValue()) > 1e-10) return 1;
+
+  //Parallel NNI tests must give the same results as serial ones:
+  NNIHomogeneousTreeLikelihood tlnni(*tree, sites, model.get(), rdist.get(), true, false);
+  tlnni.initialize();
+  vector<int> nniIds;
+  nniIds.push_back(tree->getLeafId("A"));
+  nniIds.push_back(tree->getLeafId("B"));
+  vector<double> nniDiffs = tlnni.testNNIs(nniIds);
+  tlnni.setNumberOfThreads(4);
+  vector<double> nniDiffsMt = tlnni.testNNIs(nniIds);
+  for (size_t i = 0; i < nniIds.size(); i++) {
+    cout << "NNI " << nniIds[i] << "\t" << nniDiffs[i] << "\t" << nniDiffsMt[i] << endl;
+    if (nniDiffs[i] != nniDiffsMt[i]) return 1;
+  }
+
+  //Site likelihoods computed by chunks must match the ones computed on the full alignment:
+  DRHomogeneousTreeLikelihood tlfull(*tree, sites, model.get(), rdist.get(), true, false);
+  tlfull.initialize();
+  Vdouble siteLogLik = tlfull.getLogLikelihoodForEachSite();
+  SiteContainerChunks chunks(sites, 5);
+  vector<const Tree*> trees(2, tree.get());
+  vector<string> treeNames;
+  treeNames.push_back("tree1");
+  treeNames.push_back("tree2");
+  stringstream pslStream;
+  pslStream << setprecision(20);
+  StreamingSiteLikelihoods::writeLogLikelihoodForEachSite(trees, treeNames, model.get(), rdist.get(), chunks, pslStream);
+  PairedSiteLikelihoods psl = IOTreepuzzlePairedSiteLikelihoods::read(pslStream);
+  if (psl.getNumberOfModels() != 2 || psl.getNumberOfSites() != sites.getNumberOfSites()) return 1;
+  for (size_t i = 0; i < siteLogLik.size(); i++) {
+    if (abs(psl.getLikelihoods()[1][i] - siteLogLik[i]) > 1e-10) return 1;
+  }
+
+  //Sites streamed from files must give the same log-likelihood as the full alignment:
+  Fasta(7).writeSequences("test_likelihood_chunks.fasta", sites, true);
+  Phylip(true, true, 7).writeAlignment("test_likelihood_chunks_seq.phy", sites, true);
+  Phylip(true, false, 7).writeAlignment("test_likelihood_chunks_int.phy", sites, true);
+  FastaSiteChunks fastaChunks("test_likelihood_chunks.fasta", alphabet, 5);
+  PhylipSiteChunks phylipSeqChunks("test_likelihood_chunks_seq.phy", alphabet, 5, true, true);
+  PhylipSiteChunks phylipIntChunks("test_likelihood_chunks_int.phy", alphabet, 5, true, false);
+  vector<SiteContainerChunkReader*> readers;
+  readers.push_back(&fastaChunks);
+  readers.push_back(&phylipSeqChunks);
+  readers.push_back(&phylipIntChunks);
+  StreamingSiteLikelihoods streaming(*tree, model.get(), rdist.get());
+  for (size_t r = 0; r < readers.size(); r++) {
+    if (readers[r]->getNumberOfSites() != sites.getNumberOfSites()) return 1;
+    double streamLogLik = 0;
+    SiteContainer* chunk;
+    readers[r]->rewind();
+    while ((chunk = readers[r]->nextChunk()) != 0) {
+      auto_ptr<SiteContainer> chunkPtr(chunk);
+      Vdouble chunkLogLik = streaming.computeLogLikelihoodForEachSite(*chunk);
+      for (size_t i = 0; i < chunkLogLik.size(); i++)
+        streamLogLik += chunkLogLik[i];
+    }
+    cout << "Streamed\t" << -tlfull.getValue() << "\t" << streamLogLik << endl;
+    if (abs(streamLogLik + tlfull.getValue()) > 1e-10) return 1;
+  }
+  remove("test_likelihood_chunks.fasta");
+  remove("test_likelihood_chunks_seq.phy");
+  remove("test_likelihood_chunks_int.phy");
+
+  //Mixture components are evaluated in a single traversal, and must match separate evaluations:
+  vector<SubstitutionModel*> components;
+  components.push_back(new T92(alphabet, 2., 0.3));
+  components.push_back(new T92(alphabet, 6., 0.6));
+  MixtureOfSubstitutionModels mixture(alphabet, components);
+  RHomogeneousMixedTreeLikelihood tlmix(*tree, sites, &mixture, rdist.get(), true, false);
+  tlmix.initialize();
+  Vdouble mixLik(sites.getNumberOfSites(), 0.);
+  Vdouble mixDLik(sites.getNumberOfSites(), 0.);
+  for (size_t m = 0; m < mixture.getNumberOfModels(); m++) {
+    RHomogeneousTreeLikelihood tlm(*tree, sites, mixture.getNModel(m), rdist.get(), true, false);
+    tlm.initialize();
+    tlm.computeTreeDLikelihood(params[0]);
+    for (size_t i = 0; i < mixLik.size(); i++) {
+      mixLik[i]  += tlm.getLikelihoodForASite(i) * mixture.getNProbability(m);
+      mixDLik[i] += tlm.getDLikelihoodForASite(i) * mixture.getNProbability(m);
+    }
+  }
+  double mixD1 = 0;
+  for (size_t i = 0; i < mixLik.size(); i++) {
+    if (abs(log(mixLik[i]) - tlmix.getLogLikelihoodForASite(i)) > 1e-10) return 1;
+    mixD1 -= mixDLik[i] / mixLik[i];
+  }
+  cout << "Mixture\t" << tlmix.getValue() << "\t" << tlmix.getFirstOrderDerivative(params[0]) << "\t" << mixD1 << endl;
+  if (abs(tlmix.getFirstOrderDerivative(params[0]) - mixD1) > 1e-8) return 1;
+  RHomogeneousMixedTreeLikelihood tlmixmt(*tree, sites, &mixture, rdist.get(), true, false);
+  tlmixmt.setNumberOfThreads(4);
+  tlmixmt.initialize();
+  if (tlmixmt.getValue() != tlmix.getValue()) return 1;
+
   return 0;
 }
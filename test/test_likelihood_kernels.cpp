@@ -0,0 +1,176 @@
+//
+// File: test_likelihood_kernels.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/Likelihood/LikelihoodKernels.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+//Compare the vectorized kernels to the generic loop, with and without specialization.
+bool testKernels(size_t nbStates, bool reverse) {
+  size_t nbSites = 53;
+  size_t nbClasses = 3;
+  VVVdouble pxy(nbClasses, VVdouble(nbStates, Vdouble(nbStates)));
+  for (size_t c = 0; c < nbClasses; ++c)
+    for (size_t x = 0; x < nbStates; ++x)
+      for (size_t y = 0; y < nbStates; ++y)
+        pxy[c][x][y] = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+  LikelihoodArray iLik(nbSites, nbClasses, nbStates);
+  for (size_t i = 0; i < nbSites; ++i)
+    for (size_t c = 0; c < nbClasses; ++c)
+      for (size_t y = 0; y < nbStates; ++y)
+        iLik(i, c, y) = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+
+  LikelihoodArray packedP;
+  LikelihoodKernels::packTransitionProbabilities(pxy, packedP, reverse);
+
+  LikelihoodKernels::setInstructionSet(LikelihoodKernels::GENERIC);
+  LikelihoodArray ref(nbSites, nbClasses, nbStates);
+  ref.fill(1.);
+  LikelihoodKernels::multiplyConditionalLikelihoods(packedP, iLik, ref, nbSites, nbClasses, nbStates);
+
+  LikelihoodKernels::setInstructionSet(LikelihoodKernels::getBestInstructionSet());
+  LikelihoodArray oLik(nbSites, nbClasses, nbStates);
+  oLik.fill(1.);
+  LikelihoodKernels::multiplyConditionalLikelihoods(packedP, iLik, oLik, nbSites, nbClasses, nbStates);
+
+  for (size_t i = 0; i < nbSites; ++i) {
+    for (size_t c = 0; c < nbClasses; ++c) {
+      for (size_t x = 0; x < nbStates; ++x) {
+        double l = 0;
+        for (size_t y = 0; y < nbStates; ++y)
+          l += (reverse ? pxy[c][y][x] : pxy[c][x][y]) * iLik(i, c, y);
+        if (abs(ref(i, c, x) - l) > 1e-12 * l || abs(oLik(i, c, x) - l) > 1e-12 * l) {
+          cerr << "Error for " << nbStates << " states, site " << i << ", class " << c << ", state " << x << ": " << l << "\t" << ref(i, c, x) << "\t" << oLik(i, c, x) << endl;
+          return false;
+        }
+      }
+      //Padding must remain null:
+      for (size_t x = nbStates; x < oLik.getStride(); ++x)
+        if (oLik(i, c, x) != 0) return false;
+    }
+  }
+  return true;
+}
+
+//Rescaling must be exact and propagate through the kernels.
+bool testScaling() {
+  size_t nbSites = 5;
+  size_t nbClasses = 2;
+  size_t nbStates = 4;
+  VVVdouble pxy(nbClasses, VVdouble(nbStates, Vdouble(nbStates, 0.25)));
+  LikelihoodArray packedP;
+  LikelihoodKernels::packTransitionProbabilities(pxy, packedP);
+  LikelihoodArray iLik(nbSites, nbClasses, nbStates);
+  for (size_t i = 0; i < nbSites; ++i)
+    for (size_t c = 0; c < nbClasses; ++c)
+      for (size_t y = 0; y < nbStates; ++y)
+        iLik(i, c, y) = ldexp(1. + static_cast<double>(y), -300 * static_cast<int>(i % 2));
+  iLik.rescale();
+  LikelihoodArray oLik(nbSites, nbClasses, nbStates);
+  oLik.fill(1.);
+  LikelihoodKernels::multiplyConditionalLikelihoods(packedP, iLik, oLik, nbSites, nbClasses, nbStates);
+  oLik.rescale();
+  for (size_t i = 0; i < nbSites; ++i) {
+    double logL = log(oLik(i, 0, 0)) + oLik.getLogScalingFactor(i);
+    double expected = log(2.5) - 300. * static_cast<double>(i % 2) * log(2.);
+    if (abs(logL - expected) > 1e-12 * abs(expected)) {
+      cerr << "Scaling error at site " << i << ": " << logL << "\t" << expected << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//Processing several neighbors by blocks of sites, with several threads, must give the same results.
+bool testBlocks(size_t nbStates) {
+  size_t nbSites = 1001;
+  size_t nbClasses = 4;
+  size_t nbNeighbors = 3;
+  vector<LikelihoodArray> packedP(nbNeighbors);
+  vector<LikelihoodArray> iLik(nbNeighbors, LikelihoodArray(nbSites, nbClasses, nbStates));
+  vector<const LikelihoodArray*> packedPtr(nbNeighbors), iLikPtr(nbNeighbors);
+  for (size_t n = 0; n < nbNeighbors; ++n) {
+    VVVdouble pxy(nbClasses, VVdouble(nbStates, Vdouble(nbStates)));
+    for (size_t c = 0; c < nbClasses; ++c)
+      for (size_t x = 0; x < nbStates; ++x)
+        for (size_t y = 0; y < nbStates; ++y)
+          pxy[c][x][y] = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+    LikelihoodKernels::packTransitionProbabilities(pxy, packedP[n]);
+    for (size_t i = 0; i < nbSites; ++i)
+      for (size_t c = 0; c < nbClasses; ++c)
+        for (size_t y = 0; y < nbStates; ++y)
+          iLik[n](i, c, y) = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+    packedPtr[n] = &packedP[n];
+    iLikPtr[n] = &iLik[n];
+  }
+  LikelihoodArray ref(nbSites, nbClasses, nbStates);
+  ref.fill(1.);
+  for (size_t n = 0; n < nbNeighbors; ++n)
+    LikelihoodKernels::multiplyConditionalLikelihoods(packedP[n], iLik[n], ref, nbSites, nbClasses, nbStates);
+  LikelihoodArray oLik(nbSites, nbClasses, nbStates);
+  oLik.fill(1.);
+  LikelihoodKernels::multiplyConditionalLikelihoods(packedPtr, iLikPtr, oLik, nbSites, nbClasses, nbStates, 4);
+  for (size_t i = 0; i < nbSites; ++i)
+    for (size_t c = 0; c < nbClasses; ++c)
+      for (size_t x = 0; x < nbStates; ++x)
+        if (oLik(i, c, x) != ref(i, c, x)) {
+          cerr << "Block error for " << nbStates << " states, site " << i << endl;
+          return false;
+        }
+  return true;
+}
+
+int main() {
+  cout << "Best instruction set: " << LikelihoodKernels::getInstructionSetName(LikelihoodKernels::getBestInstructionSet()) << endl;
+  size_t sizes[] = {2, 4, 7, 20, 61, 64};
+  for (size_t k = 0; k < 6; ++k) {
+    cout << "Testing kernels for " << sizes[k] << " states..." << endl;
+    if (!testKernels(sizes[k], false)) return 1;
+    if (!testKernels(sizes[k], true)) return 1;
+  }
+  cout << "Testing blocks..." << endl;
+  if (!testBlocks(4) || !testBlocks(20)) return 1;
+  cout << "Testing scaling..." << endl;
+  if (!testScaling()) return 1;
+  return 0;
+}
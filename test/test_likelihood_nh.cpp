@@ -148,6 +148,26 @@ int main() {
         return 1;
   }
 
+  //Updating only the branches of a modified model must give the same result as a full computation:
+  if (modelSet->getModelsWithParameter("T92.theta_2") != vector<size_t>(1, 1))
+    return 1;
+  if (modelSet->getModelsWithParameter("T92.kappa_1").size() != nmodels)
+    return 1;
+  auto_ptr<SiteContainer> sites(simulator.simulate(nsites));
+  auto_ptr<SubstitutionModelSet> modelSet4(modelSet->clone());
+  DRNonHomogeneousTreeLikelihood tl3(*tree, *sites.get(), modelSet4.get(), rdist, false, false);
+  tl3.initialize();
+  tl3.setParameterValue("T92.theta_2", 0.3);
+  tl3.setParameterValue("BrLen0", 0.15);
+  auto_ptr<SubstitutionModelSet> modelSet5(modelSet4->clone());
+  DRNonHomogeneousTreeLikelihood tl4(tl3.getTree(), *sites.get(), modelSet5.get(), rdist, false, false);
+  tl4.initialize();
+  cout << setprecision(20) << tl3.getValue() << "\t" << tl4.getValue() << endl;
+  if (abs(tl3.getValue() - tl4.getValue()) > 1e-8)
+    return 1;
+  if (abs(tl3.getFirstOrderDerivative("BrLen1") - tl4.getFirstOrderDerivative("BrLen1")) > 1e-6)
+    return 1;
+
   //-------------
   delete tree;
   delete modelSet;
@@ -155,9 +155,31 @@ int main() {
   cout << "Detailed count, decomposition method, type 1:" << endl;
   MatrixTools::print(*m);
   delete m;
-  ProbabilisticSubstitutionMapping* probMapDecDet = 
+  ProbabilisticSubstitutionMapping* probMapDecDet =
     SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountDecDet);
 
+  //Batched counts must match the ones computed one length and one type at a time:
+  Vdouble lengths;
+  lengths.push_back(0.001);
+  lengths.push_back(0.1);
+  lengths.push_back(1.);
+  VVVVdouble batchCounts;
+  sCountDecDet->getAllNumbersOfSubstitutionsForEachType(lengths, batchCounts);
+  for (size_t k = 0; k < lengths.size(); ++k) {
+    for (size_t t = 0; t < detReg->getNumberOfSubstitutionTypes(); ++t) {
+      m = sCountDecDet->getAllNumbersOfSubstitutions(lengths[k], t + 1);
+      for (size_t x = 0; x < m->getNumberOfRows(); ++x) {
+        for (size_t y = 0; y < m->getNumberOfColumns(); ++y) {
+          if (abs(batchCounts[k][t][x][y] - (*m)(x, y)) > 1e-12) {
+            cerr << "Error, batched counts differ from single counts." << endl;
+            return 1;
+          }
+        }
+      }
+      delete m;
+    }
+  }
+
   //Uniformization
   SubstitutionCount* sCountUniTot = new UniformizationSubstitutionCount(model, totReg);
   m = sCountUniTot->getAllNumbersOfSubstitutions(0.001,1);
@@ -172,9 +194,66 @@ int main() {
   cout << "Detailed count, uniformization method, type 1:" << endl;
   MatrixTools::print(*m);
   delete m;
-  ProbabilisticSubstitutionMapping* probMapUniDet = 
+  ProbabilisticSubstitutionMapping* probMapUniDet =
     SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountUniDet);
 
+  //Multithreaded and reduced mappings must match the serial one:
+  auto_ptr<ProbabilisticSubstitutionMapping> probMapUniDetMt(
+    SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountUniDet, false, 4));
+  vector< vector<double> > branchCounts =
+    SubstitutionMappingTools::computeCountsPerBranch(drhtl, ids, *sCountUniDet, -1, false, 4);
+  vector< vector<double> > siteCounts =
+    SubstitutionMappingTools::computeCountsPerSite(drhtl, ids, *sCountUniDet, 4);
+  for (size_t j = 0; j < ids.size(); ++j) {
+    for (size_t t = 0; t < detReg->getNumberOfSubstitutionTypes(); ++t) {
+      double total = 0;
+      for (unsigned int i = 0; i < n; ++i) {
+        double count = probMapUniDet->getNumberOfSubstitutions(ids[j], i, t);
+        if (probMapUniDetMt->getNumberOfSubstitutions(ids[j], i, t) != count) {
+          cerr << "Error, multithreaded mapping differs from serial one." << endl;
+          return 1;
+        }
+        total += count;
+      }
+      if (abs(branchCounts[j][t] - total) > 1e-6 * (1. + total)) {
+        cerr << "Error, counts per branch differ from the mapping." << endl;
+        return 1;
+      }
+    }
+  }
+  for (unsigned int k = 0; k < 3; ++k) {
+    auto_ptr<ProbabilisticSubstitutionMapping> serialMap, parallelMap;
+    if (k == 0) {
+      serialMap.reset(SubstitutionMappingTools::computeSubstitutionVectorsNoAveraging(drhtl, *sCountUniDet, false));
+      parallelMap.reset(SubstitutionMappingTools::computeSubstitutionVectorsNoAveraging(drhtl, *sCountUniDet, false, 4));
+    } else if (k == 1) {
+      serialMap.reset(SubstitutionMappingTools::computeSubstitutionVectorsNoAveragingMarginal(drhtl, *sCountUniDet, false));
+      parallelMap.reset(SubstitutionMappingTools::computeSubstitutionVectorsNoAveragingMarginal(drhtl, *sCountUniDet, false, 4));
+    } else {
+      serialMap.reset(SubstitutionMappingTools::computeSubstitutionVectorsMarginal(drhtl, *sCountUniDet, false));
+      parallelMap.reset(SubstitutionMappingTools::computeSubstitutionVectorsMarginal(drhtl, *sCountUniDet, false, 4));
+    }
+    for (size_t j = 0; j < ids.size(); ++j) {
+      for (unsigned int i = 0; i < n; ++i) {
+        for (size_t t = 0; t < detReg->getNumberOfSubstitutionTypes(); ++t) {
+          if (parallelMap->getNumberOfSubstitutions(ids[j], i, t) != serialMap->getNumberOfSubstitutions(ids[j], i, t)) {
+            cerr << "Error, multithreaded mapping differs from serial one (variant " << k << ")." << endl;
+            return 1;
+          }
+        }
+      }
+    }
+  }
+  for (unsigned int i = 0; i < n; ++i) {
+    vector<double> v = SubstitutionMappingTools::computeTotalSubstitutionVectorForSitePerType(*probMapUniDet, i);
+    for (size_t t = 0; t < v.size(); ++t) {
+      if (abs(siteCounts[i][t] - v[t]) > 1e-10) {
+        cerr << "Error, counts per site differ from the mapping." << endl;
+        return 1;
+      }
+    }
+  }
+
   //Check saturation:
   cout << "checking saturation..." << endl;
   m = sCountUniDet->getAllNumbersOfSubstitutions(0.001,1);
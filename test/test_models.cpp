@@ -38,6 +38,8 @@ knowledge of the CeCILL license and that you accept its terms.
 */
 
 #include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/Nucleotide/gBGC.h>
 #include <Bpp/Phyl/Model/Codon/YN98.h>
 #include <Bpp/Phyl/Model/FrequenciesSet/CodonFrequenciesSet.h>
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
@@ -110,10 +112,40 @@ bool testModel(SubstitutionModel& model) {
   return true;
 }
 
+//Check that cached transition probabilities are updated with the parameters:
+bool testCache(AbstractSubstitutionModel& model) {
+  vector<double> times(3);
+  times[0] = 0.01; times[1] = 0.3; times[2] = 0.01;
+  VVVdouble p1, dp1, d2p1;
+  model.getTransitionProbabilities(times, p1, &dp1, &d2p1);
+  ParameterList pl = model.getParameters();
+  pl[0].setValue(pl[0].getValue() * 1.1);
+  model.matchParametersValues(pl);
+  VVVdouble p2, dp2;
+  model.getTransitionProbabilities(times, p2, &dp2);
+  auto_ptr<AbstractSubstitutionModel> noCache(model.clone());
+  noCache->setTransitionMatrixCacheSize(0);
+  for (size_t k = 0; k < times.size(); ++k) {
+    RowMatrix<double> p = noCache->getPij_t(times[k]);
+    RowMatrix<double> dp = noCache->getdPij_dt(times[k]);
+    for (size_t i = 0; i < model.getNumberOfStates(); ++i)
+      for (size_t j = 0; j < model.getNumberOfStates(); ++j)
+        if (p2[k][i][j] != p(i, j) || dp2[k][i][j] != dp(i, j) || p1[k][i][j] != p1[k % 2][i][j]) {
+          cerr << "ERROR in cached transition probabilities for t=" << times[k] << endl;
+          return false;
+        }
+  }
+  return true;
+}
+
 int main() {
   //Nucleotide models:
   GTR gtr(&AlphabetTools::DNA_ALPHABET);
   if (!testModel(gtr)) return 1;
+  if (!testCache(gtr)) return 1;
+  //gBGC computes its eigen decomposition itself:
+  gBGC gbgc(&AlphabetTools::DNA_ALPHABET, new T92(&AlphabetTools::DNA_ALPHABET, 2., 0.4), 0.5);
+  if (!testCache(gbgc)) return 1;
 
   //Codon models:
   StandardGeneticCode gc(&AlphabetTools::DNA_ALPHABET);
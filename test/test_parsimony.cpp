@@ -38,10 +38,14 @@ knowledge of the CeCILL license and that you accept its terms.
 */
 
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
 #include <Bpp/Seq/Io/Phylip.h>
 #include <Bpp/Phyl/Tree.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
 #include <Bpp/Phyl/Io/Newick.h>
 #include <Bpp/Phyl/Parsimony/DRTreeParsimonyScore.h>
+#include <Bpp/Phyl/OptimizationTools.h>
 #include <iostream>
 
 using namespace bpp;
@@ -59,6 +63,46 @@ int main() {
     cout << "Parsimony score: " << pars.getScore() << endl;
 
     if (pars.getScore() != 9) return 1;
+
+    //Site scores must sum to the total score:
+    unsigned int sum = 0;
+    for (size_t i = 0; i < sites->getNumberOfSites(); i++)
+      sum += pars.getScoreForSite(i);
+    if (sum != pars.getScore()) return 1;
+
+    //Scores of SPR moves must match the ones of the resulting trees:
+    vector<int> ids = pars.getTree().getNodesId();
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+      const Node* node = dynamic_cast<const TreeTemplate<Node>&>(pars.getTree()).getNode(ids[i]);
+      if (!node->hasFather()) continue;
+      map<int, double> diffs = pars.testSPRs(ids[i]);
+      for (map<int, double>::iterator it = diffs.begin(); it != diffs.end(); it++)
+      {
+        DRTreeParsimonyScore moved(pars);
+        moved.doSPR(ids[i], it->first);
+        if (static_cast<double>(moved.getScore()) != static_cast<double>(pars.getScore()) + it->second) return 1;
+      }
+    }
+    auto_ptr<Tree> startTree(TreeTemplateTools::parenthesisToTree("((((s01,s05),s02),s03),s04);"));
+    DRTreeParsimonyScore spr(*startTree, *sites, false, true);
+    unsigned int startScore = spr.getScore();
+    OptimizationTools::optimizeTreeSPR(&spr, 0);
+    cout << "SPR search: " << startScore << " -> " << spr.getScore() << endl;
+    if (spr.getScore() > startScore) return 1;
+
+    //Codon alphabets have more than 21 states:
+    CodonAlphabet codonAlphabet(&AlphabetTools::DNA_ALPHABET);
+    VectorSiteContainer codons(&codonAlphabet);
+    codons.addSequence(BasicSequence("A", "AAACCCGGG", &codonAlphabet));
+    codons.addSequence(BasicSequence("B", "AAACCGGGG", &codonAlphabet));
+    codons.addSequence(BasicSequence("C", "AATCCCGGG", &codonAlphabet));
+    codons.addSequence(BasicSequence("D", "AATCCGGGG", &codonAlphabet));
+    auto_ptr<Tree> codonTree(TreeTemplateTools::parenthesisToTree("((A,B),(C,D));"));
+    DRTreeParsimonyScore codonPars(*codonTree, codons, false);
+    cout << "Codon parsimony score: " << codonPars.getScore() << endl;
+    if (codonPars.getScore() != 3) return 1;
+    if (codonPars.getScoreForSite(0) != 1 || codonPars.getScoreForSite(1) != 2 || codonPars.getScoreForSite(2) != 0) return 1;
     
   } catch (Exception& ex) {
     cerr << ex.what() << endl;
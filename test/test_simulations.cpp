@@ -46,9 +46,12 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
 #include <Bpp/Phyl/Model/SubstitutionModelSetTools.h>
 #include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
+#include <Bpp/Phyl/Simulation/StateSampler.h>
+#include <Bpp/Phyl/Simulation/SimulatedSiteChunks.h>
 #include <Bpp/Phyl/Likelihood/RNonHomogeneousTreeLikelihood.h>
 #include <Bpp/Phyl/OptimizationTools.h>
 #include <iostream>
+#include <sstream>
 
 using namespace bpp;
 using namespace std;
@@ -143,6 +146,100 @@ int main() {
   }
   delete modelSet3;
 
+  //Now try seeded simulations:
+
+  cout << "Seeded check:" << endl;
+
+  //Results must only depend on the seed:
+  auto_ptr<SiteContainer> sites3(simulator.simulate(n, 42));
+  NonHomogeneousSequenceSimulator simulatorMt(simulator);
+  simulatorMt.setNumberOfThreads(4);
+  auto_ptr<SiteContainer> sites3Mt(simulatorMt.simulate(n, 42));
+  auto_ptr<SiteContainer> sites3Other(simulatorMt.simulate(n, 43));
+  bool sameAsOther = true;
+  for (size_t i = 0; i < seqNames.size(); ++i) {
+    if (sites3->getSequence(i).getContent() != sites3Mt->getSequence(i).getContent())
+      return 1;
+    if (sites3->getSequence(i).getContent() != sites3Other->getSequence(i).getContent())
+      sameAsOther = false;
+  }
+  if (sameAsOther)
+    return 1;
+
+  //Simulating by chunks must give the same sequences:
+  SimulatedSiteChunks chunks(simulatorMt, n, 42, 3000);
+  vector< vector<int> > chunkedContent(seqNames.size());
+  SiteContainer* chunk;
+  while ((chunk = chunks.nextChunk()) != 0) {
+    for (size_t i = 0; i < seqNames.size(); ++i) {
+      const vector<int>& content = chunk->getSequence(i).getContent();
+      chunkedContent[i].insert(chunkedContent[i].end(), content.begin(), content.end());
+    }
+    delete chunk;
+  }
+  for (size_t i = 0; i < seqNames.size(); ++i) {
+    if (chunkedContent[i] != sites3->getSequence(i).getContent())
+      return 1;
+  }
+  stringstream phylip;
+  chunks.writePhylip(phylip);
+  string line;
+  getline(phylip, line);
+  if (line != TextTools::toString(seqNames.size()) + " " + TextTools::toString(n))
+    return 1;
+  getline(phylip, line);
+  if (line.substr(line.size() - chunks.getChunkSize()) != sites3->getSequence(0).toString().substr(0, chunks.getChunkSize()))
+    return 1;
+
+  //Now fit model:
+  SubstitutionModelSet* modelSet4 = modelSet->clone();
+  RNonHomogeneousTreeLikelihood tl3(*tree, *sites3, modelSet4, rdist);
+  tl3.initialize();
+
+  OptimizationTools::optimizeNumericalParameters2(
+      &tl3, tl3.getParameters(), 0,
+      0.0001, 10000, messenger, profiler, false, false, 1, OptimizationTools::OPTIMIZATION_NEWTON);
+
+  //Now compare estimated values to real ones:
+  for (size_t i = 0; i < thetas.size(); ++i) {
+    cout << thetas[i] << "\t" << modelSet4->getModel(i)->getParameter("theta").getValue() << endl;
+    double diff = abs(thetas[i] - modelSet4->getModel(i)->getParameter("theta").getValue());
+    if (diff > 0.1)
+      return 1;
+  }
+  delete modelSet4;
+
+  //Now check that state samplers draw the same states as a linear scan:
+
+  cout << "Sampler check:" << endl;
+
+  for (size_t nbStates = 2; nbStates <= 64; nbStates *= 2) {
+    vector<double> probs(nbStates);
+    double sum = 0;
+    for (size_t x = 0; x < nbStates; ++x) {
+      //Some states have a null probability:
+      probs[x] = (x % 3 == 1) ? 0. : RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+      sum += probs[x];
+    }
+    vector<double> cumprobs(nbStates);
+    double cumprob = 0;
+    for (size_t x = 0; x < nbStates; ++x) {
+      cumprob += probs[x] / sum;
+      cumprobs[x] = cumprob;
+    }
+    StateSampler sampler(cumprobs);
+    for (unsigned int k = 0; k < 10000; ++k) {
+      double r = k < 5000 ? (k + 0.5) / 5000. : RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+      size_t y = 0;
+      while (y < nbStates - 1 && r >= cumprobs[y]) y++;
+      while (probs[y] == 0) y--; //Rounding errors at the end of the distribution.
+      if (sampler.draw(r) != y) {
+        cerr << "Sampler error for " << nbStates << " states and r = " << r << endl;
+        return 1;
+      }
+    }
+  }
+
   //-------------
   delete tree;
   delete alphabet;
@@ -0,0 +1,102 @@
+//
+// File: test_site_patterns.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/SiteTools.h>
+#include <Bpp/Seq/Io/Phylip.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/SitePatterns.h>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+bool checkPatterns(const SiteContainer& sites, const SitePatterns& patterns) {
+  auto_ptr<SiteContainer> uniqueSites(patterns.getSites());
+  const vector<unsigned int>& weights = patterns.getWeights();
+  const vector<size_t>& indices = patterns.getIndices();
+  //Patterns must be unique and sorted:
+  for (size_t i = 1; i < uniqueSites->getNumberOfSites(); i++) {
+    if (!(uniqueSites->getSite(i - 1).toString() < uniqueSites->getSite(i).toString())) {
+      cerr << "Patterns " << i - 1 << " and " << i << " are not sorted." << endl;
+      return false;
+    }
+  }
+  //Each site must match its pattern:
+  vector<unsigned int> counts(weights.size(), 0);
+  for (size_t i = 0; i < sites.getNumberOfSites(); i++) {
+    if (!SiteTools::areSitesIdentical(sites.getSite(i), uniqueSites->getSite(indices[i]))) {
+      cerr << "Site " << i << " does not match its pattern." << endl;
+      return false;
+    }
+    counts[indices[i]]++;
+  }
+  return counts == weights;
+}
+
+int main() {
+  Phylip alnReader(false, false);
+  auto_ptr<SiteContainer> sites(alnReader.readAlignment("example1.ph", &AlphabetTools::DNA_ALPHABET));
+
+  SitePatterns patterns(sites.get());
+  cout << sites->getNumberOfSites() << " sites, " << patterns.getWeights().size() << " patterns." << endl;
+  if (!checkPatterns(*sites, patterns)) return 1;
+
+  //Chunked compression must give the same result:
+  SitePatterns patternsMt(sites.get(), false, 4);
+  if (patternsMt.getWeights() != patterns.getWeights()) return 1;
+  if (patternsMt.getIndices() != patterns.getIndices()) return 1;
+
+  //Sites read in several blocks must give the same patterns:
+  VectorSiteContainer repeated(sites->getSequencesNames(), sites->getAlphabet());
+  size_t nbCopies = 2 * SitePatterns::BLOCK_SIZE / sites->getNumberOfSites() + 2;
+  for (size_t k = 0; k < nbCopies; k++) {
+    for (size_t i = 0; i < sites->getNumberOfSites(); i++) {
+      repeated.addSite(sites->getSite(i), false);
+    }
+  }
+  SitePatterns patternsRep(&repeated, false, 4);
+  if (!checkPatterns(repeated, patternsRep)) return 1;
+  if (patternsRep.getWeights().size() != patterns.getWeights().size()) return 1;
+  for (size_t p = 0; p < patterns.getWeights().size(); p++) {
+    if (patternsRep.getWeights()[p] != nbCopies * patterns.getWeights()[p]) return 1;
+  }
+
+  return 0;
+}
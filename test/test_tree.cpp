@@ -39,10 +39,15 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include <Bpp/Phyl/TreeTemplate.h>
 #include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/SplitCounter.h>
 #include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Io/NewickParser.h>
+#include <Bpp/Phyl/Io/NewickBatchReader.h>
 #include <string>
 #include <vector>
 #include <iostream>
+#include <fstream>
+#include <memory>
 
 using namespace bpp;
 using namespace std;
@@ -156,6 +161,73 @@ int main() {
   }
   cout << "Newick multiple I/O ok." << endl;
 
+  //Read the same trees by batches, in parallel, and in compact form:
+  NewickBatchReader batchReader(30);
+  batchReader.setNumberOfThreads(4);
+  ifstream batchIn("tmp_trees.dnd");
+  vector<Tree*> trees3;
+  while (batchReader.read(batchIn, trees3) > 0) {}
+  batchIn.close();
+  ifstream compactIn("tmp_trees.dnd");
+  vector<CompactTree> compactTrees;
+  size_t nbCompactTrees = 0;
+  size_t nbBatch;
+  auto_ptr<SplitCounter> compactCounter;
+  while ((nbBatch = batchReader.read(compactIn, compactTrees)) > 0) {
+    if (!compactCounter.get())
+      compactCounter.reset(new SplitCounter(batchReader.getLeavesNames()));
+    for (size_t i = 0; i < nbBatch; ++i) {
+      compactCounter->addTree(compactTrees[i]);
+      auto_ptr<TreeTemplate<Node> > compactTree(compactTrees[i].toTree(batchReader.getLeavesNames()));
+      if (!TreeTools::haveSameTopology(*trees[nbCompactTrees + i], *compactTree)) {
+        cerr << "Tree " << nbCompactTrees + i << " failed to read in compact form!" << endl;
+        return 1;
+      }
+    }
+    nbCompactTrees += nbBatch;
+  }
+  if (trees3.size() != 100 || nbCompactTrees != 100)
+    return 1;
+  for (unsigned int i = 0; i < 100; ++i) {
+    if (!TreeTools::haveSameTopology(*trees[i], *trees3[i]))
+    {
+      cerr << "Tree " << i << " failed to read by batch!" << endl;
+      return 1;
+    }
+    delete trees3[i];
+  }
+  cout << "Newick batch reading ok." << endl;
+
+  //Split occurrences must not depend on the tree representation:
+  SplitCounter counter;
+  counter.addTrees(trees);
+  if (counter.getNumberOfTrees() != 100 || compactCounter->getNumberOfSplits() != counter.getNumberOfSplits())
+    return 1;
+  for (size_t i = 0; i < counter.getNumberOfSplits(); ++i) {
+    if (compactCounter->getCount(counter.getSplit(i)) != counter.getCount(i))
+      return 1;
+  }
+
+  //A topology found in a majority of trees is the majority consensus, and has bootstrap support >= 60:
+  vector<Tree*> sample(trees.begin(), trees.begin() + 40);
+  sample.insert(sample.end(), 60, tree10);
+  auto_ptr<TreeTemplate<Node> > consensus(TreeTools::majorityConsensus(sample));
+  if (!TreeTools::haveSameTopology(*tree10, *consensus))
+    return 1;
+  TreeTools::computeBootstrapValues(*tree10, sample, false);
+  vector<Node*> innerNodes = tree10->getInnerNodes();
+  size_t nbSupported = 0;
+  for (size_t i = 0; i < innerNodes.size(); ++i) {
+    if (!innerNodes[i]->hasBranchProperty(TreeTools::BOOTSTRAP))
+      continue;
+    if (dynamic_cast<Number<double>*>(innerNodes[i]->getBranchProperty(TreeTools::BOOTSTRAP))->getValue() < 60.)
+      return 1;
+    nbSupported++;
+  }
+  if (nbSupported < leaves.size() - 3)
+    return 1;
+  cout << "Consensus and bootstrap values ok." << endl;
+
   for (unsigned int i = 0; i < 100; ++i) {
     delete trees[i];
     delete trees2[i];
@@ -249,6 +321,42 @@ int main() {
   }
   cout << TreeTemplateTools::treeToParenthesis(*weird6) << endl;
   delete weird6;
+
+  //Trees spanning several lines, with comments, read one after the other from a buffer:
+  cout << "Testing the parser on a buffer:" << endl;
+  string buffer = "((A:1,B:2)80:3,\n C:4[comment]);\n(D,\n(E,F)50);\n";
+  NewickParser parser(true);
+  const char* pos = buffer.data();
+  TreeTemplate<Node>* tree11 = parser.parse(pos, buffer.data() + buffer.size());
+  TreeTemplate<Node>* tree12 = parser.parse(pos, buffer.data() + buffer.size());
+  if (!tree11 || !tree12 || parser.parse(pos, buffer.data() + buffer.size())) {
+    cout << "Error, two trees should have been read!" << endl;
+    return 1;
+  }
+  cout << TreeTemplateTools::treeToParenthesis(*tree11) << endl;
+  cout << TreeTemplateTools::treeToParenthesis(*tree12) << endl;
+  if (tree11->getLeavesNames()[2] != "C" || tree11->getNode("C")->getDistanceToFather() != 4.
+      || dynamic_cast<Number<double>*>(tree12->getRootNode()->getSon(1)->getBranchProperty(TreeTools::BOOTSTRAP))->getValue() != 50.) {
+    cout << "Error, bad tree content!" << endl;
+    return 1;
+  }
+  delete tree11;
+  delete tree12;
+
+  //A deep caterpillar tree:
+  cout << "Testing a caterpillar tree:" << endl;
+  size_t depth = 20000;
+  string caterpillar(depth, '(');
+  caterpillar += "A:1";
+  for (size_t i = 0; i < depth; ++i)
+    caterpillar += ",L" + TextTools::toString(i) + ":1):1";
+  caterpillar += ";";
+  TreeTemplate<Node>* tree13 = TreeTemplateTools::parenthesisToTree(caterpillar, true, TreeTools::BOOTSTRAP, false, false);
+  if (tree13->getNumberOfLeaves() != depth + 1) {
+    cout << "Error, tree has " << tree13->getNumberOfLeaves() << " leaves instead of " << depth + 1 << "!" << endl;
+    return 1;
+  }
+  delete tree13;
  
   return 0;
 }